@@ -0,0 +1,210 @@
+/*
+ * Batch32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Batched lookup benchmark.
+ * Fills Robin32 and Swiss32 with n keys, then times random lookups one
+ * at a time and through the prefetching batch functions at several
+ * batch sizes.  Make n large enough that the map, its entries and the
+ * keys are well beyond the last-level cache to see the DRAM latency
+ * that batching hides.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Allow batches up to this size; callers pick smaller ones with n */
+#define ROBIN32_BATCH 64
+#define SWISS32_BATCH 64
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "robin32.h"
+#include "swiss32.h"
+
+#define MAX_BATCHES 16
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static double time_robin32(const struct robin32 *m, const void **q, const size_t *ql,
+                           const size_t nq, const size_t batch,
+                           struct robin32_entry **out) {
+    const uint64_t start = bench32_now();
+    size_t found = 0;
+
+    if (batch == 0) {
+        for (size_t i = 0; i < nq; i++) {
+            found += Robin32_find(m, q[i], ql[i]) != NULL;
+        }
+    } else {
+        for (size_t i = 0; i < nq; i += batch) {
+            const size_t b = nq - i < batch ? nq - i : batch;
+
+            Robin32_find_batch(m, q + i, ql + i, b, out);
+            for (size_t j = 0; j < b; j++) {
+                found += out[j] != NULL;
+            }
+        }
+    }
+    bench32_sink += (uint32_t)found;
+    return (double)(bench32_now() - start) / (double)nq;
+}
+
+static double time_swiss32(const struct swiss32 *m, const void **q, const size_t *ql,
+                           const size_t nq, const size_t batch,
+                           struct swiss32_slot **out) {
+    const uint64_t start = bench32_now();
+    size_t found = 0;
+
+    if (batch == 0) {
+        for (size_t i = 0; i < nq; i++) {
+            found += Swiss32_find(m, q[i], ql[i]) != NULL;
+        }
+    } else {
+        for (size_t i = 0; i < nq; i += batch) {
+            const size_t b = nq - i < batch ? nq - i : batch;
+
+            Swiss32_find_batch(m, q + i, ql + i, b, out);
+            for (size_t j = 0; j < b; j++) {
+                found += out[j] != NULL;
+            }
+        }
+    }
+    bench32_sink += (uint32_t)found;
+    return (double)(bench32_now() - start) / (double)nq;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-l key_len] [-q lookups] [-u miss_percent]\n"
+                    "          [-b batch]...\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t nkeys = (size_t)8 << 20;
+    size_t key_len = 16;
+    size_t nq = (size_t)4 << 20;
+    unsigned int miss_percent = 0;
+    size_t batches[MAX_BATCHES];
+    int nbatches = 0;
+    struct Xorshift128p_state state = Xorshift128p_init(17);
+    struct robin32 robin;
+    struct swiss32 swiss;
+    struct robin32_entry *rout[ROBIN32_BATCH];
+    struct swiss32_slot *sout[SWISS32_BATCH];
+    uint8_t *keys;
+    const void **q;
+    size_t *ql;
+    double robin_one, swiss_one;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:q:u:b:")) != -1) {
+        switch (opt) {
+            case 'n': nkeys = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'l': key_len = (size_t)strtoul(optarg, NULL, 10); break;
+            case 'q': nq = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'u': miss_percent = (unsigned int)atoi(optarg); break;
+            case 'b':
+                if (nbatches == MAX_BATCHES) {
+                    usage(argv[0]);
+                }
+                batches[nbatches] = (size_t)strtoul(optarg, NULL, 10);
+                if (batches[nbatches] == 0 || batches[nbatches] > ROBIN32_BATCH) {
+                    usage(argv[0]);
+                }
+                nbatches++;
+                break;
+            default: usage(argv[0]);
+        }
+    }
+    if (nkeys == 0 || key_len < 8 || nq == 0 || miss_percent > 100) {
+        usage(argv[0]);
+    }
+    if (nbatches == 0) {
+        for (size_t b = 1; b <= ROBIN32_BATCH; b *= 2) {
+            batches[nbatches++] = b;
+        }
+    }
+
+    /* Twice as many keys as are inserted; the second half are misses.
+     * Each key ends with its index, so they are all different.
+     */
+    keys = malloc(nkeys * 2 * key_len);
+    q = malloc(nq * sizeof(*q));
+    ql = malloc(nq * sizeof(*ql));
+    if (keys == NULL || q == NULL || ql == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(keys, nkeys * 2 * key_len, 19);
+    for (size_t i = 0; i < nkeys * 2; i++) {
+        const uint64_t index = i;
+
+        memcpy(keys + i * key_len + key_len - 8, &index, 8);
+    }
+
+    Mult32_init();
+    if (Robin32_init(&robin, nkeys, 0, seed) != 0 ||
+        Swiss32_init(&swiss, nkeys, seed) != 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < nkeys; i++) {
+        const void *key = keys + i * key_len;
+        const uint32_t hash = Combo32(key, key_len, seed);
+        int inserted;
+
+        if (Robin32_insert_hash(&robin, key, key_len, hash, &inserted) == NULL ||
+            Swiss32_insert_hash(&swiss, key, key_len, hash, &inserted) == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < nq; i++) {
+        const uint64_t r = Xorshift128p(&state);
+        const size_t k = (size_t)(r % nkeys) +
+                         ((r >> 48) % 100 < miss_percent ? nkeys : 0);
+
+        q[i] = keys + k * key_len;
+        ql[i] = key_len;
+    }
+
+    printf("# %zu keys of %zu bytes, %zu lookups, %u%% missing; ns per lookup\n",
+           nkeys, key_len, nq, miss_percent);
+    printf("%-8s %10s %10s %10s %10s\n", "batch", "Robin32", "speedup", "Swiss32", "speedup");
+    robin_one = time_robin32(&robin, q, ql, nq, 0, rout);
+    swiss_one = time_swiss32(&swiss, q, ql, nq, 0, sout);
+    printf("%-8s %10.2f %10.2f %10.2f %10.2f\n", "single", robin_one, 1.0, swiss_one, 1.0);
+    for (int i = 0; i < nbatches; i++) {
+        const double r = time_robin32(&robin, q, ql, nq, batches[i], rout);
+        const double s = time_swiss32(&swiss, q, ql, nq, batches[i], sout);
+
+        printf("%-8zu %10.2f %10.2f %10.2f %10.2f\n", batches[i],
+               r, robin_one / r, s, swiss_one / s);
+        fflush(stdout);
+    }
+
+    Robin32_free(&robin);
+    Swiss32_free(&swiss);
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Bench32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Common helpers shared by the benchmark programs in this directory:
+ * a monotonic clock, a table of the hashers under test, and a
+ * reproducible random buffer filler.
+ */
+
+#ifndef BENCH32_H
+#define BENCH32_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "combo32.h"
+
+/*------------------------------------------------------------ */
+
+/* Every hasher in this repository has the same signature */
+typedef uint32_t (*bench32_hash_fn)(const void *, const size_t, const uint64_t);
+
+struct bench32_hasher {
+    const char *name;
+    bench32_hash_fn fn;
+};
+
+/* Mult32_impl skips the oneTimeDone test in Mult32, so comparing the two
+ * shows what that test costs.  Mult32_init() must have been called first.
+ */
+static uint32_t bench32_mult32_impl(const void *in, const size_t len, const uint64_t seed) {
+    return Mult32_impl(in, len, seed);
+}
+
+static const struct bench32_hasher bench32_hashers[] = {
+    { "Komi32",      Komi32 },
+    { "Mult32",      Mult32 },
+    { "Mult32_impl", bench32_mult32_impl },
+    { "Combo32",     Combo32 },
+};
+
+#define BENCH32_NUM_HASHERS \
+    (sizeof(bench32_hashers) / sizeof(bench32_hashers[0]))
+
+/* Look up a hasher by name, returns NULL if there isn't one */
+static inline const struct bench32_hasher *bench32_find_hasher(const char *name) {
+    for (unsigned int i = 0; i < BENCH32_NUM_HASHERS; i++) {
+        if (strcmp(bench32_hashers[i].name, name) == 0) {
+            return &bench32_hashers[i];
+        }
+    }
+    return NULL;
+}
+
+/*------------------------------------------------------------ */
+
+/* Nanoseconds from an arbitrary starting point */
+static inline uint64_t bench32_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+/* Fill a buffer with reproducible random bytes */
+static inline void bench32_fill(void *buf, const size_t len, const uint64_t seed) {
+    struct Xorshift128p_state state = Xorshift128p_init(seed);
+    uint8_t *p = (uint8_t *)buf;
+    size_t i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        const uint64_t r = Xorshift128p(&state);
+
+        memcpy(p + i, &r, 8);
+    }
+    if (i < len) {
+        const uint64_t r = Xorshift128p(&state);
+
+        memcpy(p + i, &r, len - i);
+    }
+}
+
+/* Keep the compiler from throwing away hash results */
+static volatile uint32_t bench32_sink;
+
+#endif /* BENCH32_H */
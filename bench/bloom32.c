@@ -0,0 +1,150 @@
+/*
+ * Bloom32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Blocked Bloom filter benchmark.
+ * For each number of bits per key, adds n keys to a Bloom32 filter and
+ * queries n keys that were never added, then prints the measured false
+ * positive rate next to the one Bloom32_expected_fpr predicts and the
+ * one of a classic Bloom filter with the same bits and 8 hashes, and
+ * the time per key of one-at-a-time and batch adds and queries.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "bloom32.h"
+
+#define KEY_LEN 16
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-b bits_per_key]...\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    double bits[16] = { 8.0, 10.0, 12.0, 16.0 };
+    unsigned int nbits = 4, given = 0;
+    size_t n = 10000000;
+    uint8_t *keys, *out;
+    const void **kp;
+    size_t *lens;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:b:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'b':
+                if (given == sizeof(bits) / sizeof(bits[0])) {
+                    usage(argv[0]);
+                }
+                bits[given++] = atof(optarg);
+                nbits = given;
+                break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0) {
+        usage(argv[0]);
+    }
+    /* The first n keys are added, the other n are not */
+    keys = malloc(2 * n * KEY_LEN);
+    kp = malloc(2 * n * sizeof(*kp));
+    lens = malloc(2 * n * sizeof(*lens));
+    out = malloc(n);
+    if (keys == NULL || kp == NULL || lens == NULL || out == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(keys, 2 * n * KEY_LEN, 53);
+    /* Number the keys so that none repeats */
+    for (size_t i = 0; i < 2 * n; i++) {
+        memcpy(keys + i * KEY_LEN, &i, sizeof(i));
+        kp[i] = keys + i * KEY_LEN;
+        lens[i] = KEY_LEN;
+    }
+    Mult32_init();
+
+    printf("# %zu keys of %d bytes; fpr in %%, time in ns per key\n", n, KEY_LEN);
+    printf("%6s %10s %10s %10s %8s %8s %8s %8s\n", "bits", "measured", "expected",
+           "classic", "add", "add/b", "query", "query/b");
+    for (unsigned int b = 0; b < nbits; b++) {
+        struct bloom32 f;
+        uint64_t start, t_add, t_add_batch, t_query, t_query_batch;
+        size_t positives = 0, batch_positives;
+        double classic;
+
+        if (bits[b] <= 0.0 || Bloom32_init(&f, n, bits[b], seed) != 0) {
+            usage(argv[0]);
+        }
+        start = bench32_now();
+        for (size_t i = 0; i < n; i++) {
+            Bloom32_add(&f, kp[i], KEY_LEN);
+        }
+        t_add = bench32_now() - start;
+
+        Bloom32_clear(&f);
+        start = bench32_now();
+        Bloom32_add_batch(&f, kp, lens, n);
+        t_add_batch = bench32_now() - start;
+
+        for (size_t i = 0; i < n; i++) {
+            if (!Bloom32_contains(&f, kp[i], KEY_LEN)) {
+                fprintf(stderr, "key %zu was added but is missing\n", i);
+                return 1;
+            }
+        }
+
+        start = bench32_now();
+        for (size_t i = n; i < 2 * n; i++) {
+            positives += (size_t)Bloom32_contains(&f, kp[i], KEY_LEN);
+        }
+        t_query = bench32_now() - start;
+
+        start = bench32_now();
+        batch_positives = Bloom32_contains_batch(&f, kp + n, lens + n, n, out);
+        t_query_batch = bench32_now() - start;
+        if (batch_positives != positives) {
+            fprintf(stderr, "batch queries disagree\n");
+            return 1;
+        }
+
+        classic = pow(1.0 - exp(-(double)BLOOM32_K * (double)n /
+                                (8.0 * (double)Bloom32_bytes(&f))), BLOOM32_K);
+        printf("%6.1f %10.4f %10.4f %10.4f %8.1f %8.1f %8.1f %8.1f\n", bits[b],
+               100.0 * (double)positives / (double)n, 100.0 * Bloom32_expected_fpr(&f, n),
+               100.0 * classic, (double)t_add / (double)n, (double)t_add_batch / (double)n,
+               (double)t_query / (double)n, (double)t_query_batch / (double)n);
+        Bloom32_free(&f);
+    }
+
+    free(keys);
+    free(kp);
+    free(lens);
+    free(out);
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * Cfilter32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Cuckoo filter benchmark.
+ * Inserts n keys into a Cfilter32 filter, queries n keys that were never
+ * inserted, and erases half of the inserted ones, then does the same
+ * with a counting Bloom filter of 4-bit counters sized for the false
+ * positive rate the cuckoo filter reached.  Prints the bits per key,
+ * the false positive rate, and the time per key of each operation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "cfilter32.h"
+
+#define KEY_LEN 16
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+/* A counting Bloom filter with saturating 4-bit counters, two to a
+ * byte, and k indexes from the two halves of Combo32x2 by double hashing
+ */
+struct counting {
+    uint8_t *counters;
+    uint64_t m;
+    unsigned int k;
+};
+
+static inline uint64_t counting_index(const struct counting *c, const uint32_t h1,
+                                      const uint32_t h2, const unsigned int i) {
+    const uint32_t h = h1 + i * h2;
+
+    return ((uint64_t)h * c->m) >> 32;
+}
+
+static inline unsigned int counting_get(const struct counting *c, const uint64_t x) {
+    return (c->counters[x >> 1] >> ((x & 1) * 4)) & 15;
+}
+
+static inline void counting_add(struct counting *c, const uint64_t x, const int delta) {
+    const unsigned int v = counting_get(c, x);
+    const unsigned int s = (unsigned int)(x & 1) * 4;
+
+    /* A saturated counter stays put, so it never undercounts */
+    if (v == 15 || (delta < 0 && v == 0)) {
+        return;
+    }
+    c->counters[x >> 1] = (uint8_t)((c->counters[x >> 1] & ~(15u << s)) |
+                                    (unsigned int)((int)v + delta) << s);
+}
+
+static void counting_update(struct counting *c, const void *key, const int delta) {
+    uint32_t h1, h2;
+
+    Combo32x2(key, KEY_LEN, seed, &h1, &h2);
+    for (unsigned int i = 0; i < c->k; i++) {
+        counting_add(c, counting_index(c, h1, h2, i), delta);
+    }
+}
+
+static int counting_contains(const struct counting *c, const void *key) {
+    uint32_t h1, h2;
+
+    Combo32x2(key, KEY_LEN, seed, &h1, &h2);
+    for (unsigned int i = 0; i < c->k; i++) {
+        if (counting_get(c, counting_index(c, h1, h2, i)) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*------------------------------------------------------------ */
+
+static void report(const char *name, const double bits, const size_t positives, const size_t n,
+                   const uint64_t t_insert, const uint64_t t_query, const uint64_t t_erase) {
+    printf("%-10s %10.2f %10.4f %8.1f %8.1f %8.1f\n", name, bits,
+           100.0 * (double)positives / (double)n, (double)t_insert / (double)n,
+           (double)t_query / (double)n, (double)t_erase / (double)(n / 2));
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 10000000;
+    uint8_t *keys;
+    double fpr;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n < 2) {
+        usage(argv[0]);
+    }
+    /* The first n keys are inserted, the other n are not */
+    keys = malloc(2 * n * KEY_LEN);
+    if (keys == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(keys, 2 * n * KEY_LEN, 59);
+    /* Number the keys so that none repeats */
+    for (size_t i = 0; i < 2 * n; i++) {
+        memcpy(keys + i * KEY_LEN, &i, sizeof(i));
+    }
+    Mult32_init();
+
+    printf("# %zu keys of %d bytes, %d-bit fingerprints; fpr in %%, time in ns per key\n",
+           n, KEY_LEN, CFILTER32_BITS);
+    printf("%-10s %10s %10s %8s %8s %8s\n", "filter", "bits/key", "fpr", "insert", "query",
+           "erase");
+    {
+        struct cfilter32 f;
+        uint64_t start, t_insert, t_query, t_erase;
+        size_t positives = 0;
+
+        if (Cfilter32_init(&f, n, seed) != 0) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        start = bench32_now();
+        for (size_t i = 0; i < n; i++) {
+            if (Cfilter32_insert(&f, keys + i * KEY_LEN, KEY_LEN) != 0) {
+                fprintf(stderr, "filter full at %zu keys\n", i);
+                return 1;
+            }
+        }
+        t_insert = bench32_now() - start;
+        start = bench32_now();
+        for (size_t i = n; i < 2 * n; i++) {
+            positives += (size_t)Cfilter32_contains(&f, keys + i * KEY_LEN, KEY_LEN);
+        }
+        t_query = bench32_now() - start;
+        start = bench32_now();
+        for (size_t i = 0; i < n; i += 2) {
+            Cfilter32_erase(&f, keys + i * KEY_LEN, KEY_LEN);
+        }
+        t_erase = bench32_now() - start;
+        for (size_t i = 1; i < n; i += 2) {
+            if (!Cfilter32_contains(&f, keys + i * KEY_LEN, KEY_LEN)) {
+                fprintf(stderr, "key %zu is missing\n", i);
+                return 1;
+            }
+        }
+        report("Cfilter32", 8.0 * (double)Cfilter32_bytes(&f) / (double)n, positives, n,
+               t_insert, t_query, t_erase);
+        fpr = (double)(positives + 1) / (double)n;
+        Cfilter32_free(&f);
+    }
+    {
+        struct counting c;
+        uint64_t start, t_insert, t_query, t_erase;
+        size_t positives = 0;
+
+        c.m = (uint64_t)(-(double)n * log(fpr) / (log(2.0) * log(2.0))) + 2;
+        c.k = (unsigned int)((double)c.m / (double)n * log(2.0) + 0.5);
+        c.k = c.k == 0 ? 1 : c.k;
+        c.counters = calloc((size_t)(c.m + 1) / 2, 1);
+        if (c.counters == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        start = bench32_now();
+        for (size_t i = 0; i < n; i++) {
+            counting_update(&c, keys + i * KEY_LEN, 1);
+        }
+        t_insert = bench32_now() - start;
+        start = bench32_now();
+        for (size_t i = n; i < 2 * n; i++) {
+            positives += (size_t)counting_contains(&c, keys + i * KEY_LEN);
+        }
+        t_query = bench32_now() - start;
+        start = bench32_now();
+        for (size_t i = 0; i < n; i += 2) {
+            counting_update(&c, keys + i * KEY_LEN, -1);
+        }
+        t_erase = bench32_now() - start;
+        report("counting", 4.0 * (double)c.m / (double)n, positives, n,
+               t_insert, t_query, t_erase);
+        free(c.counters);
+    }
+
+    free(keys);
+    return 0;
+}
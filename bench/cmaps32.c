@@ -0,0 +1,294 @@
+/*
+ * Cmaps32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Concurrent map benchmark.
+ * Fills a map with n keys, then runs 1 to N threads, each pinned to its
+ * own CPU, doing random lookups of present keys mixed with writes that
+ * erase a key and insert it again, so the size stays constant.
+ * Compares Cmap32 with Robin32 split into shards behind a mutex each,
+ * and reports aggregate operations per second and the scaling efficiency
+ * relative to one thread.
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "cmap32.h"
+#include "robin32.h"
+
+#define KEY_LEN 16
+#define NUM_SHARDS 64
+
+static const uint64_t seed = 0x5EED;
+
+/* Per-thread state, padded so that threads never share a cache line */
+struct thread_state {
+    int cpu;
+    unsigned int id;
+    uint64_t ops;
+    uint64_t ns;
+    uint64_t found;
+    uint8_t pad[64];
+};
+
+struct shard {
+    pthread_mutex_t lock;
+    struct robin32 map;
+    uint8_t pad[64];
+};
+
+static uint8_t *keys;
+static size_t nkeys;
+static unsigned int write_per_mille;
+static int use_cmap;
+static struct cmap32 cmap;
+static struct shard shards[NUM_SHARDS];
+static atomic_int stop_flag;
+static pthread_barrier_t start_barrier;
+
+/*------------------------------------------------------------ */
+
+/* Shards are picked with the low bits of the hash, slots with the high */
+static struct shard *shard_of(const uint32_t hash) {
+    return &shards[hash % NUM_SHARDS];
+}
+
+static int sharded_find(const void *key) {
+    const uint32_t hash = Combo32(key, KEY_LEN, seed);
+    struct shard *s = shard_of(hash);
+    int found;
+
+    pthread_mutex_lock(&s->lock);
+    found = Robin32_find_hash(&s->map, key, KEY_LEN, hash) != NULL;
+    pthread_mutex_unlock(&s->lock);
+    return found;
+}
+
+static void sharded_rewrite(const void *key) {
+    const uint32_t hash = Combo32(key, KEY_LEN, seed);
+    struct shard *s = shard_of(hash);
+    int inserted;
+
+    pthread_mutex_lock(&s->lock);
+    Robin32_erase(&s->map, key, KEY_LEN);
+    Robin32_insert_hash(&s->map, key, KEY_LEN, hash, &inserted);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/*------------------------------------------------------------ */
+
+static void *worker(void *arg) {
+    struct thread_state *ts = (struct thread_state *)arg;
+    struct Xorshift128p_state state = Xorshift128p_init(ts->id + 1);
+    struct cmap32_thread *th = NULL;
+    uint64_t ops = 0;
+    uint64_t found = 0;
+    uint64_t start;
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(ts->cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (use_cmap) {
+        th = Cmap32_attach(&cmap);
+    }
+
+    pthread_barrier_wait(&start_barrier);
+    start = bench32_now();
+    while (likely(!atomic_load_explicit(&stop_flag, memory_order_relaxed))) {
+        for (int i = 0; i < 256; i++) {
+            const uint64_t r = Xorshift128p(&state);
+            const uint8_t *key = keys + (r % nkeys) * KEY_LEN;
+            const int write = (r >> 40) % 1000 < write_per_mille;
+
+            if (use_cmap) {
+                Cmap32_enter(th);
+                if (unlikely(write)) {
+                    int inserted;
+
+                    Cmap32_erase(th, key, KEY_LEN);
+                    Cmap32_insert(th, key, KEY_LEN, NULL, &inserted);
+                } else {
+                    found += Cmap32_find(th, key, KEY_LEN) != NULL;
+                }
+                Cmap32_leave(th);
+            } else if (unlikely(write)) {
+                sharded_rewrite(key);
+            } else {
+                found += sharded_find(key);
+            }
+        }
+        ops += 256;
+    }
+    ts->ns = bench32_now() - start;
+    ts->ops = ops;
+    ts->found = found;
+    if (use_cmap) {
+        Cmap32_detach(th);
+    }
+    return NULL;
+}
+
+/* Run one configuration and return aggregate operations per second */
+static double run(const char *name, const int *cpulist, const int nthreads,
+                  const unsigned int duration_ms) {
+    pthread_t tid[nthreads];
+    struct thread_state ts[nthreads];
+    double total = 0.0;
+
+    atomic_store(&stop_flag, 0);
+    pthread_barrier_init(&start_barrier, NULL, (unsigned int)nthreads + 1);
+    for (int t = 0; t < nthreads; t++) {
+        memset(&ts[t], 0, sizeof(ts[t]));
+        ts[t].cpu = cpulist[t];
+        ts[t].id = (unsigned int)t;
+        pthread_create(&tid[t], NULL, worker, &ts[t]);
+    }
+    pthread_barrier_wait(&start_barrier);
+    usleep(duration_ms * 1000);
+    atomic_store(&stop_flag, 1);
+    for (int t = 0; t < nthreads; t++) {
+        pthread_join(tid[t], NULL);
+        total += (double)ts[t].ops * 1e9 / (double)ts[t].ns;
+        bench32_sink += (uint32_t)ts[t].found;
+    }
+    pthread_barrier_destroy(&start_barrier);
+
+    printf("%-8s %4d %12.2f %10.2f", name, nthreads, total / 1e6,
+           total / nthreads / 1e6);
+    return total;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-t max_threads] [-n keys] [-w writes_per_mille]\n"
+                    "          [-d duration_ms]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = ncpu;
+    unsigned int duration_ms = 500;
+    cpu_set_t online;
+    int *cpulist;
+    int n = 0;
+    int opt;
+
+    nkeys = 1000000;
+    write_per_mille = 10;
+    while ((opt = getopt(argc, argv, "t:n:w:d:")) != -1) {
+        switch (opt) {
+            case 't': max_threads = atoi(optarg); break;
+            case 'n': nkeys = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'w': write_per_mille = (unsigned int)atoi(optarg); break;
+            case 'd': duration_ms = (unsigned int)atoi(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (max_threads < 1 || max_threads > CMAP32_MAX_THREADS || nkeys == 0 ||
+        write_per_mille > 1000) {
+        usage(argv[0]);
+    }
+
+    /* CPUs this process may run on, reused round-robin past the last one */
+    cpulist = malloc(sizeof(*cpulist) * (size_t)max_threads);
+    sched_getaffinity(0, sizeof(online), &online);
+    for (int cpu = 0; cpu < CPU_SETSIZE && n < max_threads; cpu++) {
+        if (CPU_ISSET(cpu, &online)) {
+            cpulist[n++] = cpu;
+        }
+    }
+    for (int t = n; t < max_threads; t++) {
+        cpulist[t] = cpulist[t % n];
+    }
+
+    /* Unique keys: 8 random bytes followed by the key's index */
+    keys = malloc(nkeys * KEY_LEN);
+    if (cpulist == NULL || keys == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(keys, nkeys * KEY_LEN, 13);
+    for (size_t i = 0; i < nkeys; i++) {
+        const uint64_t index = i;
+
+        memcpy(keys + i * KEY_LEN + 8, &index, 8);
+    }
+
+    Mult32_init();
+    if (Cmap32_init(&cmap, nkeys, seed) != 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        pthread_mutex_init(&shards[s].lock, NULL);
+        Robin32_init(&shards[s].map, nkeys / NUM_SHARDS + 1, 0, seed);
+    }
+    {
+        struct cmap32_thread *th = Cmap32_attach(&cmap);
+
+        Cmap32_enter(th);
+        for (size_t i = 0; i < nkeys; i++) {
+            const uint8_t *key = keys + i * KEY_LEN;
+            const uint32_t hash = Combo32(key, KEY_LEN, seed);
+            int inserted;
+
+            if (Cmap32_insert_hash(th, key, KEY_LEN, hash, NULL, &inserted) == NULL ||
+                Robin32_insert_hash(&shard_of(hash)->map, key, KEY_LEN, hash,
+                                    &inserted) == NULL) {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+        }
+        Cmap32_leave(th);
+        Cmap32_detach(th);
+    }
+
+    printf("# %zu keys, %u writes per 1000 operations, %d mutex shards\n",
+           nkeys, write_per_mille, NUM_SHARDS);
+    printf("%-8s %4s %12s %10s %10s\n",
+           "map", "thr", "Mops/s", "per-thr", "eff");
+    for (use_cmap = 1; use_cmap >= 0; use_cmap--) {
+        const char *name = use_cmap ? "Cmap32" : "sharded";
+        double base = 0.0;
+
+        for (int t = 1; t <= max_threads; t = (t < max_threads && t * 2 > max_threads)
+                                              ? max_threads : t * 2) {
+            const double rate = run(name, cpulist, t, duration_ms);
+
+            base = t == 1 ? rate : base;
+            printf(" %9.3f\n", rate / (base * t));
+            fflush(stdout);
+        }
+    }
+
+    Cmap32_free(&cmap);
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        Robin32_free(&shards[s].map);
+    }
+    return 0;
+}
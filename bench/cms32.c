@@ -0,0 +1,189 @@
+/*
+ * Cms32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Count-Min sketch benchmark.
+ * Feeds a stream of n keys, drawn from m distinct keys with roughly Zipf
+ * frequencies, to a sketch that hashes each key d times, once per row,
+ * and to Cms32, which hashes it once, with plain and conservative update,
+ * one key at a time and in batches.  Prints the time per update and the
+ * mean overcount of each kind of update over the distinct keys.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "cms32.h"
+
+#define KEY_LEN 16
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+/* A sketch that hashes the key again for every row */
+struct naive {
+    uint32_t *counters;
+    uint32_t width;
+    unsigned int depth;
+};
+
+static void naive_add(struct naive *f, const void *key, const size_t len) {
+    for (unsigned int i = 0; i < f->depth; i++) {
+        const uint32_t h = Combo32(key, len, seed + i);
+
+        f->counters[(size_t)i * f->width + (size_t)(((uint64_t)h * f->width) >> 32)]++;
+    }
+}
+
+static void fail(const char *what, const int err) {
+    fprintf(stderr, "%s failed: %d\n", what, err);
+    exit(1);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n updates] [-m distinct] [-w width] [-d depth]\n", prog);
+    exit(1);
+}
+
+/* Mean of estimate - count over the distinct keys, counting to the
+ * largest value a counter holds
+ */
+static double overcount(const struct cms32 *f, const uint8_t *keys, const uint32_t *exact,
+                        const size_t m) {
+    double sum = 0.0;
+
+    for (size_t i = 0; i < m; i++) {
+        const uint32_t count = exact[i] < CMS32_MAX ? exact[i] : (uint32_t)CMS32_MAX;
+
+        sum += (double)Cms32_estimate(f, keys + i * KEY_LEN, KEY_LEN) - (double)count;
+    }
+    return sum / (double)m;
+}
+
+int main(int argc, char **argv) {
+    size_t n = 20000000;
+    size_t m = 2000000;
+    uint32_t width = 1 << 20;
+    unsigned int depth = 4;
+    struct Xorshift128p_state state = Xorshift128p_init(61);
+    struct naive nv;
+    struct cms32 f;
+    const void **stream;
+    size_t *lens;
+    uint32_t *exact;
+    uint8_t *keys;
+    uint64_t start;
+    double plain = 0.0, conservative = 0.0;
+    int opt, err;
+
+    while ((opt = getopt(argc, argv, "n:m:w:d:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'm': m = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'w': width = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'd': depth = (unsigned int)strtoul(optarg, NULL, 10); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0 || m == 0) {
+        usage(argv[0]);
+    }
+    keys = malloc(m * KEY_LEN);
+    exact = calloc(m, sizeof(*exact));
+    stream = malloc(n * sizeof(*stream));
+    lens = malloc(n * sizeof(*lens));
+    nv.counters = calloc((size_t)width * depth, sizeof(*nv.counters));
+    if (keys == NULL || exact == NULL || stream == NULL || lens == NULL || nv.counters == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    nv.width = width;
+    nv.depth = depth;
+    bench32_fill(keys, m * KEY_LEN, 67);
+    /* Number the keys so that none repeats */
+    for (size_t i = 0; i < m; i++) {
+        memcpy(keys + i * KEY_LEN, &i, sizeof(i));
+    }
+    /* Key k - 1 with probability about 1 / (k ln m) */
+    for (size_t i = 0; i < n; i++) {
+        const double u = (double)(Xorshift128p(&state) >> 11) / 9007199254740992.0;
+        size_t k = (size_t)pow((double)m, u) - 1;
+
+        k = k < m ? k : m - 1;
+        exact[k]++;
+        stream[i] = keys + k * KEY_LEN;
+        lens[i] = KEY_LEN;
+    }
+    Mult32_init();
+    if ((err = Cms32_init(&f, width, depth, seed)) != 0) {
+        fail("Cms32_init", err);
+    }
+
+    printf("# %zu updates of %zu keys of %d bytes, %u x %u counters of %d bits\n",
+           n, m, KEY_LEN, depth, width, CMS32_BITS);
+    start = bench32_now();
+    for (size_t i = 0; i < n; i++) {
+        naive_add(&nv, stream[i], KEY_LEN);
+    }
+    printf("%-28s %12.1f ns\n", "d hashes", (double)(bench32_now() - start) / (double)n);
+
+    start = bench32_now();
+    for (size_t i = 0; i < n; i++) {
+        Cms32_add(&f, stream[i], KEY_LEN, 1);
+    }
+    printf("%-28s %12.1f ns\n", "Cms32 add", (double)(bench32_now() - start) / (double)n);
+    plain = overcount(&f, keys, exact, m);
+
+    Cms32_clear(&f);
+    start = bench32_now();
+    Cms32_add_batch(&f, stream, lens, NULL, n, 0);
+    printf("%-28s %12.1f ns\n", "Cms32 add batch", (double)(bench32_now() - start) / (double)n);
+
+    Cms32_clear(&f);
+    start = bench32_now();
+    for (size_t i = 0; i < n; i++) {
+        Cms32_add_conservative(&f, stream[i], KEY_LEN, 1);
+    }
+    printf("%-28s %12.1f ns\n", "Cms32 conservative",
+           (double)(bench32_now() - start) / (double)n);
+    conservative = overcount(&f, keys, exact, m);
+
+    Cms32_clear(&f);
+    start = bench32_now();
+    Cms32_add_batch(&f, stream, lens, NULL, n, 1);
+    printf("%-28s %12.1f ns\n", "Cms32 conservative batch",
+           (double)(bench32_now() - start) / (double)n);
+
+    printf("%-28s %12.2f\n", "mean overcount, plain", plain);
+    printf("%-28s %12.2f\n", "mean overcount, conservative", conservative);
+
+    Cms32_free(&f);
+    free(nv.counters);
+    free(keys);
+    free(exact);
+    free(stream);
+    free(lens);
+    return 0;
+}
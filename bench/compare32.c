@@ -0,0 +1,270 @@
+/*
+ * Compare32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Comparison benchmark against other portable 32-bit hashers.
+ * Times Komi32, Mult32 and Combo32 next to MurmurHash3_x86_32,
+ * xxHash32, FNV-1a and CRC32C (software, and SSE4.2 where the CPU has
+ * it) over a range of key lengths, in three shapes:
+ *   lat   each hash is seeded with the previous result, so the time is
+ *         the latency of one call
+ *   tput  independent keys of the same length, so the time is the
+ *         throughput of back-to-back calls
+ *   mix   independent keys with lengths spread from len/2 to 3len/2,
+ *         so that the tail handling is not perfectly predicted
+ * Everything is built from this directory; no network is needed.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "others32.h"
+
+#define MAX_HASHERS 16
+#define MAX_LENGTHS 32
+#define NUM_KEYS 4096
+#define BUFFER_SIZE (8 << 20)
+
+enum shape { SHAPE_LAT, SHAPE_TPUT, SHAPE_MIX, NUM_SHAPES };
+
+static const char * const shape_names[NUM_SHAPES] = { "lat", "tput", "mix" };
+
+/*------------------------------------------------------------ */
+
+/* Check the reference implementations against published values */
+static int self_check(void) {
+    static const struct {
+        bench32_hash_fn fn;
+        const char *name;
+        const char *msg;
+        uint32_t seed;
+        uint32_t expect;
+    } vectors[] = {
+        { Murmur3_32, "Murmur3_32", "",          0,          UINT32_C(0x00000000) },
+        { Murmur3_32, "Murmur3_32", "hello",     0,          UINT32_C(0x248BFA47) },
+        { XXH32,      "XXH32",      "",          0,          UINT32_C(0x02CC5D05) },
+        { XXH32,      "XXH32",      "a",         0,          UINT32_C(0x550D7456) },
+        { FNV1a_32,   "FNV1a_32",   "a",         0,          UINT32_C(0xE40C292C) },
+        { FNV1a_32,   "FNV1a_32",   "foobar",    0,          UINT32_C(0xBF9CF968) },
+        { CRC32C_sw,  "CRC32C_sw",  "123456789", 0,          UINT32_C(0xE3069283) },
+    };
+    int bad = 0;
+
+    for (unsigned int i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        const uint32_t h = vectors[i].fn(vectors[i].msg, strlen(vectors[i].msg),
+                                         vectors[i].seed);
+
+        if (h != vectors[i].expect) {
+            fprintf(stderr, "%s(\"%s\") = 0x%08X, expected 0x%08X\n",
+                    vectors[i].name, vectors[i].msg, h, vectors[i].expect);
+            bad = 1;
+        }
+    }
+#if defined(OTHERS32_HAS_SSE42)
+    if (CRC32C_hw_supported()) {
+        uint8_t buf[1000];
+
+        bench32_fill(buf, sizeof(buf), 3);
+        for (size_t len = 0; len < sizeof(buf); len += 37) {
+            if (CRC32C_hw(buf, len, len) != CRC32C_sw(buf, len, len)) {
+                fprintf(stderr, "CRC32C_hw and CRC32C_sw differ at length %zu\n", len);
+                bad = 1;
+            }
+        }
+    }
+#endif
+    return bad;
+}
+
+/*------------------------------------------------------------ */
+
+/* Nanoseconds per hash, best of three runs */
+static double time_shape(const bench32_hash_fn fn, const enum shape shape,
+                         const uint8_t *buf, const uint32_t *offsets,
+                         const uint32_t *lengths, const size_t len) {
+    /* About 4 MiB of input per run, and at least one pass over the keys */
+    const unsigned int iterations =
+        (unsigned int)(((size_t)4 << 20) / ((len + 16) * NUM_KEYS)) + 1;
+    uint64_t best = UINT64_MAX;
+    uint32_t h = 0;
+
+    for (int run = 0; run < 3; run++) {
+        const uint64_t start = bench32_now();
+        uint64_t ns;
+
+        for (unsigned int it = 0; it < iterations; it++) {
+            switch (shape) {
+                case SHAPE_LAT:
+                    for (unsigned int k = 0; k < NUM_KEYS; k++) {
+                        h = fn(buf, len, h);
+                    }
+                    break;
+                case SHAPE_TPUT:
+                    for (unsigned int k = 0; k < NUM_KEYS; k++) {
+                        h += fn(buf + offsets[k], len, k);
+                    }
+                    break;
+                default:
+                    for (unsigned int k = 0; k < NUM_KEYS; k++) {
+                        h += fn(buf + offsets[k], lengths[k], k);
+                    }
+                    break;
+            }
+        }
+        ns = bench32_now() - start;
+        best = ns < best ? ns : best;
+    }
+    bench32_sink += h;
+    return (double)best / ((double)iterations * NUM_KEYS);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-l len]... [-s lat|tput|mix]... [-g]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    struct bench32_hasher hashers[MAX_HASHERS];
+    int nhashers = 0;
+    size_t lengths[MAX_LENGTHS];
+    int nlengths = 0;
+    int shapes[NUM_SHAPES];
+    int nshapes = 0;
+    int gbps = 0;
+    struct Xorshift128p_state state = Xorshift128p_init(11);
+    uint32_t *offsets, *mixlen;
+    uint8_t *buf;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:s:g")) != -1) {
+        switch (opt) {
+            case 'l':
+                if (nlengths == MAX_LENGTHS) {
+                    usage(argv[0]);
+                }
+                lengths[nlengths++] = (size_t)strtoul(optarg, NULL, 10);
+                break;
+            case 's': {
+                int s;
+
+                for (s = 0; s < NUM_SHAPES; s++) {
+                    if (strcmp(optarg, shape_names[s]) == 0) {
+                        break;
+                    }
+                }
+                if (s == NUM_SHAPES || nshapes == NUM_SHAPES) {
+                    usage(argv[0]);
+                }
+                shapes[nshapes++] = s;
+                break;
+            }
+            case 'g': gbps = 1; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (nlengths == 0) {
+        static const size_t defaults[] = {
+            0, 1, 3, 4, 7, 8, 12, 16, 24, 31, 32, 48, 63, 64, 100, 128,
+            256, 512, 1024, 4096, 65536
+        };
+
+        for (unsigned int i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+            lengths[nlengths++] = defaults[i];
+        }
+    }
+    if (nshapes == 0) {
+        for (int s = 0; s < NUM_SHAPES; s++) {
+            shapes[nshapes++] = s;
+        }
+    }
+
+    Mult32_init();
+    CRC32C_init();
+    if (self_check() != 0) {
+        return 1;
+    }
+
+    hashers[nhashers].name = "Komi32";     hashers[nhashers++].fn = Komi32;
+    hashers[nhashers].name = "Mult32";     hashers[nhashers++].fn = Mult32;
+    hashers[nhashers].name = "Combo32";    hashers[nhashers++].fn = Combo32;
+    hashers[nhashers].name = "Murmur3";    hashers[nhashers++].fn = Murmur3_32;
+    hashers[nhashers].name = "XXH32";      hashers[nhashers++].fn = XXH32;
+    hashers[nhashers].name = "FNV1a";      hashers[nhashers++].fn = FNV1a_32;
+    hashers[nhashers].name = "CRC32C_sw";  hashers[nhashers++].fn = CRC32C_sw;
+#if defined(OTHERS32_HAS_SSE42)
+    if (CRC32C_hw_supported()) {
+        hashers[nhashers].name = "CRC32C_hw";  hashers[nhashers++].fn = CRC32C_hw;
+    }
+#endif
+
+    buf = malloc(BUFFER_SIZE);
+    offsets = malloc(sizeof(*offsets) * NUM_KEYS);
+    mixlen = malloc(sizeof(*mixlen) * NUM_KEYS);
+    if (buf == NULL || offsets == NULL || mixlen == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(buf, BUFFER_SIZE, 5);
+
+    printf("# %s; * marks the fastest in each row\n",
+           gbps ? "GB/s" : "ns per hash");
+    for (int s = 0; s < nshapes; s++) {
+        printf("\n%-5s %6s", shape_names[shapes[s]], "len");
+        for (int h = 0; h < nhashers; h++) {
+            printf(" %10s", hashers[h].name);
+        }
+        printf("\n");
+
+        for (int l = 0; l < nlengths; l++) {
+            const size_t len = lengths[l];
+            double ns[MAX_HASHERS];
+            double mean = 0.0;
+            int best = 0;
+
+            if (len * 3 / 2 + 1 >= BUFFER_SIZE / 2) {
+                continue;
+            }
+            for (unsigned int k = 0; k < NUM_KEYS; k++) {
+                offsets[k] = (uint32_t)(Xorshift128p(&state) %
+                                        (BUFFER_SIZE - len * 3 / 2 - 1));
+                mixlen[k] = (uint32_t)(len / 2 + Xorshift128p(&state) % (len + 1));
+                mean += mixlen[k];
+            }
+            mean = shapes[s] == SHAPE_MIX ? mean / NUM_KEYS : (double)len;
+
+            for (int h = 0; h < nhashers; h++) {
+                ns[h] = time_shape(hashers[h].fn, (enum shape)shapes[s],
+                                   buf, offsets, mixlen, len);
+                best = ns[h] < ns[best] ? h : best;
+            }
+            printf("%-5s %6zu", "", len);
+            for (int h = 0; h < nhashers; h++) {
+                printf(" %9.3f%c", gbps ? mean / ns[h] : ns[h],
+                       h == best ? '*' : ' ');
+            }
+            printf("\n");
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,317 @@
+/*
+ * Dual32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Combo32x2 check and benchmark.
+ * First checks that the two hashes from Combo32x2 behave as independent
+ * hashes, on random keys and on sequential keys of several lengths on
+ * both sides of COMBO32_THRESHOLD:
+ *   same    h1 equals Combo32 with the same seed
+ *   bits    no bit of h1 is correlated with any bit of h2 (largest z)
+ *   pairs   keys collide on 16 bits of h1 and 16 bits of h2 together as
+ *           often as on 32 bits of one ideal hash (observed / expected)
+ *   xor     h1 ^ h2 collides as often as an ideal 32-bit hash
+ *   aval    flipping one input bit flips each bit of h2 half the time
+ *           (largest z)
+ * Exits with status 1 if any check fails.
+ * Then times Combo32x2 against two calls of Combo32 with different seeds.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+
+#define MAX_LENGTHS 16
+#define NUM_KEYS (1 << 20)
+#define AVALANCHE_KEYS 4096
+#define MAX_AVALANCHE_BITS 256
+#define TIMING_KEYS 4096
+
+/* Pass limits.  The z limits apply to the largest of thousands of cells,
+ * where an ideal hash reaches 4 to 5 and 6 has odds of about 1e-5.
+ */
+#define MAX_Z 6.0
+#define MIN_PAIRS_RATIO 0.5
+#define MAX_PAIRS_RATIO 1.6
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static int compare_u32(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *)a;
+    const uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Observed colliding pairs over the number expected of an ideal hash */
+static double collision_ratio(uint32_t *v, const size_t n) {
+    const double expected = (double)n * (double)(n - 1) / 2.0 / 4294967296.0;
+    double pairs = 0.0;
+    size_t run = 1;
+
+    if (n < 2) {
+        return 0.0;
+    }
+    qsort(v, n, sizeof(*v), compare_u32);
+    for (size_t i = 1; i <= n; i++) {
+        if (i < n && v[i] == v[i - 1]) {
+            run++;
+        } else {
+            pairs += (double)run * (double)(run - 1) / 2.0;
+            run = 1;
+        }
+    }
+    return pairs / expected;
+}
+
+/* Key i of a family: random bytes, or the counter i in the first 8 bytes
+ * of an otherwise zero key.  Short random keys are a bijection of i, so
+ * that they never repeat.
+ */
+static void make_key(uint8_t *key, const size_t len, const size_t i, const int sequential) {
+    if (sequential) {
+        const uint64_t x = i;
+
+        memset(key, 0, len);
+        memcpy(key, &x, len < 8 ? len : 8);
+    } else if (len <= 8) {
+        const uint64_t x = (uint64_t)i * UINT64_C(0x9E3779B97F4A7C15);
+
+        memcpy(key, &x, len);
+    } else {
+        bench32_fill(key, len, i * 2 + 1);
+    }
+}
+
+/* Returns 1 if every check passes */
+static int check(const size_t len, const int sequential,
+                 uint32_t *h1, uint32_t *h2, uint32_t *work) {
+    uint8_t key[1024];
+    uint32_t agree[32][32];
+    const size_t n = len < 3 ? ((size_t)1 << (len * 8)) : NUM_KEYS;
+    double z = 0.0, pairs, xors, aval = 0.0;
+    size_t same = 0;
+    int ok;
+
+    memset(agree, 0, sizeof(agree));
+    for (size_t i = 0; i < n; i++) {
+        make_key(key, len, i, sequential);
+        Combo32x2(key, len, seed, &h1[i], &h2[i]);
+        same += h1[i] == Combo32(key, len, seed);
+        for (int a = 0; a < 32; a++) {
+            const uint32_t x = ~(h2[i] ^ (0 - ((h1[i] >> a) & 1)));
+
+            for (int b = 0; b < 32; b++) {
+                agree[a][b] += (x >> b) & 1;
+            }
+        }
+    }
+    for (int a = 0; a < 32; a++) {
+        for (int b = 0; b < 32; b++) {
+            const double d = fabs(2.0 * agree[a][b] - (double)n) / sqrt((double)n);
+
+            z = d > z ? d : z;
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        work[i] = (h1[i] << 16) | (h2[i] & 0xFFFF);
+    }
+    pairs = collision_ratio(work, n);
+    for (size_t i = 0; i < n; i++) {
+        work[i] = h1[i] ^ h2[i];
+    }
+    xors = collision_ratio(work, n);
+
+    /* Avalanche of h2 over up to MAX_AVALANCHE_BITS input bits */
+    if (len > 0) {
+        const size_t nbits = len * 8 < MAX_AVALANCHE_BITS ? len * 8 : MAX_AVALANCHE_BITS;
+        const size_t nkeys = n < AVALANCHE_KEYS ? n : AVALANCHE_KEYS;
+        static uint32_t flips[MAX_AVALANCHE_BITS][32];
+
+        memset(flips, 0, sizeof(flips));
+        for (size_t i = 0; i < nkeys; i++) {
+            uint32_t a1, a2;
+
+            make_key(key, len, i, sequential);
+            Combo32x2(key, len, seed, &a1, &a2);
+            for (size_t bit = 0; bit < nbits; bit++) {
+                /* Spread the tested bits over the whole key */
+                const size_t pos = bit * len * 8 / nbits;
+                uint32_t b1, b2, d;
+
+                key[pos / 8] ^= (uint8_t)(1 << (pos % 8));
+                Combo32x2(key, len, seed, &b1, &b2);
+                key[pos / 8] ^= (uint8_t)(1 << (pos % 8));
+                d = a2 ^ b2;
+                for (int b = 0; b < 32; b++) {
+                    flips[bit][b] += (d >> b) & 1;
+                }
+            }
+        }
+        for (size_t bit = 0; bit < nbits; bit++) {
+            for (int b = 0; b < 32; b++) {
+                const double d = fabs(2.0 * flips[bit][b] - (double)nkeys) /
+                                 sqrt((double)nkeys);
+
+                aval = d > aval ? d : aval;
+            }
+        }
+    }
+
+    /* Tiny families have too few keys for the statistics to mean much */
+    ok = same == n &&
+         (n < NUM_KEYS || (z < MAX_Z &&
+                           pairs > MIN_PAIRS_RATIO && pairs < MAX_PAIRS_RATIO &&
+                           xors > MIN_PAIRS_RATIO && xors < MAX_PAIRS_RATIO &&
+                           aval < MAX_Z));
+    printf("%-10s %6zu %8zu %6s %8.2f %8.3f %8.3f %8.2f  %s\n",
+           sequential ? "sequential" : "random", len, n,
+           same == n ? "yes" : "NO", z, pairs, xors, aval, ok ? "pass" : "FAIL");
+    return ok;
+}
+
+/*------------------------------------------------------------ */
+
+/* Nanoseconds per key for both hashes, best of three runs */
+static double time_pair(const int dual, const uint8_t *buf, const uint32_t *offsets,
+                        const size_t len) {
+    const unsigned int iterations =
+        (unsigned int)(((size_t)4 << 20) / ((len + 16) * TIMING_KEYS)) + 1;
+    uint64_t best = UINT64_MAX;
+    uint32_t sum = 0;
+
+    for (int run = 0; run < 3; run++) {
+        const uint64_t start = bench32_now();
+        uint64_t ns;
+
+        for (unsigned int it = 0; it < iterations; it++) {
+            for (unsigned int k = 0; k < TIMING_KEYS; k++) {
+                uint32_t h1, h2;
+
+                if (dual) {
+                    Combo32x2(buf + offsets[k], len, k, &h1, &h2);
+                } else {
+                    h1 = Combo32(buf + offsets[k], len, k);
+                    h2 = Combo32(buf + offsets[k], len, k ^ UINT64_C(0x9E3779B97F4A7C15));
+                }
+                sum += h1 ^ (h2 << 1);
+            }
+        }
+        ns = bench32_now() - start;
+        best = ns < best ? ns : best;
+    }
+    bench32_sink += sum;
+    return (double)best / ((double)iterations * TIMING_KEYS);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-l len]... [-c | -t]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t lengths[MAX_LENGTHS];
+    int nlengths = 0;
+    int do_check = 1, do_time = 1;
+    int ok = 1;
+    struct Xorshift128p_state state = Xorshift128p_init(31);
+    uint32_t *h1, *h2, *work, *offsets;
+    uint8_t *buf;
+    const size_t buflen = (size_t)1 << 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:ct")) != -1) {
+        switch (opt) {
+            case 'l':
+                if (nlengths == MAX_LENGTHS) {
+                    usage(argv[0]);
+                }
+                lengths[nlengths] = (size_t)strtoul(optarg, NULL, 10);
+                if (lengths[nlengths] > 1024) {
+                    usage(argv[0]);
+                }
+                nlengths++;
+                break;
+            case 'c': do_time = 0; break;
+            case 't': do_check = 0; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (nlengths == 0) {
+        static const size_t defaults[] = { 0, 2, 4, 8, 16, 31, 32, 64, 100, 1024 };
+
+        for (unsigned int i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+            lengths[nlengths++] = defaults[i];
+        }
+    }
+
+    h1 = malloc(sizeof(*h1) * NUM_KEYS);
+    h2 = malloc(sizeof(*h2) * NUM_KEYS);
+    work = malloc(sizeof(*work) * NUM_KEYS);
+    offsets = malloc(sizeof(*offsets) * TIMING_KEYS);
+    buf = malloc(buflen);
+    if (h1 == NULL || h2 == NULL || work == NULL || offsets == NULL || buf == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    Mult32_init();
+
+    if (do_check) {
+        printf("# Combo32x2 independence checks, COMBO32_THRESHOLD %d\n",
+               COMBO32_THRESHOLD);
+        printf("%-10s %6s %8s %6s %8s %8s %8s %8s\n",
+               "keys", "len", "n", "same", "bits", "pairs", "xor", "aval");
+        for (int l = 0; l < nlengths; l++) {
+            for (int sequential = 0; sequential <= 1; sequential++) {
+                /* Sequential keys cover every key shorter than 3 */
+                if (lengths[l] >= 3 || sequential) {
+                    ok &= check(lengths[l], sequential, h1, h2, work);
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+
+    if (do_time) {
+        bench32_fill(buf, buflen, 37);
+        printf("\n# ns per key for two hashes\n");
+        printf("%6s %10s %10s %8s\n", "len", "Combo32x2", "2xCombo32", "ratio");
+        for (int l = 0; l < nlengths; l++) {
+            const size_t len = lengths[l];
+            double dual, twice;
+
+            for (unsigned int k = 0; k < TIMING_KEYS; k++) {
+                offsets[k] = (uint32_t)(Xorshift128p(&state) % (buflen - len));
+            }
+            dual = time_pair(1, buf, offsets, len);
+            twice = time_pair(0, buf, offsets, len);
+            printf("%6zu %10.2f %10.2f %8.2f\n", len, dual, twice, dual / twice);
+            fflush(stdout);
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/*
+ * Fuse32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Static filter benchmark.
+ * Builds Fuse32 filters with 8 and 16-bit fingerprints over n distinct
+ * keys, the 8-bit one with 1 up to the given number of threads, checks
+ * that every key is found, writes the 8-bit blob to a file and maps it
+ * back, then compares the bits per key, false positive rate and query
+ * time of the mapped filters with a Bloom32 filter of the same keys.
+ * Also builds one from the keys with a quarter of them given twice, and
+ * checks that every key is found in it too.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "bloom32.h"
+#include "fuse32.h"
+
+#define KEY_LEN 16
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static void fail(const char *what, const int err) {
+    fprintf(stderr, "%s failed: %d\n", what, err);
+    exit(1);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-q queries] [-t threads] [-f file]\n", prog);
+    exit(1);
+}
+
+/* Time nq queries of keys never added, numbered from n on */
+static void report(const char *name, const double bits_per_key, const size_t n,
+                   const size_t nq, const void *filter,
+                   int (*contains)(const void *, const void *, size_t)) {
+    uint8_t key[KEY_LEN];
+    uint64_t start, positives = 0;
+
+    bench32_fill(key, KEY_LEN, 53);
+    start = bench32_now();
+    for (size_t i = n; i < n + nq; i++) {
+        memcpy(key, &i, sizeof(i));
+        positives += (uint64_t)contains(filter, key, KEY_LEN);
+    }
+    printf("%-12s %12.3f %11.4f%% %12.1f\n", name, bits_per_key,
+           100.0 * (double)positives / (double)nq, (double)(bench32_now() - start) / (double)nq);
+}
+
+static int fuse_contains(const void *f, const void *key, const size_t len) {
+    return Fuse32_contains((const struct fuse32 *)f, key, len);
+}
+
+static int bloom_contains(const void *f, const void *key, const size_t len) {
+    return Bloom32_contains((const struct bloom32 *)f, key, len);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 10000000;
+    size_t nq = 10000000;
+    unsigned int nthreads = 4;
+    const char *path = "fuse32.bin";
+    struct fuse32 f8, f16, fr;
+    struct bloom32 b;
+    const void **kp;
+    size_t *lens;
+    uint8_t *keys;
+    void *blob = NULL, *blob16 = NULL, *blobr = NULL, *mapped;
+    size_t size = 0, size16 = 0, sizer = 0;
+    uint64_t start;
+    FILE *f;
+    int fd, opt, err;
+
+    while ((opt = getopt(argc, argv, "n:q:t:f:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'q': nq = (size_t)strtoull(optarg, NULL, 10); break;
+            case 't': nthreads = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'f': path = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0 || nq == 0 || nthreads == 0) {
+        usage(argv[0]);
+    }
+    keys = malloc(n * KEY_LEN);
+    kp = malloc(n * sizeof(*kp));
+    lens = malloc(n * sizeof(*lens));
+    if (keys == NULL || kp == NULL || lens == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    /* Number the keys so that none repeats; queries use the same fill */
+    for (size_t i = 0; i < n; i++) {
+        bench32_fill(keys + i * KEY_LEN, KEY_LEN, 53);
+        memcpy(keys + i * KEY_LEN, &i, sizeof(i));
+        kp[i] = keys + i * KEY_LEN;
+        lens[i] = KEY_LEN;
+    }
+    Mult32_init();
+
+    printf("# %zu keys of %d bytes\n", n, KEY_LEN);
+    /* 1, 2, 4 ... threads, then nthreads */
+    for (unsigned int t = 1;; t = t * 2 < nthreads ? t * 2 : nthreads) {
+        char name[32];
+
+        free(blob);
+        start = bench32_now();
+        if ((err = Fuse32_build(kp, lens, n, seed, 8, t, &blob, &size)) != 0) {
+            fail("Fuse32_build", err);
+        }
+        snprintf(name, sizeof(name), "build, %u thread%s", t, t == 1 ? "" : "s");
+        printf("%-28s %12.1f ms\n", name, (double)(bench32_now() - start) / 1e6);
+        if (t == nthreads) {
+            break;
+        }
+    }
+    if ((err = Fuse32_build(kp, lens, n, seed, 16, nthreads, &blob16, &size16)) != 0 ||
+        (err = Fuse32_load(&f16, blob16, size16)) != 0) {
+        fail("Fuse32_build", err);
+    }
+
+    /* The last quarter of the keys repeats the quarter before it */
+    for (size_t i = n - n / 4; i < n; i++) {
+        kp[i] = kp[i - n / 4];
+    }
+    start = bench32_now();
+    if ((err = Fuse32_build(kp, lens, n, seed, 8, nthreads, &blobr, &sizer)) != 0 ||
+        (err = Fuse32_load(&fr, blobr, sizer)) != 0) {
+        fail("Fuse32_build with repeats", err);
+    }
+    printf("%-28s %12.1f ms\n", "build, 25% repeats", (double)(bench32_now() - start) / 1e6);
+    for (size_t i = 0; i < n - n / 4; i++) {
+        if (!Fuse32_contains(&fr, keys + i * KEY_LEN, KEY_LEN)) {
+            fprintf(stderr, "key %zu not found with repeats\n", i);
+            return 1;
+        }
+    }
+    free(blobr);
+
+    /* Write the 8-bit blob out and use it from the file */
+    f = fopen(path, "wb");
+    if (f == NULL || fwrite(blob, 1, size, f) != size || fclose(f) != 0) {
+        fail("writing the blob", -1);
+    }
+    free(blob);
+    fd = open(path, O_RDONLY);
+    mapped = fd < 0 ? MAP_FAILED : mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        fail("mapping the blob", -1);
+    }
+    start = bench32_now();
+    if ((err = Fuse32_load(&f8, mapped, size)) != 0) {
+        fail("Fuse32_load", err);
+    }
+    printf("%-28s %12.3f ms\n", "map and load", (double)(bench32_now() - start) / 1e6);
+
+    if (Bloom32_init(&b, n, 0, seed) != 0) {
+        fail("Bloom32_init", -1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        Bloom32_add(&b, keys + i * KEY_LEN, KEY_LEN);
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!Fuse32_contains(&f8, keys + i * KEY_LEN, KEY_LEN) ||
+            !Fuse32_contains(&f16, keys + i * KEY_LEN, KEY_LEN)) {
+            fprintf(stderr, "key %zu not found\n", i);
+            return 1;
+        }
+    }
+
+    printf("%-12s %12s %12s %12s\n", "filter", "bits per key", "fpr", "query ns");
+    report("Fuse32/8", Fuse32_bits_per_key(&f8), n, nq, &f8, fuse_contains);
+    report("Fuse32/16", Fuse32_bits_per_key(&f16), n, nq, &f16, fuse_contains);
+    report("Bloom32", 8.0 * (double)Bloom32_bytes(&b) / (double)n, n, nq, &b, bloom_contains);
+
+    Bloom32_free(&b);
+    munmap(mapped, size);
+    close(fd);
+    free(blob16);
+    free(keys);
+    free(kp);
+    free(lens);
+    return 0;
+}
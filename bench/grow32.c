@@ -0,0 +1,135 @@
+/*
+ * Grow32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Insert latency benchmark.
+ * Inserts n keys one at a time into Robin32, which rebuilds its slots
+ * in one go when full, and into Grow32, which moves them a few at a
+ * time, timing every insert.  Reports the total time and the latency
+ * percentiles, where the rebuilds show up.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "grow32.h"
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static int compare_u64(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, uint64_t *ns, const size_t n, const uint64_t total) {
+    static const double pct[] = { 50.0, 99.0, 99.9, 99.99 };
+
+    qsort(ns, n, sizeof(*ns), compare_u64);
+    printf("%-8s %10.1f", name, (double)total / 1e6);
+    for (unsigned int i = 0; i < sizeof(pct) / sizeof(pct[0]); i++) {
+        printf(" %10llu", (unsigned long long)ns[(size_t)((double)(n - 1) * pct[i] / 100.0)]);
+    }
+    printf(" %12llu\n", (unsigned long long)ns[n - 1]);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-l key_len] [-a max_load]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 20000000;
+    size_t len = 16;
+    double max_load = 0.8;
+    uint8_t *keys;
+    uint64_t *ns;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:a:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'l': len = (size_t)strtoul(optarg, NULL, 10); break;
+            case 'a': max_load = atof(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0 || len < 8) {
+        usage(argv[0]);
+    }
+    keys = malloc(n * len);
+    ns = malloc(n * sizeof(*ns));
+    if (keys == NULL || ns == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(keys, n * len, 31);
+    /* Number the keys so that none repeats */
+    for (size_t i = 0; i < n; i++) {
+        memcpy(keys + i * len, &i, sizeof(i));
+    }
+    Mult32_init();
+
+    printf("# %zu keys of %zu bytes, maximum load %.2f; latency in ns\n",
+           n, len, max_load);
+    printf("%-8s %10s %10s %10s %10s %10s %12s\n",
+           "map", "total ms", "p50", "p99", "p99.9", "p99.99", "max");
+    {
+        struct robin32 m;
+        uint64_t start = bench32_now(), total;
+        int inserted;
+
+        Robin32_init(&m, 0, max_load, seed);
+        for (size_t i = 0; i < n; i++) {
+            const uint64_t t = bench32_now();
+
+            Robin32_insert(&m, keys + i * len, len, &inserted)->value = NULL;
+            ns[i] = bench32_now() - t;
+        }
+        total = bench32_now() - start;
+        report("Robin32", ns, n, total);
+        Robin32_free(&m);
+    }
+    {
+        struct grow32 m;
+        uint64_t start = bench32_now(), total;
+        int inserted;
+
+        Grow32_init(&m, 0, max_load, seed);
+        for (size_t i = 0; i < n; i++) {
+            const uint64_t t = bench32_now();
+
+            Grow32_insert(&m, keys + i * len, len, &inserted)->value = NULL;
+            ns[i] = bench32_now() - t;
+        }
+        total = bench32_now() - start;
+        report("Grow32", ns, n, total);
+        Grow32_free(&m);
+    }
+
+    free(keys);
+    free(ns);
+    return 0;
+}
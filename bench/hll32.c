@@ -0,0 +1,177 @@
+/*
+ * Hll32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Distinct count benchmark.
+ * Adds n distinct keys to an Hll32 sketch one at a time and in batches,
+ * printing the estimate and its error as the count grows, then spreads
+ * the keys over many shard sketches and times merging them, one at a
+ * time and with Hll32_merge_many, in gigabytes of registers a second.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "hll32.h"
+
+#define KEY_LEN 16
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static void fail(const char *what, const int err) {
+    fprintf(stderr, "%s failed: %d\n", what, err);
+    exit(1);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-p precision] [-s shards]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 20000000;
+    size_t nshards = 2000;
+    unsigned int p = 14;
+    struct hll32 f, *shards;
+    const struct hll32 **srcs;
+    const void **kp;
+    size_t *lens;
+    uint8_t *keys;
+    uint64_t start;
+    double gb;
+    int opt, err;
+
+    while ((opt = getopt(argc, argv, "n:p:s:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'p': p = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 's': nshards = (size_t)strtoull(optarg, NULL, 10); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0 || nshards == 0) {
+        usage(argv[0]);
+    }
+    keys = malloc(n * KEY_LEN);
+    kp = malloc(n * sizeof(*kp));
+    lens = malloc(n * sizeof(*lens));
+    shards = malloc(nshards * sizeof(*shards));
+    srcs = malloc(nshards * sizeof(*srcs));
+    if (keys == NULL || kp == NULL || lens == NULL || shards == NULL || srcs == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(keys, n * KEY_LEN, 59);
+    /* Number the keys so that none repeats */
+    for (size_t i = 0; i < n; i++) {
+        memcpy(keys + i * KEY_LEN, &i, sizeof(i));
+        kp[i] = keys + i * KEY_LEN;
+        lens[i] = KEY_LEN;
+    }
+    Mult32_init();
+
+    printf("# %zu keys of %d bytes, precision %u\n", n, KEY_LEN, p);
+    if ((err = Hll32_init(&f, p, seed)) != 0) {
+        fail("Hll32_init", err);
+    }
+    printf("%12s %14s %10s %10s\n", "keys", "estimate", "error", "bytes");
+    start = bench32_now();
+    for (size_t i = 0, next = 10; i < n; i++) {
+        if ((err = Hll32_add(&f, keys + i * KEY_LEN, KEY_LEN)) != 0) {
+            fail("Hll32_add", err);
+        }
+        if (i + 1 == next || i + 1 == n) {
+            const double e = Hll32_estimate(&f);
+
+            printf("%12zu %14.1f %+9.3f%% %10zu\n", i + 1, e,
+                   100.0 * (e - (double)(i + 1)) / (double)(i + 1), Hll32_bytes(&f));
+            next *= 10;
+        }
+    }
+    printf("%-28s %12.1f ns\n", "add", (double)(bench32_now() - start) / (double)n);
+
+    Hll32_clear(&f);
+    start = bench32_now();
+    if ((err = Hll32_add_batch(&f, kp, lens, n)) != 0) {
+        fail("Hll32_add_batch", err);
+    }
+    printf("%-28s %12.1f ns\n", "add batch", (double)(bench32_now() - start) / (double)n);
+    start = bench32_now();
+    for (unsigned int i = 0; i < 1000; i++) {
+        bench32_sink += (uint32_t)Hll32_estimate(&f);
+    }
+    printf("%-28s %12.1f us\n", "estimate", (double)(bench32_now() - start) / 1e6);
+
+    /* Key i goes to shard i mod nshards */
+    for (size_t s = 0; s < nshards; s++) {
+        if ((err = Hll32_init(&shards[s], p, seed)) != 0) {
+            fail("Hll32_init", err);
+        }
+        srcs[s] = &shards[s];
+    }
+    for (size_t i = 0; i < n; i++) {
+        if ((err = Hll32_add(&shards[i % nshards], keys + i * KEY_LEN, KEY_LEN)) != 0) {
+            fail("Hll32_add", err);
+        }
+    }
+    gb = 0.0;
+    for (size_t s = 0; s < nshards; s++) {
+        gb += (double)Hll32_bytes(&shards[s]) / 1e9;
+    }
+    printf("# %zu shards, %.1f MB of sketches\n", nshards, gb * 1e3);
+
+    Hll32_free(&f);
+    Hll32_init(&f, p, seed);
+    start = bench32_now();
+    for (size_t s = 0; s < nshards; s++) {
+        if ((err = Hll32_merge(&f, &shards[s])) != 0) {
+            fail("Hll32_merge", err);
+        }
+    }
+    printf("%-28s %12.2f GB/s\n", "merge one at a time", gb / ((double)(bench32_now() - start) / 1e9));
+    printf("%-28s %12.3f%%\n", "merged error",
+           100.0 * (Hll32_estimate(&f) - (double)n) / (double)n);
+
+    Hll32_free(&f);
+    Hll32_init(&f, p, seed);
+    start = bench32_now();
+    if ((err = Hll32_merge_many(&f, srcs, nshards)) != 0) {
+        fail("Hll32_merge_many", err);
+    }
+    printf("%-28s %12.2f GB/s\n", "merge many", gb / ((double)(bench32_now() - start) / 1e9));
+    printf("%-28s %12.3f%%\n", "merged error",
+           100.0 * (Hll32_estimate(&f) - (double)n) / (double)n);
+
+    for (size_t s = 0; s < nshards; s++) {
+        Hll32_free(&shards[s]);
+    }
+    Hll32_free(&f);
+    free(keys);
+    free(kp);
+    free(lens);
+    free(shards);
+    free(srcs);
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * Index32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Persistent index benchmark.
+ * Writes n keys to an Index32 file and closes it, then compares starting
+ * up from it, which is opening the file and looking up one key, with
+ * rebuilding a Robin32 map of the same keys, as a service that keeps its
+ * index only in memory must do.  Then times random lookups in the
+ * mapped file, and updates under several sync policies.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "index32.h"
+#include "robin32.h"
+
+#define KEY_LEN 16
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static void fail(const char *what, const int err) {
+    fprintf(stderr, "%s failed: %d\n", what, err);
+    exit(1);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-q lookups] [-u updates] [-f file]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    static const unsigned int policies[] = { 0, 1000, 100, 1 };
+    size_t n = 4000000;
+    size_t nq = 4000000;
+    size_t nu = 2000;
+    const char *path = "index32.bin";
+    struct Xorshift128p_state state = Xorshift128p_init(37);
+    struct index32 ix;
+    uint8_t *keys;
+    uint64_t start, found = 0;
+    size_t vlen;
+    int opt, err;
+
+    while ((opt = getopt(argc, argv, "n:q:u:f:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'q': nq = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'u': nu = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'f': path = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0) {
+        usage(argv[0]);
+    }
+    keys = malloc(n * KEY_LEN);
+    if (keys == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(keys, n * KEY_LEN, 41);
+    /* Number the keys so that none repeats */
+    for (size_t i = 0; i < n; i++) {
+        memcpy(keys + i * KEY_LEN, &i, sizeof(i));
+    }
+    Mult32_init();
+
+    start = bench32_now();
+    if ((err = Index32_create(&ix, path, n, seed)) != 0) {
+        fail("Index32_create", err);
+    }
+    for (size_t i = 0; i < n; i++) {
+        if ((err = Index32_put(&ix, keys + i * KEY_LEN, KEY_LEN, &i, sizeof(i))) != 0) {
+            fail("Index32_put", err);
+        }
+    }
+    if ((err = Index32_close(&ix)) != 0) {
+        fail("Index32_close", err);
+    }
+    printf("# %zu keys of %d bytes, 8-byte values\n", n, KEY_LEN);
+    printf("%-28s %12.1f ms\n", "write and close", (double)(bench32_now() - start) / 1e6);
+
+    start = bench32_now();
+    if ((err = Index32_open(&ix, path, 1)) != 0) {
+        fail("Index32_open", err);
+    }
+    found += Index32_get(&ix, keys, KEY_LEN, &vlen) != NULL;
+    printf("%-28s %12.3f ms\n", "open and first lookup", (double)(bench32_now() - start) / 1e6);
+
+    {
+        struct robin32 m;
+        int inserted;
+
+        start = bench32_now();
+        Robin32_init(&m, 0, 0.8, seed);
+        for (size_t i = 0; i < n; i++) {
+            Robin32_insert(&m, keys + i * KEY_LEN, KEY_LEN, &inserted)->value = NULL;
+        }
+        printf("%-28s %12.1f ms\n", "rebuild Robin32 in memory",
+               (double)(bench32_now() - start) / 1e6);
+        Robin32_free(&m);
+    }
+
+    start = bench32_now();
+    for (size_t i = 0; i < nq; i++) {
+        const size_t k = (size_t)(Xorshift128p(&state) % n);
+
+        found += Index32_get(&ix, keys + k * KEY_LEN, KEY_LEN, &vlen) != NULL;
+    }
+    printf("%-28s %12.1f ns\n", "random lookup", (double)(bench32_now() - start) / (double)nq);
+
+    /* Replace values, syncing after every so many */
+    for (unsigned int p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+        char name[32];
+
+        Index32_sync_every(&ix, policies[p]);
+        start = bench32_now();
+        for (size_t i = 0; i < nu; i++) {
+            const size_t k = (size_t)(Xorshift128p(&state) % n);
+
+            if ((err = Index32_put(&ix, keys + k * KEY_LEN, KEY_LEN, &i, sizeof(i))) != 0) {
+                fail("Index32_put", err);
+            }
+        }
+        if ((err = Index32_sync(&ix)) != 0) {
+            fail("Index32_sync", err);
+        }
+        snprintf(name, sizeof(name), "update, sync every %u", policies[p]);
+        printf("%-28s %12.1f us\n", policies[p] == 0 ? "update, sync at end" : name,
+               (double)(bench32_now() - start) / 1e3 / (double)nu);
+    }
+
+    Index32_close(&ix);
+    bench32_sink += (uint32_t)found;
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,292 @@
+/*
+ * Maps32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Hash map benchmark, in C++ so that std::unordered_map can be
+ * compared with the maps in this repository.  Every map uses Combo32
+ * with the same seed, so only the table layout differs.
+ * The keys come from a file, one per line, or from a synthetic corpus.
+ * Each map is timed on inserting every key, looking up every key in a
+ * shuffled order, looking up keys that are missing, erasing half the
+ * keys, and looking up every key again.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include "bench32.h"
+#include "cuckoo32.h"
+#include "robin32.h"
+#include "swiss32.h"
+
+static const uint64_t seed = 0x5EED;
+static double robin32_max_load = 0.8;
+static double cuckoo32_max_load = 0.95;
+
+struct combo32_hasher {
+    size_t operator()(const std::string_view s) const {
+        return Combo32(s.data(), s.size(), seed);
+    }
+};
+
+/*------------------------------------------------------------ */
+
+/* One adaptor per map, all with the same four operations */
+
+struct unordered_adaptor {
+    static const char *name() { return "unordered_map"; }
+    std::unordered_map<std::string_view, void *, combo32_hasher> m;
+
+    void reserve(const size_t n) { m.reserve(n); }
+    void insert(const std::string_view k, void *v) { m.emplace(k, v); }
+    bool find(const std::string_view k) const { return m.find(k) != m.end(); }
+    void erase(const std::string_view k) { m.erase(k); }
+    void report() const {}
+};
+
+struct swiss32_adaptor {
+    static const char *name() { return "Swiss32"; }
+    struct swiss32 m;
+
+    swiss32_adaptor() { Swiss32_init(&m, 0, seed); }
+    ~swiss32_adaptor() { Swiss32_free(&m); }
+    void reserve(const size_t n) { Swiss32_reserve(&m, n); }
+    void insert(const std::string_view k, void *v) {
+        int inserted;
+
+        Swiss32_insert(&m, k.data(), k.size(), &inserted)->value = v;
+    }
+    bool find(const std::string_view k) const {
+        return Swiss32_find(&m, k.data(), k.size()) != NULL;
+    }
+    void erase(const std::string_view k) { Swiss32_erase(&m, k.data(), k.size()); }
+    void report() const {}
+};
+
+struct robin32_adaptor {
+    static const char *name() { return "Robin32"; }
+    struct robin32 m;
+
+    robin32_adaptor() { Robin32_init(&m, 0, robin32_max_load, seed); }
+    ~robin32_adaptor() { Robin32_free(&m); }
+    void reserve(const size_t n) { Robin32_reserve(&m, n); }
+    void insert(const std::string_view k, void *v) {
+        int inserted;
+
+        Robin32_insert(&m, k.data(), k.size(), &inserted)->value = v;
+    }
+    bool find(const std::string_view k) const {
+        return Robin32_find(&m, k.data(), k.size()) != NULL;
+    }
+    void erase(const std::string_view k) { Robin32_erase(&m, k.data(), k.size()); }
+    void report() const {
+        struct robin32_stats st;
+
+        Robin32_stats(&m, &st);
+        printf("# Robin32 full: load %.3f, probe distance mean %.3f, max %u\n",
+               st.load, st.mean, st.max);
+    }
+};
+
+struct cuckoo32_adaptor {
+    static const char *name() { return "Cuckoo32"; }
+    struct cuckoo32 m;
+
+    cuckoo32_adaptor() { Cuckoo32_init(&m, 0, cuckoo32_max_load, seed); }
+    ~cuckoo32_adaptor() { Cuckoo32_free(&m); }
+    void reserve(const size_t n) { Cuckoo32_reserve(&m, n); }
+    void insert(const std::string_view k, void *v) {
+        int inserted;
+
+        Cuckoo32_insert(&m, k.data(), k.size(), &inserted)->value = v;
+    }
+    bool find(const std::string_view k) const {
+        return Cuckoo32_find(&m, k.data(), k.size()) != NULL;
+    }
+    void erase(const std::string_view k) { Cuckoo32_erase(&m, k.data(), k.size()); }
+    void report() const {
+        printf("# Cuckoo32 full: load %.3f, %zu buckets of %d\n",
+               Cuckoo32_load(&m), m.nbuckets, CUCKOO32_WAYS);
+    }
+};
+
+/*------------------------------------------------------------ */
+
+struct corpus {
+    std::vector<std::string> storage;
+    std::vector<std::string_view> keys;      /* present */
+    std::vector<std::string_view> missing;   /* never inserted */
+};
+
+static void load_file(const char *path, corpus &c) {
+    FILE *f = fopen(path, "r");
+    char line[4096];
+
+    if (f == NULL) {
+        perror(path);
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        size_t len = strlen(line);
+
+        if (len > 0 && line[len - 1] == '\n') {
+            len--;
+        }
+        c.storage.emplace_back(line, len);
+    }
+    fclose(f);
+    std::sort(c.storage.begin(), c.storage.end());
+    c.storage.erase(std::unique(c.storage.begin(), c.storage.end()), c.storage.end());
+}
+
+/* Random printable keys with lengths from minlen to maxlen */
+static void synthesize(const size_t n, const size_t minlen, const size_t maxlen,
+                       corpus &c) {
+    struct Xorshift128p_state state = Xorshift128p_init(n);
+
+    for (size_t i = 0; i < n; i++) {
+        const size_t len = minlen + Xorshift128p(&state) % (maxlen - minlen + 1);
+        std::string s(len, ' ');
+
+        for (size_t j = 0; j < len; j++) {
+            s[j] = (char)('!' + Xorshift128p(&state) % 94);
+        }
+        /* Make every key unique */
+        for (size_t j = 0, x = i; j < len && x != 0; j++, x /= 94) {
+            s[j] = (char)('!' + x % 94);
+        }
+        c.storage.push_back(s);
+    }
+}
+
+/* Split the stored strings into present and missing keys */
+static void split(corpus &c) {
+    struct Xorshift128p_state state = Xorshift128p_init(99);
+
+    for (size_t i = c.storage.size(); i > 1; i--) {
+        std::swap(c.storage[i - 1], c.storage[Xorshift128p(&state) % i]);
+    }
+    for (size_t i = 0; i < c.storage.size(); i++) {
+        (i % 4 == 3 ? c.missing : c.keys).push_back(c.storage[i]);
+    }
+}
+
+/*------------------------------------------------------------ */
+
+template <class Map>
+static void run(const corpus &c, const bool reserve) {
+    std::vector<std::string_view> shuffled(c.keys);
+    struct Xorshift128p_state state = Xorshift128p_init(7);
+    const double n = (double)c.keys.size();
+    size_t found = 0;
+    uint64_t t0, t1, t2, t3, t4, t5;
+    Map map;
+
+    for (size_t i = shuffled.size(); i > 1; i--) {
+        std::swap(shuffled[i - 1], shuffled[Xorshift128p(&state) % i]);
+    }
+
+    t0 = bench32_now();
+    if (reserve) {
+        map.reserve(c.keys.size());
+    }
+    for (size_t i = 0; i < c.keys.size(); i++) {
+        map.insert(c.keys[i], (void *)&c.keys[i]);
+    }
+    t1 = bench32_now();
+    for (const std::string_view k : shuffled) {
+        found += map.find(k);
+    }
+    t2 = bench32_now();
+    for (const std::string_view k : c.missing) {
+        found += map.find(k);
+    }
+    t3 = bench32_now();
+    map.report();
+    for (size_t i = 0; i < shuffled.size(); i += 2) {
+        map.erase(shuffled[i]);
+    }
+    t4 = bench32_now();
+    for (const std::string_view k : c.keys) {
+        found += map.find(k);
+    }
+    t5 = bench32_now();
+    bench32_sink += (uint32_t)found;
+
+    printf("%-14s %10.2f %10.2f %10.2f %10.2f %10.2f\n", Map::name(),
+           (double)(t1 - t0) / n, (double)(t2 - t1) / n,
+           (double)(t3 - t2) / (double)c.missing.size(),
+           (double)(t4 - t3) / (n / 2), (double)(t5 - t4) / n);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-l minlen,maxlen] [-r] [-a robin32_max_load]\n"
+                    "          [-c cuckoo32_max_load] [-f key_file]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 1000000;
+    size_t minlen = 8, maxlen = 24;
+    const char *path = NULL;
+    bool reserve = false;
+    corpus c;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:ra:c:f:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'l':
+                if (sscanf(optarg, "%zu,%zu", &minlen, &maxlen) != 2 ||
+                    minlen == 0 || maxlen < minlen) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'r': reserve = true; break;
+            case 'a': robin32_max_load = atof(optarg); break;
+            case 'c': cuckoo32_max_load = atof(optarg); break;
+            case 'f': path = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (path != NULL) {
+        load_file(path, c);
+    } else {
+        synthesize(n, minlen, maxlen, c);
+    }
+    split(c);
+    Mult32_init();
+
+    printf("# %zu keys, %zu missing keys, %s; ns per operation\n",
+           c.keys.size(), c.missing.size(), reserve ? "reserved" : "growing");
+    printf("%-14s %10s %10s %10s %10s %10s\n",
+           "map", "insert", "find", "miss", "erase", "find/2");
+    run<unordered_adaptor>(c, reserve);
+    run<swiss32_adaptor>(c, reserve);
+    run<robin32_adaptor>(c, reserve);
+    run<cuckoo32_adaptor>(c, reserve);
+    return 0;
+}
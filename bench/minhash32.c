@@ -0,0 +1,182 @@
+/*
+ * Minhash32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Near-duplicate detection benchmark.
+ * Makes n documents of random words in pairs, the second of each pair a
+ * copy of the first with some words changed, and signs the w-byte
+ * shingles of each with k MinHash permutations, in millions of shingles
+ * a second.  Then compresses the signatures to b bits, compares the
+ * similarity estimates of the pairs with and without compression, and
+ * times adding the signatures to an LSH index and querying it, counting
+ * how many pairs find each other and how many other candidates come up.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "minhash32.h"
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static void fail(const char *what, const int err) {
+    fprintf(stderr, "%s failed: %d\n", what, err);
+    exit(1);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n documents] [-l length] [-w shingle] [-k permutations] "
+            "[-b bits] [-B bands] [-r rows] [-c changed]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t ndocs = 20000;
+    size_t len = 4000;
+    size_t w = 8;
+    unsigned int k = 128, bits = 4, bands = 16, rows = 8;
+    double changed = 0.05;
+    struct Xorshift128p_state state = Xorshift128p_init(71);
+    struct minhash32 m;
+    struct minhash32_lsh x;
+    char *docs;
+    uint32_t *sigs, *out;
+    uint64_t *packed;
+    size_t words, found = 0, others = 0;
+    uint64_t start;
+    double exact = 0.0, compressed = 0.0;
+    int opt, err;
+
+    while ((opt = getopt(argc, argv, "n:l:w:k:b:B:r:c:")) != -1) {
+        switch (opt) {
+            case 'n': ndocs = (size_t)strtoull(optarg, NULL, 10) & ~(size_t)1; break;
+            case 'l': len = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'w': w = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'k': k = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'b': bits = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'B': bands = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'r': rows = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'c': changed = atof(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (ndocs == 0 || len < w || w == 0 || (bits & (bits - 1)) != 0 || bits > 32) {
+        usage(argv[0]);
+    }
+    if ((err = Minhash32_init(&m, k, seed)) != 0) {
+        fail("Minhash32_init", err);
+    }
+    if ((err = Minhash32_lsh_init(&x, &m, bands, rows)) != 0) {
+        fail("Minhash32_lsh_init", err);
+    }
+    words = Minhash32_bbit_words(&m, bits);
+    docs = malloc(ndocs * len);
+    sigs = malloc(ndocs * k * sizeof(*sigs));
+    packed = malloc(ndocs * words * sizeof(*packed));
+    out = malloc(ndocs * sizeof(*out));
+    if (docs == NULL || sigs == NULL || packed == NULL || out == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    /* Words of 1 to 8 letters; the copy changes each with probability changed */
+    for (size_t d = 0; d < ndocs; d += 2) {
+        char *a = docs + d * len, *b = a + len;
+
+        for (size_t i = 0; i < len;) {
+            const uint64_t r = Xorshift128p(&state);
+            const size_t n = (size_t)(r & 7) + 1;
+            const int change = (double)(r >> 11) / 9007199254740992.0 < changed;
+
+            for (size_t j = 0; j < n && i < len; j++, i++) {
+                a[i] = (char)('a' + (r >> (8 + 5 * j)) % 26);
+                b[i] = change ? (char)('a' + (r >> (9 + 5 * j)) % 26) : a[i];
+            }
+            if (i < len) {
+                a[i] = b[i] = ' ';
+                i++;
+            }
+        }
+    }
+
+    printf("# %zu documents of %zu bytes, %zu-byte shingles, %u permutations\n",
+           ndocs, len, w, k);
+    start = bench32_now();
+    for (size_t d = 0; d < ndocs; d++) {
+        Minhash32_text(&m, docs + d * len, len, w, sigs + d * k);
+    }
+    printf("%-28s %12.1f M/s\n", "shingles signed",
+           (double)(ndocs * (len - w + 1)) / ((double)(bench32_now() - start) / 1e3));
+
+    start = bench32_now();
+    for (size_t d = 0; d < ndocs; d++) {
+        Minhash32_bbit(&m, sigs + d * k, bits, packed + d * words);
+    }
+    printf("%-28s %12.1f ns\n", "compress", (double)(bench32_now() - start) / (double)ndocs);
+    start = bench32_now();
+    for (size_t d = 0; d < ndocs; d += 2) {
+        compressed += Minhash32_bbit_similarity(&m, packed + d * words,
+                                                packed + (d + 1) * words, bits);
+    }
+    printf("%-28s %12.1f ns\n", "compressed similarity",
+           (double)(bench32_now() - start) / (double)(ndocs / 2));
+    for (size_t d = 0; d < ndocs; d += 2) {
+        exact += Minhash32_similarity(&m, sigs + d * k, sigs + (d + 1) * k);
+    }
+    printf("%-28s %12.3f\n", "mean pair similarity", exact / (double)(ndocs / 2));
+    printf("%-28s %12.3f (%u bits, %zu bytes)\n", "  from compressed",
+           compressed / (double)(ndocs / 2), bits, words * sizeof(uint64_t));
+
+    start = bench32_now();
+    for (size_t d = 0; d < ndocs; d++) {
+        if ((err = Minhash32_lsh_add(&x, sigs + d * k, (uint32_t)d)) != 0) {
+            fail("Minhash32_lsh_add", err);
+        }
+    }
+    printf("%-28s %12.1f ns\n", "LSH add", (double)(bench32_now() - start) / (double)ndocs);
+    start = bench32_now();
+    for (size_t d = 0; d < ndocs; d++) {
+        const size_t n = Minhash32_lsh_query(&x, sigs + d * k, out, ndocs);
+        size_t pair = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            pair += out[i] == (d ^ 1);
+        }
+        found += pair;
+        /* Every document finds itself */
+        others += n - 1 - pair;
+    }
+    printf("%-28s %12.1f ns\n", "LSH query", (double)(bench32_now() - start) / (double)ndocs);
+    printf("%-28s %12.3f (%u bands of %u)\n", "pairs found", (double)found / (double)ndocs,
+           bands, rows);
+    printf("%-28s %12.3f\n", "other candidates per query", (double)others / (double)ndocs);
+
+    Minhash32_lsh_free(&x);
+    Minhash32_free(&m);
+    free(docs);
+    free(sigs);
+    free(packed);
+    free(out);
+    return 0;
+}
@@ -0,0 +1,265 @@
+/*
+ * Others32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Small reference implementations of other 32-bit hashers, written
+ * from their published descriptions, for comparison benchmarks only:
+ * Austin Appleby's MurmurHash3_x86_32, Yann Collet's xxHash32,
+ * FNV-1a, and CRC32C (Castagnoli) in software and with SSE4.2.
+ * All of them take the same arguments as Combo32; the 64-bit seed is
+ * folded to 32 bits where the hasher only takes a 32-bit seed.
+ */
+
+#ifndef OTHERS32_H
+#define OTHERS32_H
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define OTHERS32_HAS_SSE42 1
+  #include <nmmintrin.h>
+#endif
+
+static inline uint32_t others32_read32(const uint8_t *p) {
+    uint32_t v;
+
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint32_t others32_rotl(const uint32_t x, const int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t others32_fold_seed(const uint64_t seed) {
+    return (uint32_t)seed ^ (uint32_t)(seed >> 32);
+}
+
+/*------------------------------------------------------------ */
+
+/* MurmurHash3_x86_32 */
+static uint32_t Murmur3_32(const void *in, const size_t len, const uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)in;
+    const uint32_t c1 = UINT32_C(0xCC9E2D51);
+    const uint32_t c2 = UINT32_C(0x1B873593);
+    const size_t nblocks = len / 4;
+    uint32_t h = others32_fold_seed(seed);
+    uint32_t k = 0;
+
+    for (size_t i = 0; i < nblocks; i++) {
+        k = others32_read32(p + i * 4);
+        k *= c1;
+        k = others32_rotl(k, 15);
+        k *= c2;
+        h ^= k;
+        h = others32_rotl(h, 13);
+        h = h * 5 + UINT32_C(0xE6546B64);
+    }
+
+    p += nblocks * 4;
+    k = 0;
+    switch (len & 3) {
+        case 3: k ^= (uint32_t)p[2] << 16; /* fall through */
+        case 2: k ^= (uint32_t)p[1] << 8;  /* fall through */
+        case 1: k ^= p[0];
+                k *= c1;
+                k = others32_rotl(k, 15);
+                k *= c2;
+                h ^= k;
+    }
+
+    h ^= (uint32_t)len;
+    h ^= h >> 16;
+    h *= UINT32_C(0x85EBCA6B);
+    h ^= h >> 13;
+    h *= UINT32_C(0xC2B2AE35);
+    h ^= h >> 16;
+    return h;
+}
+
+/*------------------------------------------------------------ */
+
+/* xxHash32 */
+#define XXH32_P1 UINT32_C(0x9E3779B1)
+#define XXH32_P2 UINT32_C(0x85EBCA77)
+#define XXH32_P3 UINT32_C(0xC2B2AE3D)
+#define XXH32_P4 UINT32_C(0x27D4EB2F)
+#define XXH32_P5 UINT32_C(0x165667B1)
+
+static inline uint32_t xxh32_round(uint32_t acc, const uint32_t input) {
+    acc += input * XXH32_P2;
+    acc = others32_rotl(acc, 13);
+    return acc * XXH32_P1;
+}
+
+static uint32_t XXH32(const void *in, const size_t len, const uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)in;
+    const uint8_t * const end = p + len;
+    const uint32_t s = others32_fold_seed(seed);
+    uint32_t h;
+
+    if (len >= 16) {
+        const uint8_t * const limit = end - 16;
+        uint32_t v1 = s + XXH32_P1 + XXH32_P2;
+        uint32_t v2 = s + XXH32_P2;
+        uint32_t v3 = s;
+        uint32_t v4 = s - XXH32_P1;
+
+        do {
+            v1 = xxh32_round(v1, others32_read32(p));
+            v2 = xxh32_round(v2, others32_read32(p + 4));
+            v3 = xxh32_round(v3, others32_read32(p + 8));
+            v4 = xxh32_round(v4, others32_read32(p + 12));
+            p += 16;
+        } while (p <= limit);
+
+        h = others32_rotl(v1, 1) + others32_rotl(v2, 7) +
+            others32_rotl(v3, 12) + others32_rotl(v4, 18);
+    } else {
+        h = s + XXH32_P5;
+    }
+
+    h += (uint32_t)len;
+    while (p + 4 <= end) {
+        h += others32_read32(p) * XXH32_P3;
+        h = others32_rotl(h, 17) * XXH32_P4;
+        p += 4;
+    }
+    while (p < end) {
+        h += (*p++) * XXH32_P5;
+        h = others32_rotl(h, 11) * XXH32_P1;
+    }
+
+    h ^= h >> 15;
+    h *= XXH32_P2;
+    h ^= h >> 13;
+    h *= XXH32_P3;
+    h ^= h >> 16;
+    return h;
+}
+
+/*------------------------------------------------------------ */
+
+/* FNV-1a, with the seed mixed into the offset basis */
+static uint32_t FNV1a_32(const void *in, const size_t len, const uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)in;
+    uint32_t h = UINT32_C(0x811C9DC5) ^ others32_fold_seed(seed);
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= UINT32_C(0x01000193);
+    }
+    return h;
+}
+
+/*------------------------------------------------------------ */
+
+/* CRC32C, reflected polynomial 0x82F63B78, with the seed as the initial
+ * value.  The software version is slicing-by-8.
+ */
+static uint32_t crc32c_table[8][256];
+
+static void CRC32C_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+
+        for (int j = 0; j < 8; j++) {
+            c = (c >> 1) ^ (UINT32_C(0x82F63B78) & (0 - (c & 1)));
+        }
+        crc32c_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            const uint32_t c = crc32c_table[t - 1][i];
+
+            crc32c_table[t][i] = (c >> 8) ^ crc32c_table[0][c & 0xFF];
+        }
+    }
+}
+
+static uint32_t CRC32C_sw(const void *in, const size_t len, const uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)in;
+    size_t n = len;
+    uint32_t c = ~others32_fold_seed(seed);
+
+    while (n >= 8) {
+        const uint32_t lo = others32_read32(p) ^ c;
+        const uint32_t hi = others32_read32(p + 4);
+
+        c = crc32c_table[7][ lo        & 0xFF] ^
+            crc32c_table[6][(lo >>  8) & 0xFF] ^
+            crc32c_table[5][(lo >> 16) & 0xFF] ^
+            crc32c_table[4][ lo >> 24        ] ^
+            crc32c_table[3][ hi        & 0xFF] ^
+            crc32c_table[2][(hi >>  8) & 0xFF] ^
+            crc32c_table[1][(hi >> 16) & 0xFF] ^
+            crc32c_table[0][ hi >> 24        ];
+        p += 8;
+        n -= 8;
+    }
+    while (n-- > 0) {
+        c = (c >> 8) ^ crc32c_table[0][(c ^ *p++) & 0xFF];
+    }
+    return ~c;
+}
+
+#if defined(OTHERS32_HAS_SSE42)
+__attribute__((target("sse4.2")))
+static uint32_t CRC32C_hw(const void *in, const size_t len, const uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)in;
+    size_t n = len;
+    uint32_t c = ~others32_fold_seed(seed);
+
+  #if defined(__x86_64__)
+    uint64_t c64 = c;
+
+    while (n >= 8) {
+        uint64_t v;
+
+        memcpy(&v, p, 8);
+        c64 = _mm_crc32_u64(c64, v);
+        p += 8;
+        n -= 8;
+    }
+    c = (uint32_t)c64;
+  #endif
+    while (n >= 4) {
+        c = _mm_crc32_u32(c, others32_read32(p));
+        p += 4;
+        n -= 4;
+    }
+    while (n-- > 0) {
+        c = _mm_crc32_u8(c, *p++);
+    }
+    return ~c;
+}
+
+/* Non-zero if this CPU can run CRC32C_hw */
+static inline int CRC32C_hw_supported(void) {
+    return __builtin_cpu_supports("sse4.2");
+}
+#else
+static inline int CRC32C_hw_supported(void) {
+    return 0;
+}
+#endif /* OTHERS32_HAS_SSE42 */
+
+#endif /* OTHERS32_H */
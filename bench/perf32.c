@@ -0,0 +1,290 @@
+/*
+ * Perf32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Hardware performance counter benchmark, Linux only.
+ * Uses perf_event_open to count instructions, cycles, branch misses,
+ * and L1D and LLC read misses while each hasher runs over keys from
+ * one length class, and reports the counts per hash and per byte.
+ * Lengths are drawn at random within each class, so that the tail
+ * switch statements see a realistic mix; use -x to hash only the
+ * shortest length in each class and see the predictable case.
+ * The "none" row runs the same loop with a hasher that only returns
+ * its length, and can be subtracted from the other rows.
+ */
+
+#define _GNU_SOURCE
+
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "bench32.h"
+
+#define NUM_KEYS (1 << 16)
+#define BUFFER_SIZE (16 << 20)
+
+struct counter {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+    int fd;
+    double value;
+};
+
+#define CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | \
+     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static struct counter counters[] = {
+    { "instr",   PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,   -1, 0 },
+    { "cycles",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,     -1, 0 },
+    { "br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,  -1, 0 },
+    { "l1d-miss", PERF_TYPE_HW_CACHE,
+      CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D), -1, 0 },
+    { "llc-miss", PERF_TYPE_HW_CACHE,
+      CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL), -1, 0 },
+};
+
+#define NUM_COUNTERS (sizeof(counters) / sizeof(counters[0]))
+
+enum { INSTR, CYCLES, BRMISS, L1DMISS, LLCMISS };
+
+struct length_class {
+    const char *name;
+    size_t min;
+    size_t max;
+};
+
+static const struct length_class classes[] = {
+    { "0-3",       0,    3 },
+    { "4-7",       4,    7 },
+    { "8-15",      8,   15 },
+    { "16-31",    16,   31 },
+    { "32-63",    32,   63 },
+    { "64-127",   64,  127 },
+    { "128-1023", 128, 1023 },
+    { "1024-8191", 1024, 8191 },
+};
+
+#define NUM_CLASSES (sizeof(classes) / sizeof(classes[0]))
+
+/*------------------------------------------------------------ */
+
+static uint32_t none_hash(const void *in, const size_t len, const uint64_t seed) {
+    (void)in;
+    (void)seed;
+    return (uint32_t)len;
+}
+
+static int open_counter(struct counter *c) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = c->type;
+    attr.config = c->config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    c->fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    return c->fd;
+}
+
+static void start_counters(void) {
+    for (unsigned int i = 0; i < NUM_COUNTERS; i++) {
+        if (counters[i].fd >= 0) {
+            ioctl(counters[i].fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+/* Stop the counters and scale for multiplexing; -1 if unavailable */
+static void stop_counters(void) {
+    for (unsigned int i = 0; i < NUM_COUNTERS; i++) {
+        uint64_t v[3];
+
+        counters[i].value = -1.0;
+        if (counters[i].fd < 0) {
+            continue;
+        }
+        ioctl(counters[i].fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counters[i].fd, v, sizeof(v)) == sizeof(v) && v[2] != 0) {
+            counters[i].value = (double)v[0] * (double)v[1] / (double)v[2];
+        }
+    }
+}
+
+/*------------------------------------------------------------ */
+
+static uint32_t run(const bench32_hash_fn fn, const uint8_t *buf,
+                    const uint32_t *offsets, const uint16_t *lengths,
+                    const unsigned int reps) {
+    uint32_t sink = 0;
+
+    for (unsigned int r = 0; r < reps; r++) {
+        for (unsigned int k = 0; k < NUM_KEYS; k++) {
+            sink += fn(buf + offsets[k], lengths[k], r);
+        }
+    }
+    return sink;
+}
+
+static void print_value(const double value, const double divisor) {
+    if (value < 0.0) {
+        printf(" %8s", "n/a");
+    } else {
+        printf(" %8.3f", value / divisor);
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-r reps] [-x] [-H hasher]...\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    struct bench32_hasher hashers[BENCH32_NUM_HASHERS + 1];
+    int nhashers = 0;
+    unsigned int reps = 16;
+    int fixed = 0;
+    int available = 0;
+    uint8_t *buf;
+    uint32_t *offsets;
+    uint16_t *lengths;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:xH:")) != -1) {
+        switch (opt) {
+            case 'r': reps = (unsigned int)atoi(optarg); break;
+            case 'x': fixed = 1; break;
+            case 'H': {
+                const struct bench32_hasher *h = bench32_find_hasher(optarg);
+
+                if (h == NULL || (size_t)nhashers == BENCH32_NUM_HASHERS) {
+                    usage(argv[0]);
+                }
+                hashers[nhashers++] = *h;
+                break;
+            }
+            default: usage(argv[0]);
+        }
+    }
+    if (nhashers == 0) {
+        for (unsigned int i = 0; i < BENCH32_NUM_HASHERS; i++) {
+            hashers[nhashers++] = bench32_hashers[i];
+        }
+    }
+    hashers[nhashers].name = "none";
+    hashers[nhashers].fn = none_hash;
+    nhashers++;
+
+    for (unsigned int i = 0; i < NUM_COUNTERS; i++) {
+        if (open_counter(&counters[i]) >= 0) {
+            available++;
+        }
+    }
+    if (available == 0) {
+        fprintf(stderr, "perf_event_open failed; check "
+                "/proc/sys/kernel/perf_event_paranoid\n");
+        return 1;
+    }
+
+    buf = malloc(BUFFER_SIZE);
+    offsets = malloc(sizeof(*offsets) * NUM_KEYS);
+    lengths = malloc(sizeof(*lengths) * NUM_KEYS);
+    if (buf == NULL || offsets == NULL || lengths == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(buf, BUFFER_SIZE, 1);
+    Mult32_init();
+
+    printf("# lengths %s within each class, %u x %u hashes per row\n",
+           fixed ? "fixed at the minimum" : "random", reps, NUM_KEYS);
+    printf("%-11s %-9s %8s | %8s %8s %8s %8s %8s %8s | %8s %8s %8s %8s %8s\n",
+           "hasher", "class", "bytes", "instr", "cycles", "IPC",
+           "br-miss", "l1d-miss", "llc-miss",
+           "instr/B", "cyc/B", "brmis/KB", "l1d/KB", "llc/KB");
+
+    for (unsigned int c = 0; c < NUM_CLASSES; c++) {
+        struct Xorshift128p_state state = Xorshift128p_init(c);
+        const size_t span = classes[c].max - classes[c].min + 1;
+        uint64_t bytes = 0;
+        uint32_t offset = 0;
+
+        /* Keys are laid out back to back, wrapping at the buffer end */
+        for (unsigned int k = 0; k < NUM_KEYS; k++) {
+            const size_t len = fixed ? classes[c].min
+                                     : classes[c].min + Xorshift128p(&state) % span;
+
+            if (offset + len > BUFFER_SIZE) {
+                offset = 0;
+            }
+            offsets[k] = offset;
+            lengths[k] = (uint16_t)len;
+            offset += (uint32_t)len;
+            bytes += len;
+        }
+
+        for (int h = 0; h < nhashers; h++) {
+            const double n = (double)reps * NUM_KEYS;
+            const double nbytes = (double)reps * (double)bytes;
+
+            /* Warm up the caches and branch predictors */
+            bench32_sink += run(hashers[h].fn, buf, offsets, lengths, 1);
+
+            start_counters();
+            bench32_sink += run(hashers[h].fn, buf, offsets, lengths, reps);
+            stop_counters();
+
+            printf("%-11s %-9s %8.1f |", hashers[h].name, classes[c].name,
+                   (double)bytes / NUM_KEYS);
+            print_value(counters[INSTR].value, n);
+            print_value(counters[CYCLES].value, n);
+            if (counters[INSTR].value < 0.0 || counters[CYCLES].value <= 0.0) {
+                printf(" %8s", "n/a");
+            } else {
+                printf(" %8.3f", counters[INSTR].value / counters[CYCLES].value);
+            }
+            print_value(counters[BRMISS].value, n);
+            print_value(counters[L1DMISS].value, n);
+            print_value(counters[LLCMISS].value, n);
+            printf(" |");
+            if (nbytes == 0.0) {
+                printf(" %8s %8s %8s %8s %8s\n", "-", "-", "-", "-", "-");
+            } else {
+                print_value(counters[INSTR].value, nbytes);
+                print_value(counters[CYCLES].value, nbytes);
+                print_value(counters[BRMISS].value, nbytes / 1024.0);
+                print_value(counters[L1DMISS].value, nbytes / 1024.0);
+                print_value(counters[LLCMISS].value, nbytes / 1024.0);
+                printf("\n");
+            }
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * Perfect32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Minimal perfect hash benchmark.
+ * Builds a Perfect32 function over n distinct keys with 1 up to the
+ * given number of threads, checks that every key gets its own index,
+ * writes the blob to a file and maps it back, then compares random
+ * lookups through the mapped function with finds in a Robin32 map of
+ * the same keys.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "perfect32.h"
+#include "robin32.h"
+
+#define KEY_LEN 16
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static void fail(const char *what, const int err) {
+    fprintf(stderr, "%s failed: %d\n", what, err);
+    exit(1);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-q lookups] [-t threads] [-f file]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 10000000;
+    size_t nq = 10000000;
+    unsigned int nthreads = 4;
+    const char *path = "perfect32.bin";
+    struct Xorshift128p_state state = Xorshift128p_init(43);
+    struct perfect32 p;
+    const void **kp;
+    size_t *lens;
+    uint8_t *keys, *seen;
+    void *blob = NULL, *mapped;
+    size_t size = 0;
+    uint64_t start, sum = 0;
+    FILE *f;
+    int fd, opt, err;
+
+    while ((opt = getopt(argc, argv, "n:q:t:f:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'q': nq = (size_t)strtoull(optarg, NULL, 10); break;
+            case 't': nthreads = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'f': path = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0 || nthreads == 0) {
+        usage(argv[0]);
+    }
+    keys = malloc(n * KEY_LEN);
+    kp = malloc(n * sizeof(*kp));
+    lens = malloc(n * sizeof(*lens));
+    seen = calloc(n, 1);
+    if (keys == NULL || kp == NULL || lens == NULL || seen == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(keys, n * KEY_LEN, 47);
+    /* Number the keys so that none repeats */
+    for (size_t i = 0; i < n; i++) {
+        memcpy(keys + i * KEY_LEN, &i, sizeof(i));
+        kp[i] = keys + i * KEY_LEN;
+        lens[i] = KEY_LEN;
+    }
+    Mult32_init();
+
+    printf("# %zu keys of %d bytes\n", n, KEY_LEN);
+    /* 1, 2, 4 ... threads, then nthreads */
+    for (unsigned int t = 1;; t = t * 2 < nthreads ? t * 2 : nthreads) {
+        char name[32];
+
+        free(blob);
+        start = bench32_now();
+        if ((err = Perfect32_build(kp, lens, n, seed, t, &blob, &size)) != 0) {
+            fail("Perfect32_build", err);
+        }
+        snprintf(name, sizeof(name), "build, %u thread%s", t, t == 1 ? "" : "s");
+        printf("%-28s %12.1f ms\n", name, (double)(bench32_now() - start) / 1e6);
+        if (t == nthreads) {
+            break;
+        }
+    }
+
+    /* Write the blob out and use it from the file */
+    f = fopen(path, "wb");
+    if (f == NULL || fwrite(blob, 1, size, f) != size || fclose(f) != 0) {
+        fail("writing the blob", -1);
+    }
+    free(blob);
+    fd = open(path, O_RDONLY);
+    mapped = fd < 0 ? MAP_FAILED : mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        fail("mapping the blob", -1);
+    }
+    start = bench32_now();
+    if ((err = Perfect32_load(&p, mapped, size)) != 0) {
+        fail("Perfect32_load", err);
+    }
+    printf("%-28s %12.3f ms\n", "map and load", (double)(bench32_now() - start) / 1e6);
+    printf("%-28s %12.3f\n", "bits per key", Perfect32_bits_per_key(&p));
+
+    for (size_t i = 0; i < n; i++) {
+        const uint64_t k = Perfect32_lookup(&p, keys + i * KEY_LEN, KEY_LEN);
+
+        if (k >= n || seen[k]) {
+            fprintf(stderr, "key %zu: index %llu is not its own\n", i, (unsigned long long)k);
+            return 1;
+        }
+        seen[k] = 1;
+    }
+
+    start = bench32_now();
+    for (size_t i = 0; i < nq; i++) {
+        const size_t k = (size_t)(Xorshift128p(&state) % n);
+
+        sum += Perfect32_lookup(&p, keys + k * KEY_LEN, KEY_LEN);
+    }
+    printf("%-28s %12.1f ns\n", "Perfect32 lookup", (double)(bench32_now() - start) / (double)nq);
+
+    {
+        struct robin32 m;
+        int inserted;
+
+        Robin32_init(&m, 0, 0.8, seed);
+        for (size_t i = 0; i < n; i++) {
+            Robin32_insert(&m, keys + i * KEY_LEN, KEY_LEN, &inserted)->value = NULL;
+        }
+        start = bench32_now();
+        for (size_t i = 0; i < nq; i++) {
+            const size_t k = (size_t)(Xorshift128p(&state) % n);
+
+            sum += Robin32_find(&m, keys + k * KEY_LEN, KEY_LEN) != NULL;
+        }
+        printf("%-28s %12.1f ns\n", "Robin32 find", (double)(bench32_now() - start) / (double)nq);
+        printf("%-28s %12.3f\n", "Robin32 bits per key",
+               8.0 * (double)(m.nslots * sizeof(*m.slots)) / (double)n);
+        Robin32_free(&m);
+    }
+
+    munmap(mapped, size);
+    close(fd);
+    bench32_sink += (uint32_t)sum;
+    free(keys);
+    free(kp);
+    free(lens);
+    free(seen);
+    return 0;
+}
@@ -0,0 +1,411 @@
+/*
+ * Probe32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Probe-length quality benchmark.
+ * Feeds structured and adversarial key families, hashed with Combo32
+ * at several seeds, into linear-probing tables of power-of-two and
+ * non-power-of-two sizes at a range of load factors.
+ * Reports the mean and maximum successful probe lengths next to the
+ * values expected from a uniform hash, the mean unsuccessful probe
+ * length, and a chi-squared score of the bucket counts.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+
+#define MAX_KEY_LEN 64
+#define MAX_LOADS 16
+#define MAX_SEEDS 16
+
+struct keyset {
+    uint8_t *data;  /* MAX_KEY_LEN bytes reserved per key */
+    uint8_t *len;
+    uint32_t n;
+};
+
+enum family {
+    FAMILY_SEQ32,
+    FAMILY_SEQ64,
+    FAMILY_GRAY,
+    FAMILY_SPARSE,
+    FAMILY_PADDED,
+    FAMILY_PADDED48,
+    FAMILY_BOUNDARY,
+    FAMILY_RANDOM,
+    NUM_FAMILIES
+};
+
+static const char * const family_names[NUM_FAMILIES] = {
+    "seq32",     /* 4-byte little-endian counter */
+    "seq64",     /* 8-byte counter in the upper 32 bits */
+    "gray",      /* 16-byte keys, neighbours differ by a single bit */
+    "sparse",    /* 24 zero bytes with 1, 2, 3... bits set */
+    "padded",    /* "user:<n>" padded with spaces to 20 bytes */
+    "padded48",  /* "user:<n>" padded with zeros to 48 bytes */
+    "boundary",  /* "item/<n>" with lengths 28 to 36 */
+    "random",    /* 16 random bytes */
+};
+
+/*------------------------------------------------------------ */
+
+/* Key generators */
+
+static void put_u64(uint8_t *p, const uint64_t x) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(x >> (i * 8));
+    }
+}
+
+/* Enumerate keys of 24 bytes with w bits set, for w = 1, 2, 3 ... */
+static void gen_sparse(struct keyset *ks) {
+    const int nbits = 24 * 8;
+    int idx[MAX_KEY_LEN * 8];
+    uint32_t k = 0;
+
+    for (int w = 1; w <= nbits && k < ks->n; w++) {
+        for (int i = 0; i < w; i++) {
+            idx[i] = i;
+        }
+        while (k < ks->n) {
+            uint8_t *p = ks->data + (size_t)k * MAX_KEY_LEN;
+            int i;
+
+            for (i = 0; i < w; i++) {
+                p[idx[i] >> 3] |= (uint8_t)(1 << (idx[i] & 7));
+            }
+            ks->len[k++] = 24;
+
+            /* Next combination of w bit positions */
+            for (i = w - 1; i >= 0 && idx[i] == nbits - w + i; i--) {
+            }
+            if (i < 0) {
+                break;
+            }
+            idx[i]++;
+            for (i++; i < w; i++) {
+                idx[i] = idx[i - 1] + 1;
+            }
+        }
+    }
+}
+
+static void gen_keys(const enum family family, struct keyset *ks) {
+    uint8_t base[16];
+    uint64_t base64;
+
+    memset(ks->data, 0, (size_t)ks->n * MAX_KEY_LEN);
+    bench32_fill(base, sizeof(base), 0x5EED);
+    memcpy(&base64, base, 8);
+    if (family == FAMILY_SPARSE) {
+        gen_sparse(ks);
+        return;
+    }
+    if (family == FAMILY_RANDOM) {
+        bench32_fill(ks->data, (size_t)ks->n * MAX_KEY_LEN, 0xF00D);
+    }
+    for (uint32_t k = 0; k < ks->n; k++) {
+        uint8_t *p = ks->data + (size_t)k * MAX_KEY_LEN;
+        char *s = (char *)p;
+        int n;
+
+        switch (family) {
+            case FAMILY_SEQ32:
+                put_u64(p, k);
+                ks->len[k] = 4;
+                break;
+            case FAMILY_SEQ64:
+                put_u64(p, (uint64_t)k << 32);
+                ks->len[k] = 8;
+                break;
+            case FAMILY_GRAY:
+                memcpy(p, base, 16);
+                put_u64(p, (uint64_t)(k ^ (k >> 1)) ^ base64);
+                ks->len[k] = 16;
+                break;
+            case FAMILY_PADDED:
+                n = snprintf(s, MAX_KEY_LEN, "user:%u", k);
+                memset(p + n, ' ', 20 - (size_t)n);
+                ks->len[k] = 20;
+                break;
+            case FAMILY_PADDED48:
+                snprintf(s, MAX_KEY_LEN, "user:%u", k);
+                ks->len[k] = 48;
+                break;
+            case FAMILY_BOUNDARY:
+                n = snprintf(s, MAX_KEY_LEN, "item/%010u", k);
+                ks->len[k] = (uint8_t)(28 + k % 9);
+                memset(p + n, '.', ks->len[k] - (size_t)n);
+                break;
+            case FAMILY_RANDOM:
+                ks->len[k] = 16;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/*------------------------------------------------------------ */
+
+/* Bucket reductions */
+
+enum reduction {
+    REDUCE_MASK,      /* power-of-two size, low bits */
+    REDUCE_MOD,       /* non-power-of-two size, h % size */
+    REDUCE_MULHI,     /* non-power-of-two size, (h * size) >> 32 */
+    NUM_REDUCTIONS
+};
+
+static const char * const reduction_names[NUM_REDUCTIONS] = {
+    "mask", "mod", "mulhi"
+};
+
+static inline uint32_t reduce(const enum reduction r, const uint32_t h,
+                              const uint32_t size) {
+    switch (r) {
+        case REDUCE_MASK:  return h & (size - 1);
+        case REDUCE_MOD:   return h % size;
+        default:           return (uint32_t)(((uint64_t)h * size) >> 32);
+    }
+}
+
+static int is_prime(const uint32_t n) {
+    if (n < 2) {
+        return 0;
+    }
+    for (uint32_t d = 2; (uint64_t)d * d <= n; d++) {
+        if (n % d == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*------------------------------------------------------------ */
+
+struct probe_result {
+    double mean;
+    double unsuccessful;
+    uint32_t max;
+    double chi2z;
+};
+
+/* Insert the first n hashes into a linear-probing table */
+static void probe(const uint32_t *hashes, const uint32_t n,
+                  const enum reduction r, const uint32_t size,
+                  uint8_t *used, uint32_t *count,
+                  struct probe_result *res) {
+    uint64_t total = 0;
+    uint64_t unsuccessful = 0;
+    uint32_t max = 0;
+    uint32_t run = 0;
+    double chi2 = 0.0;
+    const double expected = (double)n / size;
+
+    memset(used, 0, size);
+    memset(count, 0, sizeof(*count) * size);
+    for (uint32_t k = 0; k < n; k++) {
+        uint32_t b = reduce(r, hashes[k], size);
+        uint32_t d = 1;
+
+        count[b]++;
+        while (used[b]) {
+            b = b + 1 == size ? 0 : b + 1;
+            d++;
+        }
+        used[b] = 1;
+        total += d;
+        max = d > max ? d : max;
+    }
+
+    /* An unsuccessful search starting at bucket b probes up to and
+     * including the next empty bucket.  Walk backwards twice around
+     * the table so that runs wrapping past the end are counted.
+     */
+    for (uint64_t i = 2 * (uint64_t)size; i-- > 0; ) {
+        const uint32_t b = (uint32_t)(i % size);
+
+        run = used[b] ? run + 1 : 0;
+        if (i < size) {
+            unsuccessful += run + 1;
+        }
+    }
+
+    for (uint32_t b = 0; b < size; b++) {
+        const double diff = count[b] - expected;
+
+        chi2 += diff * diff / expected;
+    }
+
+    res->mean = (double)total / n;
+    res->unsuccessful = (double)unsuccessful / size;
+    res->max = max;
+    /* Normalized so that a uniform hash scores about +-1 */
+    res->chi2z = (chi2 - (size - 1)) / sqrt(2.0 * (size - 1));
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-k log2_size] [-a load]... [-s seed]... [-f family]...\n",
+            prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    double loads[MAX_LOADS];
+    int nloads = 0;
+    uint64_t seeds[MAX_SEEDS];
+    int nseeds = 0;
+    int families[NUM_FAMILIES];
+    int nfamilies = 0;
+    int log2size = 20;
+    uint32_t sizes[NUM_REDUCTIONS];
+    uint32_t maxsize, maxkeys;
+    struct keyset ks;
+    uint32_t *hashes, *count;
+    uint8_t *used;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:a:s:f:")) != -1) {
+        switch (opt) {
+            case 'k': log2size = atoi(optarg); break;
+            case 'a':
+                if (nloads == MAX_LOADS) {
+                    usage(argv[0]);
+                }
+                loads[nloads++] = atof(optarg);
+                break;
+            case 's':
+                if (nseeds == MAX_SEEDS) {
+                    usage(argv[0]);
+                }
+                seeds[nseeds++] = strtoull(optarg, NULL, 0);
+                break;
+            case 'f': {
+                int f;
+
+                for (f = 0; f < NUM_FAMILIES; f++) {
+                    if (strcmp(optarg, family_names[f]) == 0) {
+                        break;
+                    }
+                }
+                if (f == NUM_FAMILIES || nfamilies == NUM_FAMILIES) {
+                    usage(argv[0]);
+                }
+                families[nfamilies++] = f;
+                break;
+            }
+            default: usage(argv[0]);
+        }
+    }
+    if (log2size < 4 || log2size > 28) {
+        usage(argv[0]);
+    }
+    if (nloads == 0) {
+        loads[nloads++] = 0.5;
+        loads[nloads++] = 0.75;
+        loads[nloads++] = 0.9;
+        loads[nloads++] = 0.95;
+    }
+    if (nseeds == 0) {
+        seeds[nseeds++] = 0;
+        seeds[nseeds++] = 1;
+        seeds[nseeds++] = UINT64_C(0xDEADBEEFDEADBEEF);
+    }
+    if (nfamilies == 0) {
+        for (int f = 0; f < NUM_FAMILIES; f++) {
+            families[nfamilies++] = f;
+        }
+    }
+
+    /* The non-power-of-two size is the largest prime below 3/4 of the
+     * power-of-two size, so that it is odd and far from any power of two.
+     */
+    sizes[REDUCE_MASK] = UINT32_C(1) << log2size;
+    sizes[REDUCE_MOD] = sizes[REDUCE_MASK] / 4 * 3;
+    while (!is_prime(sizes[REDUCE_MOD])) {
+        sizes[REDUCE_MOD]--;
+    }
+    sizes[REDUCE_MULHI] = sizes[REDUCE_MOD];
+    maxsize = sizes[REDUCE_MASK];
+
+    maxkeys = 0;
+    for (int a = 0; a < nloads; a++) {
+        if (loads[a] <= 0.0 || loads[a] >= 1.0) {
+            usage(argv[0]);
+        }
+        if ((uint32_t)(loads[a] * maxsize) > maxkeys) {
+            maxkeys = (uint32_t)(loads[a] * maxsize);
+        }
+    }
+
+    ks.n = maxkeys;
+    ks.data = malloc((size_t)maxkeys * MAX_KEY_LEN);
+    ks.len = malloc(maxkeys);
+    hashes = malloc(sizeof(*hashes) * maxkeys);
+    count = malloc(sizeof(*count) * maxsize);
+    used = malloc(maxsize);
+    if (ks.data == NULL || ks.len == NULL || hashes == NULL ||
+        count == NULL || used == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    printf("# linear probing, table sizes %u (mask) and %u (mod, mulhi)\n",
+           sizes[REDUCE_MASK], sizes[REDUCE_MOD]);
+    printf("# expect: mean probes for a uniform hash, 1/2 (1 + 1/(1 - a))\n");
+    printf("# chi2z: bucket chi-squared, normalized so a uniform hash is about +-1\n");
+    printf("%-9s %18s %-5s %9s %5s %8s %8s %6s %10s %8s\n",
+           "family", "seed", "table", "size", "load", "mean", "expect",
+           "max", "unsucc", "chi2z");
+
+    for (int f = 0; f < nfamilies; f++) {
+        gen_keys((enum family)families[f], &ks);
+        for (int s = 0; s < nseeds; s++) {
+            for (uint32_t k = 0; k < maxkeys; k++) {
+                hashes[k] = Combo32(ks.data + (size_t)k * MAX_KEY_LEN,
+                                    ks.len[k], seeds[s]);
+            }
+            for (int r = 0; r < NUM_REDUCTIONS; r++) {
+                for (int a = 0; a < nloads; a++) {
+                    const uint32_t n = (uint32_t)(loads[a] * sizes[r]);
+                    struct probe_result res;
+
+                    probe(hashes, n, (enum reduction)r, sizes[r],
+                          used, count, &res);
+                    printf("%-9s 0x%016llx %-5s %9u %5.2f %8.3f %8.3f %6u %10.3f %8.2f\n",
+                           family_names[families[f]],
+                           (unsigned long long)seeds[s], reduction_names[r],
+                           sizes[r], loads[a], res.mean,
+                           0.5 * (1.0 + 1.0 / (1.0 - loads[a])),
+                           res.max, res.unsuccessful, res.chi2z);
+                }
+            }
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Quotient32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Counting quotient filter benchmark.
+ * Inserts n distinct keys into two Quotient32 filters, half into each,
+ * key i (i mod 4) + 1 times, letting them double as they fill, and
+ * checks every count.  Then times count queries of inserted and other
+ * keys, merging the two filters, and writing the result to a file and
+ * reading it back.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "quotient32.h"
+
+#define KEY_LEN 16
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static void fail(const char *what, const int err) {
+    fprintf(stderr, "%s failed: %d\n", what, err);
+    exit(1);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-f file]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 4000000;
+    const char *path = "quotient32.bin";
+    struct quotient32 half[2], merged, loaded;
+    uint64_t start, inserts = 0, sum = 0;
+    size_t positives = 0;
+    uint8_t *keys;
+    int opt, err;
+
+    while ((opt = getopt(argc, argv, "n:f:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'f': path = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n < 2) {
+        usage(argv[0]);
+    }
+    /* The first n keys are inserted, the other n are not */
+    keys = malloc(2 * n * KEY_LEN);
+    if (keys == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(keys, 2 * n * KEY_LEN, 61);
+    /* Number the keys so that none repeats */
+    for (size_t i = 0; i < 2 * n; i++) {
+        memcpy(keys + i * KEY_LEN, &i, sizeof(i));
+    }
+    Mult32_init();
+
+    printf("# %zu keys of %d bytes, %d count bits per slot\n", n, KEY_LEN,
+           QUOTIENT32_COUNT_BITS);
+    start = bench32_now();
+    for (unsigned int h = 0; h < 2; h++) {
+        if ((err = Quotient32_init(&half[h], 0, seed)) != 0) {
+            fail("Quotient32_init", err);
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (size_t c = 0; c <= i % 4; c++) {
+            if ((err = Quotient32_insert(&half[i % 2], keys + i * KEY_LEN, KEY_LEN, 1)) != 0) {
+                fail("Quotient32_insert", err);
+            }
+            inserts++;
+        }
+    }
+    printf("%-28s %12.1f ns\n", "insert, growing", (double)(bench32_now() - start) / (double)inserts);
+
+    start = bench32_now();
+    if ((err = Quotient32_merge(&merged, &half[0], &half[1])) != 0) {
+        fail("Quotient32_merge", err);
+    }
+    printf("%-28s %12.1f ms\n", "merge halves", (double)(bench32_now() - start) / 1e6);
+    printf("%-28s %12.3f\n", "load", Quotient32_load(&merged));
+    printf("%-28s %12.2f\n", "bits per key", 8.0 * (double)Quotient32_bytes(&merged) / (double)n);
+
+    /* Another key with the same Combo32 value adds to a count */
+    for (size_t i = 0; i < n; i++) {
+        if (Quotient32_count(&merged, keys + i * KEY_LEN, KEY_LEN) < i % 4 + 1) {
+            fprintf(stderr, "key %zu: count too low\n", i);
+            return 1;
+        }
+    }
+
+    start = bench32_now();
+    for (size_t i = 0; i < n; i++) {
+        sum += Quotient32_count(&merged, keys + i * KEY_LEN, KEY_LEN);
+    }
+    printf("%-28s %12.1f ns\n", "count, inserted keys", (double)(bench32_now() - start) / (double)n);
+    start = bench32_now();
+    for (size_t i = n; i < 2 * n; i++) {
+        positives += Quotient32_contains(&merged, keys + i * KEY_LEN, KEY_LEN);
+    }
+    printf("%-28s %12.1f ns\n", "count, other keys", (double)(bench32_now() - start) / (double)n);
+    printf("%-28s %12.4f %%\n", "false positives", 100.0 * (double)positives / (double)n);
+
+    start = bench32_now();
+    if ((err = Quotient32_write(&merged, path)) != 0) {
+        fail("Quotient32_write", err);
+    }
+    printf("%-28s %12.1f ms\n", "write", (double)(bench32_now() - start) / 1e6);
+    start = bench32_now();
+    if ((err = Quotient32_read(&loaded, path)) != 0) {
+        fail("Quotient32_read", err);
+    }
+    printf("%-28s %12.1f ms\n", "read", (double)(bench32_now() - start) / 1e6);
+    if (Quotient32_count(&loaded, keys, KEY_LEN) != Quotient32_count(&merged, keys, KEY_LEN)) {
+        fprintf(stderr, "read back a different filter\n");
+        return 1;
+    }
+
+    bench32_sink += (uint32_t)sum;
+    Quotient32_free(&half[0]);
+    Quotient32_free(&half[1]);
+    Quotient32_free(&merged);
+    Quotient32_free(&loaded);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*
+ * Reduce32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Bucket reduction benchmark.
+ * First compares the memory of power-of-2 tables with tables sized from
+ * the Range32 ladder, for several key counts and on average over key
+ * counts spread evenly on a log scale.
+ * Then times the reductions alone: masking, %, the Range32 multiply-high
+ * and its batch version.
+ * Last, times random lookups of Combo32-hashed keys in a table of n
+ * buckets, with a power-of-2 size and masking, and with a ladder size
+ * and either the multiply-high or %.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "range32.h"
+
+#define NUM_HASHES (1 << 22)
+#define KEY_LEN 16
+
+/*------------------------------------------------------------ */
+
+static void memory_report(const double max_load, const size_t bucket_bytes) {
+    static const double counts[] = {
+        1e3, 1e5, 1e6, 3e6, 1e7, 3e7, 1e8, 3e8, 1e9, 3e9
+    };
+    double saved = 0.0;
+    double load2 = 0.0, loadr = 0.0;
+    int samples = 0;
+
+    printf("# memory at a maximum load of %.3f, %zu bytes per bucket\n",
+           max_load, bucket_bytes);
+    printf("%12s %12s %8s %12s %8s %8s\n",
+           "keys", "pow2", "load", "ladder", "load", "saved");
+    for (unsigned int i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        const uint64_t n = (uint64_t)counts[i];
+        const uint64_t p = Range32_pow2_for(n, max_load);
+        const uint64_t r = Range32_size_for(n, max_load);
+
+        if ((double)p * max_load < (double)n) {
+            break;
+        }
+        printf("%12" PRIu64 " %11.1fM %8.3f %11.1fM %8.3f %7.1f%%\n", n,
+               (double)(p * bucket_bytes) / 1048576.0, (double)n / (double)p,
+               (double)(r * bucket_bytes) / 1048576.0, (double)n / (double)r,
+               100.0 * (1.0 - (double)r / (double)p));
+    }
+
+    /* Key counts spread evenly on a log scale from 1000 to 3.5 billion */
+    for (double lg = log(1e3); lg < log(3.5e9); lg += 0.001) {
+        const uint64_t n = (uint64_t)exp(lg);
+        const uint64_t p = Range32_pow2_for(n, max_load);
+        const uint64_t r = Range32_size_for(n, max_load);
+
+        saved += 1.0 - (double)r / (double)p;
+        load2 += (double)n / (double)p;
+        loadr += (double)n / (double)r;
+        samples++;
+    }
+    printf("%12s %12s %8.3f %12s %8.3f %7.1f%%\n", "average", "",
+           load2 / samples, "", loadr / samples, 100.0 * saved / samples);
+}
+
+/*------------------------------------------------------------ */
+
+/* Nanoseconds per hash to reduce every hash, best of three runs */
+static double time_reduce(const int how, const uint32_t *hashes, uint32_t *out,
+                          const uint64_t nbuckets) {
+    uint64_t best = UINT64_MAX;
+
+    for (int run = 0; run < 3; run++) {
+        const uint64_t start = bench32_now();
+        uint64_t ns;
+
+        switch (how) {
+            case 0:
+                for (size_t i = 0; i < NUM_HASHES; i++) {
+                    out[i] = Range32_mask(hashes[i], nbuckets);
+                }
+                break;
+            case 1:
+                for (size_t i = 0; i < NUM_HASHES; i++) {
+                    out[i] = hashes[i] % (uint32_t)nbuckets;
+                }
+                break;
+            case 2:
+                for (size_t i = 0; i < NUM_HASHES; i++) {
+                    out[i] = Range32_reduce(hashes[i], nbuckets);
+                }
+                break;
+            default:
+                Range32_reduce_batch(hashes, NUM_HASHES, (uint32_t)nbuckets, out);
+                break;
+        }
+        ns = bench32_now() - start;
+        best = ns < best ? ns : best;
+        bench32_sink += out[NUM_HASHES / 2];
+    }
+    return (double)best / NUM_HASHES;
+}
+
+/* Nanoseconds per lookup: hash a key, reduce it, read its bucket */
+static double time_lookup(const int how, const uint8_t *keys, const size_t nkeys,
+                          const uint32_t *table, const uint64_t nbuckets) {
+    const uint64_t start = bench32_now();
+    uint32_t sum = 0;
+
+    for (size_t i = 0; i < nkeys; i++) {
+        const uint32_t h = Combo32(keys + i * KEY_LEN, KEY_LEN, 0);
+        uint32_t b;
+
+        switch (how) {
+            case 0:  b = Range32_mask(h, nbuckets); break;
+            case 1:  b = h % (uint32_t)nbuckets; break;
+            default: b = Range32_reduce(h, nbuckets); break;
+        }
+        sum += table[b];
+    }
+    bench32_sink += sum;
+    return (double)(bench32_now() - start) / (double)nkeys;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-a max_load] [-w bucket_bytes] [-q lookups]\n",
+            prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 40000000;
+    double max_load = 0.875;
+    size_t bucket_bytes = 8;
+    size_t nq = (size_t)4 << 20;
+    struct Xorshift128p_state state = Xorshift128p_init(23);
+    uint32_t *hashes, *out, *table;
+    uint64_t pow2, ladder;
+    uint8_t *keys;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:a:w:q:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'a': max_load = atof(optarg); break;
+            case 'w': bucket_bytes = (size_t)strtoul(optarg, NULL, 10); break;
+            case 'q': nq = (size_t)strtoull(optarg, NULL, 10); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0 || max_load <= 0.0 || max_load > 1.0 || bucket_bytes == 0 || nq == 0) {
+        usage(argv[0]);
+    }
+    Mult32_init();
+
+    memory_report(max_load, bucket_bytes);
+
+    pow2 = Range32_pow2_for(n, max_load);
+    ladder = Range32_size_for(n, max_load);
+    if (ladder >= RANGE32_MAX_SIZE) {
+        fprintf(stderr, "too many keys for a 32-bit hash\n");
+        return 1;
+    }
+    hashes = malloc(sizeof(*hashes) * NUM_HASHES);
+    out = malloc(sizeof(*out) * NUM_HASHES);
+    table = malloc(sizeof(*table) * pow2);
+    keys = malloc(nq * KEY_LEN);
+    if (hashes == NULL || out == NULL || table == NULL || keys == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < NUM_HASHES; i++) {
+        hashes[i] = (uint32_t)Xorshift128p(&state);
+    }
+    /* Touch every bucket so that page faults are not timed */
+    for (uint64_t i = 0; i < pow2; i++) {
+        table[i] = (uint32_t)i;
+    }
+    bench32_fill(keys, nq * KEY_LEN, 29);
+
+    printf("\n# reduction alone, ns per hash, %" PRIu64 " buckets (%" PRIu64
+           " for mask)\n", ladder, pow2);
+    printf("%-12s %8.3f\n", "mask", time_reduce(0, hashes, out, pow2));
+    printf("%-12s %8.3f\n", "mod", time_reduce(1, hashes, out, ladder));
+    printf("%-12s %8.3f\n", "mulhi", time_reduce(2, hashes, out, ladder));
+    printf("%-12s %8.3f\n", "mulhi batch", time_reduce(3, hashes, out, ladder));
+
+    printf("\n# %zu keys, random lookups of 4-byte buckets, ns per lookup\n", n);
+    printf("%-12s %12s %10s\n", "reduction", "buckets", "ns");
+    printf("%-12s %12" PRIu64 " %10.2f\n", "mask", pow2,
+           time_lookup(0, keys, nq, table, pow2));
+    printf("%-12s %12" PRIu64 " %10.2f\n", "mod", ladder,
+           time_lookup(1, keys, nq, table, ladder));
+    printf("%-12s %12" PRIu64 " %10.2f\n", "mulhi", ladder,
+           time_lookup(2, keys, nq, table, ladder));
+
+    free(hashes);
+    free(out);
+    free(table);
+    free(keys);
+    return 0;
+}
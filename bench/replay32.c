@@ -0,0 +1,261 @@
+/*
+ * Replay32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Production-replay benchmark.
+ * Reads a histogram written by Combo32_histogram_dump(), generates
+ * random keys whose lengths and seeds follow it, and times Komi32,
+ * Mult32, Combo32, and Combo32 with a range of Komi32/Mult32
+ * thresholds over those keys, so that the threshold can be tuned
+ * against real traffic.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+
+/* Longest key generated for a "loglen" bucket */
+#define MAX_REPLAY_LEN (1 << 20)
+#define MAX_BUCKETS 4096
+#define MAX_SEEDS 64
+
+struct bucket {
+    size_t min;      /* lengths min to max, uniformly */
+    size_t max;
+    uint64_t count;
+};
+
+struct histogram {
+    struct bucket len[MAX_BUCKETS];
+    unsigned int nlen;
+    uint64_t seed[MAX_SEEDS];
+    uint64_t seed_count[MAX_SEEDS];
+    unsigned int nseeds;
+    uint64_t other_seeds;
+};
+
+static size_t threshold;
+
+/* Combo32 with a run-time threshold */
+static uint32_t combo32_at(const void *in, const size_t len, const uint64_t seed) {
+    if (likely(len < threshold)) {
+        return Komi32(in, len, seed);
+    }
+    return Mult32(in, len, seed);
+}
+
+/*------------------------------------------------------------ */
+
+static int read_histogram(FILE *f, struct histogram *h) {
+    char line[256];
+
+    memset(h, 0, sizeof(*h));
+    while (fgets(line, sizeof(line), f) != NULL) {
+        unsigned long long a, b;
+
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if (h->nlen < MAX_BUCKETS &&
+            sscanf(line, "len %llu %llu", &a, &b) == 2) {
+            h->len[h->nlen].min = (size_t)a;
+            h->len[h->nlen].max = (size_t)a;
+            h->len[h->nlen++].count = b;
+        } else if (h->nlen < MAX_BUCKETS &&
+                   sscanf(line, "loglen %llu %llu", &a, &b) == 2) {
+            if (a >= 20) {
+                a = 19;
+            }
+            h->len[h->nlen].min = (size_t)1 << a;
+            h->len[h->nlen].max = ((size_t)2 << a) - 1;
+            h->len[h->nlen++].count = b;
+        } else if (sscanf(line, "seed other %llu", &b) == 1) {
+            h->other_seeds += b;
+        } else if (h->nseeds < MAX_SEEDS &&
+                   sscanf(line, "seed %llx %llu", &a, &b) == 2) {
+            h->seed[h->nseeds] = a;
+            h->seed_count[h->nseeds++] = b;
+        } else {
+            fprintf(stderr, "bad histogram line: %s", line);
+            return -1;
+        }
+    }
+    return h->nlen == 0 ? -1 : 0;
+}
+
+/* Pick an index with probability proportional to its count */
+static unsigned int pick(const uint64_t *cumulative, const unsigned int n,
+                         const uint64_t r) {
+    const uint64_t x = r % cumulative[n - 1];
+    unsigned int lo = 0;
+    unsigned int hi = n - 1;
+
+    while (lo < hi) {
+        const unsigned int mid = (lo + hi) / 2;
+
+        if (cumulative[mid] > x) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+static double time_hasher(const bench32_hash_fn fn, const uint8_t *buf,
+                          const size_t *offsets, const size_t *lengths,
+                          const uint64_t *seeds, const size_t nkeys,
+                          const unsigned int reps) {
+    uint32_t sink = 0;
+    uint64_t start, best = UINT64_MAX;
+
+    for (unsigned int r = 0; r < reps; r++) {
+        start = bench32_now();
+        for (size_t k = 0; k < nkeys; k++) {
+            sink += fn(buf + offsets[k], lengths[k], seeds[k]);
+        }
+        start = bench32_now() - start;
+        best = start < best ? start : best;
+    }
+    bench32_sink += sink;
+    return (double)best / (double)nkeys;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-r reps] [histogram_file]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    static const size_t thresholds[] = { 8, 16, 24, 32, 40, 48, 64, 96, 128 };
+    static struct histogram h;
+    uint64_t cumulative_len[MAX_BUCKETS];
+    uint64_t cumulative_seed[MAX_SEEDS + 1];
+    struct Xorshift128p_state state = Xorshift128p_init(42);
+    size_t nkeys = 1 << 20;
+    unsigned int reps = 5;
+    size_t *offsets, *lengths;
+    uint64_t *seeds;
+    uint64_t total = 0, short_keys = 0, tails[8] = { 0 };
+    size_t bytes = 0;
+    uint8_t *buf;
+    FILE *f = stdin;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+            case 'n': nkeys = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'r': reps = (unsigned int)atoi(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind < argc && (f = fopen(argv[optind], "r")) == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    if (read_histogram(f, &h) != 0 || nkeys == 0 || reps == 0) {
+        usage(argv[0]);
+    }
+
+    for (unsigned int i = 0; i < h.nlen; i++) {
+        total += h.len[i].count;
+        cumulative_len[i] = total;
+        if (h.len[i].max < 32) {
+            short_keys += h.len[i].count;
+            tails[h.len[i].min & 7] += h.len[i].count;
+        }
+    }
+    for (unsigned int i = 0; i < h.nseeds; i++) {
+        cumulative_seed[i] = (i == 0 ? 0 : cumulative_seed[i - 1]) +
+                             h.seed_count[i];
+    }
+    cumulative_seed[h.nseeds] = (h.nseeds == 0 ? 0 : cumulative_seed[h.nseeds - 1]) +
+                                h.other_seeds;
+    if (total == 0) {
+        usage(argv[0]);
+    }
+
+    /* Draw the keys, then fill one buffer with them back to back */
+    offsets = malloc(sizeof(*offsets) * nkeys);
+    lengths = malloc(sizeof(*lengths) * nkeys);
+    seeds = malloc(sizeof(*seeds) * nkeys);
+    if (offsets == NULL || lengths == NULL || seeds == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (size_t k = 0; k < nkeys; k++) {
+        const struct bucket *b = &h.len[pick(cumulative_len, h.nlen,
+                                             Xorshift128p(&state))];
+
+        lengths[k] = b->min + (size_t)(Xorshift128p(&state) % (b->max - b->min + 1));
+        offsets[k] = bytes;
+        bytes += lengths[k];
+        if (cumulative_seed[h.nseeds] == 0) {
+            seeds[k] = 0;
+        } else {
+            const unsigned int s = pick(cumulative_seed, h.nseeds + 1,
+                                        Xorshift128p(&state));
+
+            seeds[k] = s < h.nseeds ? h.seed[s] : Xorshift128p(&state);
+        }
+    }
+    buf = malloc(bytes + 1);
+    if (buf == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(buf, bytes + 1, 7);
+    Mult32_init();
+
+    printf("# %llu recorded hashes, %.1f%% shorter than 32 bytes\n",
+           (unsigned long long)total, 100.0 * (double)short_keys / (double)total);
+    printf("# short keys by length mod 8:");
+    for (int i = 0; i < 8; i++) {
+        printf(" %d:%.1f%%", i,
+               short_keys ? 100.0 * (double)tails[i] / (double)short_keys : 0.0);
+    }
+    printf("\n# %zu replayed keys, %.1f bytes on average\n",
+           nkeys, (double)bytes / (double)nkeys);
+    printf("%-16s %10s %10s\n", "hasher", "ns/hash", "GB/s");
+
+    for (unsigned int i = 0; i < BENCH32_NUM_HASHERS; i++) {
+        const double ns = time_hasher(bench32_hashers[i].fn, buf, offsets,
+                                      lengths, seeds, nkeys, reps);
+
+        printf("%-16s %10.2f %10.3f\n", bench32_hashers[i].name, ns,
+               (double)bytes / (double)nkeys / ns);
+    }
+    for (unsigned int i = 0; i < sizeof(thresholds) / sizeof(thresholds[0]); i++) {
+        char name[32];
+        double ns;
+
+        threshold = thresholds[i];
+        ns = time_hasher(combo32_at, buf, offsets, lengths, seeds, nkeys, reps);
+        snprintf(name, sizeof(name), "Combo32 <%zu%s", threshold,
+                 threshold == COMBO32_THRESHOLD ? "*" : "");
+        printf("%-16s %10.2f %10.3f\n", name, ns,
+               (double)bytes / (double)nkeys / ns);
+    }
+    printf("# * is the compiled-in COMBO32_THRESHOLD\n");
+    return 0;
+}
@@ -0,0 +1,345 @@
+/*
+ * Scaling32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Multi-core scaling benchmark.
+ * Runs each hasher on 1 to N threads, pinned either one per physical
+ * core ("nosmt") or packed onto SMT siblings ("smt"), reading either a
+ * private buffer per thread or one buffer shared by all threads.
+ * Reports aggregate and per-thread throughput, the input bandwidth
+ * consumed, and the scaling efficiency relative to one thread.
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+
+#define MAX_LENGTHS 16
+
+struct cpu_info {
+    int cpu;
+    int package;
+    int core;
+};
+
+/* Per-thread state, padded so that threads never share a cache line */
+struct thread_state {
+    const struct bench32_hasher *hasher;
+    const uint8_t *buf;
+    size_t buflen;
+    size_t len;
+    int cpu;
+    uint64_t hashes;
+    uint64_t ns;
+    uint32_t sink;
+    uint8_t pad[64];
+};
+
+static atomic_int stop_flag;
+static pthread_barrier_t start_barrier;
+
+/*------------------------------------------------------------ */
+
+/* Read one integer from a sysfs topology file, -1 if it is missing */
+static int read_topology(const int cpu, const char *what) {
+    char path[128];
+    FILE *f;
+    int value = -1;
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, what);
+    f = fopen(path, "r");
+    if (f != NULL) {
+        if (fscanf(f, "%d", &value) != 1) {
+            value = -1;
+        }
+        fclose(f);
+    }
+    return value;
+}
+
+/* Build the two CPU orders.
+ * nosmt: the first logical CPU of each physical core.
+ * smt:   all logical CPUs, with SMT siblings next to each other, so that
+ *        N threads land on N/2 cores.
+ */
+static void build_cpu_lists(struct cpu_info *cpus, const int ncpu,
+                            int *smt, int *nsmt, int *nosmt, int *nnosmt) {
+    *nsmt = 0;
+    *nnosmt = 0;
+    for (int i = 0; i < ncpu; i++) {
+        int seen = 0;
+
+        for (int j = 0; j < i; j++) {
+            if (cpus[j].package == cpus[i].package &&
+                cpus[j].core == cpus[i].core) {
+                seen = 1;
+                break;
+            }
+        }
+        if (seen) {
+            continue;
+        }
+        nosmt[(*nnosmt)++] = cpus[i].cpu;
+        for (int j = i; j < ncpu; j++) {
+            if (cpus[j].package == cpus[i].package &&
+                cpus[j].core == cpus[i].core) {
+                smt[(*nsmt)++] = cpus[j].cpu;
+            }
+        }
+    }
+}
+
+/*------------------------------------------------------------ */
+
+static void *worker(void *arg) {
+    struct thread_state *ts = (struct thread_state *)arg;
+    const bench32_hash_fn fn = ts->hasher->fn;
+    const uint8_t *buf = ts->buf;
+    const size_t len = ts->len;
+    const size_t last = ts->buflen - len;
+    size_t offset = 0;
+    uint64_t hashes = 0;
+    uint32_t sink = 0;
+    uint64_t start;
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(ts->cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    pthread_barrier_wait(&start_barrier);
+    start = bench32_now();
+    while (likely(!atomic_load_explicit(&stop_flag, memory_order_relaxed))) {
+        for (int i = 0; i < 256; i++) {
+            sink += fn(buf + offset, len, hashes);
+            offset += len;
+            if (unlikely(offset > last)) {
+                offset = 0;
+            }
+            hashes++;
+        }
+    }
+    ts->ns = bench32_now() - start;
+    ts->hashes = hashes;
+    ts->sink = sink;
+    return NULL;
+}
+
+/* Run one configuration and return aggregate hashes per second */
+static double run(const struct bench32_hasher *hasher, const size_t len,
+                  const int *cpulist, const char *order, const int nthreads,
+                  const int shared,
+                  uint8_t **bufs, const size_t buflen,
+                  const unsigned int duration_ms) {
+    pthread_t tid[nthreads];
+    struct thread_state ts[nthreads];
+    double total = 0.0;
+    double tmin = 0.0;
+    double tmax = 0.0;
+    uint64_t bytes = 0;
+    uint64_t ns = 0;
+
+    atomic_store(&stop_flag, 0);
+    pthread_barrier_init(&start_barrier, NULL, (unsigned int)nthreads + 1);
+    for (int t = 0; t < nthreads; t++) {
+        memset(&ts[t], 0, sizeof(ts[t]));
+        ts[t].hasher = hasher;
+        ts[t].buf = shared ? bufs[0] + ((size_t)t * 4096) % (buflen / 2)
+                           : bufs[t];
+        ts[t].buflen = shared ? buflen / 2 : buflen;
+        ts[t].len = len;
+        ts[t].cpu = cpulist[t];
+        pthread_create(&tid[t], NULL, worker, &ts[t]);
+    }
+    pthread_barrier_wait(&start_barrier);
+    usleep(duration_ms * 1000);
+    atomic_store(&stop_flag, 1);
+    for (int t = 0; t < nthreads; t++) {
+        double rate;
+
+        pthread_join(tid[t], NULL);
+        rate = (double)ts[t].hashes * 1e9 / (double)ts[t].ns;
+        total += rate;
+        tmin = (t == 0 || rate < tmin) ? rate : tmin;
+        tmax = (t == 0 || rate > tmax) ? rate : tmax;
+        bytes += ts[t].hashes * len;
+        ns = ts[t].ns > ns ? ts[t].ns : ns;
+        bench32_sink += ts[t].sink;
+    }
+    pthread_barrier_destroy(&start_barrier);
+
+    printf("%-11s %5zu %-7s %-5s %4d %12.2f %10.2f %10.2f %10.2f %9.3f",
+           hasher->name, len, shared ? "shared" : "private",
+           order, nthreads,
+           total / 1e6, tmin / 1e6, total / nthreads / 1e6, tmax / 1e6,
+           (double)bytes / (double)ns);
+    return total;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-t max_threads] [-l len]... [-b buffer_MiB]\n"
+            "          [-d duration_ms] [-m private|shared|both]\n"
+            "          [-s smt|nosmt|both] [-H hasher]...\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t lengths[MAX_LENGTHS];
+    int nlengths = 0;
+    const struct bench32_hasher *hashers[BENCH32_NUM_HASHERS];
+    int nhashers = 0;
+    int ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = ncpu;
+    size_t buflen = (size_t)64 << 20;
+    unsigned int duration_ms = 500;
+    int do_private = 1, do_shared = 1;
+    int do_smt = 1, do_nosmt = 1;
+    struct cpu_info *cpus;
+    int *smt, *nosmt;
+    int nsmt, nnosmt;
+    uint8_t **bufs;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:l:b:d:m:s:H:")) != -1) {
+        switch (opt) {
+            case 't': max_threads = atoi(optarg); break;
+            case 'l':
+                if (nlengths == MAX_LENGTHS) {
+                    usage(argv[0]);
+                }
+                lengths[nlengths++] = (size_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'b': buflen = (size_t)strtoul(optarg, NULL, 10) << 20; break;
+            case 'd': duration_ms = (unsigned int)atoi(optarg); break;
+            case 'm':
+                do_private = strcmp(optarg, "shared") != 0;
+                do_shared  = strcmp(optarg, "private") != 0;
+                break;
+            case 's':
+                do_smt   = strcmp(optarg, "nosmt") != 0;
+                do_nosmt = strcmp(optarg, "smt") != 0;
+                break;
+            case 'H':
+                if ((size_t)nhashers == BENCH32_NUM_HASHERS ||
+                    (hashers[nhashers] = bench32_find_hasher(optarg)) == NULL) {
+                    usage(argv[0]);
+                }
+                nhashers++;
+                break;
+            default: usage(argv[0]);
+        }
+    }
+    if (nlengths == 0) {
+        lengths[nlengths++] = 8;
+        lengths[nlengths++] = 31;
+        lengths[nlengths++] = 64;
+        lengths[nlengths++] = 1024;
+    }
+    if (nhashers == 0) {
+        for (unsigned int i = 0; i < BENCH32_NUM_HASHERS; i++) {
+            hashers[nhashers++] = &bench32_hashers[i];
+        }
+    }
+    if (max_threads < 1 || max_threads > ncpu) {
+        max_threads = ncpu;
+    }
+
+    cpus = malloc(sizeof(*cpus) * (size_t)ncpu);
+    smt = malloc(sizeof(*smt) * (size_t)ncpu);
+    nosmt = malloc(sizeof(*nosmt) * (size_t)ncpu);
+    bufs = malloc(sizeof(*bufs) * (size_t)max_threads);
+    for (int i = 0; i < ncpu; i++) {
+        cpus[i].cpu = i;
+        cpus[i].package = read_topology(i, "physical_package_id");
+        cpus[i].core = read_topology(i, "core_id");
+        if (cpus[i].core < 0) {
+            /* No topology information, treat every CPU as its own core */
+            cpus[i].core = i;
+        }
+    }
+    build_cpu_lists(cpus, ncpu, smt, &nsmt, nosmt, &nnosmt);
+
+    /* Each private buffer is filled by the main thread; on NUMA systems
+     * run under "numactl --localalloc" or use the shared mode to compare.
+     */
+    for (int t = 0; t < max_threads; t++) {
+        bufs[t] = malloc(buflen);
+        if (bufs[t] == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        bench32_fill(bufs[t], buflen, (uint64_t)t);
+    }
+
+    /* Do the one-time initialization before any thread starts, so that
+     * the Mult32 and Mult32_impl rows differ only by the test.
+     */
+    Mult32_init();
+
+    printf("# %d online CPUs, %d physical cores, %zu MiB per buffer\n",
+           ncpu, nnosmt, buflen >> 20);
+    printf("# GB/s is the input read bandwidth consumed by hashing\n");
+    printf("%-11s %5s %-7s %-5s %4s %12s %10s %10s %10s %9s %6s\n",
+           "hasher", "len", "buffer", "smt", "thr", "Mhash/s", "min/thr",
+           "avg/thr", "max/thr", "GB/s", "eff");
+
+    for (int h = 0; h < nhashers; h++) {
+        for (int l = 0; l < nlengths; l++) {
+            if (lengths[l] == 0 || lengths[l] > buflen / 2) {
+                continue;
+            }
+            for (int shared = 0; shared < 2; shared++) {
+                if ((shared && !do_shared) || (!shared && !do_private)) {
+                    continue;
+                }
+                for (int s = 0; s < 2; s++) {
+                    const int *list = s ? smt : nosmt;
+                    const int nlist = s ? nsmt : nnosmt;
+                    const int limit = nlist < max_threads ? nlist : max_threads;
+                    double single = 0.0;
+
+                    if ((s && !do_smt) || (!s && !do_nosmt)) {
+                        continue;
+                    }
+                    for (int n = 1; n <= limit; n = (n * 2 > limit && n < limit) ? limit : n * 2) {
+                        double rate = run(hashers[h], lengths[l], list,
+                                          s ? "smt" : "nosmt", n, shared,
+                                          bufs, buflen, duration_ms);
+
+                        if (n == 1) {
+                            single = rate;
+                        }
+                        printf(" %5.1f%%\n", 100.0 * rate / (single * n));
+                        fflush(stdout);
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * Simhash32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SimHash benchmark.
+ * Fingerprints n short texts of t weighted tokens each, half of them
+ * copies of the other half with one token changed, adding the tokens one
+ * bit at a time, one token at a time, and in batches.  Then indexes the
+ * fingerprints to find those within k bits, and times queries for the
+ * copies, counting how many find their original.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "simhash32.h"
+
+#define TOKEN_LEN 6
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+/* Add a token the plain way, one bit at a time */
+static void bitwise_add(struct simhash32 *s, const void *token, const size_t len, const float w) {
+    const uint64_t hash = Simhash32_hash(s, token, len);
+
+    for (unsigned int b = 0; b < s->bits; b++) {
+        if ((hash >> b & 1) != 0) {
+            s->sum[b] += w;
+        }
+    }
+    s->total += w;
+}
+
+static void fail(const char *what, const int err) {
+    fprintf(stderr, "%s failed: %d\n", what, err);
+    exit(1);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n texts] [-t tokens] [-b bits] [-k distance]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 1000000;
+    size_t ntokens = 24;
+    unsigned int bits = 64, k = 3;
+    struct simhash32 s;
+    struct simhash32_index x;
+    uint8_t *tokens;
+    const void **tp;
+    size_t *lens;
+    float *weights;
+    uint64_t *fps;
+    uint32_t out[64];
+    uint64_t start, check = 0;
+    size_t found = 0, candidates = 0;
+    int opt, err;
+
+    while ((opt = getopt(argc, argv, "n:t:b:k:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10) & ~(size_t)1; break;
+            case 't': ntokens = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'b': bits = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'k': k = (unsigned int)strtoul(optarg, NULL, 10); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0 || ntokens == 0) {
+        usage(argv[0]);
+    }
+    if ((err = Simhash32_init(&s, bits, seed)) != 0) {
+        fail("Simhash32_init", err);
+    }
+    tokens = malloc(n * ntokens * TOKEN_LEN);
+    tp = malloc(n * ntokens * sizeof(*tp));
+    lens = malloc(n * ntokens * sizeof(*lens));
+    weights = malloc(n * ntokens * sizeof(*weights));
+    fps = malloc(n * sizeof(*fps));
+    if (tokens == NULL || tp == NULL || lens == NULL || weights == NULL || fps == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(tokens, n * ntokens * TOKEN_LEN, 79);
+    /* Text i + n/2 is text i with its first token changed */
+    memcpy(tokens + n / 2 * ntokens * TOKEN_LEN, tokens, n / 2 * ntokens * TOKEN_LEN);
+    for (size_t i = n / 2; i < n; i++) {
+        tokens[i * ntokens * TOKEN_LEN] ^= 1;
+    }
+    for (size_t i = 0; i < n * ntokens; i++) {
+        tp[i] = tokens + i * TOKEN_LEN;
+        lens[i] = TOKEN_LEN;
+        weights[i] = 1.0f + (float)(i % ntokens % 4);
+    }
+    Mult32_init();
+
+    printf("# %zu texts of %zu tokens of %d bytes, %u-bit fingerprints\n",
+           n, ntokens, TOKEN_LEN, bits);
+    start = bench32_now();
+    for (size_t i = 0; i < n; i++) {
+        Simhash32_clear(&s);
+        for (size_t j = i * ntokens; j < (i + 1) * ntokens; j++) {
+            bitwise_add(&s, tp[j], lens[j], weights[j]);
+        }
+        check += Simhash32_final(&s);
+    }
+    printf("%-28s %12.1f ns/token\n", "bit by bit",
+           (double)(bench32_now() - start) / (double)(n * ntokens));
+
+    start = bench32_now();
+    for (size_t i = 0; i < n; i++) {
+        Simhash32_clear(&s);
+        for (size_t j = i * ntokens; j < (i + 1) * ntokens; j++) {
+            Simhash32_add(&s, tp[j], lens[j], weights[j]);
+        }
+        check -= Simhash32_final(&s);
+    }
+    printf("%-28s %12.1f ns/token\n", "Simhash32 add",
+           (double)(bench32_now() - start) / (double)(n * ntokens));
+
+    start = bench32_now();
+    for (size_t i = 0; i < n; i++) {
+        Simhash32_clear(&s);
+        Simhash32_add_batch(&s, tp + i * ntokens, lens + i * ntokens, weights + i * ntokens,
+                            ntokens);
+        fps[i] = Simhash32_final(&s);
+    }
+    printf("%-28s %12.1f ns/token\n", "Simhash32 add batch",
+           (double)(bench32_now() - start) / (double)(n * ntokens));
+    if (check != 0) {
+        fprintf(stderr, "fingerprints differ\n");
+        return 1;
+    }
+
+    start = bench32_now();
+    if ((err = Simhash32_index_build(&x, fps, n / 2, bits, k)) != 0) {
+        fail("Simhash32_index_build", err);
+    }
+    printf("%-28s %12.1f ms\n", "index build", (double)(bench32_now() - start) / 1e6);
+    start = bench32_now();
+    for (size_t i = n / 2; i < n; i++) {
+        const size_t c = Simhash32_index_query(&x, fps[i], out, sizeof(out) / sizeof(out[0]));
+
+        for (size_t j = 0; j < c && j < sizeof(out) / sizeof(out[0]); j++) {
+            found += out[j] == i - n / 2;
+        }
+        candidates += c;
+    }
+    printf("%-28s %12.1f ns\n", "index query", (double)(bench32_now() - start) / (double)(n / 2));
+    printf("%-28s %12.3f (within %u bits)\n", "originals found",
+           (double)found / (double)(n / 2), k);
+    printf("%-28s %12.3f\n", "matches per query", (double)candidates / (double)(n / 2));
+
+    Simhash32_index_free(&x);
+    free(tokens);
+    free(tp);
+    free(lens);
+    free(weights);
+    free(fps);
+    return 0;
+}
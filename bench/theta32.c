@@ -0,0 +1,188 @@
+/*
+ * Theta32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Set operations benchmark.
+ * Sketches two days of n distinct keys each, sharing a fraction o of
+ * them, in Theta32 sketches keeping k hashes.  Times adding the keys one
+ * at a time and in batches, and adding their hashes one at a time and
+ * through the SIMD theta check.  Then prints the estimated sizes of the
+ * days, their union, intersection and difference against the true ones,
+ * and times combining, storing and loading the compact sketches.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "theta32.h"
+
+#define KEY_LEN 16
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static void fail(const char *what, const int err) {
+    fprintf(stderr, "%s failed: %d\n", what, err);
+    exit(1);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n keys] [-k hashes] [-o overlap]\n", prog);
+    exit(1);
+}
+
+static void report(const char *name, const double estimate, const double exact) {
+    printf("%-28s %14.1f %14.0f %+9.3f%%\n", name, estimate, exact,
+           exact != 0.0 ? 100.0 * (estimate - exact) / exact : 0.0);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 10000000;
+    size_t k = 4096;
+    double overlap = 0.5;
+    struct theta32 f;
+    struct theta32_compact day[2], c;
+    const void **kp;
+    size_t *lens, shift, bytes;
+    uint8_t *keys, *stored;
+    uint64_t *hashes, start;
+    int opt, err;
+
+    while ((opt = getopt(argc, argv, "n:k:o:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'k': k = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'o': overlap = atof(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0 || overlap < 0.0 || overlap > 1.0) {
+        usage(argv[0]);
+    }
+    /* Day d has keys d * shift to d * shift + n - 1 */
+    shift = n - (size_t)((double)n * overlap);
+    keys = malloc((n + shift) * KEY_LEN);
+    kp = malloc((n + shift) * sizeof(*kp));
+    lens = malloc((n + shift) * sizeof(*lens));
+    hashes = malloc(n * sizeof(*hashes));
+    if (keys == NULL || kp == NULL || lens == NULL || hashes == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(keys, (n + shift) * KEY_LEN, 67);
+    /* Number the keys so that none repeats */
+    for (size_t i = 0; i < n + shift; i++) {
+        memcpy(keys + i * KEY_LEN, &i, sizeof(i));
+        kp[i] = keys + i * KEY_LEN;
+        lens[i] = KEY_LEN;
+    }
+    Mult32_init();
+
+    printf("# 2 days of %zu keys of %d bytes, %zu in common, %zu hashes kept\n",
+           n, KEY_LEN, n - shift, k);
+    if ((err = Theta32_init(&f, k, seed)) != 0) {
+        fail("Theta32_init", err);
+    }
+    start = bench32_now();
+    for (size_t i = 0; i < n; i++) {
+        Theta32_add(&f, keys + i * KEY_LEN, KEY_LEN);
+    }
+    printf("%-28s %12.1f ns\n", "add", (double)(bench32_now() - start) / (double)n);
+
+    Theta32_clear(&f);
+    start = bench32_now();
+    Theta32_add_batch(&f, kp, lens, n);
+    printf("%-28s %12.1f ns\n", "add batch", (double)(bench32_now() - start) / (double)n);
+
+    for (size_t i = 0; i < n; i++) {
+        hashes[i] = Theta32_hash(&f, keys + i * KEY_LEN, KEY_LEN);
+    }
+    Theta32_clear(&f);
+    start = bench32_now();
+    for (size_t i = 0; i < n; i++) {
+        Theta32_add_hash(&f, hashes[i]);
+    }
+    printf("%-28s %12.2f ns\n", "add hash", (double)(bench32_now() - start) / (double)n);
+
+    Theta32_clear(&f);
+    start = bench32_now();
+    Theta32_add_hashes(&f, hashes, n);
+    printf("%-28s %12.2f ns\n", "add hashes, theta checked", (double)(bench32_now() - start) / (double)n);
+
+    for (unsigned int d = 0; d < 2; d++) {
+        Theta32_clear(&f);
+        Theta32_add_batch(&f, kp + d * shift, lens, n);
+        if ((err = Theta32_compact(&f, &day[d])) != 0) {
+            fail("Theta32_compact", err);
+        }
+    }
+
+    printf("%-28s %14s %14s %10s\n", "", "estimate", "exact", "error");
+    report("day 0", Theta32_compact_estimate(&day[0]), (double)n);
+    report("day 1", Theta32_compact_estimate(&day[1]), (double)n);
+
+    start = bench32_now();
+    if ((err = Theta32_union(&c, &day[0], &day[1], k)) != 0) {
+        fail("Theta32_union", err);
+    }
+    report("union", Theta32_compact_estimate(&c), (double)(n + shift));
+    Theta32_compact_free(&c);
+    if ((err = Theta32_intersect(&c, &day[0], &day[1])) != 0) {
+        fail("Theta32_intersect", err);
+    }
+    report("intersection", Theta32_compact_estimate(&c), (double)(n - shift));
+    Theta32_compact_free(&c);
+    if ((err = Theta32_a_not_b(&c, &day[0], &day[1])) != 0) {
+        fail("Theta32_a_not_b", err);
+    }
+    report("day 0 not day 1", Theta32_compact_estimate(&c), (double)shift);
+    Theta32_compact_free(&c);
+    printf("%-28s %12.1f us\n", "combine, all three", (double)(bench32_now() - start) / 1e3);
+
+    bytes = Theta32_stored_size(&day[0]);
+    stored = malloc(bytes);
+    if (stored == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    start = bench32_now();
+    Theta32_store(&day[0], stored);
+    if ((err = Theta32_load(&c, stored, bytes)) != 0) {
+        fail("Theta32_load", err);
+    }
+    printf("%-28s %12.1f us\n", "store and load", (double)(bench32_now() - start) / 1e3);
+    printf("%-28s %12zu bytes\n", "stored size", bytes);
+    bench32_sink += (uint32_t)c.n;
+
+    Theta32_compact_free(&c);
+    Theta32_compact_free(&day[0]);
+    Theta32_compact_free(&day[1]);
+    Theta32_free(&f);
+    free(stored);
+    free(keys);
+    free(kp);
+    free(lens);
+    free(hashes);
+    return 0;
+}
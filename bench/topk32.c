@@ -0,0 +1,249 @@
+/*
+ * Topk32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Heavy hitters benchmark.
+ * Feeds a stream of n keys, drawn from m distinct keys with Zipf
+ * frequencies of exponent s, to a Topk32 tracker of k counters, timing
+ * each update against just hashing the key.  Then feeds it to t trackers
+ * in turn, as t threads would, and times merging those.  Prints how many
+ * of the true k / 10 most frequent keys each finds among its k / 10
+ * highest counts, and last times the updates of the keys the first
+ * tracker ended with, each of which finds its counter.  First checks a
+ * tracker whose counters all have different counts.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench32.h"
+#include "topk32.h"
+
+#define KEY_LEN 16
+
+static const uint64_t seed = 0x5EED;
+
+/*------------------------------------------------------------ */
+
+static const uint64_t *sort_counts;
+
+static int compare_count(const void *a, const void *b) {
+    const uint64_t x = sort_counts[*(const uint32_t *)a], y = sort_counts[*(const uint32_t *)b];
+
+    return (x < y) - (x > y);
+}
+
+static void fail(const char *what, const int err) {
+    fprintf(stderr, "%s failed: %d\n", what, err);
+    exit(1);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n updates] [-m distinct] [-k counters] [-s exponent] "
+            "[-t trackers]\n", prog);
+    exit(1);
+}
+
+/* Four counters of counts 1 to 4, the one of 4 going up, and a new key
+ * taking over the counter of 1, which must be at the top of the heap
+ */
+static void check_distinct_counts(void) {
+    static const char *const names[] = { "a", "b", "c", "d", "e" };
+    static const uint64_t expect[] = { 0, 2, 3, 5, 2 };
+    struct topk32 t;
+    int err;
+
+    if ((err = Topk32_init(&t, 4, seed)) != 0) {
+        fail("Topk32_init", err);
+    }
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j <= i; j++) {
+            Topk32_add(&t, names[i], 1, 1);
+        }
+    }
+    Topk32_add(&t, "d", 1, 1);
+    /* Takes over the counter of a */
+    Topk32_add(&t, "e", 1, 1);
+    for (int i = 0; i < 5; i++) {
+        const uint64_t count = Topk32_count(&t, names[i], 1, NULL);
+
+        if (count != expect[i]) {
+            fprintf(stderr, "key %s: count %llu, not %llu\n", names[i],
+                    (unsigned long long)count, (unsigned long long)expect[i]);
+            exit(1);
+        }
+    }
+    Topk32_free(&t);
+}
+
+/* How many of the top keys the tracker lists among its top */
+static size_t recall(const struct topk32 *t, const uint32_t *order, const size_t top) {
+    struct topk32_item *items = malloc(top * sizeof(*items));
+    const size_t n = Topk32_list(t, items, top);
+    size_t hits = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t id;
+
+        memcpy(&id, items[i].key, sizeof(id));
+        for (size_t j = 0; j < top; j++) {
+            hits += order[j] == id;
+        }
+    }
+    free(items);
+    return hits;
+}
+
+int main(int argc, char **argv) {
+    size_t n = 20000000;
+    size_t m = 10000000;
+    uint32_t k = 1000;
+    unsigned int ntrackers = 4;
+    double s = 1.1;
+    struct Xorshift128p_state state = Xorshift128p_init(83);
+    struct topk32 t, *parts;
+    uint8_t *keys;
+    uint32_t *stream, *order;
+    uint64_t *exact, start;
+    double *cdf;
+    size_t top, hot;
+    int opt, err;
+
+    while ((opt = getopt(argc, argv, "n:m:k:s:t:")) != -1) {
+        switch (opt) {
+            case 'n': n = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'm': m = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'k': k = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 's': s = atof(optarg); break;
+            case 't': ntrackers = (unsigned int)strtoul(optarg, NULL, 10); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0 || m == 0 || k < 10 || ntrackers == 0) {
+        usage(argv[0]);
+    }
+    top = k / 10;
+    keys = malloc(m * KEY_LEN);
+    exact = calloc(m, sizeof(*exact));
+    order = malloc(m * sizeof(*order));
+    cdf = malloc(m * sizeof(*cdf));
+    stream = malloc(n * sizeof(*stream));
+    parts = malloc(ntrackers * sizeof(*parts));
+    if (keys == NULL || exact == NULL || order == NULL || cdf == NULL || stream == NULL ||
+        parts == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench32_fill(keys, m * KEY_LEN, 89);
+    /* Number the keys so that none repeats */
+    for (size_t i = 0; i < m; i++) {
+        memcpy(keys + i * KEY_LEN, &i, sizeof(i));
+        cdf[i] = (i > 0 ? cdf[i - 1] : 0.0) + pow((double)(i + 1), -s);
+        order[i] = (uint32_t)i;
+    }
+    /* Key i with probability proportional to 1 / (i + 1)^s */
+    for (size_t i = 0; i < n; i++) {
+        const double u = (double)(Xorshift128p(&state) >> 11) / 9007199254740992.0 * cdf[m - 1];
+        size_t lo = 0, hi = m - 1;
+
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+
+            if (cdf[mid] < u) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        stream[i] = (uint32_t)lo;
+        exact[lo]++;
+    }
+    sort_counts = exact;
+    qsort(order, m, sizeof(*order), compare_count);
+    Mult32_init();
+    check_distinct_counts();
+
+    printf("# %zu updates of %zu keys of %d bytes, Zipf exponent %.2f, %u counters\n",
+           n, m, KEY_LEN, s, k);
+    if ((err = Topk32_init(&t, k, seed)) != 0) {
+        fail("Topk32_init", err);
+    }
+    /* Reading and hashing the keys alone, which every update does */
+    start = bench32_now();
+    for (size_t i = 0; i < n; i++) {
+        bench32_sink += Topk32_hash(&t, keys + (size_t)stream[i] * KEY_LEN, KEY_LEN);
+    }
+    printf("%-28s %12.1f ns\n", "hash only", (double)(bench32_now() - start) / (double)n);
+    start = bench32_now();
+    for (size_t i = 0; i < n; i++) {
+        Topk32_add(&t, keys + (size_t)stream[i] * KEY_LEN, KEY_LEN, 1);
+    }
+    printf("%-28s %12.1f ns\n", "update", (double)(bench32_now() - start) / (double)n);
+    printf("%-28s %8zu of %zu\n", "top keys found", recall(&t, order, top), top);
+
+    for (unsigned int p = 0; p < ntrackers; p++) {
+        if ((err = Topk32_init(&parts[p], k, seed)) != 0) {
+            fail("Topk32_init", err);
+        }
+    }
+    /* Consecutive runs of the stream to each tracker */
+    for (size_t i = 0; i < n; i++) {
+        Topk32_add(&parts[i * ntrackers / n], keys + (size_t)stream[i] * KEY_LEN, KEY_LEN, 1);
+    }
+    start = bench32_now();
+    for (unsigned int p = 1; p < ntrackers; p++) {
+        if ((err = Topk32_merge(&parts[0], &parts[p])) != 0) {
+            fail("Topk32_merge", err);
+        }
+    }
+    printf("%-28s %12.1f us\n", "merge all", (double)(bench32_now() - start) / 1e3);
+    printf("%-28s %8zu of %zu\n", "top keys found, merged", recall(&parts[0], order, top), top);
+
+    /* The stream's updates of keys the tracker ended up with, replayed:
+     * each finds its counter, as a frequent key's update mostly does
+     */
+    hot = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (Topk32_count(&t, keys + (size_t)stream[i] * KEY_LEN, KEY_LEN, NULL) != 0) {
+            stream[hot++] = stream[i];
+        }
+    }
+    start = bench32_now();
+    for (size_t i = 0; i < hot; i++) {
+        Topk32_add(&t, keys + (size_t)stream[i] * KEY_LEN, KEY_LEN, 1);
+    }
+    printf("%-28s %12.1f ns\n", "update, tracked key",
+           hot > 0 ? (double)(bench32_now() - start) / (double)hot : 0.0);
+
+    for (unsigned int p = 0; p < ntrackers; p++) {
+        Topk32_free(&parts[p]);
+    }
+    Topk32_free(&t);
+    free(keys);
+    free(exact);
+    free(order);
+    free(cdf);
+    free(stream);
+    free(parts);
+    return 0;
+}
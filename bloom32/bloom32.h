@@ -0,0 +1,269 @@
+/*
+ * Bloom32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A cache-line-blocked Bloom filter for byte strings, written in C.
+ * Each key is hashed once with Combo32x2.  The first hash picks one
+ * aligned 64-byte block, and the second, multiplied by eight fixed odd
+ * salts, picks one bit in each of the block's eight 64-bit words, so
+ * adding or testing a key touches one cache line.  With AVX2 the eight
+ * bits are made and tested in two registers.
+ */
+
+#ifndef BLOOM32_H
+#define BLOOM32_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* comment out the next line if you don't want AVX2 */
+#define BLOOM32_USE_SIMD 1
+
+#if defined(BLOOM32_USE_SIMD) && BLOOM32_USE_SIMD && defined(__AVX2__)
+  #define BLOOM32_AVX2 1
+  #include <immintrin.h>
+#endif
+
+/* Bits set per key, one in each word of a block */
+#define BLOOM32_K 8
+#define BLOOM32_BLOCK 64
+/* Keys hashed and prefetched together by the batch functions */
+#define BLOOM32_BATCH 16
+
+struct bloom32_block {
+    uint64_t word[BLOOM32_K];
+};
+
+struct bloom32 {
+    struct bloom32_block *blocks;      /* aligned to BLOOM32_BLOCK */
+    void *memory;                      /* what to free for blocks */
+    size_t nblocks;
+    uint64_t seed;
+};
+
+/* Odd multipliers whose top 6 bits of h2 * salt pick the bit of each word */
+static const uint32_t bloom32_salt[BLOOM32_K] = {
+    UINT32_C(0x47B6137B), UINT32_C(0x44974D91), UINT32_C(0x8824AD5B), UINT32_C(0xA2B7289D),
+    UINT32_C(0x705495C7), UINT32_C(0x2DF1424B), UINT32_C(0x9EFC4947), UINT32_C(0x5C6BFB31)
+};
+
+/*------------------------------------------------------------ */
+
+/* Bloom32 helpers */
+
+static inline size_t bloom32_block_of(const struct bloom32 *f, const uint32_t h1) {
+    return (size_t)(((uint64_t)h1 * f->nblocks) >> 32);
+}
+
+#if defined(BLOOM32_AVX2)
+
+/* The eight one-bit masks, in two registers of four words */
+static inline void bloom32_masks(const uint32_t h2, __m256i *lo, __m256i *hi) {
+    const __m256i salt = _mm256_loadu_si256((const __m256i *)bloom32_salt);
+    const __m256i bits = _mm256_srli_epi32(
+        _mm256_mullo_epi32(_mm256_set1_epi32((int)h2), salt), 26);
+    const __m256i one = _mm256_set1_epi64x(1);
+
+    *lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bits)));
+    *hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bits, 1)));
+}
+
+static inline void bloom32_set(struct bloom32_block *b, const uint32_t h2) {
+    __m256i lo, hi;
+    __m256i *w = (__m256i *)b->word;
+
+    bloom32_masks(h2, &lo, &hi);
+    _mm256_store_si256(w, _mm256_or_si256(_mm256_load_si256(w), lo));
+    _mm256_store_si256(w + 1, _mm256_or_si256(_mm256_load_si256(w + 1), hi));
+}
+
+static inline int bloom32_test(const struct bloom32_block *b, const uint32_t h2) {
+    __m256i lo, hi;
+    const __m256i *w = (const __m256i *)b->word;
+
+    bloom32_masks(h2, &lo, &hi);
+    /* testc is 1 when every bit of the mask is set in the block */
+    return _mm256_testc_si256(_mm256_load_si256(w), lo) &
+           _mm256_testc_si256(_mm256_load_si256(w + 1), hi);
+}
+
+#else
+
+static inline void bloom32_set(struct bloom32_block *b, const uint32_t h2) {
+    for (unsigned int i = 0; i < BLOOM32_K; i++) {
+        b->word[i] |= UINT64_C(1) << ((h2 * bloom32_salt[i]) >> 26);
+    }
+}
+
+static inline int bloom32_test(const struct bloom32_block *b, const uint32_t h2) {
+    uint64_t missing = 0;
+
+    for (unsigned int i = 0; i < BLOOM32_K; i++) {
+        missing |= ~b->word[i] & (UINT64_C(1) << ((h2 * bloom32_salt[i]) >> 26));
+    }
+    return missing == 0;
+}
+
+#endif
+
+/*------------------------------------------------------------ */
+
+/* Bloom32 filter functions */
+
+/* Size the filter for n keys at bits_per_key bits each; 0 selects 12,
+ * for a false positive rate of about 0.4%.
+ * Returns 0, or -1 if out of memory.
+ */
+static int Bloom32_init(struct bloom32 *f, const size_t n, double bits_per_key,
+                        const uint64_t seed) {
+    size_t nblocks;
+
+    if (bits_per_key <= 0.0) {
+        bits_per_key = 12.0;
+    }
+    nblocks = (size_t)((double)n * bits_per_key / (8.0 * BLOOM32_BLOCK)) + 1;
+    f->memory = malloc(nblocks * sizeof(struct bloom32_block) + BLOOM32_BLOCK - 1);
+    if (f->memory == NULL) {
+        return -1;
+    }
+    f->blocks = (struct bloom32_block *)
+        (((uintptr_t)f->memory + BLOOM32_BLOCK - 1) & ~(uintptr_t)(BLOOM32_BLOCK - 1));
+    memset(f->blocks, 0, nblocks * sizeof(struct bloom32_block));
+    f->nblocks = nblocks;
+    f->seed = seed;
+    return 0;
+}
+
+static void Bloom32_free(struct bloom32 *f) {
+    free(f->memory);
+    f->memory = NULL;
+    f->blocks = NULL;
+    f->nblocks = 0;
+}
+
+static void Bloom32_clear(struct bloom32 *f) {
+    memset(f->blocks, 0, f->nblocks * sizeof(struct bloom32_block));
+}
+
+static inline void Bloom32_add_hash(struct bloom32 *f, const uint32_t h1, const uint32_t h2) {
+    bloom32_set(&f->blocks[bloom32_block_of(f, h1)], h2);
+}
+
+static inline void Bloom32_add(struct bloom32 *f, const void *key, const size_t len) {
+    uint32_t h1, h2;
+
+    Combo32x2(key, len, f->seed, &h1, &h2);
+    Bloom32_add_hash(f, h1, h2);
+}
+
+/* Returns 1 if the key may have been added, 0 if it certainly was not */
+static inline int Bloom32_contains_hash(const struct bloom32 *f, const uint32_t h1,
+                                        const uint32_t h2) {
+    return bloom32_test(&f->blocks[bloom32_block_of(f, h1)], h2);
+}
+
+static inline int Bloom32_contains(const struct bloom32 *f, const void *key, const size_t len) {
+    uint32_t h1, h2;
+
+    Combo32x2(key, len, f->seed, &h1, &h2);
+    return Bloom32_contains_hash(f, h1, h2);
+}
+
+/* Add n keys, hashing up to BLOOM32_BATCH of them and prefetching their
+ * blocks before touching any, so the cache misses overlap.
+ */
+static void Bloom32_add_batch(struct bloom32 *f, const void *const *keys,
+                              const size_t *lens, const size_t n) {
+    uint32_t block[BLOOM32_BATCH];
+    uint32_t h2[BLOOM32_BATCH];
+
+    for (size_t base = 0; base < n; base += BLOOM32_BATCH) {
+        const size_t b = n - base < BLOOM32_BATCH ? n - base : BLOOM32_BATCH;
+
+        for (size_t i = 0; i < b; i++) {
+            uint32_t h1;
+
+            Combo32x2(keys[base + i], lens[base + i], f->seed, &h1, &h2[i]);
+            block[i] = (uint32_t)bloom32_block_of(f, h1);
+            prefetch(&f->blocks[block[i]]);
+        }
+        for (size_t i = 0; i < b; i++) {
+            bloom32_set(&f->blocks[block[i]], h2[i]);
+        }
+    }
+}
+
+/* Test n keys the same way, setting out[i] to Bloom32_contains of keys[i].
+ * Returns the number that may have been added.
+ */
+static size_t Bloom32_contains_batch(const struct bloom32 *f, const void *const *keys,
+                                     const size_t *lens, const size_t n, uint8_t *out) {
+    uint32_t block[BLOOM32_BATCH];
+    uint32_t h2[BLOOM32_BATCH];
+    size_t found = 0;
+
+    for (size_t base = 0; base < n; base += BLOOM32_BATCH) {
+        const size_t b = n - base < BLOOM32_BATCH ? n - base : BLOOM32_BATCH;
+
+        for (size_t i = 0; i < b; i++) {
+            uint32_t h1;
+
+            Combo32x2(keys[base + i], lens[base + i], f->seed, &h1, &h2[i]);
+            block[i] = (uint32_t)bloom32_block_of(f, h1);
+            prefetch(&f->blocks[block[i]]);
+        }
+        for (size_t i = 0; i < b; i++) {
+            out[base + i] = (uint8_t)bloom32_test(&f->blocks[block[i]], h2[i]);
+            found += out[base + i];
+        }
+    }
+    return found;
+}
+
+/* The false positive rate expected after adding n distinct keys.
+ * The number of keys in a block is Poisson distributed with mean
+ * n / nblocks, and a block with j keys answers yes for a new key when
+ * the key's bit is set in all eight words, each of which has j bits
+ * drawn out of 64.
+ */
+static double Bloom32_expected_fpr(const struct bloom32 *f, const size_t n) {
+    const double lambda = (double)n / (double)f->nblocks;
+    const double q = 1.0 - 1.0 / (8.0 * sizeof(uint64_t));
+    const unsigned int last = (unsigned int)(lambda + 12.0 * sqrt(lambda) + 32.0);
+    double fpr = 0.0;
+
+    for (unsigned int j = 1; j <= last; j++) {
+        const double p = exp((double)j * log(lambda) - lambda - lgamma((double)j + 1.0));
+
+        fpr += p * pow(1.0 - pow(q, (double)j), BLOOM32_K);
+    }
+    return fpr;
+}
+
+/* Size of the filter in bytes */
+static inline size_t Bloom32_bytes(const struct bloom32 *f) {
+    return f->nblocks * sizeof(struct bloom32_block);
+}
+
+#endif /* BLOOM32_H */
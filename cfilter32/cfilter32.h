@@ -0,0 +1,338 @@
+/*
+ * Cfilter32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A cuckoo filter for byte strings, with deletion, written in C.
+ * Each key is hashed once with Combo32x2: the first hash picks the
+ * key's primary bucket and the second gives its 12 to 16-bit
+ * fingerprint.  The alternate bucket is a hash of the fingerprint minus
+ * the primary, modulo the number of buckets, so either bucket leads to
+ * the other from the fingerprint alone and the number of buckets need
+ * not be a power of 2.  Buckets hold four fingerprints packed into 6 to 8 bytes, and a
+ * query checks both buckets with one SSE2 compare, or with word-wide
+ * bit tricks when the fingerprints are narrower than 16 bits.
+ */
+
+#ifndef CFILTER32_H
+#define CFILTER32_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* comment out the next line if you don't want SSE2 */
+#define CFILTER32_USE_SIMD 1
+
+/* Bits per fingerprint, an even number from 12 to 16 */
+#ifndef CFILTER32_BITS
+#define CFILTER32_BITS 16
+#endif
+#if CFILTER32_BITS < 12 || CFILTER32_BITS > 16 || CFILTER32_BITS % 2 != 0
+  #error "CFILTER32_BITS must be 12, 14 or 16"
+#endif
+
+#if defined(CFILTER32_USE_SIMD) && CFILTER32_USE_SIMD && CFILTER32_BITS == 16 && \
+    (defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #define CFILTER32_SSE2 1
+  #include <emmintrin.h>
+#endif
+
+#define CFILTER32_WAYS 4
+#define CFILTER32_BUCKET_BYTES (CFILTER32_WAYS * CFILTER32_BITS / 8)
+#define CFILTER32_BUCKET_MASK (UINT64_MAX >> (64 - CFILTER32_WAYS * CFILTER32_BITS))
+#define CFILTER32_FP_MASK ((UINT32_C(1) << CFILTER32_BITS) - 1)
+/* A one in the lowest bit of every fingerprint of a bucket */
+#define CFILTER32_LANES (CFILTER32_BUCKET_MASK / CFILTER32_FP_MASK)
+#define CFILTER32_MIN_BUCKETS 2
+/* Load the filter is sized for, and past which inserts start to fail */
+#define CFILTER32_LOAD 0.95
+/* Fingerprints moved before an insert gives up */
+#define CFILTER32_MAX_KICKS 500
+
+struct cfilter32 {
+    uint8_t *table;                /* buckets of CFILTER32_BUCKET_BYTES, then padding */
+    size_t nbuckets;               /* below 2^32 */
+    size_t size;                   /* fingerprints stored */
+    uint64_t seed;
+    uint64_t rng;                  /* for choosing fingerprints to move */
+};
+
+/*------------------------------------------------------------ */
+
+/* Cfilter32 helpers */
+
+/* Buckets are read and written as 8 bytes, of which the low
+ * CFILTER32_WAYS * CFILTER32_BITS bits are the bucket's; 0 marks an
+ * empty slot
+ */
+static inline uint64_t cfilter32_get(const struct cfilter32 *f, const size_t b) {
+    uint64_t x;
+
+    memcpy(&x, f->table + b * CFILTER32_BUCKET_BYTES, sizeof(x));
+    return x & CFILTER32_BUCKET_MASK;
+}
+
+static inline void cfilter32_put(struct cfilter32 *f, const size_t b, const uint64_t bucket) {
+    uint8_t *p = f->table + b * CFILTER32_BUCKET_BYTES;
+    uint64_t x;
+
+    memcpy(&x, p, sizeof(x));
+    x = (x & ~CFILTER32_BUCKET_MASK) | bucket;
+    memcpy(p, &x, sizeof(x));
+}
+
+static inline uint32_t cfilter32_slot(const uint64_t bucket, const unsigned int i) {
+    return (uint32_t)(bucket >> (i * CFILTER32_BITS)) & CFILTER32_FP_MASK;
+}
+
+static inline uint64_t cfilter32_set_slot(const uint64_t bucket, const unsigned int i,
+                                          const uint32_t fp) {
+    const unsigned int s = i * CFILTER32_BITS;
+
+    return (bucket & ~((uint64_t)CFILTER32_FP_MASK << s)) | (uint64_t)fp << s;
+}
+
+static inline uint32_t cfilter32_fingerprint(const uint32_t h2) {
+    const uint32_t fp = h2 & CFILTER32_FP_MASK;
+
+    return fp != 0 ? fp : 1;
+}
+
+static inline size_t cfilter32_primary(const struct cfilter32 *f, const uint32_t h1) {
+    return (size_t)(((uint64_t)h1 * f->nbuckets) >> 32);
+}
+
+/* The other bucket of a fingerprint in bucket b, (H(fp) - b) mod
+ * nbuckets, which maps it back to b; for about one fingerprint in
+ * nbuckets that is b itself, and the fingerprint has only the one bucket
+ */
+static inline size_t cfilter32_alternate(const struct cfilter32 *f, const size_t b,
+                                         const uint32_t fp) {
+    const size_t h = (size_t)(((uint64_t)(fp * UINT32_C(0x5BD1E995)) * f->nbuckets) >> 32);
+
+    return h >= b ? h - b : h + f->nbuckets - b;
+}
+
+/* The first slot of a bucket holding fp, or -1 */
+static inline int cfilter32_find_slot(const uint64_t bucket, const uint32_t fp) {
+    for (unsigned int i = 0; i < CFILTER32_WAYS; i++) {
+        if (cfilter32_slot(bucket, i) == fp) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/* Does either bucket hold fp? */
+#if defined(CFILTER32_SSE2)
+
+static inline int cfilter32_match2(const uint64_t b1, const uint64_t b2, const uint32_t fp) {
+    const __m128i v = _mm_set_epi64x((long long)b2, (long long)b1);
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(v, _mm_set1_epi16((short)fp))) != 0;
+}
+
+#else
+
+/* Some fingerprint of x is zero when subtracting one from each borrows
+ * into the top bit of one that was clear
+ */
+static inline int cfilter32_match2(const uint64_t b1, const uint64_t b2, const uint32_t fp) {
+    const uint64_t high = CFILTER32_LANES << (CFILTER32_BITS - 1);
+    const uint64_t x1 = b1 ^ (fp * CFILTER32_LANES);
+    const uint64_t x2 = b2 ^ (fp * CFILTER32_LANES);
+
+    return (((x1 - CFILTER32_LANES) & ~x1) | ((x2 - CFILTER32_LANES) & ~x2)) & high ? 1 : 0;
+}
+
+#endif
+
+static inline uint64_t cfilter32_random(struct cfilter32 *f) {
+    f->rng ^= f->rng << 13;
+    f->rng ^= f->rng >> 7;
+    f->rng ^= f->rng << 17;
+    return f->rng;
+}
+
+/*------------------------------------------------------------ */
+
+/* Cfilter32 filter functions */
+
+/* Size the filter for n keys.  Returns 0, or -1 if out of memory or if
+ * n needs 2^32 buckets or more.
+ */
+static int Cfilter32_init(struct cfilter32 *f, const size_t n, const uint64_t seed) {
+    const double need = (double)n / (CFILTER32_WAYS * CFILTER32_LOAD);
+    size_t nbuckets;
+
+    if (need >= 4294967295.0) {
+        return -1;
+    }
+    nbuckets = (size_t)need;
+    nbuckets += (double)nbuckets < need;
+    nbuckets = nbuckets < CFILTER32_MIN_BUCKETS ? CFILTER32_MIN_BUCKETS : nbuckets;
+    /* The last bucket is read and written 8 bytes at a time */
+    f->table = (uint8_t *)calloc(nbuckets * CFILTER32_BUCKET_BYTES + 8, 1);
+    if (f->table == NULL) {
+        return -1;
+    }
+    f->nbuckets = nbuckets;
+    f->size = 0;
+    f->seed = seed;
+    f->rng = seed ^ UINT64_C(0x9E3779B97F4A7C15);
+    f->rng = f->rng != 0 ? f->rng : 1;
+    return 0;
+}
+
+static void Cfilter32_free(struct cfilter32 *f) {
+    free(f->table);
+    f->table = NULL;
+    f->nbuckets = 0;
+    f->size = 0;
+}
+
+static inline void Cfilter32_hash(const struct cfilter32 *f, const void *key, const size_t len,
+                                  uint32_t *h1, uint32_t *h2) {
+    Combo32x2(key, len, f->seed, h1, h2);
+}
+
+/* Returns 1 if the key may have been inserted, 0 if it certainly was not */
+static inline int Cfilter32_contains_hash(const struct cfilter32 *f, const uint32_t h1,
+                                          const uint32_t h2) {
+    const uint32_t fp = cfilter32_fingerprint(h2);
+    const size_t b1 = cfilter32_primary(f, h1);
+    const size_t b2 = cfilter32_alternate(f, b1, fp);
+
+    return cfilter32_match2(cfilter32_get(f, b1), cfilter32_get(f, b2), fp);
+}
+
+static inline int Cfilter32_contains(const struct cfilter32 *f, const void *key,
+                                     const size_t len) {
+    uint32_t h1, h2;
+
+    Cfilter32_hash(f, key, len, &h1, &h2);
+    return Cfilter32_contains_hash(f, h1, h2);
+}
+
+/* Add a key's fingerprint, moving others to their alternate buckets to
+ * make room if both of its buckets are full.
+ * Returns 0, or -1 if no room was found within CFILTER32_MAX_KICKS
+ * moves, in which case the moves are undone and the filter is unchanged.
+ * A key inserted twice is stored twice.
+ */
+static int Cfilter32_insert_hash(struct cfilter32 *f, const uint32_t h1, const uint32_t h2) {
+    size_t path_bucket[CFILTER32_MAX_KICKS];
+    uint8_t path_slot[CFILTER32_MAX_KICKS];
+    uint32_t fp = cfilter32_fingerprint(h2);
+    size_t b = cfilter32_primary(f, h1);
+    size_t alt = cfilter32_alternate(f, b, fp);
+    uint64_t bucket;
+    int slot;
+
+    if ((slot = cfilter32_find_slot(bucket = cfilter32_get(f, b), 0)) >= 0 ||
+        (slot = cfilter32_find_slot(bucket = cfilter32_get(f, b = alt), 0)) >= 0) {
+        cfilter32_put(f, b, cfilter32_set_slot(bucket, (unsigned int)slot, fp));
+        f->size++;
+        return 0;
+    }
+
+    /* Both are full: evict fingerprints along a random walk */
+    b = cfilter32_random(f) & 1 ? b : cfilter32_primary(f, h1);
+    for (unsigned int kick = 0; kick < CFILTER32_MAX_KICKS; kick++) {
+        const unsigned int s = (unsigned int)(cfilter32_random(f) >> 32) % CFILTER32_WAYS;
+        uint32_t victim;
+
+        bucket = cfilter32_get(f, b);
+        victim = cfilter32_slot(bucket, s);
+        cfilter32_put(f, b, cfilter32_set_slot(bucket, s, fp));
+        path_bucket[kick] = b;
+        path_slot[kick] = (uint8_t)s;
+        fp = victim;
+        b = cfilter32_alternate(f, b, fp);
+        bucket = cfilter32_get(f, b);
+        if ((slot = cfilter32_find_slot(bucket, 0)) >= 0) {
+            cfilter32_put(f, b, cfilter32_set_slot(bucket, (unsigned int)slot, fp));
+            f->size++;
+            return 0;
+        }
+    }
+
+    /* Swap everything back, last move first */
+    for (unsigned int kick = CFILTER32_MAX_KICKS; kick-- > 0;) {
+        uint32_t moved;
+
+        bucket = cfilter32_get(f, path_bucket[kick]);
+        moved = cfilter32_slot(bucket, path_slot[kick]);
+        cfilter32_put(f, path_bucket[kick], cfilter32_set_slot(bucket, path_slot[kick], fp));
+        fp = moved;
+    }
+    return -1;
+}
+
+static inline int Cfilter32_insert(struct cfilter32 *f, const void *key, const size_t len) {
+    uint32_t h1, h2;
+
+    Cfilter32_hash(f, key, len, &h1, &h2);
+    return Cfilter32_insert_hash(f, h1, h2);
+}
+
+/* Remove one copy of a key's fingerprint.  Only erase keys that were
+ * inserted: erasing another key that happens to share a fingerprint
+ * and bucket would remove that key instead.
+ * Returns 1 if a fingerprint was removed, 0 if the key was not found.
+ */
+static int Cfilter32_erase_hash(struct cfilter32 *f, const uint32_t h1, const uint32_t h2) {
+    const uint32_t fp = cfilter32_fingerprint(h2);
+    size_t b = cfilter32_primary(f, h1);
+    uint64_t bucket;
+    int slot;
+
+    if ((slot = cfilter32_find_slot(bucket = cfilter32_get(f, b), fp)) < 0) {
+        b = cfilter32_alternate(f, b, fp);
+        if ((slot = cfilter32_find_slot(bucket = cfilter32_get(f, b), fp)) < 0) {
+            return 0;
+        }
+    }
+    cfilter32_put(f, b, cfilter32_set_slot(bucket, (unsigned int)slot, 0));
+    f->size--;
+    return 1;
+}
+
+static inline int Cfilter32_erase(struct cfilter32 *f, const void *key, const size_t len) {
+    uint32_t h1, h2;
+
+    Cfilter32_hash(f, key, len, &h1, &h2);
+    return Cfilter32_erase_hash(f, h1, h2);
+}
+
+/* Fraction of the slots in use */
+static inline double Cfilter32_load(const struct cfilter32 *f) {
+    return (double)f->size / (double)(f->nbuckets * CFILTER32_WAYS);
+}
+
+/* Size of the filter in bytes */
+static inline size_t Cfilter32_bytes(const struct cfilter32 *f) {
+    return f->nbuckets * CFILTER32_BUCKET_BYTES;
+}
+
+#endif /* CFILTER32_H */
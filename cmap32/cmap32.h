@@ -0,0 +1,642 @@
+/*
+ * Cmap32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A concurrent hash map keyed by byte strings, written in C11.
+ * It is a linear-probing table whose slots each hold an atomic word
+ * with the key's 32-bit Combo32 value and a state, and an atomic
+ * pointer to an immutable entry.  The home slot comes from the high
+ * bits of the hash, and the hash in the word rejects nearly every
+ * mismatch without reading the entry or the key.
+ *
+ * Lookups take no locks, write no shared memory and never wait: a slot
+ * claimed by an insert that has not published its entry yet is passed
+ * over, as the key is not in the map until it is.  Inserts claim an
+ * empty slot with one compare-and-swap, and erases turn a full slot
+ * into a tombstone with another.  Erased entries and replaced tables
+ * are freed through epoch-based reclamation, so a lookup may keep
+ * using what it found until it leaves its critical section.
+ * When the table fills up, one writer builds a larger table, reusing
+ * the stored hashes; other writers wait for it, readers do not.
+ *
+ * Every thread attaches to the map once, and brackets its operations
+ * with Cmap32_enter() and Cmap32_leave().
+ * The map stores pointers to keys and values; the caller owns the
+ * memory they point to.
+ */
+
+#ifndef CMAP32_H
+#define CMAP32_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+  #include <immintrin.h>
+  #define CMAP32_PAUSE() _mm_pause()
+#else
+  #define CMAP32_PAUSE() do {} while (0)
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sched.h>
+  #define CMAP32_YIELD() sched_yield()
+#else
+  #define CMAP32_YIELD() do {} while (0)
+#endif
+
+#ifndef CMAP32_MAX_THREADS
+#define CMAP32_MAX_THREADS 256
+#endif
+#define CMAP32_MIN_SLOTS 16
+/* Slot claims are added to the shared count in batches of at most this
+ * size, smaller for small tables
+ */
+#define CMAP32_COUNT_BATCH 32
+/* Retired objects are collected once a thread has this many */
+#define CMAP32_RETIRE_BATCH 64
+
+/* Spins before a waiting thread starts yielding its CPU */
+#define CMAP32_SPINS 64
+
+/* Low two bits of a slot word; the upper 32 bits hold the hash */
+#define CMAP32_EMPTY   0
+#define CMAP32_BUSY    1      /* claimed, entry not yet published */
+#define CMAP32_FULL    2
+#define CMAP32_DELETED 3
+
+struct cmap32_entry {
+    const void *key;
+    size_t len;
+    void *value;
+    uint32_t hash;
+};
+
+struct cmap32_slot {
+    _Atomic uint64_t word;
+    _Atomic(struct cmap32_entry *) entry;
+};
+
+struct cmap32_table {
+    size_t nslots;             /* always a power of 2 */
+    unsigned int shift;        /* 32 - log2(nslots) */
+    size_t grow_at;            /* claimed slots that trigger a resize */
+    size_t count_batch;        /* claims each thread adds to used at once */
+    _Alignas(64) _Atomic size_t used;   /* claimed slots, full or deleted */
+    _Alignas(64) struct cmap32_slot slots[];
+};
+
+struct cmap32_retired {
+    void *ptr;
+    uint64_t epoch;
+};
+
+struct cmap32;
+
+/* Per-thread state, one cache line of shared fields each */
+struct cmap32_thread {
+    _Alignas(64) _Atomic uint64_t epoch;  /* epoch << 1 | 1 while inside */
+    _Atomic int writing;
+    _Atomic int in_use;
+    struct cmap32 *map;
+    struct cmap32_table *count_table;
+    size_t pending;                       /* claims not yet counted */
+    struct cmap32_retired *retired;
+    size_t nretired;
+    size_t retired_cap;
+};
+
+struct cmap32 {
+    _Alignas(64) _Atomic(struct cmap32_table *) table;
+    _Atomic uint64_t epoch;
+    _Atomic int resizing;
+    uint64_t seed;
+    struct cmap32_thread threads[CMAP32_MAX_THREADS];
+};
+
+/*------------------------------------------------------------ */
+
+/* Cmap32 helpers */
+
+static inline size_t cmap32_home(const struct cmap32_table *t, const uint32_t hash) {
+    return (size_t)(hash >> t->shift);
+}
+
+static inline uint64_t cmap32_word(const uint32_t hash, const unsigned int state) {
+    return ((uint64_t)hash << 32) | state;
+}
+
+/* Spin briefly, then yield, in case the thread being waited for has
+ * been preempted
+ */
+static inline void cmap32_backoff(unsigned int *spins) {
+    if (++*spins < CMAP32_SPINS) {
+        CMAP32_PAUSE();
+    } else {
+        CMAP32_YIELD();
+    }
+}
+
+/* Wait for an insert that has claimed slot s to publish its entry */
+static inline uint64_t cmap32_settle(const struct cmap32_slot *s, uint64_t w) {
+    unsigned int spins = 0;
+
+    while ((w & 3) == CMAP32_BUSY) {
+        cmap32_backoff(&spins);
+        w = atomic_load_explicit(&s->word, memory_order_acquire);
+    }
+    return w;
+}
+
+static struct cmap32_table *cmap32_table_new(const size_t nslots) {
+    struct cmap32_table *t = (struct cmap32_table *)
+        calloc(1, sizeof(struct cmap32_table) + nslots * sizeof(struct cmap32_slot));
+    unsigned int lg = 0;
+
+    if (t == NULL) {
+        return NULL;
+    }
+    while (((size_t)1 << lg) < nslots) {
+        lg++;
+    }
+    /* calloc leaves every slot empty with a NULL entry */
+    t->nslots = nslots;
+    t->shift = 32 - lg;
+    t->grow_at = nslots / 4 * 3;
+    /* Each thread holds back fewer than a batch of claims, so even with
+     * every thread attached the uncounted ones fit in the last quarter
+     */
+    t->count_batch = nslots / 4 / CMAP32_MAX_THREADS;
+    if (t->count_batch > CMAP32_COUNT_BATCH) {
+        t->count_batch = CMAP32_COUNT_BATCH;
+    } else if (t->count_batch == 0) {
+        t->count_batch = 1;
+    }
+    return t;
+}
+
+/* Tables are resized to be at most half full */
+static size_t cmap32_slots_for(const size_t n) {
+    size_t nslots = CMAP32_MIN_SLOTS;
+
+    while (nslots / 2 < n) {
+        nslots <<= 1;
+    }
+    return nslots;
+}
+
+/* Free whatever this thread retired at least two epochs ago */
+static void cmap32_collect(struct cmap32_thread *th) {
+    struct cmap32 *m = th->map;
+    uint64_t e = atomic_load(&m->epoch);
+    size_t kept = 0;
+    int advance = 1;
+
+    /* The epoch can advance once every thread inside a critical section
+     * has seen the current one
+     */
+    for (unsigned int i = 0; i < CMAP32_MAX_THREADS && advance; i++) {
+        uint64_t v;
+
+        if (!atomic_load_explicit(&m->threads[i].in_use, memory_order_acquire)) {
+            continue;
+        }
+        v = atomic_load(&m->threads[i].epoch);
+        advance = (v & 1) == 0 || (v >> 1) == e;
+    }
+    if (advance && atomic_compare_exchange_strong(&m->epoch, &e, e + 1)) {
+        e++;
+    }
+
+    for (size_t i = 0; i < th->nretired; i++) {
+        if (th->retired[i].epoch + 2 <= e) {
+            free(th->retired[i].ptr);
+        } else {
+            th->retired[kept++] = th->retired[i];
+        }
+    }
+    th->nretired = kept;
+}
+
+/* Free ptr once no thread can still be using it */
+static void cmap32_retire(struct cmap32_thread *th, void *ptr) {
+    if (th->nretired == th->retired_cap) {
+        const size_t n = th->retired_cap == 0 ? CMAP32_RETIRE_BATCH * 2
+                                              : th->retired_cap * 2;
+        struct cmap32_retired *r = (struct cmap32_retired *)
+            realloc(th->retired, n * sizeof(struct cmap32_retired));
+
+        if (r == NULL) {
+            /* Better to leak than to free too early */
+            return;
+        }
+        th->retired = r;
+        th->retired_cap = n;
+    }
+    th->retired[th->nretired].ptr = ptr;
+    th->retired[th->nretired].epoch = atomic_load(&th->map->epoch);
+    th->nretired++;
+    if (th->nretired % CMAP32_RETIRE_BATCH == 0) {
+        cmap32_collect(th);
+    }
+}
+
+/* Writers announce themselves, so that a resize can wait for them */
+static inline void cmap32_writer_enter(struct cmap32_thread *th) {
+    struct cmap32 *m = th->map;
+    unsigned int spins = 0;
+
+    for (;;) {
+        while (atomic_load_explicit(&m->resizing, memory_order_acquire)) {
+            cmap32_backoff(&spins);
+        }
+        atomic_store(&th->writing, 1);
+        if (likely(!atomic_load(&m->resizing))) {
+            return;
+        }
+        atomic_store(&th->writing, 0);
+    }
+}
+
+static inline void cmap32_writer_leave(struct cmap32_thread *th) {
+    atomic_store_explicit(&th->writing, 0, memory_order_release);
+}
+
+/* Replace table old with one at most half full.
+ * Called by a writer; returns 0, or -1 if out of memory.
+ * If another writer is already resizing, waits for it instead.
+ */
+static int cmap32_resize(struct cmap32_thread *th, struct cmap32_table *old) {
+    struct cmap32 *m = th->map;
+    struct cmap32_table *t;
+    size_t live = 0;
+    int expected = 0;
+
+    cmap32_writer_leave(th);
+    if (!atomic_compare_exchange_strong(&m->resizing, &expected, 1)) {
+        cmap32_writer_enter(th);
+        return 0;
+    }
+    for (unsigned int i = 0; i < CMAP32_MAX_THREADS; i++) {
+        unsigned int spins = 0;
+
+        while (atomic_load(&m->threads[i].writing)) {
+            cmap32_backoff(&spins);
+        }
+    }
+
+    /* No writers now; readers carry on with the old table */
+    if (atomic_load(&m->table) != old) {
+        atomic_store(&m->resizing, 0);
+        cmap32_writer_enter(th);
+        return 0;
+    }
+    for (size_t i = 0; i < old->nslots; i++) {
+        live += (atomic_load_explicit(&old->slots[i].word, memory_order_relaxed) & 3)
+                == CMAP32_FULL;
+    }
+    t = cmap32_table_new(cmap32_slots_for(live + 1));
+    if (t == NULL) {
+        atomic_store(&m->resizing, 0);
+        cmap32_writer_enter(th);
+        return -1;
+    }
+    for (size_t i = 0; i < old->nslots; i++) {
+        const uint64_t w = atomic_load_explicit(&old->slots[i].word, memory_order_relaxed);
+        size_t pos;
+
+        if ((w & 3) != CMAP32_FULL) {
+            continue;
+        }
+        pos = cmap32_home(t, (uint32_t)(w >> 32));
+        while (atomic_load_explicit(&t->slots[pos].word, memory_order_relaxed) != 0) {
+            pos = (pos + 1) & (t->nslots - 1);
+        }
+        atomic_store_explicit(&t->slots[pos].entry,
+            atomic_load_explicit(&old->slots[i].entry, memory_order_relaxed),
+            memory_order_relaxed);
+        atomic_store_explicit(&t->slots[pos].word, w, memory_order_relaxed);
+    }
+    atomic_store_explicit(&t->used, live, memory_order_relaxed);
+
+    atomic_store_explicit(&m->table, t, memory_order_release);
+    cmap32_retire(th, old);
+    atomic_store(&m->resizing, 0);
+    cmap32_writer_enter(th);
+    return 0;
+}
+
+/* Count one claimed slot; returns 1 if the table should be resized */
+static inline int cmap32_count(struct cmap32_thread *th, struct cmap32_table *t) {
+    if (th->count_table != t) {
+        /* Claims pending for a replaced table were counted when the
+         * resize set the new one's used from its slots
+         */
+        th->count_table = t;
+        th->pending = 0;
+    }
+    if (++th->pending < t->count_batch) {
+        return 0;
+    }
+    th->pending = 0;
+    return atomic_fetch_add_explicit(&t->used, t->count_batch, memory_order_relaxed)
+           + t->count_batch >= t->grow_at;
+}
+
+/*------------------------------------------------------------ */
+
+/* Cmap32 map functions */
+
+/* Returns 0, or -1 if out of memory */
+static int Cmap32_init(struct cmap32 *m, const size_t capacity, const uint64_t seed) {
+    struct cmap32_table *t = cmap32_table_new(cmap32_slots_for(capacity));
+
+    if (t == NULL) {
+        return -1;
+    }
+    memset(m->threads, 0, sizeof(m->threads));
+    atomic_init(&m->table, t);
+    atomic_init(&m->epoch, 1);
+    atomic_init(&m->resizing, 0);
+    m->seed = seed;
+    return 0;
+}
+
+/* Free the map and every entry in it; no thread may be using it */
+static void Cmap32_free(struct cmap32 *m) {
+    struct cmap32_table *t = atomic_load(&m->table);
+
+    for (size_t i = 0; i < t->nslots; i++) {
+        if ((atomic_load(&t->slots[i].word) & 3) == CMAP32_FULL) {
+            free(atomic_load(&t->slots[i].entry));
+        }
+    }
+    free(t);
+    for (unsigned int i = 0; i < CMAP32_MAX_THREADS; i++) {
+        for (size_t j = 0; j < m->threads[i].nretired; j++) {
+            free(m->threads[i].retired[j].ptr);
+        }
+        free(m->threads[i].retired);
+    }
+    memset(m->threads, 0, sizeof(m->threads));
+}
+
+/* Each thread calls this once before using the map.
+ * Returns NULL if CMAP32_MAX_THREADS threads are already attached.
+ */
+static struct cmap32_thread *Cmap32_attach(struct cmap32 *m) {
+    for (unsigned int i = 0; i < CMAP32_MAX_THREADS; i++) {
+        struct cmap32_thread *th = &m->threads[i];
+        int expected = 0;
+
+        if (atomic_compare_exchange_strong(&th->in_use, &expected, 1)) {
+            th->map = m;
+            th->count_table = NULL;
+            th->pending = 0;
+            atomic_store(&th->epoch, 0);
+            return th;
+        }
+    }
+    return NULL;
+}
+
+/* Anything the thread retired is freed by whichever thread reuses its
+ * slot, or by Cmap32_free()
+ */
+static void Cmap32_detach(struct cmap32_thread *th) {
+    /* Count the claims still pending; as a writer, the table cannot be
+     * replaced meanwhile
+     */
+    cmap32_writer_enter(th);
+    if (th->pending != 0 && th->count_table == atomic_load(&th->map->table)) {
+        atomic_fetch_add_explicit(&th->count_table->used, th->pending, memory_order_relaxed);
+    }
+    th->pending = 0;
+    cmap32_writer_leave(th);
+    atomic_store(&th->epoch, 0);
+    atomic_store_explicit(&th->in_use, 0, memory_order_release);
+}
+
+/* Bracket every operation, or a run of them, with these.
+ * Entries found inside stay valid until Cmap32_leave().
+ * They must not be nested.
+ */
+static inline void Cmap32_enter(struct cmap32_thread *th) {
+    atomic_store(&th->epoch, (atomic_load(&th->map->epoch) << 1) | 1);
+}
+
+static inline void Cmap32_leave(struct cmap32_thread *th) {
+    atomic_store_explicit(&th->epoch, 0, memory_order_release);
+}
+
+static inline uint32_t Cmap32_hash(const struct cmap32 *m, const void *key, const size_t len) {
+    return Combo32(key, len, m->seed);
+}
+
+/* Look up a key whose Combo32 value with the map's seed is already known.
+ * Returns NULL if the key is not in the map, or if its insert has not
+ * yet published its entry.
+ */
+static inline struct cmap32_entry *Cmap32_find_hash(struct cmap32_thread *th,
+                                                    const void *key,
+                                                    const size_t len,
+                                                    const uint32_t hash) {
+    const struct cmap32_table *t =
+        atomic_load_explicit(&th->map->table, memory_order_acquire);
+    const size_t mask = t->nslots - 1;
+    size_t pos = cmap32_home(t, hash);
+
+    for (size_t n = 0; n <= mask; n++) {
+        const struct cmap32_slot *s = &t->slots[pos];
+        uint64_t w = atomic_load_explicit(&s->word, memory_order_acquire);
+
+        if ((w & 3) == CMAP32_EMPTY) {
+            return NULL;
+        }
+        /* A claimed slot whose entry is not yet published holds no key
+         * yet, so it is skipped rather than waited for
+         */
+        if ((uint32_t)(w >> 32) == hash && (w & 3) == CMAP32_FULL) {
+            struct cmap32_entry *e = atomic_load_explicit(&s->entry, memory_order_acquire);
+
+            if (likely(e->len == len && memcmp(e->key, key, len) == 0)) {
+                return e;
+            }
+        }
+        pos = (pos + 1) & mask;
+    }
+    return NULL;
+}
+
+static inline struct cmap32_entry *Cmap32_find(struct cmap32_thread *th,
+                                               const void *key, const size_t len) {
+    return Cmap32_find_hash(th, key, len, Cmap32_hash(th->map, key, len));
+}
+
+/* Find a key, or add it with the given value if it is missing.
+ * *inserted is set to 1 if the key was added, or 0 if it was already
+ * there, in which case its existing entry is returned.
+ * Returns NULL if out of memory.
+ */
+static struct cmap32_entry *Cmap32_insert_hash(struct cmap32_thread *th,
+                                               const void *key,
+                                               const size_t len,
+                                               const uint32_t hash,
+                                               void *value,
+                                               int *inserted) {
+    struct cmap32_entry *e = (struct cmap32_entry *)malloc(sizeof(struct cmap32_entry));
+    struct cmap32_entry *result = NULL;
+
+    *inserted = 0;
+    if (e == NULL) {
+        return NULL;
+    }
+    e->key = key;
+    e->len = len;
+    e->value = value;
+    e->hash = hash;
+
+    cmap32_writer_enter(th);
+    for (;;) {
+        struct cmap32_table *t =
+            atomic_load_explicit(&th->map->table, memory_order_acquire);
+        const size_t mask = t->nslots - 1;
+        size_t pos = cmap32_home(t, hash);
+        size_t n = 0;
+        int resize = 0;
+
+        while (n <= mask) {
+            struct cmap32_slot *s = &t->slots[pos];
+            uint64_t w = atomic_load_explicit(&s->word, memory_order_acquire);
+
+            if ((w & 3) == CMAP32_EMPTY) {
+                if (!atomic_compare_exchange_weak(&s->word, &w,
+                                                  cmap32_word(hash, CMAP32_BUSY))) {
+                    /* Lost the race for this slot; look at it again */
+                    continue;
+                }
+                atomic_store_explicit(&s->entry, e, memory_order_relaxed);
+                atomic_store_explicit(&s->word, cmap32_word(hash, CMAP32_FULL),
+                                      memory_order_release);
+                *inserted = 1;
+                result = e;
+                resize = cmap32_count(th, t);
+                break;
+            }
+            if ((uint32_t)(w >> 32) == hash) {
+                w = cmap32_settle(s, w);
+                if ((w & 3) == CMAP32_FULL) {
+                    struct cmap32_entry *old =
+                        atomic_load_explicit(&s->entry, memory_order_acquire);
+
+                    if (old->len == len && memcmp(old->key, key, len) == 0) {
+                        result = old;
+                        break;
+                    }
+                }
+            }
+            pos = (pos + 1) & mask;
+            n++;
+        }
+
+        if (result != NULL) {
+            if (resize) {
+                cmap32_resize(th, t);
+            }
+            break;
+        }
+        /* Every slot was claimed */
+        if (cmap32_resize(th, t) != 0) {
+            break;
+        }
+    }
+    cmap32_writer_leave(th);
+
+    if (result != e) {
+        free(e);
+    }
+    return result;
+}
+
+static inline struct cmap32_entry *Cmap32_insert(struct cmap32_thread *th,
+                                                 const void *key,
+                                                 const size_t len,
+                                                 void *value,
+                                                 int *inserted) {
+    return Cmap32_insert_hash(th, key, len, Cmap32_hash(th->map, key, len),
+                              value, inserted);
+}
+
+/* Returns 1 if the key was removed, 0 if it was not in the map */
+static int Cmap32_erase(struct cmap32_thread *th, const void *key, const size_t len) {
+    const uint32_t hash = Cmap32_hash(th->map, key, len);
+    int erased = 0;
+
+    cmap32_writer_enter(th);
+    {
+        struct cmap32_table *t =
+            atomic_load_explicit(&th->map->table, memory_order_acquire);
+        const size_t mask = t->nslots - 1;
+        size_t pos = cmap32_home(t, hash);
+
+        for (size_t n = 0; n <= mask; n++) {
+            struct cmap32_slot *s = &t->slots[pos];
+            uint64_t w = atomic_load_explicit(&s->word, memory_order_acquire);
+
+            if ((w & 3) == CMAP32_EMPTY) {
+                break;
+            }
+            if ((uint32_t)(w >> 32) == hash) {
+                w = cmap32_settle(s, w);
+                if ((w & 3) == CMAP32_FULL) {
+                    struct cmap32_entry *e =
+                        atomic_load_explicit(&s->entry, memory_order_acquire);
+
+                    if (e->len == len && memcmp(e->key, key, len) == 0) {
+                        /* Only one eraser can win; the slot stays claimed
+                         * as a tombstone until the next resize
+                         */
+                        if (atomic_compare_exchange_strong(&s->word, &w,
+                                cmap32_word(hash, CMAP32_DELETED))) {
+                            cmap32_retire(th, e);
+                            erased = 1;
+                        }
+                        break;
+                    }
+                }
+            }
+            pos = (pos + 1) & mask;
+        }
+    }
+    cmap32_writer_leave(th);
+    return erased;
+}
+
+/* Approximate number of claimed slots, including tombstones */
+static inline size_t Cmap32_used(struct cmap32 *m) {
+    struct cmap32_table *t = atomic_load_explicit(&m->table, memory_order_acquire);
+
+    return atomic_load_explicit(&t->used, memory_order_relaxed);
+}
+
+#endif /* CMAP32_H */
@@ -0,0 +1,303 @@
+/*
+ * Cms32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A Count-Min sketch for byte strings, written in C.
+ * Each key is hashed once with Combo32x2, and its counter in row i is
+ * picked by h1 + i * h2, so the d rows cost one hash, not d.  Counters
+ * are 8, 16 or 32 bits wide and stop at their maximum rather than wrap.
+ * Conservative update raises only the counters below the key's new
+ * estimate, which keeps them from overcounting as much, and the batch
+ * functions hash a batch of keys and prefetch all of their counters
+ * before touching any.
+ */
+
+#ifndef CMS32_H
+#define CMS32_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* Bits per counter, 8, 16 or 32 */
+#ifndef CMS32_BITS
+#define CMS32_BITS 32
+#endif
+#if CMS32_BITS == 8
+  typedef uint8_t cms32_counter;
+  #define CMS32_MAX UINT8_MAX
+#elif CMS32_BITS == 16
+  typedef uint16_t cms32_counter;
+  #define CMS32_MAX UINT16_MAX
+#elif CMS32_BITS == 32
+  typedef uint32_t cms32_counter;
+  #define CMS32_MAX UINT32_MAX
+#else
+  #error "CMS32_BITS must be 8, 16 or 32"
+#endif
+
+#define CMS32_MAX_DEPTH 16
+/* Keys hashed and prefetched together by the batch functions */
+#define CMS32_BATCH 16
+
+/* Errors; all are negative */
+#define CMS32_ERR_MEMORY   -1
+#define CMS32_ERR_SIZE     -2      /* width 0, or depth not 1 to CMS32_MAX_DEPTH */
+#define CMS32_ERR_MISMATCH -3      /* merging sketches of another shape or seed */
+
+struct cms32 {
+    cms32_counter *counters;       /* depth rows of width counters */
+    uint32_t width;
+    unsigned int depth;
+    uint64_t total;                /* sum of the counts added */
+    uint64_t seed;
+};
+
+/*------------------------------------------------------------ */
+
+/* Cms32 helpers */
+
+/* The counter of row i for hashes h1 and h2, as an offset into counters */
+static inline size_t cms32_slot(const struct cms32 *f, const unsigned int i, const uint32_t h1,
+                                const uint32_t h2) {
+    const uint32_t g = h1 + i * h2;
+
+    return (size_t)i * f->width + (size_t)(((uint64_t)g * f->width) >> 32);
+}
+
+static inline cms32_counter cms32_saturate(const uint64_t x) {
+    return x > CMS32_MAX ? (cms32_counter)CMS32_MAX : (cms32_counter)x;
+}
+
+static inline void cms32_add_slots(struct cms32 *f, const size_t *slot, const uint32_t count) {
+    for (unsigned int i = 0; i < f->depth; i++) {
+        f->counters[slot[i]] = cms32_saturate((uint64_t)f->counters[slot[i]] + count);
+    }
+}
+
+static inline void cms32_add_slots_conservative(struct cms32 *f, const size_t *slot,
+                                                const uint32_t count) {
+    cms32_counter est = (cms32_counter)CMS32_MAX, target;
+
+    for (unsigned int i = 0; i < f->depth; i++) {
+        est = f->counters[slot[i]] < est ? f->counters[slot[i]] : est;
+    }
+    target = cms32_saturate((uint64_t)est + count);
+    for (unsigned int i = 0; i < f->depth; i++) {
+        if (f->counters[slot[i]] < target) {
+            f->counters[slot[i]] = target;
+        }
+    }
+}
+
+static inline uint32_t cms32_min_slots(const struct cms32 *f, const size_t *slot) {
+    cms32_counter est = (cms32_counter)CMS32_MAX;
+
+    for (unsigned int i = 0; i < f->depth; i++) {
+        est = f->counters[slot[i]] < est ? f->counters[slot[i]] : est;
+    }
+    return est;
+}
+
+static inline void cms32_slots(const struct cms32 *f, const uint32_t h1, const uint32_t h2,
+                               size_t *slot) {
+    for (unsigned int i = 0; i < f->depth; i++) {
+        slot[i] = cms32_slot(f, i, h1, h2);
+    }
+}
+
+/*------------------------------------------------------------ */
+
+/* Cms32 sketch functions */
+
+/* Make an empty sketch of depth rows of width counters.  Estimates
+ * overcount by at most e / width times the total count with probability
+ * 1 - e^-depth, so width = e / epsilon and depth = ln(1 / delta).
+ * Returns 0 or a negative CMS32_ERR code.
+ */
+static int Cms32_init(struct cms32 *f, const uint32_t width, const unsigned int depth,
+                      const uint64_t seed) {
+    if (width == 0 || depth == 0 || depth > CMS32_MAX_DEPTH) {
+        return CMS32_ERR_SIZE;
+    }
+    f->counters = (cms32_counter *)calloc((size_t)width * depth, sizeof(cms32_counter));
+    if (f->counters == NULL) {
+        return CMS32_ERR_MEMORY;
+    }
+    f->width = width;
+    f->depth = depth;
+    f->total = 0;
+    f->seed = seed;
+    return 0;
+}
+
+static void Cms32_free(struct cms32 *f) {
+    free(f->counters);
+    f->counters = NULL;
+    f->width = 0;
+    f->total = 0;
+}
+
+static void Cms32_clear(struct cms32 *f) {
+    memset(f->counters, 0, (size_t)f->width * f->depth * sizeof(cms32_counter));
+    f->total = 0;
+}
+
+static inline void Cms32_hash(const struct cms32 *f, const void *key, const size_t len,
+                              uint32_t *h1, uint32_t *h2) {
+    Combo32x2(key, len, f->seed, h1, h2);
+}
+
+/* Add count to a key's counters */
+static inline void Cms32_add_hash(struct cms32 *f, const uint32_t h1, const uint32_t h2,
+                                  const uint32_t count) {
+    size_t slot[CMS32_MAX_DEPTH];
+
+    cms32_slots(f, h1, h2, slot);
+    cms32_add_slots(f, slot, count);
+    f->total += count;
+}
+
+static inline void Cms32_add(struct cms32 *f, const void *key, const size_t len,
+                             const uint32_t count) {
+    uint32_t h1, h2;
+
+    Cms32_hash(f, key, len, &h1, &h2);
+    Cms32_add_hash(f, h1, h2, count);
+}
+
+/* Add count to a key's estimate, raising only the counters below it.
+ * Estimates stay upper bounds, also after merging, as long as counts are
+ * only ever added.
+ */
+static inline void Cms32_add_conservative_hash(struct cms32 *f, const uint32_t h1,
+                                               const uint32_t h2, const uint32_t count) {
+    size_t slot[CMS32_MAX_DEPTH];
+
+    cms32_slots(f, h1, h2, slot);
+    cms32_add_slots_conservative(f, slot, count);
+    f->total += count;
+}
+
+static inline void Cms32_add_conservative(struct cms32 *f, const void *key, const size_t len,
+                                          const uint32_t count) {
+    uint32_t h1, h2;
+
+    Cms32_hash(f, key, len, &h1, &h2);
+    Cms32_add_conservative_hash(f, h1, h2, count);
+}
+
+/* The key's count, or more; CMS32_MAX once a counter saturates */
+static inline uint32_t Cms32_estimate_hash(const struct cms32 *f, const uint32_t h1,
+                                           const uint32_t h2) {
+    size_t slot[CMS32_MAX_DEPTH];
+
+    cms32_slots(f, h1, h2, slot);
+    return cms32_min_slots(f, slot);
+}
+
+static inline uint32_t Cms32_estimate(const struct cms32 *f, const void *key, const size_t len) {
+    uint32_t h1, h2;
+
+    Cms32_hash(f, key, len, &h1, &h2);
+    return Cms32_estimate_hash(f, h1, h2);
+}
+
+/* Add n keys, counts[i] to keys[i], or 1 to each if counts is NULL,
+ * conservatively if conservative is nonzero.  Hashes up to CMS32_BATCH
+ * keys and prefetches all of their counters before touching any, so the
+ * cache misses overlap.
+ */
+static void Cms32_add_batch(struct cms32 *f, const void *const *keys, const size_t *lens,
+                            const uint32_t *counts, const size_t n, const int conservative) {
+    size_t slot[CMS32_BATCH][CMS32_MAX_DEPTH];
+
+    for (size_t base = 0; base < n; base += CMS32_BATCH) {
+        const size_t b = n - base < CMS32_BATCH ? n - base : CMS32_BATCH;
+
+        for (size_t i = 0; i < b; i++) {
+            uint32_t h1, h2;
+
+            Cms32_hash(f, keys[base + i], lens[base + i], &h1, &h2);
+            cms32_slots(f, h1, h2, slot[i]);
+            for (unsigned int r = 0; r < f->depth; r++) {
+                prefetch(&f->counters[slot[i][r]]);
+            }
+        }
+        for (size_t i = 0; i < b; i++) {
+            const uint32_t count = counts != NULL ? counts[base + i] : 1;
+
+            if (conservative) {
+                cms32_add_slots_conservative(f, slot[i], count);
+            } else {
+                cms32_add_slots(f, slot[i], count);
+            }
+            f->total += count;
+        }
+    }
+}
+
+/* Estimate n keys the same way, setting out[i] to Cms32_estimate of keys[i] */
+static void Cms32_estimate_batch(const struct cms32 *f, const void *const *keys,
+                                 const size_t *lens, const size_t n, uint32_t *out) {
+    size_t slot[CMS32_BATCH][CMS32_MAX_DEPTH];
+
+    for (size_t base = 0; base < n; base += CMS32_BATCH) {
+        const size_t b = n - base < CMS32_BATCH ? n - base : CMS32_BATCH;
+
+        for (size_t i = 0; i < b; i++) {
+            uint32_t h1, h2;
+
+            Cms32_hash(f, keys[base + i], lens[base + i], &h1, &h2);
+            cms32_slots(f, h1, h2, slot[i]);
+            for (unsigned int r = 0; r < f->depth; r++) {
+                prefetch(&f->counters[slot[i][r]]);
+            }
+        }
+        for (size_t i = 0; i < b; i++) {
+            out[base + i] = cms32_min_slots(f, slot[i]);
+        }
+    }
+}
+
+/* Add src's counts to dst, saturating.
+ * Returns 0 or CMS32_ERR_MISMATCH if their shapes or seeds differ.
+ */
+static int Cms32_merge(struct cms32 *dst, const struct cms32 *src) {
+    const size_t n = (size_t)dst->width * dst->depth;
+
+    if (dst->width != src->width || dst->depth != src->depth || dst->seed != src->seed) {
+        return CMS32_ERR_MISMATCH;
+    }
+    for (size_t i = 0; i < n; i++) {
+        dst->counters[i] = cms32_saturate((uint64_t)dst->counters[i] + src->counters[i]);
+    }
+    dst->total += src->total;
+    return 0;
+}
+
+/* Size of the sketch in bytes */
+static inline size_t Cms32_bytes(const struct cms32 *f) {
+    return (size_t)f->width * f->depth * sizeof(cms32_counter);
+}
+
+#endif /* CMS32_H */
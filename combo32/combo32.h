@@ -127,12 +127,229 @@
 #include "mult32.h"
 #include "komi32.h"
 
+/* Byte strings shorter than this use Komi32, the rest use Mult32.
+ * Adjust this depending on the relative speeds of your system.
+ */
+#ifndef COMBO32_THRESHOLD
+#define COMBO32_THRESHOLD 32
+#endif
+
+/* Raised whenever Combo32 returns different values for the same input
+ * and seed, so that hashes stored on disk can be checked against it.
+ */
+#define COMBO32_VERSION 1
+
+/*------------------------------------------------------------ */
+
+/* Optional key-length histogram.
+ * Define COMBO32_HISTOGRAM to 1 before including this file, and every
+ * Combo32 call records its length and seed in a histogram owned by the
+ * calling thread.  Combo32_histogram_dump() writes the sum over all
+ * threads, in the format read by bench/replay32.c.
+ * Recording costs a thread-local pointer load and two counter updates;
+ * the counters are only written by their own thread, so no locked
+ * instructions are needed.  A thread's histogram is never freed, so its
+ * counts are still dumped after the thread exits.
+ * The histograms are static, so dump from the same translation unit
+ * that calls Combo32.
+ */
+#if defined(COMBO32_HISTOGRAM) && COMBO32_HISTOGRAM
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+  #define COMBO32_THREAD_LOCAL __declspec(thread)
+#else
+  #define COMBO32_THREAD_LOCAL _Thread_local
+#endif
+
+/* Lengths below this are counted exactly, longer ones by log2 */
+#ifndef COMBO32_HIST_LENGTHS
+#define COMBO32_HIST_LENGTHS 1024
+#endif
+/* Number of distinct seeds counted per thread */
+#define COMBO32_HIST_SEEDS 16
+
+struct combo32_histogram {
+    _Atomic uint64_t len[COMBO32_HIST_LENGTHS];
+    _Atomic uint64_t log_len[64];
+    _Atomic uint64_t seed_count[COMBO32_HIST_SEEDS];
+    _Atomic uint64_t other_seeds;
+    _Atomic uint64_t seed[COMBO32_HIST_SEEDS];
+    _Atomic unsigned int nseeds;
+    unsigned int last_seed;
+    struct combo32_histogram *next;
+};
+
+static struct combo32_histogram * _Atomic combo32_histograms;
+static COMBO32_THREAD_LOCAL struct combo32_histogram *combo32_histogram;
+
+/* Increment a counter that only the current thread writes */
+#define COMBO32_HIST_INC(x) \
+    atomic_store_explicit(&(x), \
+        atomic_load_explicit(&(x), memory_order_relaxed) + 1, \
+        memory_order_relaxed)
+
+static struct combo32_histogram *combo32_histogram_new(void) {
+    struct combo32_histogram *h = calloc(1, sizeof(*h));
+
+    if (h != NULL) {
+        h->next = atomic_load(&combo32_histograms);
+        while (!atomic_compare_exchange_weak(&combo32_histograms, &h->next, h)) {
+        }
+    }
+    return h;
+}
+
+static inline void combo32_record(const size_t len, const uint64_t seed) {
+    struct combo32_histogram *h = combo32_histogram;
+    unsigned int i;
+
+    if (unlikely(h == NULL)) {
+        h = combo32_histogram = combo32_histogram_new();
+        if (h == NULL) {
+            return;
+        }
+    }
+
+    if (likely(len < COMBO32_HIST_LENGTHS)) {
+        COMBO32_HIST_INC(h->len[len]);
+    } else {
+        unsigned int lg = 0;
+
+        while ((len >> lg) > 1) {
+            lg++;
+        }
+        COMBO32_HIST_INC(h->log_len[lg]);
+    }
+
+    /* Most programs use one seed, so try the last one first */
+    i = h->last_seed;
+    if (likely(i < h->nseeds && h->seed[i] == seed)) {
+        COMBO32_HIST_INC(h->seed_count[i]);
+        return;
+    }
+    for (i = 0; i < h->nseeds; i++) {
+        if (h->seed[i] == seed) {
+            break;
+        }
+    }
+    if (i == h->nseeds) {
+        if (i == COMBO32_HIST_SEEDS) {
+            COMBO32_HIST_INC(h->other_seeds);
+            return;
+        }
+        atomic_store_explicit(&h->seed[i], seed, memory_order_relaxed);
+        atomic_store_explicit(&h->nseeds, i + 1, memory_order_release);
+    }
+    h->last_seed = i;
+    COMBO32_HIST_INC(h->seed_count[i]);
+}
+
+/* Write the histogram of all threads to f.
+ * Only non-zero buckets are written, one per line:
+ *   len <length> <count>
+ *   loglen <log2 of length> <count>   (lengths 2^log to 2^(log+1)-1)
+ *   seed <seed> <count>
+ *   seed other <count>
+ */
+static void Combo32_histogram_dump(FILE *f) {
+    uint64_t *len = calloc(COMBO32_HIST_LENGTHS + 64, sizeof(uint64_t));
+    uint64_t seeds[COMBO32_HIST_SEEDS * 4];
+    uint64_t counts[COMBO32_HIST_SEEDS * 4];
+    unsigned int nseeds = 0;
+    uint64_t other = 0;
+
+    if (len == NULL) {
+        return;
+    }
+    for (struct combo32_histogram *h = atomic_load(&combo32_histograms);
+         h != NULL; h = h->next) {
+        const unsigned int n = atomic_load_explicit(&h->nseeds,
+                                                    memory_order_acquire);
+
+        for (unsigned int i = 0; i < COMBO32_HIST_LENGTHS; i++) {
+            len[i] += atomic_load_explicit(&h->len[i], memory_order_relaxed);
+        }
+        for (unsigned int i = 0; i < 64; i++) {
+            len[COMBO32_HIST_LENGTHS + i] +=
+                atomic_load_explicit(&h->log_len[i], memory_order_relaxed);
+        }
+        other += atomic_load_explicit(&h->other_seeds, memory_order_relaxed);
+        for (unsigned int i = 0; i < n; i++) {
+            const uint64_t seed = atomic_load_explicit(&h->seed[i],
+                                                       memory_order_relaxed);
+            const uint64_t count = atomic_load_explicit(&h->seed_count[i],
+                                                        memory_order_relaxed);
+            unsigned int j;
+
+            for (j = 0; j < nseeds && seeds[j] != seed; j++) {
+            }
+            if (j < nseeds) {
+                counts[j] += count;
+            } else if (nseeds < COMBO32_HIST_SEEDS * 4) {
+                seeds[nseeds] = seed;
+                counts[nseeds++] = count;
+            } else {
+                other += count;
+            }
+        }
+    }
+
+    fprintf(f, "# Combo32 histogram\n");
+    for (unsigned int i = 0; i < COMBO32_HIST_LENGTHS; i++) {
+        if (len[i] != 0) {
+            fprintf(f, "len %u %llu\n", i, (unsigned long long)len[i]);
+        }
+    }
+    for (unsigned int i = 0; i < 64; i++) {
+        if (len[COMBO32_HIST_LENGTHS + i] != 0) {
+            fprintf(f, "loglen %u %llu\n", i,
+                    (unsigned long long)len[COMBO32_HIST_LENGTHS + i]);
+        }
+    }
+    for (unsigned int i = 0; i < nseeds; i++) {
+        fprintf(f, "seed 0x%016llx %llu\n", (unsigned long long)seeds[i],
+                (unsigned long long)counts[i]);
+    }
+    if (other != 0) {
+        fprintf(f, "seed other %llu\n", (unsigned long long)other);
+    }
+    fflush(f);
+    free(len);
+}
+
+#endif /* COMBO32_HISTOGRAM */
+
+/*------------------------------------------------------------ */
+
 static uint32_t Combo32(const void * in, const size_t len, const uint64_t seed) {
-    /* Adjust this depending on the relative speeds of your system */
-    if (likely(len < 32)) {
+#if defined(COMBO32_HISTOGRAM) && COMBO32_HISTOGRAM
+    combo32_record(len, seed);
+#endif
+    if (likely(len < COMBO32_THRESHOLD)) {
         return Komi32(in, len, seed);
     }
     return Mult32(in, len, seed);
 }
 
+/* Two 32-bit hashes from one pass over the input, for cuckoo tables,
+ * Bloom filters and double hashing.
+ * *h1 is the same as Combo32(in, len, seed), so a table can switch to
+ * this without rehashing; *h2 is independent of it.
+ */
+static inline void Combo32x2(const void * in, const size_t len, const uint64_t seed,
+                             uint32_t *h1, uint32_t *h2) {
+#if defined(COMBO32_HISTOGRAM) && COMBO32_HISTOGRAM
+    combo32_record(len, seed);
+#endif
+    if (likely(len < COMBO32_THRESHOLD)) {
+        Komi32x2(in, len, seed, h1, h2);
+        return;
+    }
+    Mult32x2(in, len, seed, h1, h2);
+}
+
 #endif /* COMBO32_H */
@@ -0,0 +1,554 @@
+/*
+ * Cuckoo32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A bucketized cuckoo hash map keyed by byte strings, written in C.
+ * Each key lives in one of two buckets of 4 or 8 slots.  A bucket holds
+ * the 32-bit Combo32 value of each of its keys next to the index of the
+ * key's entry in a dense entry array, and fills a 32-byte or 64-byte
+ * aligned block, so a lookup reads at most two bucket cache lines before
+ * the entry, and compares all the hashes of a bucket at once with SSE2
+ * or AVX2.
+ * The first bucket comes from the high bits of the hash, and the other
+ * is the first XOR a value computed from the hash, so either bucket
+ * leads to the other from the stored hash alone and moving a key never
+ * calls Combo32 or reads the key.
+ * Inserts look for a free slot along the shortest chain of moves,
+ * found by breadth-first search, which keeps inserts working at load
+ * factors above 95%.
+ */
+
+#ifndef CUCKOO32_H
+#define CUCKOO32_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* comment out the next line if you don't want SSE2 and AVX2 */
+#define CUCKOO32_USE_SIMD 1
+
+#if defined(CUCKOO32_USE_SIMD) && CUCKOO32_USE_SIMD && \
+    (defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #define CUCKOO32_SSE2 1
+  #include <emmintrin.h>
+  #if defined(__AVX2__)
+    #define CUCKOO32_AVX2 1
+    #include <immintrin.h>
+  #endif
+#endif
+
+#if defined(__GNUC__)
+  #define CUCKOO32_CTZ(x) __builtin_ctz(x)
+#else
+  static inline int CUCKOO32_CTZ(uint32_t x) {
+      int n = 0;
+
+      while ((x & 1) == 0) {
+          x >>= 1;
+          n++;
+      }
+      return n;
+  }
+#endif
+
+/* Slots per bucket, 4 or 8 */
+#ifndef CUCKOO32_WAYS
+#define CUCKOO32_WAYS 8
+#endif
+#if CUCKOO32_WAYS != 4 && CUCKOO32_WAYS != 8
+  #error "CUCKOO32_WAYS must be 4 or 8"
+#endif
+
+#define CUCKOO32_EMPTY UINT32_MAX
+#define CUCKOO32_MIN_BUCKETS 2
+#define CUCKOO32_MAX_LOAD 0.99
+/* The breadth-first search for a free slot gives up after this many buckets */
+#define CUCKOO32_BFS_NODES 512
+/* Doublings tried when keys cannot be placed, before giving up */
+#define CUCKOO32_GROW_TRIES 4
+
+struct cuckoo32_bucket {
+    uint32_t hash[CUCKOO32_WAYS];
+    uint32_t index[CUCKOO32_WAYS];     /* into entries, or CUCKOO32_EMPTY */
+};
+
+struct cuckoo32_entry {
+    const void *key;
+    size_t len;
+    void *value;
+    uint32_t hash;
+};
+
+struct cuckoo32 {
+    struct cuckoo32_bucket *buckets;   /* aligned to the bucket size */
+    void *memory;                      /* what to free for buckets */
+    struct cuckoo32_entry *entries;
+    size_t nbuckets;                   /* always a power of 2 */
+    unsigned int shift;                /* 32 - log2(nbuckets) */
+    size_t size;                       /* number of entries */
+    size_t capacity;                   /* room in entries */
+    size_t grow_at;                    /* size at which the buckets are doubled */
+    double max_load;
+    uint64_t seed;
+};
+
+/*------------------------------------------------------------ */
+
+/* Bucket matching.
+ * Each function returns a mask with bit i set if slot i matches.
+ */
+
+#if defined(CUCKOO32_AVX2) && CUCKOO32_WAYS == 8
+
+static inline uint32_t cuckoo32_match_words(const uint32_t *words, const uint32_t x) {
+    const __m256i v = _mm256_load_si256((const __m256i *)words);
+
+    return (uint32_t)_mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, _mm256_set1_epi32((int)x))));
+}
+
+#elif defined(CUCKOO32_SSE2)
+
+static inline uint32_t cuckoo32_match_words(const uint32_t *words, const uint32_t x) {
+    const __m128i k = _mm_set1_epi32((int)x);
+    uint32_t mask = 0;
+
+    for (unsigned int i = 0; i < CUCKOO32_WAYS; i += 4) {
+        const __m128i v = _mm_load_si128((const __m128i *)(words + i));
+
+        mask |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, k))) << i;
+    }
+    return mask;
+}
+
+#else
+
+static inline uint32_t cuckoo32_match_words(const uint32_t *words, const uint32_t x) {
+    uint32_t mask = 0;
+
+    for (unsigned int i = 0; i < CUCKOO32_WAYS; i++) {
+        mask |= (uint32_t)(words[i] == x) << i;
+    }
+    return mask;
+}
+
+#endif
+
+static inline uint32_t cuckoo32_match(const struct cuckoo32_bucket *b, const uint32_t hash) {
+    return cuckoo32_match_words(b->hash, hash);
+}
+
+static inline uint32_t cuckoo32_match_empty(const struct cuckoo32_bucket *b) {
+    return cuckoo32_match_words(b->index, CUCKOO32_EMPTY);
+}
+
+/*------------------------------------------------------------ */
+
+/* Cuckoo32 helpers */
+
+static inline size_t cuckoo32_first(const struct cuckoo32 *m, const uint32_t hash) {
+    return (size_t)(hash >> m->shift);
+}
+
+/* The other bucket of a key with this hash that is in bucket b.
+ * The XOR value is odd, so the two buckets always differ, and applying
+ * it twice leads back to b.
+ */
+static inline size_t cuckoo32_other(const struct cuckoo32 *m, const size_t b,
+                                    const uint32_t hash) {
+    return (b ^ (size_t)((hash | 1) * UINT32_C(0x5BD1E995))) & (m->nbuckets - 1);
+}
+
+static size_t cuckoo32_buckets_for(const size_t n, const double max_load) {
+    size_t nbuckets = CUCKOO32_MIN_BUCKETS;
+
+    while ((double)(nbuckets * CUCKOO32_WAYS) * max_load < (double)n + 1) {
+        nbuckets <<= 1;
+    }
+    return nbuckets;
+}
+
+static int cuckoo32_alloc_buckets(struct cuckoo32 *m, const size_t nbuckets) {
+    const size_t align = sizeof(struct cuckoo32_bucket);
+    unsigned int lg = 0;
+
+    m->memory = malloc(nbuckets * sizeof(struct cuckoo32_bucket) + align - 1);
+    if (m->memory == NULL) {
+        return -1;
+    }
+    m->buckets = (struct cuckoo32_bucket *)
+        (((uintptr_t)m->memory + align - 1) & ~(uintptr_t)(align - 1));
+    /* All ones marks every slot empty */
+    memset(m->buckets, 0xFF, nbuckets * sizeof(struct cuckoo32_bucket));
+    while (((size_t)1 << lg) < nbuckets) {
+        lg++;
+    }
+    m->nbuckets = nbuckets;
+    m->shift = 32 - lg;
+    m->grow_at = (size_t)((double)(nbuckets * CUCKOO32_WAYS) * m->max_load);
+    return 0;
+}
+
+/* One bucket visited by the breadth-first search */
+struct cuckoo32_node {
+    size_t bucket;
+    int parent;            /* node index, or -1 for the key's own buckets */
+    int way;               /* slot of the parent whose key would move here */
+};
+
+/* Put hash and index in one of the key's two buckets, moving other keys
+ * to their other buckets along the shortest chain that ends in a free
+ * slot.  Returns 0, or -1 if no chain was found within
+ * CUCKOO32_BFS_NODES buckets, in which case nothing has moved.
+ */
+static int cuckoo32_place(struct cuckoo32 *m, const uint32_t hash, const uint32_t index) {
+    struct cuckoo32_node queue[CUCKOO32_BFS_NODES];
+    int head = 0, tail = 2;
+
+    queue[0].bucket = cuckoo32_first(m, hash);
+    queue[0].parent = -1;
+    queue[0].way = -1;
+    queue[1].bucket = cuckoo32_other(m, queue[0].bucket, hash);
+    queue[1].parent = -1;
+    queue[1].way = -1;
+
+    while (head < tail) {
+        const int n = head++;
+        const struct cuckoo32_bucket *b = &m->buckets[queue[n].bucket];
+        const uint32_t avail = cuckoo32_match_empty(b);
+
+        if (avail != 0) {
+            int cur = n;
+            int way = CUCKOO32_CTZ(avail);
+
+            /* Move each key one step along the chain, last first */
+            while (queue[cur].parent >= 0) {
+                struct cuckoo32_bucket *to = &m->buckets[queue[cur].bucket];
+                struct cuckoo32_bucket *from = &m->buckets[queue[queue[cur].parent].bucket];
+                const int from_way = queue[cur].way;
+
+                to->hash[way] = from->hash[from_way];
+                to->index[way] = from->index[from_way];
+                way = from_way;
+                cur = queue[cur].parent;
+            }
+            m->buckets[queue[cur].bucket].hash[way] = hash;
+            m->buckets[queue[cur].bucket].index[way] = index;
+            return 0;
+        }
+
+        for (int w = 0; w < CUCKOO32_WAYS && tail < CUCKOO32_BFS_NODES; w++) {
+            const size_t next = cuckoo32_other(m, queue[n].bucket, b->hash[w]);
+            int seen = 0;
+
+            /* A chain must not pass through the same bucket twice */
+            for (int p = n; p >= 0 && !seen; p = queue[p].parent) {
+                seen = queue[p].bucket == next;
+            }
+            if (!seen) {
+                queue[tail].bucket = next;
+                queue[tail].parent = n;
+                queue[tail].way = w;
+                tail++;
+            }
+        }
+    }
+    return -1;
+}
+
+/* Bucket and slot holding entry index, whose hash is hash */
+static inline uint32_t *cuckoo32_slot_of(const struct cuckoo32 *m, const uint32_t hash,
+                                         const uint32_t index) {
+    const size_t first = cuckoo32_first(m, hash);
+    struct cuckoo32_bucket *b = &m->buckets[first];
+    uint32_t match = cuckoo32_match_words(b->index, index);
+
+    if (match == 0) {
+        b = &m->buckets[cuckoo32_other(m, first, hash)];
+        match = cuckoo32_match_words(b->index, index);
+    }
+    return &b->index[CUCKOO32_CTZ(match)];
+}
+
+/*------------------------------------------------------------ */
+
+/* Cuckoo32 map functions */
+
+/* max_load is the largest fraction of slots in use, up to 0.99;
+ * 0 selects 0.95.  Returns 0, or -1 if out of memory.
+ */
+static int Cuckoo32_init(struct cuckoo32 *m, const size_t capacity,
+                         double max_load, const uint64_t seed) {
+    if (max_load <= 0.0) {
+        max_load = 0.95;
+    } else if (max_load > CUCKOO32_MAX_LOAD) {
+        max_load = CUCKOO32_MAX_LOAD;
+    } else if (max_load < 0.25) {
+        max_load = 0.25;
+    }
+    m->max_load = max_load;
+    m->seed = seed;
+    m->size = 0;
+    m->capacity = capacity;
+    m->entries = NULL;
+    if (capacity != 0) {
+        m->entries = (struct cuckoo32_entry *)malloc(capacity * sizeof(struct cuckoo32_entry));
+        if (m->entries == NULL) {
+            return -1;
+        }
+    }
+    if (cuckoo32_alloc_buckets(m, cuckoo32_buckets_for(capacity, max_load)) != 0) {
+        free(m->entries);
+        return -1;
+    }
+    return 0;
+}
+
+static void Cuckoo32_free(struct cuckoo32 *m) {
+    free(m->memory);
+    free(m->entries);
+    m->memory = NULL;
+    m->buckets = NULL;
+    m->entries = NULL;
+    m->nbuckets = 0;
+    m->size = 0;
+    m->capacity = 0;
+    m->grow_at = 0;
+}
+
+static inline uint32_t Cuckoo32_hash(const struct cuckoo32 *m, const void *key, const size_t len) {
+    return Combo32(key, len, m->seed);
+}
+
+/* Look up a key whose Combo32 value with the map's seed is already known.
+ * Returns NULL if the key is not in the map.
+ */
+static inline struct cuckoo32_entry *Cuckoo32_find_hash(const struct cuckoo32 *m,
+                                                        const void *key,
+                                                        const size_t len,
+                                                        const uint32_t hash) {
+    const size_t first = cuckoo32_first(m, hash);
+    const size_t other = cuckoo32_other(m, first, hash);
+    const struct cuckoo32_bucket *b = &m->buckets[first];
+
+    /* Fetch both bucket lines at once */
+    prefetch(&m->buckets[other]);
+    for (int i = 0; i < 2; i++) {
+        uint32_t match = cuckoo32_match(b, hash);
+
+        while (match != 0) {
+            const uint32_t index = b->index[CUCKOO32_CTZ(match)];
+
+            if (likely(index != CUCKOO32_EMPTY)) {
+                struct cuckoo32_entry *e = &m->entries[index];
+
+                if (likely(e->len == len && memcmp(e->key, key, len) == 0)) {
+                    return e;
+                }
+            }
+            match &= match - 1;
+        }
+        b = &m->buckets[other];
+    }
+    return NULL;
+}
+
+static inline struct cuckoo32_entry *Cuckoo32_find(const struct cuckoo32 *m,
+                                                   const void *key, const size_t len) {
+    return Cuckoo32_find_hash(m, key, len, Cuckoo32_hash(m, key, len));
+}
+
+/* Rebuild the buckets as nbuckets of them, doubling again if a key
+ * cannot be placed, up to CUCKOO32_GROW_TRIES times.
+ * Returns 0, or -1 if out of memory or the keys still could not be
+ * placed, in which case the map is unchanged.
+ */
+static int cuckoo32_rebuild(struct cuckoo32 *m, size_t nbuckets) {
+    struct cuckoo32 old = *m;
+
+    for (unsigned int tries = 0;; tries++) {
+        size_t i;
+
+        if (tries > CUCKOO32_GROW_TRIES || cuckoo32_alloc_buckets(m, nbuckets) != 0) {
+            *m = old;
+            return -1;
+        }
+        for (i = 0; i < m->size; i++) {
+            if (cuckoo32_place(m, m->entries[i].hash, (uint32_t)i) != 0) {
+                break;
+            }
+        }
+        if (i == m->size) {
+            break;
+        }
+        free(m->memory);
+        nbuckets <<= 1;
+    }
+    free(old.memory);
+    return 0;
+}
+
+/* Whether both buckets of hash are full of keys with that same hash,
+ * which no number of buckets would separate
+ */
+static int cuckoo32_hash_full(const struct cuckoo32 *m, const uint32_t hash) {
+    const uint32_t all = (UINT32_C(1) << CUCKOO32_WAYS) - 1;
+    const struct cuckoo32_bucket *a = &m->buckets[cuckoo32_first(m, hash)];
+    const struct cuckoo32_bucket *b = &m->buckets[cuckoo32_other(m, cuckoo32_first(m, hash), hash)];
+
+    /* An empty slot's hash is all ones, so check for those apart */
+    return cuckoo32_match_words(a->hash, hash) == all && cuckoo32_match_empty(a) == 0 &&
+           cuckoo32_match_words(b->hash, hash) == all && cuckoo32_match_empty(b) == 0;
+}
+
+/* Rebuild the buckets for at least n keys, doubling again if a key
+ * cannot be placed.
+ * The stored hashes are reused, so neither Combo32 nor the keys are
+ * touched.
+ * Returns 0, or -1 if out of memory or the keys could not be placed,
+ * in which case the map is unchanged.
+ */
+static int Cuckoo32_rehash(struct cuckoo32 *m, size_t n) {
+    if (n < m->size) {
+        n = m->size;
+    }
+    return cuckoo32_rebuild(m, cuckoo32_buckets_for(n, m->max_load));
+}
+
+/* Make room for n keys without further rehashing */
+static int Cuckoo32_reserve(struct cuckoo32 *m, const size_t n) {
+    if (n > m->capacity) {
+        struct cuckoo32_entry *e = (struct cuckoo32_entry *)
+            realloc(m->entries, n * sizeof(struct cuckoo32_entry));
+
+        if (e == NULL) {
+            return -1;
+        }
+        m->entries = e;
+        m->capacity = n;
+    }
+    if (n <= m->grow_at) {
+        return 0;
+    }
+    return Cuckoo32_rehash(m, n);
+}
+
+/* Find a key, or add it if it is missing.
+ * *inserted is set to 1 if the key was added, in which case the entry's
+ * value is uninitialized, or 0 if it was already there.
+ * Returns the key's entry, or NULL if out of memory or if more than
+ * 2 * CUCKOO32_WAYS keys share its hash.
+ * Entry pointers stay valid until the next insert or erase.
+ */
+static struct cuckoo32_entry *Cuckoo32_insert_hash(struct cuckoo32 *m,
+                                                   const void *key,
+                                                   const size_t len,
+                                                   const uint32_t hash,
+                                                   int *inserted) {
+    struct cuckoo32_entry *e = Cuckoo32_find_hash(m, key, len, hash);
+
+    *inserted = 0;
+    if (e != NULL) {
+        return e;
+    }
+    if (unlikely(m->size >= CUCKOO32_EMPTY - 1)) {
+        return NULL;
+    }
+    if (unlikely(m->size == m->capacity)) {
+        const size_t n = m->capacity < 8 ? 8 : m->capacity * 2;
+        struct cuckoo32_entry *grown = (struct cuckoo32_entry *)
+            realloc(m->entries, n * sizeof(struct cuckoo32_entry));
+
+        if (grown == NULL) {
+            return NULL;
+        }
+        m->entries = grown;
+        m->capacity = n;
+    }
+    if (unlikely(m->size + 1 > m->grow_at) &&
+        Cuckoo32_rehash(m, m->size + 1) != 0) {
+        return NULL;
+    }
+    /* No chain of moves found; grow until there is one, unless the
+     * key's buckets are already full of its own hash
+     */
+    for (unsigned int tries = 0;
+         unlikely(cuckoo32_place(m, hash, (uint32_t)m->size) != 0); tries++) {
+        if (tries == CUCKOO32_GROW_TRIES || cuckoo32_hash_full(m, hash) ||
+            cuckoo32_rebuild(m, m->nbuckets * 2) != 0) {
+            return NULL;
+        }
+    }
+
+    e = &m->entries[m->size];
+    e->key = key;
+    e->len = len;
+    e->hash = hash;
+    m->size++;
+    *inserted = 1;
+    return e;
+}
+
+static inline struct cuckoo32_entry *Cuckoo32_insert(struct cuckoo32 *m,
+                                                     const void *key,
+                                                     const size_t len,
+                                                     int *inserted) {
+    return Cuckoo32_insert_hash(m, key, len, Cuckoo32_hash(m, key, len), inserted);
+}
+
+/* Remove entry e, which must be an entry of this map.
+ * The last entry moves into e's place to keep the entry array dense.
+ */
+static void Cuckoo32_erase_entry(struct cuckoo32 *m, struct cuckoo32_entry *e) {
+    const uint32_t index = (uint32_t)(e - m->entries);
+    const uint32_t last = (uint32_t)(m->size - 1);
+    uint32_t *slot = cuckoo32_slot_of(m, e->hash, index);
+
+    /* The hash beside an empty slot is never compared with an index */
+    *slot = CUCKOO32_EMPTY;
+
+    if (index != last) {
+        m->entries[index] = m->entries[last];
+        *cuckoo32_slot_of(m, m->entries[index].hash, last) = index;
+    }
+    m->size--;
+}
+
+/* Returns 1 if the key was removed, 0 if it was not in the map */
+static inline int Cuckoo32_erase(struct cuckoo32 *m, const void *key, const size_t len) {
+    struct cuckoo32_entry *e = Cuckoo32_find(m, key, len);
+
+    if (e == NULL) {
+        return 0;
+    }
+    Cuckoo32_erase_entry(m, e);
+    return 1;
+}
+
+/* Fraction of slots in use */
+static inline double Cuckoo32_load(const struct cuckoo32 *m) {
+    return (double)m->size / (double)(m->nbuckets * CUCKOO32_WAYS);
+}
+
+#endif /* CUCKOO32_H */
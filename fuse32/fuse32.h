@@ -0,0 +1,597 @@
+/*
+ * Fuse32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A binary fuse filter for static sets of byte strings, written in C.
+ * Each key is hashed once with Combo32x2 into 64 bits, which pick a
+ * partition and, remixed with the partition's salt, three positions in
+ * three consecutive segments of its array of 8 or 16-bit fingerprints
+ * and the key's fingerprint.  The builder finds fingerprints whose
+ * exclusive-or at the three positions of every key is that key's
+ * fingerprint, by peeling the positions held by one key, so a query is
+ * one hash and three memory reads.
+ * A partition that does not peel is retried with another salt.
+ * Partitions are built in parallel, and the result is one position
+ * independent blob that can be written to a file and used straight from
+ * mmap.
+ */
+
+#ifndef FUSE32_H
+#define FUSE32_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* comment out the next line if you don't want to build with threads */
+#define FUSE32_USE_THREADS 1
+
+#if defined(FUSE32_USE_THREADS) && FUSE32_USE_THREADS
+  #include <pthread.h>
+#endif
+
+#define FUSE32_FORMAT 1
+#define FUSE32_BYTE_ORDER UINT32_C(0x01020304)
+/* Average keys per partition */
+#ifndef FUSE32_PARTITION
+#define FUSE32_PARTITION (1 << 24)
+#endif
+#define FUSE32_MAX_SEGMENT (1 << 18)
+/* Salts tried per partition, one more segment every eighth try */
+#define FUSE32_ATTEMPTS 64
+
+/* Errors; all are negative */
+#define FUSE32_ERR_MEMORY -1
+#define FUSE32_ERR_KEYS   -2     /* could not build, or bits not 8 or 16 */
+#define FUSE32_ERR_FORMAT -3     /* not a Fuse32 blob, or another byte order */
+#define FUSE32_ERR_HASHER -4     /* built with another Combo32 version or threshold */
+
+static const char fuse32_magic[8] = { 'F', 'u', 's', 'e', '3', '2', 0, 0 };
+
+/* The blob starts with this header, then one fuse32_part per partition,
+ * then the fingerprint arrays, each padded to 8 bytes
+ */
+struct fuse32_header {
+    char magic[8];
+    uint32_t format;
+    uint32_t byte_order;           /* FUSE32_BYTE_ORDER as written */
+    uint32_t combo32_version;
+    uint32_t combo32_threshold;
+    uint64_t seed;
+    uint64_t n;                    /* keys */
+    uint64_t nparts;
+    uint32_t bits;                 /* per fingerprint, 8 or 16 */
+    uint32_t unused;
+    uint64_t size;                 /* of the whole blob, in bytes */
+};
+
+struct fuse32_part {
+    uint64_t salt;
+    uint32_t segment_length;       /* a power of 2 */
+    uint32_t segment_count_length; /* segments a first position can be in, times their length */
+    uint64_t array_length;         /* fingerprints */
+    uint64_t fingerprints;         /* blob offset of the fingerprints */
+};
+
+/* A loaded filter; it points into the blob, which must outlive it */
+struct fuse32 {
+    const uint8_t *blob;
+    const struct fuse32_part *parts;
+    uint64_t nparts;
+    uint64_t n;
+    uint64_t seed;
+    unsigned int bits;
+};
+
+/*------------------------------------------------------------ */
+
+/* Fuse32 hashing */
+
+static inline uint64_t fuse32_mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= UINT64_C(0xFF51AFD7ED558CCD);
+    x ^= x >> 33;
+    x *= UINT64_C(0xC4CEB9FE1A85EC53);
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint64_t fuse32_hash(const void *key, const size_t len, const uint64_t seed) {
+    uint32_t h1, h2;
+
+    Combo32x2(key, len, seed, &h1, &h2);
+    return (uint64_t)h1 << 32 | h2;
+}
+
+/* The partition comes from the high half of the key's hash */
+static inline uint64_t fuse32_partition(const uint64_t hash, const uint64_t nparts) {
+    return ((hash >> 32) * nparts) >> 32;
+}
+
+/* The three positions of a remixed hash, one in each of three
+ * consecutive segments
+ */
+static inline void fuse32_positions(const struct fuse32_part *pt, const uint64_t h,
+                                    uint64_t pos[3]) {
+    const uint64_t mask = pt->segment_length - 1;
+
+    pos[0] = ((h >> 32) * pt->segment_count_length) >> 32;
+    pos[1] = (pos[0] + pt->segment_length) ^ ((h >> 18) & mask);
+    pos[2] = (pos[0] + 2 * (uint64_t)pt->segment_length) ^ (h & mask);
+}
+
+static inline uint32_t fuse32_fingerprint(const uint64_t h) {
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/*------------------------------------------------------------ */
+
+/* Fuse32 lookup */
+
+/* Check a blob and set up f to use it in place.
+ * Returns 0 or a negative FUSE32_ERR code.
+ */
+static int Fuse32_load(struct fuse32 *f, const void *blob, const size_t size) {
+    const struct fuse32_header *h = (const struct fuse32_header *)blob;
+
+    if (size < sizeof(*h) || memcmp(h->magic, fuse32_magic, sizeof(h->magic)) != 0 ||
+        h->format != FUSE32_FORMAT || h->byte_order != FUSE32_BYTE_ORDER ||
+        h->size > size || h->nparts == 0 || (h->bits != 8 && h->bits != 16) ||
+        sizeof(*h) + h->nparts * sizeof(struct fuse32_part) > h->size) {
+        return FUSE32_ERR_FORMAT;
+    }
+    if (h->combo32_version != COMBO32_VERSION ||
+        h->combo32_threshold != COMBO32_THRESHOLD) {
+        return FUSE32_ERR_HASHER;
+    }
+    f->blob = (const uint8_t *)blob;
+    f->parts = (const struct fuse32_part *)(h + 1);
+    f->nparts = h->nparts;
+    f->n = h->n;
+    f->seed = h->seed;
+    f->bits = h->bits;
+    return 0;
+}
+
+static inline uint64_t Fuse32_hash(const struct fuse32 *f, const void *key, const size_t len) {
+    return fuse32_hash(key, len, f->seed);
+}
+
+/* Returns 1 if the key may be in the set, 0 if it certainly is not */
+static inline int Fuse32_contains_hash(const struct fuse32 *f, const uint64_t hash) {
+    const struct fuse32_part *pt = &f->parts[fuse32_partition(hash, f->nparts)];
+    const uint64_t h = fuse32_mix64(hash + pt->salt);
+    const uint32_t fp = fuse32_fingerprint(h);
+    uint64_t pos[3];
+
+    fuse32_positions(pt, h, pos);
+    if (f->bits == 8) {
+        const uint8_t *a = f->blob + pt->fingerprints;
+
+        return (uint8_t)fp == (a[pos[0]] ^ a[pos[1]] ^ a[pos[2]]);
+    } else {
+        const uint16_t *a = (const uint16_t *)(f->blob + pt->fingerprints);
+
+        return (uint16_t)fp == (a[pos[0]] ^ a[pos[1]] ^ a[pos[2]]);
+    }
+}
+
+static inline int Fuse32_contains(const struct fuse32 *f, const void *key, const size_t len) {
+    return Fuse32_contains_hash(f, Fuse32_hash(f, key, len));
+}
+
+/* Size of the blob in bits per key */
+static inline double Fuse32_bits_per_key(const struct fuse32 *f) {
+    const struct fuse32_header *h = (const struct fuse32_header *)f->blob;
+
+    return f->n != 0 ? 8.0 * (double)h->size / (double)f->n : 0.0;
+}
+
+/*------------------------------------------------------------ */
+
+/* Fuse32 builder */
+
+struct fuse32_work {
+    uint64_t *hashes;              /* grouped by partition */
+    struct fuse32_part *parts;
+    uint64_t *part_start;          /* index of each partition's first hash */
+    void **arrays;                 /* fingerprints, per partition */
+    uint64_t nparts;
+    unsigned int bits;
+    unsigned int thread;
+    unsigned int nthreads;
+    int err;
+    /* hashing stage */
+    const void *const *keys;
+    const size_t *lens;
+    uint64_t n;
+    uint64_t seed;
+    uint64_t *all;                 /* hashes in key order */
+    uint64_t *counts;              /* nthreads * nparts */
+};
+
+/* Size a partition of n keys, with extra segments after failed tries */
+static void fuse32_size_part(struct fuse32_part *pt, const uint64_t n, const unsigned int extra) {
+    uint64_t length = 4, capacity = 0, count;
+
+    if (n > 1) {
+        const double factor = fmax(1.125, 0.875 + 0.25 * log(1e6) / log((double)n));
+
+        length = UINT64_C(1) << (unsigned int)floor(log((double)n) / log(3.33) + 2.25);
+        length = length > FUSE32_MAX_SEGMENT ? FUSE32_MAX_SEGMENT : length;
+        capacity = (uint64_t)llround((double)n * factor);
+    }
+    count = (capacity + length - 1) / length;
+    count = count > 3 ? count - 2 : 1;
+    count += extra;
+    pt->segment_length = (uint32_t)length;
+    pt->segment_count_length = (uint32_t)(count * length);
+    pt->array_length = (count + 2) * length;
+}
+
+static int fuse32_cmp64(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Sort n hashes and drop the repeats; returns how many are left */
+static uint64_t fuse32_dedupe(uint64_t *hashes, const uint64_t n) {
+    uint64_t m = 0;
+
+    qsort(hashes, (size_t)n, sizeof(uint64_t), fuse32_cmp64);
+    for (uint64_t i = 0; i < n; i++) {
+        if (m == 0 || hashes[m - 1] != hashes[i]) {
+            hashes[m++] = hashes[i];
+        }
+    }
+    return m;
+}
+
+/* Build the fingerprints of one partition's n hashes into *out, trying
+ * salts until the positions peel.  Equal hashes never peel, so after
+ * the first failed try the hashes are sorted in place and kept once.
+ */
+static int fuse32_build_part(struct fuse32_part *pt, uint64_t *hashes, uint64_t n,
+                             const unsigned int bits, const uint64_t seed, void **out) {
+    uint8_t *t2count = NULL, *found = NULL;
+    uint64_t *t2hash = NULL, *order = NULL;
+    uint32_t *alone = NULL;
+    void *array = NULL;
+    int deduped = 0;
+    int err = FUSE32_ERR_KEYS;
+
+    for (unsigned int attempt = 0; attempt < FUSE32_ATTEMPTS; attempt++) {
+        uint64_t queued = 0, peeled = 0;
+        int overflow = 0;
+
+        if (attempt == 1 && !deduped) {
+            n = fuse32_dedupe(hashes, n);
+            deduped = 1;
+        }
+
+        fuse32_size_part(pt, n, attempt / 8);
+        pt->salt = fuse32_mix64(seed + attempt + 1);
+        free(t2count);
+        free(t2hash);
+        free(alone);
+        t2count = (uint8_t *)calloc((size_t)pt->array_length, 1);
+        t2hash = (uint64_t *)calloc((size_t)pt->array_length, sizeof(uint64_t));
+        alone = (uint32_t *)malloc((size_t)pt->array_length * sizeof(uint32_t));
+        if (order == NULL) {
+            order = (uint64_t *)malloc((size_t)(n + 1) * sizeof(uint64_t));
+            found = (uint8_t *)malloc((size_t)(n + 1));
+        }
+        if (t2count == NULL || t2hash == NULL || alone == NULL || order == NULL ||
+            found == NULL) {
+            err = FUSE32_ERR_MEMORY;
+            goto done;
+        }
+
+        /* Each position counts its keys, times 4, with the exclusive-or
+         * of which of its keys' three positions it is in the low 2 bits,
+         * and the exclusive-or of their hashes
+         */
+        for (uint64_t i = 0; i < n && !overflow; i++) {
+            const uint64_t h = fuse32_mix64(hashes[i] + pt->salt);
+            uint64_t pos[3];
+
+            fuse32_positions(pt, h, pos);
+            for (unsigned int k = 0; k < 3; k++) {
+                t2count[pos[k]] = (uint8_t)((t2count[pos[k]] + 4) ^ k);
+                t2hash[pos[k]] ^= h;
+            }
+            overflow = t2count[pos[0]] < 4 || t2count[pos[1]] < 4 || t2count[pos[2]] < 4;
+        }
+        if (overflow) {
+            continue;
+        }
+
+        /* Peel positions with one key, recording the key and which of its
+         * positions it was peeled at
+         */
+        for (uint64_t i = 0; i < pt->array_length; i++) {
+            if (t2count[i] >> 2 == 1) {
+                alone[queued++] = (uint32_t)i;
+            }
+        }
+        while (queued > 0) {
+            const uint32_t i = alone[--queued];
+
+            if (t2count[i] >> 2 == 1) {
+                const uint64_t h = t2hash[i];
+                const unsigned int k = t2count[i] & 3;
+                uint64_t pos[3];
+
+                order[peeled] = h;
+                found[peeled++] = (uint8_t)k;
+                fuse32_positions(pt, h, pos);
+                for (unsigned int j = 0; j < 3; j++) {
+                    if (j != k) {
+                        t2count[pos[j]] = (uint8_t)((t2count[pos[j]] - 4) ^ j);
+                        t2hash[pos[j]] ^= h;
+                        if (t2count[pos[j]] >> 2 == 1) {
+                            alone[queued++] = (uint32_t)pos[j];
+                        }
+                    }
+                }
+                t2count[i] = 0;
+            }
+        }
+        if (peeled != n) {
+            continue;
+        }
+
+        /* Assign fingerprints in the reverse of the peeling order, each
+         * key's peeled position last, so that it sees its final value
+         */
+        array = calloc((size_t)pt->array_length, bits / 8);
+        if (array == NULL) {
+            err = FUSE32_ERR_MEMORY;
+            goto done;
+        }
+        for (uint64_t i = peeled; i-- > 0;) {
+            const uint64_t h = order[i];
+            const unsigned int k = found[i];
+            uint64_t pos[3];
+
+            fuse32_positions(pt, h, pos);
+            if (bits == 8) {
+                uint8_t *a = (uint8_t *)array;
+
+                a[pos[k]] = (uint8_t)(fuse32_fingerprint(h) ^ a[pos[(k + 1) % 3]] ^
+                                      a[pos[(k + 2) % 3]]);
+            } else {
+                uint16_t *a = (uint16_t *)array;
+
+                a[pos[k]] = (uint16_t)(fuse32_fingerprint(h) ^ a[pos[(k + 1) % 3]] ^
+                                       a[pos[(k + 2) % 3]]);
+            }
+        }
+        *out = array;
+        err = 0;
+        break;
+    }
+
+done:
+    free(t2count);
+    free(t2hash);
+    free(alone);
+    free(order);
+    free(found);
+    return err;
+}
+
+static void *fuse32_hash_thread(void *arg) {
+    struct fuse32_work *w = (struct fuse32_work *)arg;
+    const uint64_t first = w->n * w->thread / w->nthreads;
+    const uint64_t last = w->n * (w->thread + 1) / w->nthreads;
+    uint64_t *counts = w->counts + (uint64_t)w->thread * w->nparts;
+
+    for (uint64_t i = first; i < last; i++) {
+        w->all[i] = fuse32_hash(w->keys[i], w->lens[i], w->seed);
+        counts[fuse32_partition(w->all[i], w->nparts)]++;
+    }
+    return NULL;
+}
+
+static void *fuse32_scatter_thread(void *arg) {
+    struct fuse32_work *w = (struct fuse32_work *)arg;
+    const uint64_t first = w->n * w->thread / w->nthreads;
+    const uint64_t last = w->n * (w->thread + 1) / w->nthreads;
+    uint64_t *next = w->counts + (uint64_t)w->thread * w->nparts;
+
+    for (uint64_t i = first; i < last; i++) {
+        w->hashes[next[fuse32_partition(w->all[i], w->nparts)]++] = w->all[i];
+    }
+    return NULL;
+}
+
+static void *fuse32_part_thread(void *arg) {
+    struct fuse32_work *w = (struct fuse32_work *)arg;
+
+    for (uint64_t i = w->thread; i < w->nparts && w->err == 0; i += w->nthreads) {
+        w->err = fuse32_build_part(&w->parts[i], w->hashes + w->part_start[i],
+                                   w->part_start[i + 1] - w->part_start[i], w->bits,
+                                   w->seed + i * UINT64_C(0x9E3779B97F4A7C15), &w->arrays[i]);
+    }
+    return NULL;
+}
+
+/* Run fn on every work item, on threads if there are any */
+static void fuse32_run(void *(*fn)(void *), struct fuse32_work *work,
+                       const unsigned int nthreads) {
+#if defined(FUSE32_USE_THREADS) && FUSE32_USE_THREADS
+    pthread_t *threads = (pthread_t *)malloc(nthreads * sizeof(pthread_t));
+    unsigned int started = 0;
+
+    if (threads != NULL) {
+        for (; started < nthreads; started++) {
+            if (pthread_create(&threads[started], NULL, fn, &work[started]) != 0) {
+                break;
+            }
+        }
+    }
+    /* Whatever could not get a thread runs here */
+    for (unsigned int t = started; t < nthreads; t++) {
+        fn(&work[t]);
+    }
+    for (unsigned int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+#else
+    for (unsigned int t = 0; t < nthreads; t++) {
+        fn(&work[t]);
+    }
+#endif
+}
+
+/* Build a filter of n keys with bits, 8 or 16, bits per fingerprint,
+ * using up to nthreads threads.  Keys may repeat, and are kept once.
+ * On success sets *blob to a malloc'd blob of *size bytes, for
+ * Fuse32_load or to be written to a file, and returns 0; else returns a
+ * negative FUSE32_ERR code.
+ */
+static int Fuse32_build(const void *const *keys, const size_t *lens, const uint64_t n,
+                        const uint64_t seed, const unsigned int bits, unsigned int nthreads,
+                        void **blob, size_t *size) {
+    const uint64_t nparts = n / FUSE32_PARTITION + 1;
+    struct fuse32_work *work;
+    struct fuse32_part *parts;
+    uint64_t *all, *hashes, *counts, *part_start;
+    void **arrays;
+    int err = FUSE32_ERR_MEMORY;
+
+    if (bits != 8 && bits != 16) {
+        return FUSE32_ERR_KEYS;
+    }
+#if !defined(FUSE32_USE_THREADS) || !FUSE32_USE_THREADS
+    nthreads = 1;
+#endif
+    if (nthreads == 0) {
+        nthreads = 1;
+    }
+    all = (uint64_t *)malloc((size_t)(n + 1) * sizeof(uint64_t));
+    hashes = (uint64_t *)malloc((size_t)(n + 1) * sizeof(uint64_t));
+    counts = (uint64_t *)calloc((size_t)(nthreads * nparts), sizeof(uint64_t));
+    part_start = (uint64_t *)malloc((size_t)(nparts + 1) * sizeof(uint64_t));
+    parts = (struct fuse32_part *)calloc((size_t)nparts, sizeof(struct fuse32_part));
+    arrays = (void **)calloc((size_t)nparts, sizeof(void *));
+    work = (struct fuse32_work *)calloc(nthreads, sizeof(struct fuse32_work));
+    if (all == NULL || hashes == NULL || counts == NULL || part_start == NULL ||
+        parts == NULL || arrays == NULL || work == NULL) {
+        goto done;
+    }
+    /* Mult32x2 sets itself up on its first call; make that this thread */
+    fuse32_hash("", 0, seed);
+
+    for (unsigned int t = 0; t < nthreads; t++) {
+        work[t].keys = keys;
+        work[t].lens = lens;
+        work[t].n = n;
+        work[t].seed = seed;
+        work[t].all = all;
+        work[t].hashes = hashes;
+        work[t].counts = counts;
+        work[t].parts = parts;
+        work[t].part_start = part_start;
+        work[t].arrays = arrays;
+        work[t].nparts = nparts;
+        work[t].bits = bits;
+        work[t].thread = t;
+        work[t].nthreads = nthreads;
+    }
+    fuse32_run(fuse32_hash_thread, work, nthreads);
+
+    /* Turn the per-thread counts into where each thread scatters */
+    part_start[0] = 0;
+    for (uint64_t i = 0; i < nparts; i++) {
+        uint64_t total = part_start[i];
+
+        for (unsigned int t = 0; t < nthreads; t++) {
+            const uint64_t c = counts[t * nparts + i];
+
+            counts[t * nparts + i] = total;
+            total += c;
+        }
+        part_start[i + 1] = total;
+    }
+    fuse32_run(fuse32_scatter_thread, work, nthreads);
+    fuse32_run(fuse32_part_thread, work, nthreads);
+
+    err = 0;
+    for (unsigned int t = 0; t < nthreads; t++) {
+        err = work[t].err != 0 ? work[t].err : err;
+    }
+    if (err == 0) {
+        struct fuse32_header *h;
+        uint8_t *out;
+        size_t bytes = sizeof(*h) + (size_t)nparts * sizeof(struct fuse32_part);
+
+        for (uint64_t i = 0; i < nparts; i++) {
+            parts[i].fingerprints = bytes;
+            bytes += ((size_t)parts[i].array_length * (bits / 8) + 7) & ~(size_t)7;
+        }
+        out = (uint8_t *)calloc(bytes, 1);
+        if (out == NULL) {
+            err = FUSE32_ERR_MEMORY;
+            goto done;
+        }
+        h = (struct fuse32_header *)out;
+        memcpy(h->magic, fuse32_magic, sizeof(h->magic));
+        h->format = FUSE32_FORMAT;
+        h->byte_order = FUSE32_BYTE_ORDER;
+        h->combo32_version = COMBO32_VERSION;
+        h->combo32_threshold = COMBO32_THRESHOLD;
+        h->seed = seed;
+        h->n = n;
+        h->nparts = nparts;
+        h->bits = bits;
+        h->size = bytes;
+        memcpy(h + 1, parts, (size_t)nparts * sizeof(struct fuse32_part));
+        for (uint64_t i = 0; i < nparts; i++) {
+            memcpy(out + parts[i].fingerprints, arrays[i],
+                   (size_t)parts[i].array_length * (bits / 8));
+        }
+        *blob = out;
+        *size = bytes;
+    }
+
+done:
+    if (arrays != NULL) {
+        for (uint64_t i = 0; i < nparts; i++) {
+            free(arrays[i]);
+        }
+    }
+    free(all);
+    free(hashes);
+    free(counts);
+    free(part_start);
+    free(parts);
+    free(arrays);
+    free(work);
+    return err;
+}
+
+#endif /* FUSE32_H */
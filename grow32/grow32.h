@@ -0,0 +1,385 @@
+/*
+ * Grow32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Robin32 with incremental resizing, for maps so large that rebuilding
+ * the slots in one go would stall the caller.
+ * When the map is full it allocates slots of twice the size and keeps
+ * the old ones.  New keys go into the new slots, lookups search both,
+ * and every insert and erase moves a few whole clusters of old slots
+ * across, until the old slots are empty and are freed.
+ * Moving a slot uses its stored Combo32 value, so neither Combo32 nor
+ * the keys are touched.
+ * The old slots can also be moved in the caller's idle time, with
+ * Grow32_migrate.
+ * Filling a large array with empty slots would stall as well, so the
+ * next, larger slots are allocated shortly before they are needed and
+ * a few of them are emptied on each insert.
+ */
+
+#ifndef GROW32_H
+#define GROW32_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "robin32.h"
+
+/* Old slots examined by each insert and erase while the map grows.
+ * Each step runs on to the end of the cluster it is in, so that the old
+ * slots left behind can still be searched.
+ */
+#ifndef GROW32_STEP
+#define GROW32_STEP 16
+#endif
+/* Slots of the next, larger array emptied by each insert */
+#ifndef GROW32_CLEAR
+#define GROW32_CLEAR 128
+#endif
+
+struct grow32 {
+    struct robin32 map;    /* new slots, and the entries of both */
+    struct robin32 old;    /* old slots while growing; shares map's entries */
+    size_t next;           /* next old slot to move */
+    size_t left;           /* old slots not yet examined, 0 if not growing */
+    struct robin32_slot *spare;  /* the next slots, or NULL */
+    size_t spare_nslots;
+    size_t cleared;        /* spare slots emptied so far */
+};
+
+/*------------------------------------------------------------ */
+
+/* Grow32 helpers */
+
+/* Position of the slot holding entry index, whose hash is hash, or
+ * SIZE_MAX if it is not among t's slots
+ */
+static inline size_t grow32_slot_of(const struct robin32 *t, const uint32_t hash,
+                                    const uint32_t index) {
+    const size_t mask = t->nslots - 1;
+    size_t pos = robin32_home(t, hash);
+    size_t dist = 0;
+
+    for (;;) {
+        const struct robin32_slot s = t->slots[pos];
+
+        if (s.index == index) {
+            return pos;
+        }
+        if (s.index == ROBIN32_EMPTY || robin32_distance(t, pos, s.hash) < dist) {
+            return SIZE_MAX;
+        }
+        pos = (pos + 1) & mask;
+        dist++;
+    }
+}
+
+/* Move at least nslots old slots to the new ones, stopping at the end of
+ * a cluster.  Frees the old slots once they are all moved.
+ * Returns 1 if old slots remain, else 0.
+ */
+static int grow32_step(struct grow32 *m, const size_t nslots) {
+    const size_t mask = m->old.nslots - 1;
+    size_t done = 0;
+
+    if (m->left == 0) {
+        return 0;
+    }
+    /* Removing only whole clusters keeps every remaining Robin Hood
+     * chain intact, so the old slots stay searchable
+     */
+    while (m->left != 0 &&
+           (done < nslots || m->old.slots[m->next].index != ROBIN32_EMPTY)) {
+        struct robin32_slot *s = &m->old.slots[m->next];
+
+        if (s->index != ROBIN32_EMPTY) {
+            robin32_place(&m->map, *s);
+            s->hash = ROBIN32_EMPTY;
+            s->index = ROBIN32_EMPTY;
+        }
+        m->next = (m->next + 1) & mask;
+        m->left--;
+        done++;
+    }
+    if (m->left == 0) {
+        free(m->old.slots);
+        m->old.slots = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+/* Empty up to nslots more of the next slots, allocating them first if
+ * need be.  If they cannot be allocated, grow32_start tries again.
+ */
+static void grow32_prepare(struct grow32 *m, const size_t nslots) {
+    size_t n;
+
+    if (m->spare == NULL) {
+        m->spare_nslots = m->map.nslots * 2;
+        m->cleared = 0;
+        m->spare = (struct robin32_slot *)
+            malloc(m->spare_nslots * sizeof(struct robin32_slot));
+        if (m->spare == NULL) {
+            return;
+        }
+    }
+    n = m->spare_nslots - m->cleared < nslots ? m->spare_nslots - m->cleared : nslots;
+    /* All ones marks a slot empty */
+    memset(m->spare + m->cleared, 0xFF, n * sizeof(struct robin32_slot));
+    m->cleared += n;
+}
+
+/* Start moving to slots of twice the size.  Any earlier growth is
+ * finished first.  Returns 0, or -1 if out of memory, in which case the
+ * map is unchanged.
+ */
+static int grow32_start(struct grow32 *m) {
+    struct robin32 old;
+    size_t pos = 0;
+
+    grow32_step(m, SIZE_MAX);
+    old = m->map;
+    if (m->spare != NULL && m->spare_nslots != old.nslots * 2) {
+        free(m->spare);
+        m->spare = NULL;
+    }
+    grow32_prepare(m, SIZE_MAX);
+    if (m->spare == NULL) {
+        return -1;
+    }
+    m->map.slots = m->spare;
+    m->map.nslots = m->spare_nslots;
+    m->map.shift = old.shift - 1;
+    m->map.grow_at = (size_t)((double)m->map.nslots * m->map.max_load);
+    m->spare = NULL;
+    m->old = old;
+    /* Begin after an empty slot, so that no cluster wraps around the
+     * start; there is always one, as the load is at most 0.95
+     */
+    while (old.slots[pos].index != ROBIN32_EMPTY) {
+        pos++;
+    }
+    m->next = pos;
+    m->left = old.nslots;
+    return 0;
+}
+
+/*------------------------------------------------------------ */
+
+/* Grow32 map functions */
+
+/* max_load is the largest fraction of the new slots in use, up to 0.95;
+ * 0 selects 0.8.  Returns 0, or -1 if out of memory.
+ */
+static int Grow32_init(struct grow32 *m, const size_t capacity,
+                       const double max_load, const uint64_t seed) {
+    memset(&m->old, 0, sizeof(m->old));
+    m->next = 0;
+    m->left = 0;
+    m->spare = NULL;
+    m->spare_nslots = 0;
+    m->cleared = 0;
+    return Robin32_init(&m->map, capacity, max_load, seed);
+}
+
+static void Grow32_free(struct grow32 *m) {
+    free(m->old.slots);
+    free(m->spare);
+    m->old.slots = NULL;
+    m->spare = NULL;
+    m->left = 0;
+    Robin32_free(&m->map);
+}
+
+static inline uint32_t Grow32_hash(const struct grow32 *m, const void *key, const size_t len) {
+    return Combo32(key, len, m->map.seed);
+}
+
+/* Returns 1 while old slots remain to be moved */
+static inline int Grow32_growing(const struct grow32 *m) {
+    return m->left != 0;
+}
+
+/* Move at least nslots old slots, for callers that want to finish growing
+ * in their idle time; SIZE_MAX finishes it now.
+ * The map is not thread-safe: a background thread calling this must hold
+ * the same lock as every other user of the map.
+ * Returns 1 if old slots remain, else 0.
+ */
+static inline int Grow32_migrate(struct grow32 *m, const size_t nslots) {
+    return grow32_step(m, nslots);
+}
+
+/* Look up a key whose Combo32 value with the map's seed is already known.
+ * Returns NULL if the key is not in the map.
+ */
+static inline struct robin32_entry *Grow32_find_hash(const struct grow32 *m,
+                                                     const void *key,
+                                                     const size_t len,
+                                                     const uint32_t hash) {
+    struct robin32_entry *e = Robin32_find_hash(&m->map, key, len, hash);
+
+    if (e == NULL && unlikely(m->left != 0)) {
+        e = Robin32_find_hash(&m->old, key, len, hash);
+    }
+    return e;
+}
+
+static inline struct robin32_entry *Grow32_find(const struct grow32 *m,
+                                                const void *key, const size_t len) {
+    return Grow32_find_hash(m, key, len, Grow32_hash(m, key, len));
+}
+
+/* Make room for n keys without further growing.
+ * This rebuilds the slots in one go, like Robin32_reserve, so it is
+ * meant for when the map is created or quiet.
+ */
+static int Grow32_reserve(struct grow32 *m, const size_t n) {
+    if (n > m->map.capacity) {
+        struct robin32_entry *e = (struct robin32_entry *)
+            realloc(m->map.entries, n * sizeof(struct robin32_entry));
+
+        if (e == NULL) {
+            return -1;
+        }
+        m->map.entries = e;
+        m->map.capacity = n;
+        m->old.entries = e;
+    }
+    if (n <= m->map.grow_at) {
+        return 0;
+    }
+    grow32_step(m, SIZE_MAX);
+    /* The next slots are sized from the current ones */
+    free(m->spare);
+    m->spare = NULL;
+    return Robin32_rehash(&m->map, n);
+}
+
+/* Find a key, or add it if it is missing.
+ * *inserted is set to 1 if the key was added, in which case the entry's
+ * value is uninitialized, or 0 if it was already there.
+ * Returns the key's entry, or NULL if out of memory.
+ * Entry pointers stay valid until the next insert or erase.
+ */
+static struct robin32_entry *Grow32_insert_hash(struct grow32 *m,
+                                                const void *key,
+                                                const size_t len,
+                                                const uint32_t hash,
+                                                int *inserted) {
+    struct robin32 *t = &m->map;
+    struct robin32_entry *e = Grow32_find_hash(m, key, len, hash);
+    struct robin32_slot s;
+
+    *inserted = 0;
+    if (e != NULL) {
+        return e;
+    }
+    if (unlikely(t->size >= ROBIN32_EMPTY - 1)) {
+        return NULL;
+    }
+    /* realloc of a large block remaps its pages rather than copying
+     * them on most systems, so this does not stall like a rehash
+     */
+    if (unlikely(t->size == t->capacity)) {
+        const size_t n = t->capacity < 8 ? 8 : t->capacity * 2;
+        struct robin32_entry *grown = (struct robin32_entry *)
+            realloc(t->entries, n * sizeof(struct robin32_entry));
+
+        if (grown == NULL) {
+            return NULL;
+        }
+        t->entries = grown;
+        t->capacity = n;
+        m->old.entries = grown;
+    }
+    if (unlikely(t->size + 1 > t->grow_at) && grow32_start(m) != 0) {
+        return NULL;
+    }
+    grow32_step(m, GROW32_STEP);
+    /* Start on the next slots only when they will soon be needed, so
+     * that they do not take memory early
+     */
+    if (t->grow_at - t->size <= t->nslots * 2 / GROW32_CLEAR + 1) {
+        grow32_prepare(m, GROW32_CLEAR);
+    }
+
+    e = &t->entries[t->size];
+    e->key = key;
+    e->len = len;
+    e->hash = hash;
+    s.hash = hash;
+    s.index = (uint32_t)t->size;
+    robin32_place(t, s);
+    t->size++;
+    *inserted = 1;
+    return e;
+}
+
+static inline struct robin32_entry *Grow32_insert(struct grow32 *m,
+                                                  const void *key,
+                                                  const size_t len,
+                                                  int *inserted) {
+    return Grow32_insert_hash(m, key, len, Grow32_hash(m, key, len), inserted);
+}
+
+/* Remove entry e, which must be an entry of this map, from whichever
+ * slots hold it.  The last entry moves into e's place to keep the entry
+ * array dense.
+ */
+static void Grow32_erase_entry(struct grow32 *m, struct robin32_entry *e) {
+    struct robin32 *t = &m->map;
+    const uint32_t index = (uint32_t)(e - t->entries);
+    const uint32_t last = (uint32_t)(t->size - 1);
+    size_t pos = grow32_slot_of(t, e->hash, index);
+
+    if (pos != SIZE_MAX) {
+        robin32_remove(t, pos);
+    } else {
+        robin32_remove(&m->old, robin32_slot_of(&m->old, e->hash, index));
+    }
+
+    if (index != last) {
+        t->entries[index] = t->entries[last];
+        pos = grow32_slot_of(t, t->entries[index].hash, last);
+        if (pos != SIZE_MAX) {
+            t->slots[pos].index = index;
+        } else {
+            m->old.slots[robin32_slot_of(&m->old, t->entries[index].hash, last)].index = index;
+        }
+    }
+    t->size--;
+    grow32_step(m, GROW32_STEP);
+}
+
+/* Returns 1 if the key was removed, 0 if it was not in the map */
+static inline int Grow32_erase(struct grow32 *m, const void *key, const size_t len) {
+    struct robin32_entry *e = Grow32_find(m, key, len);
+
+    if (e == NULL) {
+        return 0;
+    }
+    Grow32_erase_entry(m, e);
+    return 1;
+}
+
+#endif /* GROW32_H */
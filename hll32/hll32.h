@@ -0,0 +1,590 @@
+/*
+ * Hll32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A HyperLogLog distinct count estimator for byte strings, written in C.
+ * Each key is hashed into 64 bits with Combo32x2, whose top p bits pick
+ * one of 2^p registers and whose other bits give the rank, the position
+ * of their first set bit, which the register keeps the largest of.
+ * A sketch starts sparse, as a small table of the registers set so far,
+ * and turns dense, one byte per register, once the table would be as
+ * big.  Dense sketches merge by bytewise maximum and are summed for the
+ * estimate with SSE2 or AVX2.  The estimate is Ertl's improved one, which
+ * needs no bias tables and holds from zero up to 2^64 keys.
+ */
+
+#ifndef HLL32_H
+#define HLL32_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* comment out the next line if you don't want SSE2 and AVX2 */
+#define HLL32_USE_SIMD 1
+
+/* comment out the next line to hash with Combo32 alone, which is faster,
+ * but whose 32 bits saturate above about 2^30 distinct keys
+ */
+#define HLL32_USE_HASH64 1
+
+#if defined(HLL32_USE_SIMD) && HLL32_USE_SIMD && \
+    (defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #define HLL32_SSE2 1
+  #include <emmintrin.h>
+  #if defined(__AVX2__)
+    #define HLL32_AVX2 1
+    #include <immintrin.h>
+  #endif
+#endif
+
+#if defined(HLL32_USE_HASH64) && HLL32_USE_HASH64
+  #define HLL32_HASH_BITS 64
+#else
+  #define HLL32_HASH_BITS 32
+#endif
+
+#if defined(__GNUC__)
+  #define HLL32_CLZ64(x) __builtin_clzll(x)
+  #define HLL32_POPCOUNT(x) __builtin_popcount(x)
+#else
+  static inline int HLL32_CLZ64(uint64_t x) {
+      int n = 0;
+
+      while ((x & UINT64_C(0x8000000000000000)) == 0) {
+          x <<= 1;
+          n++;
+      }
+      return n;
+  }
+
+  static inline int HLL32_POPCOUNT(uint32_t x) {
+      int n = 0;
+
+      while (x != 0) {
+          x &= x - 1;
+          n++;
+      }
+      return n;
+  }
+#endif
+
+#define HLL32_MIN_PRECISION 4
+#define HLL32_MAX_PRECISION 18
+/* Keys hashed and prefetched together by the batch function */
+#define HLL32_BATCH 16
+
+/* Errors; all are negative */
+#define HLL32_ERR_MEMORY    -1
+#define HLL32_ERR_PRECISION -2     /* precision out of range */
+#define HLL32_ERR_MISMATCH  -3     /* merging sketches of another precision or seed */
+
+struct hll32 {
+    uint8_t *registers;            /* dense, or NULL while sparse */
+    uint32_t *sparse;              /* register << 8 | rank, 0 if free */
+    size_t nsparse;                /* entries used */
+    size_t sparse_slots;           /* a power of 2 */
+    unsigned int p;                /* 2^p registers */
+    uint64_t seed;
+};
+
+/*------------------------------------------------------------ */
+
+/* Hll32 helpers */
+
+static inline size_t hll32_registers(const struct hll32 *f) {
+    return (size_t)1 << f->p;
+}
+
+/* The rank of a hash: one more than the leading zeros after the register
+ * bits, at most HLL32_HASH_BITS - p + 1
+ */
+static inline unsigned int hll32_rank(const uint64_t hash, const unsigned int p) {
+    const uint64_t w = hash << p;
+    const unsigned int q = HLL32_HASH_BITS - p;
+    const unsigned int r = w == 0 ? q + 1 : (unsigned int)HLL32_CLZ64(w) + 1;
+
+    return r > q + 1 ? q + 1 : r;
+}
+
+/* Keep the larger rank of register i in the sparse table */
+static void hll32_sparse_set(uint32_t *sparse, const size_t slots, const uint32_t i,
+                             const unsigned int rank, size_t *nsparse) {
+    size_t s = (size_t)((i * UINT32_C(0x9E3779B1)) & (slots - 1));
+
+    for (;; s = (s + 1) & (slots - 1)) {
+        if (sparse[s] == 0) {
+            sparse[s] = i << 8 | rank;
+            (*nsparse)++;
+            return;
+        }
+        if (sparse[s] >> 8 == i) {
+            if ((sparse[s] & 0xFF) < rank) {
+                sparse[s] = i << 8 | rank;
+            }
+            return;
+        }
+    }
+}
+
+/* Turn a sparse sketch dense */
+static int hll32_densify(struct hll32 *f) {
+    uint8_t *registers = (uint8_t *)calloc(hll32_registers(f), 1);
+
+    if (registers == NULL) {
+        return HLL32_ERR_MEMORY;
+    }
+    for (size_t s = 0; s < f->sparse_slots; s++) {
+        if (f->sparse[s] != 0) {
+            registers[f->sparse[s] >> 8] = (uint8_t)(f->sparse[s] & 0xFF);
+        }
+    }
+    free(f->sparse);
+    f->sparse = NULL;
+    f->nsparse = 0;
+    f->sparse_slots = 0;
+    f->registers = registers;
+    return 0;
+}
+
+/* Double the sparse table, or turn dense once the table would be as big */
+static int hll32_sparse_grow(struct hll32 *f) {
+    const size_t slots = f->sparse_slots * 2;
+    uint32_t *sparse;
+    size_t n = 0;
+
+    if (slots * sizeof(uint32_t) >= hll32_registers(f)) {
+        return hll32_densify(f);
+    }
+    sparse = (uint32_t *)calloc(slots, sizeof(uint32_t));
+    if (sparse == NULL) {
+        return hll32_densify(f);
+    }
+    for (size_t s = 0; s < f->sparse_slots; s++) {
+        if (f->sparse[s] != 0) {
+            hll32_sparse_set(sparse, slots, f->sparse[s] >> 8, f->sparse[s] & 0xFF, &n);
+        }
+    }
+    free(f->sparse);
+    f->sparse = sparse;
+    f->sparse_slots = slots;
+    return 0;
+}
+
+static inline int hll32_set(struct hll32 *f, const uint32_t i, const unsigned int rank) {
+    if (likely(f->registers != NULL)) {
+        if (f->registers[i] < rank) {
+            f->registers[i] = (uint8_t)rank;
+        }
+        return 0;
+    }
+    /* Keep the table at most three quarters full */
+    if (4 * (f->nsparse + 1) > 3 * f->sparse_slots) {
+        const int err = hll32_sparse_grow(f);
+
+        if (err != 0) {
+            return err;
+        }
+        if (f->registers != NULL) {
+            return hll32_set(f, i, rank);
+        }
+    }
+    hll32_sparse_set(f->sparse, f->sparse_slots, i, rank, &f->nsparse);
+    return 0;
+}
+
+/* dst[i] = max(dst[i], a[i]) */
+static void hll32_max(uint8_t *dst, const uint8_t *a, const size_t m) {
+    size_t i = 0;
+
+#if defined(HLL32_AVX2)
+    for (; i + 32 <= m; i += 32) {
+        _mm256_storeu_si256((__m256i *)(dst + i),
+                            _mm256_max_epu8(_mm256_loadu_si256((const __m256i *)(dst + i)),
+                                            _mm256_loadu_si256((const __m256i *)(a + i))));
+    }
+#elif defined(HLL32_SSE2)
+    for (; i + 16 <= m; i += 16) {
+        _mm_storeu_si128((__m128i *)(dst + i),
+                         _mm_max_epu8(_mm_loadu_si128((const __m128i *)(dst + i)),
+                                      _mm_loadu_si128((const __m128i *)(a + i))));
+    }
+#endif
+    for (; i < m; i++) {
+        dst[i] = dst[i] > a[i] ? dst[i] : a[i];
+    }
+}
+
+/* dst[i] = max(dst[i], a[i], b[i], c[i], d[i]), reading and writing dst
+ * once for four sources
+ */
+static void hll32_max4(uint8_t *dst, const uint8_t *a, const uint8_t *b, const uint8_t *c,
+                       const uint8_t *d, const size_t m) {
+    size_t i = 0;
+
+#if defined(HLL32_AVX2)
+    for (; i + 32 <= m; i += 32) {
+        const __m256i ab = _mm256_max_epu8(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                           _mm256_loadu_si256((const __m256i *)(b + i)));
+        const __m256i cd = _mm256_max_epu8(_mm256_loadu_si256((const __m256i *)(c + i)),
+                                           _mm256_loadu_si256((const __m256i *)(d + i)));
+
+        _mm256_storeu_si256((__m256i *)(dst + i),
+                            _mm256_max_epu8(_mm256_loadu_si256((const __m256i *)(dst + i)),
+                                            _mm256_max_epu8(ab, cd)));
+    }
+#elif defined(HLL32_SSE2)
+    for (; i + 16 <= m; i += 16) {
+        const __m128i ab = _mm_max_epu8(_mm_loadu_si128((const __m128i *)(a + i)),
+                                        _mm_loadu_si128((const __m128i *)(b + i)));
+        const __m128i cd = _mm_max_epu8(_mm_loadu_si128((const __m128i *)(c + i)),
+                                        _mm_loadu_si128((const __m128i *)(d + i)));
+
+        _mm_storeu_si128((__m128i *)(dst + i),
+                         _mm_max_epu8(_mm_loadu_si128((const __m128i *)(dst + i)),
+                                      _mm_max_epu8(ab, cd)));
+    }
+#endif
+    for (; i < m; i++) {
+        uint8_t x = dst[i];
+
+        x = x > a[i] ? x : a[i];
+        x = x > b[i] ? x : b[i];
+        x = x > c[i] ? x : c[i];
+        dst[i] = x > d[i] ? x : d[i];
+    }
+}
+
+/* Sum 2^-rank over the dense registers, counting those at 0 and at top;
+ * pow2[r] is 2^-r
+ */
+static double hll32_sum(const uint8_t *r, const size_t m, const unsigned int top,
+                        const double *pow2, size_t *zeros, size_t *tops) {
+    double sum = 0.0;
+    size_t i = 0, z = 0, t = 0;
+
+#if defined(HLL32_AVX2)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i high = _mm256_set1_epi8((char)top);
+        const __m256i bias = _mm256_set1_epi64x(1023);
+        __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+        double lanes[4];
+
+        for (; i + 32 <= m; i += 32) {
+            const __m256i v = _mm256_loadu_si256((const __m256i *)(r + i));
+            const __m128i lo = _mm256_castsi256_si128(v);
+            const __m128i hi = _mm256_extracti128_si256(v, 1);
+            __m128i part[8];
+
+            z += (size_t)HLL32_POPCOUNT((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)));
+            t += (size_t)HLL32_POPCOUNT((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, high)));
+            part[0] = lo;
+            part[1] = _mm_srli_si128(lo, 4);
+            part[2] = _mm_srli_si128(lo, 8);
+            part[3] = _mm_srli_si128(lo, 12);
+            part[4] = hi;
+            part[5] = _mm_srli_si128(hi, 4);
+            part[6] = _mm_srli_si128(hi, 8);
+            part[7] = _mm_srli_si128(hi, 12);
+            /* 2^-rank is the double with exponent 1023 - rank */
+            for (unsigned int j = 0; j < 8; j += 2) {
+                const __m256i x = _mm256_sub_epi64(bias, _mm256_cvtepu8_epi64(part[j]));
+                const __m256i y = _mm256_sub_epi64(bias, _mm256_cvtepu8_epi64(part[j + 1]));
+
+                acc0 = _mm256_add_pd(acc0, _mm256_castsi256_pd(_mm256_slli_epi64(x, 52)));
+                acc1 = _mm256_add_pd(acc1, _mm256_castsi256_pd(_mm256_slli_epi64(y, 52)));
+            }
+        }
+        _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+        sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+#elif defined(HLL32_SSE2)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i high = _mm_set1_epi8((char)top);
+        double sums[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+        for (; i + 16 <= m; i += 16) {
+            const __m128i v = _mm_loadu_si128((const __m128i *)(r + i));
+
+            z += (size_t)HLL32_POPCOUNT((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)));
+            t += (size_t)HLL32_POPCOUNT((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, high)));
+            for (unsigned int j = 0; j < 16; j += 4) {
+                sums[0] += pow2[r[i + j]];
+                sums[1] += pow2[r[i + j + 1]];
+                sums[2] += pow2[r[i + j + 2]];
+                sums[3] += pow2[r[i + j + 3]];
+            }
+        }
+        sum = sums[0] + sums[1] + sums[2] + sums[3];
+    }
+#endif
+    for (; i < m; i++) {
+        sum += pow2[r[i]];
+        z += r[i] == 0;
+        t += r[i] == top;
+    }
+    *zeros = z;
+    *tops = t;
+    return sum;
+}
+
+/* Ertl's sigma and tau corrections for registers at 0 and at top */
+static double hll32_sigma(double x) {
+    double y = 1.0, z = x, zp;
+
+    if (x == 1.0) {
+        return INFINITY;
+    }
+    do {
+        x *= x;
+        zp = z;
+        z += x * y;
+        y += y;
+    } while (z != zp);
+    return z;
+}
+
+static double hll32_tau(double x) {
+    double y = 1.0, z = 1.0 - x, zp;
+
+    if (x == 0.0 || x == 1.0) {
+        return 0.0;
+    }
+    do {
+        x = sqrt(x);
+        zp = z;
+        y *= 0.5;
+        z -= (1.0 - x) * (1.0 - x) * y;
+    } while (z != zp);
+    return z / 3.0;
+}
+
+/*------------------------------------------------------------ */
+
+/* Hll32 sketch functions */
+
+/* Start an empty sketch of 2^p registers, p from 4 to 18; the standard
+ * error of its estimates is about 1.04 / 2^(p/2).
+ * Returns 0 or a negative HLL32_ERR code.
+ */
+static int Hll32_init(struct hll32 *f, const unsigned int p, const uint64_t seed) {
+    if (p < HLL32_MIN_PRECISION || p > HLL32_MAX_PRECISION) {
+        return HLL32_ERR_PRECISION;
+    }
+    f->p = p;
+    f->seed = seed;
+    f->registers = NULL;
+    f->nsparse = 0;
+    f->sparse_slots = 16;
+    /* Start dense when even the smallest table is as big */
+    if (f->sparse_slots * sizeof(uint32_t) >= hll32_registers(f)) {
+        f->sparse = NULL;
+        f->sparse_slots = 0;
+        f->registers = (uint8_t *)calloc(hll32_registers(f), 1);
+        return f->registers != NULL ? 0 : HLL32_ERR_MEMORY;
+    }
+    f->sparse = (uint32_t *)calloc(f->sparse_slots, sizeof(uint32_t));
+    return f->sparse != NULL ? 0 : HLL32_ERR_MEMORY;
+}
+
+static void Hll32_free(struct hll32 *f) {
+    free(f->registers);
+    free(f->sparse);
+    f->registers = NULL;
+    f->sparse = NULL;
+    f->nsparse = 0;
+    f->sparse_slots = 0;
+}
+
+/* Empty the sketch, keeping its memory */
+static void Hll32_clear(struct hll32 *f) {
+    if (f->registers != NULL) {
+        memset(f->registers, 0, hll32_registers(f));
+    } else {
+        memset(f->sparse, 0, f->sparse_slots * sizeof(uint32_t));
+        f->nsparse = 0;
+    }
+}
+
+static inline uint64_t Hll32_hash(const struct hll32 *f, const void *key, const size_t len) {
+#if HLL32_HASH_BITS == 64
+    uint32_t h1, h2;
+
+    Combo32x2(key, len, f->seed, &h1, &h2);
+    return (uint64_t)h1 << 32 | h2;
+#else
+    return (uint64_t)Combo32(key, len, f->seed) << 32;
+#endif
+}
+
+/* Add a key by its Hll32_hash.
+ * Returns 0, or HLL32_ERR_MEMORY if a sparse sketch could not grow.
+ */
+static inline int Hll32_add_hash(struct hll32 *f, const uint64_t hash) {
+    return hll32_set(f, (uint32_t)(hash >> (64 - f->p)), hll32_rank(hash, f->p));
+}
+
+static inline int Hll32_add(struct hll32 *f, const void *key, const size_t len) {
+    return Hll32_add_hash(f, Hll32_hash(f, key, len));
+}
+
+/* Add n keys, hashing up to HLL32_BATCH of them and prefetching their
+ * registers before touching any.
+ * Returns 0, or HLL32_ERR_MEMORY if a sparse sketch could not grow.
+ */
+static int Hll32_add_batch(struct hll32 *f, const void *const *keys, const size_t *lens,
+                           const size_t n) {
+    uint64_t hash[HLL32_BATCH];
+
+    for (size_t base = 0; base < n; base += HLL32_BATCH) {
+        const size_t b = n - base < HLL32_BATCH ? n - base : HLL32_BATCH;
+
+        for (size_t i = 0; i < b; i++) {
+            hash[i] = Hll32_hash(f, keys[base + i], lens[base + i]);
+            if (f->registers != NULL) {
+                prefetch(&f->registers[hash[i] >> (64 - f->p)]);
+            }
+        }
+        for (size_t i = 0; i < b; i++) {
+            const int err = Hll32_add_hash(f, hash[i]);
+
+            if (err != 0) {
+                return err;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Merge src into dst, which then estimates the keys added to either.
+ * Returns 0 or a negative HLL32_ERR code.
+ */
+static int Hll32_merge(struct hll32 *dst, const struct hll32 *src) {
+    if (dst->p != src->p || dst->seed != src->seed) {
+        return HLL32_ERR_MISMATCH;
+    }
+    if (src->registers == NULL) {
+        for (size_t s = 0; s < src->sparse_slots; s++) {
+            if (src->sparse[s] != 0) {
+                const int err = hll32_set(dst, src->sparse[s] >> 8, src->sparse[s] & 0xFF);
+
+                if (err != 0) {
+                    return err;
+                }
+            }
+        }
+        return 0;
+    }
+    if (dst->registers == NULL) {
+        const int err = hll32_densify(dst);
+
+        if (err != 0) {
+            return err;
+        }
+    }
+    hll32_max(dst->registers, src->registers, hll32_registers(dst));
+    return 0;
+}
+
+/* Merge n sketches into dst, taking dense ones four at a time so that
+ * dst is read and written once for every four.
+ * Returns 0 or a negative HLL32_ERR code.
+ */
+static int Hll32_merge_many(struct hll32 *dst, const struct hll32 *const *srcs, const size_t n) {
+    const uint8_t *dense[4];
+    unsigned int ndense = 0;
+    int err;
+
+    for (size_t i = 0; i < n; i++) {
+        if (dst->p != srcs[i]->p || dst->seed != srcs[i]->seed) {
+            return HLL32_ERR_MISMATCH;
+        }
+    }
+    if (dst->registers == NULL && (err = hll32_densify(dst)) != 0) {
+        return err;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (srcs[i]->registers == NULL) {
+            if ((err = Hll32_merge(dst, srcs[i])) != 0) {
+                return err;
+            }
+            continue;
+        }
+        dense[ndense++] = srcs[i]->registers;
+        if (ndense == 4) {
+            hll32_max4(dst->registers, dense[0], dense[1], dense[2], dense[3],
+                       hll32_registers(dst));
+            ndense = 0;
+        }
+    }
+    for (unsigned int i = 0; i < ndense; i++) {
+        hll32_max(dst->registers, dense[i], hll32_registers(dst));
+    }
+    return 0;
+}
+
+/* Estimate the number of distinct keys added */
+static double Hll32_estimate(const struct hll32 *f) {
+    const size_t m = hll32_registers(f);
+    const unsigned int q = HLL32_HASH_BITS - f->p;
+    double pow2[HLL32_HASH_BITS + 2];
+    size_t zeros, tops;
+    double sum, z;
+
+    pow2[0] = 1.0;
+    for (unsigned int r = 1; r < HLL32_HASH_BITS + 2; r++) {
+        pow2[r] = 0.5 * pow2[r - 1];
+    }
+    if (f->registers != NULL) {
+        sum = hll32_sum(f->registers, m, q + 1, pow2, &zeros, &tops);
+    } else {
+        sum = 0.0;
+        tops = 0;
+        for (size_t s = 0; s < f->sparse_slots; s++) {
+            if (f->sparse[s] != 0) {
+                sum += pow2[f->sparse[s] & 0xFF];
+                tops += (f->sparse[s] & 0xFF) == q + 1;
+            }
+        }
+        zeros = m - f->nsparse;
+        sum += (double)zeros;
+    }
+    if (zeros == m) {
+        return 0.0;
+    }
+    /* The registers at 0 and at the top rank are counted by sigma and tau */
+    z = sum - (double)zeros - (double)tops * pow2[q + 1];
+    z += (double)m * hll32_sigma((double)zeros / (double)m);
+    z += (double)m * hll32_tau(1.0 - (double)tops / (double)m) * pow2[q];
+    return 0.5 / log(2.0) * (double)m * (double)m / z;
+}
+
+/* Size of the sketch in bytes */
+static inline size_t Hll32_bytes(const struct hll32 *f) {
+    return f->registers != NULL ? hll32_registers(f) : f->sparse_slots * sizeof(uint32_t);
+}
+
+#endif /* HLL32_H */
@@ -0,0 +1,774 @@
+/*
+ * Index32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A persistent hash index in one memory-mapped file, keyed by Combo32.
+ * The file holds a fixed header, an array of 64-byte buckets of four
+ * 32-bit Combo32 tags and four record offsets each, and an append-only
+ * log of key/value records and overflow buckets.
+ * Opening the file maps it and lookups run straight away, reading the
+ * buckets and records in place, with nothing to deserialize.
+ * Updates append a record and then point a bucket slot at it; the
+ * header's end of the log only moves forward when the file is synced,
+ * so after a crash any slot pointing past it is dropped.  A key whose
+ * slot is synced is replaced or erased through another slot, with a new
+ * record or a tombstone, and lookups take the one latest in the log; the
+ * older slot is only freed once a sync has made the newer one durable,
+ * so a crash brings back the synced value rather than losing the key.
+ * The header records the Combo32 version, seed and threshold, and a
+ * file written with different ones is refused, as its stored tags would
+ * not match.
+ * Needs POSIX mmap, msync and ftruncate.
+ */
+
+#ifndef INDEX32_H
+#define INDEX32_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "combo32.h"
+
+#define INDEX32_FORMAT 2
+#define INDEX32_BYTE_ORDER UINT32_C(0x01020304)
+#define INDEX32_HEADER_SIZE 4096
+#define INDEX32_WAYS 4
+/* Keys per bucket the bucket array is sized for when created */
+#define INDEX32_FILL 3
+/* The file grows by at least this much, or by an eighth of its size */
+#define INDEX32_MIN_GROWTH (1 << 20)
+/* value_len of the record an erase appends */
+#define INDEX32_TOMBSTONE UINT64_MAX
+
+/* Errors; all are negative */
+#define INDEX32_ERR_IO       -1     /* see errno */
+#define INDEX32_ERR_FORMAT   -2     /* not an Index32 file, or another byte order */
+#define INDEX32_ERR_HASHER   -3     /* written with another Combo32 version or threshold */
+#define INDEX32_ERR_READONLY -4
+#define INDEX32_ERR_MEMORY   -5
+
+static const char index32_magic[8] = { 'I', 'n', 'd', 'e', 'x', '3', '2', 0 };
+
+/* At file offset 0, padded to INDEX32_HEADER_SIZE */
+struct index32_header {
+    char magic[8];
+    uint32_t format;
+    uint32_t byte_order;           /* INDEX32_BYTE_ORDER as written */
+    uint32_t combo32_version;
+    uint32_t combo32_threshold;
+    uint64_t seed;
+    uint64_t nbuckets;             /* always a power of 2 */
+    uint32_t shift;                /* 32 - log2(nbuckets) */
+    uint32_t clean;                /* 1 if closed after a final sync */
+    uint64_t end;                  /* end of the log as of the last sync */
+    uint64_t count;                /* keys as of the last sync */
+};
+
+struct index32_bucket {
+    uint32_t tag[INDEX32_WAYS];    /* Combo32 of the key */
+    uint64_t offset[INDEX32_WAYS]; /* of the key's record, 0 if free */
+    uint64_t next;                 /* offset of the overflow bucket, 0 if none */
+    uint64_t unused;
+};
+
+/* A record starts on an 8-byte boundary, followed by the key bytes and
+ * the value bytes, if it is not a tombstone
+ */
+struct index32_record {
+    uint32_t hash;
+    uint32_t key_len;
+    uint64_t value_len;
+};
+
+/* A slot to free once the file is synced: one whose key has a newer
+ * slot, or a tombstone, which must go after the slots it hides
+ */
+struct index32_pending {
+    uint64_t bucket;
+    uint64_t offset;               /* the slot's record, if it still is */
+    int way;
+    int tombstone;
+};
+
+/* Where index32_lookup found a key, and where a new slot for it can go */
+struct index32_where {
+    uint64_t bucket;               /* the key's newest slot */
+    uint64_t offset;
+    int way;
+    uint64_t free_bucket;          /* the first free slot, or the last bucket */
+    int free_way;                  /* and -1 if there is none */
+};
+
+struct index32 {
+    int fd;
+    int writable;
+    uint8_t *base;                 /* the whole file, mapped */
+    size_t mapped;
+    uint64_t end;                  /* end of the log, synced or not */
+    uint64_t count;
+    uint64_t seed;
+    uint64_t nbuckets;
+    unsigned int shift;
+    unsigned int sync_every;       /* 0: only Index32_sync and Index32_close */
+    unsigned int unsynced;         /* updates since the last sync */
+    struct index32_pending *pending;
+    size_t npending;
+    size_t pending_cap;
+};
+
+/*------------------------------------------------------------ */
+
+/* Index32 helpers */
+
+static inline struct index32_header *index32_header(const struct index32 *ix) {
+    return (struct index32_header *)ix->base;
+}
+
+static inline uint64_t index32_log_start(const uint64_t nbuckets) {
+    return INDEX32_HEADER_SIZE + nbuckets * sizeof(struct index32_bucket);
+}
+
+static inline uint64_t index32_home(const struct index32 *ix, const uint32_t hash) {
+    return INDEX32_HEADER_SIZE +
+           ((uint64_t)hash >> ix->shift) * sizeof(struct index32_bucket);
+}
+
+static inline struct index32_bucket *index32_bucket_at(const struct index32 *ix,
+                                                       const uint64_t off) {
+    return (struct index32_bucket *)(ix->base + off);
+}
+
+static inline uint64_t index32_record_size(const size_t len, const size_t value_len) {
+    return (sizeof(struct index32_record) + len + value_len + 7) & ~(uint64_t)7;
+}
+
+static inline uint64_t index32_record_bytes(const struct index32_record *r) {
+    return index32_record_size(r->key_len,
+                               r->value_len == INDEX32_TOMBSTONE ? 0 : (size_t)r->value_len);
+}
+
+static inline int index32_is_tombstone(const struct index32 *ix, const uint64_t off) {
+    return ((const struct index32_record *)(ix->base + off))->value_len == INDEX32_TOMBSTONE;
+}
+
+static int index32_map(struct index32 *ix, const size_t size) {
+    void *p;
+
+    if (ix->base != NULL) {
+        munmap(ix->base, ix->mapped);
+        ix->base = NULL;
+    }
+    p = mmap(NULL, size, ix->writable ? PROT_READ | PROT_WRITE : PROT_READ,
+             MAP_SHARED, ix->fd, 0);
+    if (p == MAP_FAILED) {
+        return INDEX32_ERR_IO;
+    }
+    ix->base = (uint8_t *)p;
+    ix->mapped = size;
+    return 0;
+}
+
+/* Make sure need more bytes fit after the end of the log */
+static int index32_room(struct index32 *ix, const uint64_t need) {
+    uint64_t size = ix->mapped;
+
+    if (ix->end + need <= size) {
+        return 0;
+    }
+    size += size / 8 > INDEX32_MIN_GROWTH ? size / 8 : INDEX32_MIN_GROWTH;
+    if (size < ix->end + need) {
+        size = ix->end + need;
+    }
+    if (ftruncate(ix->fd, (off_t)size) != 0) {
+        return INDEX32_ERR_IO;
+    }
+    return index32_map(ix, (size_t)size);
+}
+
+/* Does the record at off hold this key?  Records the mapping does not
+ * cover yet, which a reader can meet, set *stale instead.
+ */
+static inline int index32_match(const struct index32 *ix, const uint64_t off,
+                                const void *key, const size_t len,
+                                const uint32_t hash, int *stale) {
+    const struct index32_record *r;
+
+    if (unlikely(off + sizeof(*r) > ix->mapped)) {
+        *stale = 1;
+        return 0;
+    }
+    r = (const struct index32_record *)(ix->base + off);
+    if (unlikely(off + index32_record_bytes(r) > ix->mapped)) {
+        *stale = 1;
+        return 0;
+    }
+    return r->hash == hash && r->key_len == len &&
+           memcmp(ix->base + off + sizeof(*r), key, len) == 0;
+}
+
+/* Find the newest slot holding a key, the one whose record is latest
+ * in the log, and the first free slot in its chain.  A reader passes
+ * over slots and overflow buckets past the synced end of the log, which
+ * the writer has not synced yet.
+ * Returns 1 if found, else 0.  Sets *stale if the mapping is too short
+ * to be sure.
+ */
+static int index32_lookup(const struct index32 *ix, const void *key, const size_t len,
+                          const uint32_t hash, struct index32_where *at, int *stale) {
+    const uint64_t limit = ix->writable ? UINT64_MAX : index32_header(ix)->end;
+    uint64_t boff = index32_home(ix, hash);
+
+    *stale = 0;
+    at->offset = 0;
+    at->free_way = -1;
+    for (;;) {
+        const struct index32_bucket *b = index32_bucket_at(ix, boff);
+
+        for (int w = 0; w < INDEX32_WAYS; w++) {
+            const uint64_t off = b->offset[w];
+
+            if (off == 0) {
+                if (at->free_way < 0) {
+                    at->free_bucket = boff;
+                    at->free_way = w;
+                }
+            } else if (b->tag[w] == hash && off > at->offset && off < limit &&
+                       index32_match(ix, off, key, len, hash, stale)) {
+                at->bucket = boff;
+                at->way = w;
+                at->offset = off;
+            }
+        }
+        if (b->next == 0 || b->next >= limit) {
+            break;
+        }
+        if (unlikely(b->next + sizeof(*b) > ix->mapped)) {
+            *stale = 1;
+            break;
+        }
+        boff = b->next;
+    }
+    if (at->free_way < 0) {
+        at->free_bucket = boff;
+    }
+    return at->offset != 0;
+}
+
+/* Two slots of a chain whose records hold the same key */
+static inline int index32_same_key(const struct index32 *ix, const struct index32_bucket *a,
+                                   const int wa, const struct index32_bucket *b, const int wb) {
+    const struct index32_record *x = (const struct index32_record *)(ix->base + a->offset[wa]);
+    const struct index32_record *y = (const struct index32_record *)(ix->base + b->offset[wb]);
+
+    return a->tag[wa] == b->tag[wb] && x->key_len == y->key_len &&
+           memcmp(x + 1, y + 1, x->key_len) == 0;
+}
+
+/* Keep only the newest slot of each key in the chain from boff, and
+ * none of a key whose newest slot is a tombstone; returns the keys left
+ */
+static uint64_t index32_dedupe(struct index32 *ix, const uint64_t first) {
+    uint64_t count = 0;
+
+    for (uint64_t boff = first; boff != 0; boff = index32_bucket_at(ix, boff)->next) {
+        struct index32_bucket *b = index32_bucket_at(ix, boff);
+
+        for (int w = 0; w < INDEX32_WAYS; w++) {
+            uint64_t coff = boff;
+            int cw = w + 1;
+
+            /* Compare with every later slot, dropping the older of a pair */
+            while (b->offset[w] != 0 && coff != 0) {
+                struct index32_bucket *c = index32_bucket_at(ix, coff);
+
+                for (; cw < INDEX32_WAYS && b->offset[w] != 0; cw++) {
+                    if (c->offset[cw] != 0 && index32_same_key(ix, b, w, c, cw)) {
+                        if (b->offset[w] < c->offset[cw]) {
+                            b->offset[w] = 0;
+                        } else {
+                            c->offset[cw] = 0;
+                        }
+                    }
+                }
+                coff = c->next;
+                cw = 0;
+            }
+        }
+    }
+    for (uint64_t boff = first; boff != 0; boff = index32_bucket_at(ix, boff)->next) {
+        struct index32_bucket *b = index32_bucket_at(ix, boff);
+
+        for (int w = 0; w < INDEX32_WAYS; w++) {
+            if (b->offset[w] != 0 && index32_is_tombstone(ix, b->offset[w])) {
+                b->offset[w] = 0;
+            }
+            count += b->offset[w] != 0;
+        }
+    }
+    return count;
+}
+
+/* Drop every slot and overflow link past the synced end of the log,
+ * after a writer stopped without closing the file, and any slot a newer
+ * synced one replaced that it had not freed yet
+ */
+static void index32_recover(struct index32 *ix) {
+    const uint64_t start = index32_log_start(ix->nbuckets);
+    const uint64_t end = index32_header(ix)->end;
+
+    ix->count = 0;
+    for (uint64_t i = 0; i < ix->nbuckets; i++) {
+        uint64_t boff = INDEX32_HEADER_SIZE + i * sizeof(struct index32_bucket);
+
+        while (boff != 0) {
+            struct index32_bucket *b = index32_bucket_at(ix, boff);
+
+            for (int w = 0; w < INDEX32_WAYS; w++) {
+                if (b->offset[w] != 0 &&
+                    (b->offset[w] < start || b->offset[w] >= end)) {
+                    b->offset[w] = 0;
+                }
+            }
+            if (b->next != 0 && (b->next < start || b->next >= end)) {
+                b->next = 0;
+            }
+            boff = b->next;
+        }
+        ix->count += index32_dedupe(ix, INDEX32_HEADER_SIZE + i * sizeof(struct index32_bucket));
+    }
+}
+
+/* Remember a slot to free after the next sync */
+static void index32_defer(struct index32 *ix, const uint64_t bucket, const int way,
+                          const uint64_t offset, const int tombstone) {
+    struct index32_pending *p = &ix->pending[ix->npending++];
+
+    p->bucket = bucket;
+    p->way = way;
+    p->offset = offset;
+    p->tombstone = tombstone;
+}
+
+/* Free the slots index32_defer remembered, now that a sync has made
+ * their replacements durable.  The tombstones go only once the slots
+ * they hide are freed on disk too.
+ */
+static int index32_free_pending(struct index32 *ix) {
+    int tombstones = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            if (!tombstones) {
+                break;
+            }
+            if (msync(ix->base, ix->mapped, MS_SYNC) != 0) {
+                return INDEX32_ERR_IO;
+            }
+        }
+        for (size_t i = 0; i < ix->npending; i++) {
+            const struct index32_pending *p = &ix->pending[i];
+            struct index32_bucket *b = index32_bucket_at(ix, p->bucket);
+
+            tombstones |= p->tombstone;
+            /* A slot since reused in place is left alone */
+            if (p->tombstone == pass && b->offset[p->way] == p->offset) {
+                b->offset[p->way] = 0;
+            }
+        }
+    }
+    ix->npending = 0;
+    return 0;
+}
+
+/* Point a slot for the key at the record at roff, just appended.  A
+ * slot replaced since the last sync is reused; a synced one is kept
+ * until the next sync, and the key gets another.
+ * Returns 0 or a negative INDEX32_ERR code, before changing anything.
+ */
+static int index32_link(struct index32 *ix, const struct index32_where *at, const int found,
+                        const uint32_t hash, const uint64_t roff, const int tombstone) {
+    struct index32_bucket *b;
+    uint64_t boff = at->free_bucket;
+    int way = at->free_way;
+
+    if (ix->npending + 2 > ix->pending_cap) {
+        const size_t n = ix->pending_cap < 16 ? 32 : ix->pending_cap * 2;
+        struct index32_pending *p = (struct index32_pending *)
+            realloc(ix->pending, n * sizeof(struct index32_pending));
+
+        if (p == NULL) {
+            return INDEX32_ERR_MEMORY;
+        }
+        ix->pending = p;
+        ix->pending_cap = n;
+    }
+    if (found && at->offset >= index32_header(ix)->end) {
+        boff = at->bucket;
+        way = at->way;
+    } else {
+        if (found) {
+            index32_defer(ix, at->bucket, at->way, at->offset, 0);
+        }
+        if (way < 0) {
+            const uint64_t nb = (ix->end + sizeof(*b) - 1) & ~(uint64_t)(sizeof(*b) - 1);
+
+            memset(ix->base + nb, 0, sizeof(*b));
+            ix->end = nb + sizeof(*b);
+            index32_bucket_at(ix, boff)->next = nb;
+            boff = nb;
+            way = 0;
+        }
+    }
+    if (tombstone) {
+        index32_defer(ix, boff, way, roff, 1);
+    }
+    b = index32_bucket_at(ix, boff);
+    b->tag[way] = hash;
+    b->offset[way] = roff;
+    return 0;
+}
+
+/* Append a record for the key, with room after it for an overflow
+ * bucket, and return its offset
+ */
+static uint64_t index32_append(struct index32 *ix, const void *key, const size_t len,
+                               const uint32_t hash, const void *value, const uint64_t value_len) {
+    const uint64_t roff = ix->end;
+    struct index32_record *r = (struct index32_record *)(ix->base + roff);
+
+    r->hash = hash;
+    r->key_len = (uint32_t)len;
+    r->value_len = value_len;
+    memcpy(r + 1, key, len);
+    if (value_len != INDEX32_TOMBSTONE) {
+        memcpy((uint8_t *)(r + 1) + len, value, (size_t)value_len);
+    }
+    ix->end += index32_record_bytes(r);
+    return roff;
+}
+
+/*------------------------------------------------------------ */
+
+/* Index32 functions */
+
+static inline uint32_t Index32_hash(const struct index32 *ix, const void *key, const size_t len) {
+    return Combo32(key, len, ix->seed);
+}
+
+/* Create or truncate the file at path, with buckets for nkeys keys;
+ * more keys go into overflow buckets.
+ * Returns 0 or a negative INDEX32_ERR code.
+ */
+static int Index32_create(struct index32 *ix, const char *path,
+                          const uint64_t nkeys, const uint64_t seed) {
+    struct index32_header *h;
+    uint64_t nbuckets = 2;
+    unsigned int lg = 1;
+
+    while (nbuckets * INDEX32_FILL < nkeys && lg < 32) {
+        nbuckets <<= 1;
+        lg++;
+    }
+    memset(ix, 0, sizeof(*ix));
+    ix->writable = 1;
+    ix->seed = seed;
+    ix->nbuckets = nbuckets;
+    ix->shift = 32 - lg;
+    ix->end = index32_log_start(nbuckets);
+    ix->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (ix->fd < 0) {
+        return INDEX32_ERR_IO;
+    }
+    /* The file starts out as zeros, which is an empty bucket array */
+    if (ftruncate(ix->fd, (off_t)(ix->end + INDEX32_MIN_GROWTH)) != 0 ||
+        index32_map(ix, (size_t)(ix->end + INDEX32_MIN_GROWTH)) != 0) {
+        close(ix->fd);
+        return INDEX32_ERR_IO;
+    }
+    h = index32_header(ix);
+    memcpy(h->magic, index32_magic, sizeof(h->magic));
+    h->format = INDEX32_FORMAT;
+    h->byte_order = INDEX32_BYTE_ORDER;
+    h->combo32_version = COMBO32_VERSION;
+    h->combo32_threshold = COMBO32_THRESHOLD;
+    h->seed = seed;
+    h->nbuckets = nbuckets;
+    h->shift = ix->shift;
+    h->clean = 0;
+    h->end = ix->end;
+    h->count = 0;
+    if (msync(ix->base, INDEX32_HEADER_SIZE, MS_SYNC) != 0) {
+        munmap(ix->base, ix->mapped);
+        close(ix->fd);
+        return INDEX32_ERR_IO;
+    }
+    return 0;
+}
+
+/* Open an existing file, for reading only or for reading and writing.
+ * Only one writer may have the file open at a time.  A writer that
+ * finds the file was not closed cleanly drops the updates made since
+ * its last sync.
+ * Returns 0 or a negative INDEX32_ERR code.
+ */
+static int Index32_open(struct index32 *ix, const char *path, const int writable) {
+    const struct index32_header *h;
+    struct stat st;
+    int err = INDEX32_ERR_FORMAT;
+
+    memset(ix, 0, sizeof(*ix));
+    ix->writable = writable;
+    ix->fd = open(path, writable ? O_RDWR : O_RDONLY);
+    if (ix->fd < 0) {
+        return INDEX32_ERR_IO;
+    }
+    if (fstat(ix->fd, &st) != 0 || index32_map(ix, (size_t)st.st_size) != 0) {
+        close(ix->fd);
+        return INDEX32_ERR_IO;
+    }
+    h = index32_header(ix);
+    if (ix->mapped < INDEX32_HEADER_SIZE ||
+        memcmp(h->magic, index32_magic, sizeof(h->magic)) != 0 ||
+        h->format != INDEX32_FORMAT || h->byte_order != INDEX32_BYTE_ORDER ||
+        h->shift > 31 || h->nbuckets != (uint64_t)1 << (32 - h->shift) ||
+        ix->mapped < index32_log_start(h->nbuckets) || h->end > ix->mapped) {
+        goto fail;
+    }
+    if (h->combo32_version != COMBO32_VERSION ||
+        h->combo32_threshold != COMBO32_THRESHOLD) {
+        err = INDEX32_ERR_HASHER;
+        goto fail;
+    }
+    ix->seed = h->seed;
+    ix->nbuckets = h->nbuckets;
+    ix->shift = h->shift;
+    ix->end = h->end;
+    ix->count = h->count;
+    if (writable) {
+        if (!h->clean) {
+            index32_recover(ix);
+        }
+        index32_header(ix)->clean = 0;
+        if (msync(ix->base, ix->mapped, MS_SYNC) != 0) {
+            err = INDEX32_ERR_IO;
+            goto fail;
+        }
+    }
+    return 0;
+
+fail:
+    munmap(ix->base, ix->mapped);
+    close(ix->fd);
+    return err;
+}
+
+/* Sync after every n updates; 0, the default, syncs only in
+ * Index32_sync and Index32_close
+ */
+static inline void Index32_sync_every(struct index32 *ix, const unsigned int n) {
+    ix->sync_every = n;
+}
+
+/* Write every update to disk, then move the header's end of the log and
+ * key count up to them.  Returns 0 or a negative INDEX32_ERR code.
+ */
+static int Index32_sync(struct index32 *ix) {
+    struct index32_header *h = index32_header(ix);
+
+    if (!ix->writable) {
+        return INDEX32_ERR_READONLY;
+    }
+    /* The records and buckets must be on disk before the header says so */
+    if (msync(ix->base, ix->mapped, MS_SYNC) != 0 || fsync(ix->fd) != 0) {
+        return INDEX32_ERR_IO;
+    }
+    h->end = ix->end;
+    h->count = ix->count;
+    if (msync(ix->base, INDEX32_HEADER_SIZE, MS_SYNC) != 0) {
+        return INDEX32_ERR_IO;
+    }
+    ix->unsynced = 0;
+    return index32_free_pending(ix);
+}
+
+static int index32_updated(struct index32 *ix) {
+    if (ix->sync_every != 0 && ++ix->unsynced >= ix->sync_every) {
+        return Index32_sync(ix);
+    }
+    return 0;
+}
+
+/* Map any part of the file a writer has added since it was opened, for
+ * readers in other processes.  Returns 0 or a negative INDEX32_ERR code.
+ */
+static int Index32_refresh(struct index32 *ix) {
+    struct stat st;
+
+    if (fstat(ix->fd, &st) != 0) {
+        return INDEX32_ERR_IO;
+    }
+    if ((size_t)st.st_size > ix->mapped) {
+        return index32_map(ix, (size_t)st.st_size);
+    }
+    return 0;
+}
+
+/* Look up a key whose Combo32 value with the file's seed is already
+ * known.  Returns its value, setting *value_len, or NULL if the key is
+ * missing; a reader gets the value as of the writer's last sync.  The value points into the mapping and stays valid until the
+ * next update or refresh.
+ */
+static const void *Index32_get_hash(struct index32 *ix, const void *key, const size_t len,
+                                    const uint32_t hash, size_t *value_len) {
+    struct index32_where at;
+    int stale;
+    int found = index32_lookup(ix, key, len, hash, &at, &stale);
+    const struct index32_record *r;
+
+    if (unlikely(stale)) {
+        if (Index32_refresh(ix) != 0) {
+            return NULL;
+        }
+        found = index32_lookup(ix, key, len, hash, &at, &stale);
+    }
+    if (!found || index32_is_tombstone(ix, at.offset)) {
+        return NULL;
+    }
+    r = (const struct index32_record *)(ix->base + at.offset);
+    *value_len = (size_t)r->value_len;
+    return (const uint8_t *)(r + 1) + len;
+}
+
+static inline const void *Index32_get(struct index32 *ix, const void *key, const size_t len,
+                                      size_t *value_len) {
+    return Index32_get_hash(ix, key, len, Index32_hash(ix, key, len), value_len);
+}
+
+/* Add a key, or replace its value, by appending a record.
+ * Returns 0 or a negative INDEX32_ERR code; an error from the sync that
+ * follows the update leaves the update in place.
+ */
+static int Index32_put(struct index32 *ix, const void *key, const size_t len,
+                       const void *value, const size_t value_len) {
+    const uint32_t hash = Index32_hash(ix, key, len);
+    struct index32_where at;
+    uint64_t roff;
+    int found, stale;
+    int err;
+
+    if (!ix->writable) {
+        return INDEX32_ERR_READONLY;
+    }
+    if (len > UINT32_MAX) {
+        return INDEX32_ERR_FORMAT;
+    }
+    /* Room for the record and a 64-byte aligned overflow bucket, before
+     * taking any pointers into the mapping
+     */
+    err = index32_room(ix, index32_record_size(len, value_len) +
+                           2 * sizeof(struct index32_bucket));
+    if (err != 0) {
+        return err;
+    }
+    found = index32_lookup(ix, key, len, hash, &at, &stale);
+    roff = index32_append(ix, key, len, hash, value, value_len);
+    /* Only now point a slot at the record */
+    err = index32_link(ix, &at, found, hash, roff, 0);
+    if (err != 0) {
+        ix->end = roff;
+        return err;
+    }
+    if (!found || index32_is_tombstone(ix, at.offset)) {
+        ix->count++;
+    }
+    return index32_updated(ix);
+}
+
+/* Returns 1 if the key was removed, 0 if it was missing, or a negative
+ * INDEX32_ERR code.  Its record stays in the log, followed by a
+ * tombstone.
+ */
+static int Index32_erase(struct index32 *ix, const void *key, const size_t len) {
+    const uint32_t hash = Index32_hash(ix, key, len);
+    struct index32_where at;
+    uint64_t roff;
+    int stale;
+    int err;
+
+    if (!ix->writable) {
+        return INDEX32_ERR_READONLY;
+    }
+    err = index32_room(ix, index32_record_size(len, 0) + 2 * sizeof(struct index32_bucket));
+    if (err != 0) {
+        return err;
+    }
+    if (!index32_lookup(ix, key, len, hash, &at, &stale) ||
+        index32_is_tombstone(ix, at.offset)) {
+        return 0;
+    }
+    roff = index32_append(ix, key, len, hash, NULL, INDEX32_TOMBSTONE);
+    err = index32_link(ix, &at, 1, hash, roff, 1);
+    if (err != 0) {
+        ix->end = roff;
+        return err;
+    }
+    ix->count--;
+    return index32_updated(ix) == 0 ? 1 : INDEX32_ERR_IO;
+}
+
+/* Keys in the index; for a reader, as of the writer's last sync */
+static inline uint64_t Index32_count(const struct index32 *ix) {
+    return ix->writable ? ix->count : index32_header(ix)->count;
+}
+
+/* A writer syncs and marks the file as closed cleanly.
+ * Returns 0 or a negative INDEX32_ERR code.
+ */
+static int Index32_close(struct index32 *ix) {
+    int err = 0;
+
+    if (ix->writable) {
+        err = Index32_sync(ix);
+        if (err == 0) {
+            index32_header(ix)->clean = 1;
+            if (msync(ix->base, INDEX32_HEADER_SIZE, MS_SYNC) != 0) {
+                err = INDEX32_ERR_IO;
+            }
+        }
+    }
+    munmap(ix->base, ix->mapped);
+    if (close(ix->fd) != 0 && err == 0) {
+        err = INDEX32_ERR_IO;
+    }
+    free(ix->pending);
+    ix->pending = NULL;
+    ix->npending = 0;
+    ix->base = NULL;
+    ix->mapped = 0;
+    ix->fd = -1;
+    return err;
+}
+
+#endif /* INDEX32_H */
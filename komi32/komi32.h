@@ -274,8 +274,11 @@ static inline uint32_t komi32_final_bytes(const uint8_t * const Msg,
  * statistical quality, and is used only as an additional entropy source. May
  * need endianness-correction if this value is shared between big- and
  * little-endian systems.
+ * @param State5 Receives Seed5, the half of the final state that is not
+ * returned, for Komi32x2_impl.
  */
-static inline uint32_t Komi32_impl(const void * const in, const size_t len, uint64_t UseSeed) {
+static inline uint32_t komi32_state(const void * const in, const size_t len,
+                                    uint64_t UseSeed, uint32_t * const State5) {
     /* Allow the compiler to put Msg in a register */
     const uint8_t* Msg = (const uint8_t*)in;
     /* Allow the compiler to put MsgLen in a register */
@@ -294,6 +297,7 @@ static inline uint32_t Komi32_impl(const void * const in, const size_t len, uint
         KOMI32_HASHROUND();
         KOMI32_HASHROUND();
 
+        *State5 = Seed5;
         return Seed1;
     }
 
@@ -364,15 +368,44 @@ static inline uint32_t Komi32_impl(const void * const in, const size_t len, uint
 
     KOMI32_FINALIZE();
 
+    *State5 = Seed5;
     return Seed1;
 }
 
+static inline uint32_t Komi32_impl(const void * const in, const size_t len, uint64_t UseSeed) {
+    uint32_t Seed5;
+
+    return komi32_state(in, len, UseSeed, &Seed5);
+}
+
+/* Two 32-bit hashes from one pass over the input.
+ * *h1 is the same as Komi32_impl(in, len, UseSeed).  *h2 comes from two
+ * more rounds of the state's PRNG, so it also depends on Seed5, the
+ * 32 bits of state that *h1 does not reveal.
+ */
+static inline void Komi32x2_impl(const void * const in, const size_t len, uint64_t UseSeed,
+                                 uint32_t * const h1, uint32_t * const h2) {
+    uint32_t r1l, r1h;
+    uint32_t Seed5;
+    uint32_t Seed1 = komi32_state(in, len, UseSeed, &Seed5);
+
+    *h1 = Seed1;
+    KOMI32_HASHROUND();
+    KOMI32_HASHROUND();
+    *h2 = Seed1;
+}
+
 /*------------------------------------------------------------ */
 
 static uint32_t Komi32(const void * in, const size_t len, const uint64_t seed) {
     return Komi32_impl(in, len, seed);
 }
 
+static inline void Komi32x2(const void * in, const size_t len, const uint64_t seed,
+                            uint32_t *h1, uint32_t *h2) {
+    Komi32x2_impl(in, len, seed, h1, h2);
+}
+
 #undef GET_U32
 
 #endif /* KOMI32_H */
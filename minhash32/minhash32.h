@@ -0,0 +1,468 @@
+/*
+ * Minhash32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MinHash signatures of sets of byte strings, such as the shingles of a
+ * document, written in C.
+ * Each shingle is hashed once with Komi32, and the k permutations are
+ * each an exclusive-or with a salt, a multiply by an odd constant and a
+ * xorshift of that one hash, worked out eight at a time with AVX2.  The
+ * salts and multipliers are drawn from Komi32's PRNG.  The signature is
+ * the smallest value of each permutation over the set.  Signatures
+ * compress to b bits per value, and an LSH index of bands of values finds
+ * the signatures likely to be similar to a given one.
+ */
+
+#ifndef MINHASH32_H
+#define MINHASH32_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "komi32.h"
+
+/* comment out the next line if you don't want AVX2 */
+#define MINHASH32_USE_SIMD 1
+
+#if defined(MINHASH32_USE_SIMD) && MINHASH32_USE_SIMD && defined(__AVX2__)
+  #define MINHASH32_AVX2 1
+  #include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+  #define MINHASH32_POPCOUNT64(x) __builtin_popcountll(x)
+#else
+  static inline int MINHASH32_POPCOUNT64(uint64_t x) {
+      int n = 0;
+
+      while (x != 0) {
+          x &= x - 1;
+          n++;
+      }
+      return n;
+  }
+#endif
+
+/* Permutations are worked out in groups of this many */
+#define MINHASH32_LANES 8
+/* Shingles hashed at a time by Minhash32_sketch */
+#define MINHASH32_BATCH 256
+
+/* Errors; all are negative */
+#define MINHASH32_ERR_MEMORY -1
+#define MINHASH32_ERR_SIZE   -2    /* k 0, or bands * rows more than k */
+
+struct minhash32 {
+    uint32_t *salt;                /* k rounded up to MINHASH32_LANES of each */
+    uint32_t *mult;                /* odd */
+    unsigned int k;
+    uint64_t seed;
+};
+
+/* One LSH index entry; id is one more than the signature's id, 0 if free */
+struct minhash32_entry {
+    uint32_t hash;
+    uint32_t id;
+};
+
+struct minhash32_lsh {
+    struct minhash32_entry *slots; /* bands tables of nslots entries */
+    size_t nslots;                 /* per band, a power of 2 */
+    size_t size;                   /* signatures added */
+    unsigned int bands;
+    unsigned int rows;
+    uint64_t seed;
+};
+
+/*------------------------------------------------------------ */
+
+/* Minhash32 helpers */
+
+static inline uint32_t minhash32_permute(const uint32_t h, const uint32_t salt,
+                                         const uint32_t mult) {
+    uint32_t x = (h ^ salt) * mult;
+
+    return x ^ (x >> 16);
+}
+
+/* Lower sig[j] to the least permutation j of any of the n hashes, a group
+ * of permutations at a time, so the minimums stay in registers
+ */
+static void minhash32_update(const struct minhash32 *m, const uint32_t *hashes, const size_t n,
+                             uint32_t *sig) {
+    unsigned int j = 0;
+
+#if defined(MINHASH32_AVX2)
+    for (; j + 2 * MINHASH32_LANES <= m->k; j += 2 * MINHASH32_LANES) {
+        const __m256i s0 = _mm256_loadu_si256((const __m256i *)(m->salt + j));
+        const __m256i s1 = _mm256_loadu_si256((const __m256i *)(m->salt + j + 8));
+        const __m256i m0 = _mm256_loadu_si256((const __m256i *)(m->mult + j));
+        const __m256i m1 = _mm256_loadu_si256((const __m256i *)(m->mult + j + 8));
+        __m256i min0 = _mm256_loadu_si256((const __m256i *)(sig + j));
+        __m256i min1 = _mm256_loadu_si256((const __m256i *)(sig + j + 8));
+
+        for (size_t i = 0; i < n; i++) {
+            const __m256i h = _mm256_set1_epi32((int)hashes[i]);
+            __m256i x0 = _mm256_mullo_epi32(_mm256_xor_si256(h, s0), m0);
+            __m256i x1 = _mm256_mullo_epi32(_mm256_xor_si256(h, s1), m1);
+
+            x0 = _mm256_xor_si256(x0, _mm256_srli_epi32(x0, 16));
+            x1 = _mm256_xor_si256(x1, _mm256_srli_epi32(x1, 16));
+            min0 = _mm256_min_epu32(min0, x0);
+            min1 = _mm256_min_epu32(min1, x1);
+        }
+        _mm256_storeu_si256((__m256i *)(sig + j), min0);
+        _mm256_storeu_si256((__m256i *)(sig + j + 8), min1);
+    }
+    for (; j + MINHASH32_LANES <= m->k; j += MINHASH32_LANES) {
+        const __m256i s0 = _mm256_loadu_si256((const __m256i *)(m->salt + j));
+        const __m256i m0 = _mm256_loadu_si256((const __m256i *)(m->mult + j));
+        __m256i min0 = _mm256_loadu_si256((const __m256i *)(sig + j));
+
+        for (size_t i = 0; i < n; i++) {
+            __m256i x0 = _mm256_mullo_epi32(
+                _mm256_xor_si256(_mm256_set1_epi32((int)hashes[i]), s0), m0);
+
+            x0 = _mm256_xor_si256(x0, _mm256_srli_epi32(x0, 16));
+            min0 = _mm256_min_epu32(min0, x0);
+        }
+        _mm256_storeu_si256((__m256i *)(sig + j), min0);
+    }
+#endif
+    for (; j < m->k; j++) {
+        const uint32_t salt = m->salt[j], mult = m->mult[j];
+        uint32_t min = sig[j];
+
+        for (size_t i = 0; i < n; i++) {
+            const uint32_t x = minhash32_permute(hashes[i], salt, mult);
+
+            min = x < min ? x : min;
+        }
+        sig[j] = min;
+    }
+}
+
+/* How many of the n values of b bits packed in a and b are equal */
+static unsigned int minhash32_bbit_matches(const uint64_t *a, const uint64_t *b,
+                                           const unsigned int k, const unsigned int bits) {
+    const unsigned int per_word = 64 / bits;
+    const unsigned int words = (k + per_word - 1) / per_word;
+    /* A one in the lowest bit of every value */
+    const uint64_t low = UINT64_MAX / ((UINT64_C(1) << bits) - 1);
+    unsigned int differ = 0;
+
+    for (unsigned int w = 0; w < words; w++) {
+        uint64_t x = a[w] ^ b[w];
+
+        /* Fold each value's bits into its lowest */
+        for (unsigned int s = 1; s < bits; s *= 2) {
+            x |= x >> s;
+        }
+        differ += (unsigned int)MINHASH32_POPCOUNT64(x & low);
+    }
+    /* Padding values are 0 in both */
+    return k - differ;
+}
+
+static inline uint32_t minhash32_band_hash(const struct minhash32_lsh *x, const uint32_t *sig,
+                                           const unsigned int band) {
+    return Komi32(sig + (size_t)band * x->rows, x->rows * sizeof(uint32_t), x->seed + band);
+}
+
+static inline size_t minhash32_home(const struct minhash32_lsh *x, const uint32_t hash) {
+    return (size_t)(((uint64_t)hash * x->nslots) >> 32);
+}
+
+static void minhash32_lsh_put(struct minhash32_entry *table, const size_t nslots,
+                              const size_t home, const struct minhash32_entry e) {
+    size_t s = home;
+
+    while (table[s].id != 0) {
+        s = (s + 1) & (nslots - 1);
+    }
+    table[s] = e;
+}
+
+/* Double the tables of every band */
+static int minhash32_lsh_grow(struct minhash32_lsh *x) {
+    const size_t nslots = x->nslots * 2;
+    struct minhash32_entry *slots = (struct minhash32_entry *)calloc(
+        nslots * x->bands, sizeof(struct minhash32_entry));
+
+    if (slots == NULL) {
+        return MINHASH32_ERR_MEMORY;
+    }
+    for (unsigned int band = 0; band < x->bands; band++) {
+        const struct minhash32_entry *old = x->slots + band * x->nslots;
+
+        for (size_t s = 0; s < x->nslots; s++) {
+            if (old[s].id != 0) {
+                minhash32_lsh_put(slots + band * nslots, nslots,
+                                  (size_t)(((uint64_t)old[s].hash * nslots) >> 32), old[s]);
+            }
+        }
+    }
+    free(x->slots);
+    x->slots = slots;
+    x->nslots = nslots;
+    return 0;
+}
+
+static int minhash32_compare_u32(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*------------------------------------------------------------ */
+
+/* Minhash32 signature functions */
+
+/* Set up k permutations, and so signatures of k values.
+ * Returns 0 or a negative MINHASH32_ERR code.
+ */
+static int Minhash32_init(struct minhash32 *m, const unsigned int k, const uint64_t seed) {
+    const unsigned int padded = (k + MINHASH32_LANES - 1) / MINHASH32_LANES * MINHASH32_LANES;
+    uint32_t Seed1, Seed5, r1l, r1h;
+
+    if (k == 0) {
+        return MINHASH32_ERR_SIZE;
+    }
+    m->salt = (uint32_t *)malloc(padded * sizeof(uint32_t));
+    m->mult = (uint32_t *)malloc(padded * sizeof(uint32_t));
+    if (m->salt == NULL || m->mult == NULL) {
+        free(m->salt);
+        free(m->mult);
+        return MINHASH32_ERR_MEMORY;
+    }
+    /* The constants come from Komi32's PRNG, seeded by hashing the seed,
+     * rather than from hashes of small numbers, which shingles may be
+     */
+    Komi32x2(&seed, sizeof(seed), seed, &Seed1, &Seed5);
+    for (unsigned int j = 0; j < padded; j++) {
+        KOMI32_HASHROUND();
+        m->salt[j] = Seed1;
+        KOMI32_HASHROUND();
+        m->mult[j] = Seed1 | 1;
+    }
+    m->k = k;
+    m->seed = seed;
+    return 0;
+}
+
+static void Minhash32_free(struct minhash32 *m) {
+    free(m->salt);
+    free(m->mult);
+    m->salt = NULL;
+    m->mult = NULL;
+    m->k = 0;
+}
+
+/* Start a signature of the empty set, to be lowered by the add functions */
+static void Minhash32_clear(const struct minhash32 *m, uint32_t *sig) {
+    for (unsigned int j = 0; j < m->k; j++) {
+        sig[j] = UINT32_MAX;
+    }
+}
+
+static inline uint32_t Minhash32_hash(const struct minhash32 *m, const void *shingle,
+                                      const size_t len) {
+    return Komi32(shingle, len, m->seed);
+}
+
+/* Add n shingles, by their Minhash32_hash, to the signature sig of k values */
+static void Minhash32_add_hashes(const struct minhash32 *m, const uint32_t *hashes,
+                                 const size_t n, uint32_t *sig) {
+    minhash32_update(m, hashes, n, sig);
+}
+
+/* Add n shingles to the signature sig of k values */
+static void Minhash32_add(const struct minhash32 *m, const void *const *shingles,
+                          const size_t *lens, const size_t n, uint32_t *sig) {
+    uint32_t hashes[MINHASH32_BATCH];
+
+    for (size_t base = 0; base < n; base += MINHASH32_BATCH) {
+        const size_t b = n - base < MINHASH32_BATCH ? n - base : MINHASH32_BATCH;
+
+        for (size_t i = 0; i < b; i++) {
+            hashes[i] = Minhash32_hash(m, shingles[base + i], lens[base + i]);
+        }
+        minhash32_update(m, hashes, b, sig);
+    }
+}
+
+/* Set sig to the signature of the w-byte shingles of text, every run of w
+ * consecutive bytes, or of the whole text if it is shorter than w
+ */
+static void Minhash32_text(const struct minhash32 *m, const void *text, const size_t len,
+                           const size_t w, uint32_t *sig) {
+    const uint8_t *t = (const uint8_t *)text;
+    const size_t n = len > w ? len - w + 1 : 1;
+    uint32_t hashes[MINHASH32_BATCH];
+
+    Minhash32_clear(m, sig);
+    for (size_t base = 0; base < n; base += MINHASH32_BATCH) {
+        const size_t b = n - base < MINHASH32_BATCH ? n - base : MINHASH32_BATCH;
+
+        for (size_t i = 0; i < b; i++) {
+            hashes[i] = Minhash32_hash(m, t + base + i, len < w ? len : w);
+        }
+        minhash32_update(m, hashes, b, sig);
+    }
+}
+
+/* Estimate the Jaccard similarity of two sets from their signatures */
+static double Minhash32_similarity(const struct minhash32 *m, const uint32_t *a,
+                                   const uint32_t *b) {
+    unsigned int same = 0;
+
+    for (unsigned int j = 0; j < m->k; j++) {
+        same += a[j] == b[j];
+    }
+    return (double)same / (double)m->k;
+}
+
+/* Words of a signature compressed to bits, 1, 2, 4, 8, 16 or 32, per value */
+static inline size_t Minhash32_bbit_words(const struct minhash32 *m, const unsigned int bits) {
+    const unsigned int per_word = 64 / bits;
+
+    return (m->k + per_word - 1) / per_word;
+}
+
+/* Keep the lowest bits of each value of sig, packed into
+ * Minhash32_bbit_words words of out
+ */
+static void Minhash32_bbit(const struct minhash32 *m, const uint32_t *sig,
+                           const unsigned int bits, uint64_t *out) {
+    const unsigned int per_word = 64 / bits;
+    const uint64_t mask = (UINT64_C(1) << bits) - 1;
+
+    memset(out, 0, Minhash32_bbit_words(m, bits) * sizeof(uint64_t));
+    for (unsigned int j = 0; j < m->k; j++) {
+        out[j / per_word] |= (sig[j] & mask) << (j % per_word * bits);
+    }
+}
+
+/* Estimate the Jaccard similarity of two sets from their compressed
+ * signatures.  Two b-bit values are equal by chance 1 / 2^b of the time,
+ * which is taken out, as it is for sets that are small next to 2^32.
+ */
+static double Minhash32_bbit_similarity(const struct minhash32 *m, const uint64_t *a,
+                                        const uint64_t *b, const unsigned int bits) {
+    const double chance = 1.0 / (double)(UINT64_C(1) << bits);
+    const double same = (double)minhash32_bbit_matches(a, b, m->k, bits) / (double)m->k;
+    const double j = (same - chance) / (1.0 - chance);
+
+    return j > 0.0 ? j : 0.0;
+}
+
+/*------------------------------------------------------------ */
+
+/* Minhash32 LSH index functions */
+
+/* Make an empty index of signatures, bands of rows values each, which
+ * finds pairs of Jaccard similarity s with probability
+ * 1 - (1 - s^rows)^bands.  bands * rows must be at most k.
+ * Returns 0 or a negative MINHASH32_ERR code.
+ */
+static int Minhash32_lsh_init(struct minhash32_lsh *x, const struct minhash32 *m,
+                              const unsigned int bands, const unsigned int rows) {
+    if (bands == 0 || rows == 0 || (uint64_t)bands * rows > m->k) {
+        return MINHASH32_ERR_SIZE;
+    }
+    x->nslots = 16;
+    x->slots = (struct minhash32_entry *)calloc(x->nslots * bands,
+                                                sizeof(struct minhash32_entry));
+    if (x->slots == NULL) {
+        return MINHASH32_ERR_MEMORY;
+    }
+    x->size = 0;
+    x->bands = bands;
+    x->rows = rows;
+    x->seed = m->seed;
+    return 0;
+}
+
+static void Minhash32_lsh_free(struct minhash32_lsh *x) {
+    free(x->slots);
+    x->slots = NULL;
+    x->nslots = 0;
+    x->size = 0;
+}
+
+/* Add the signature sig under id, less than UINT32_MAX.
+ * Returns 0 or MINHASH32_ERR_MEMORY.
+ */
+static int Minhash32_lsh_add(struct minhash32_lsh *x, const uint32_t *sig, const uint32_t id) {
+    /* Keep the tables at most half full */
+    if (2 * (x->size + 1) > x->nslots) {
+        const int err = minhash32_lsh_grow(x);
+
+        if (err != 0) {
+            return err;
+        }
+    }
+    for (unsigned int band = 0; band < x->bands; band++) {
+        struct minhash32_entry e;
+
+        e.hash = minhash32_band_hash(x, sig, band);
+        e.id = id + 1;
+        minhash32_lsh_put(x->slots + band * x->nslots, x->nslots, minhash32_home(x, e.hash), e);
+    }
+    x->size++;
+    return 0;
+}
+
+/* Find the ids of the signatures that share a band with sig, setting out
+ * to them in increasing order and returning how many there are.  If more
+ * than max entries match, returns that number, repeats included, for the
+ * caller to try again with room for them.
+ */
+static size_t Minhash32_lsh_query(const struct minhash32_lsh *x, const uint32_t *sig,
+                                  uint32_t *out, const size_t max) {
+    size_t found = 0, unique = 0;
+
+    for (unsigned int band = 0; band < x->bands; band++) {
+        const struct minhash32_entry *table = x->slots + band * x->nslots;
+        const uint32_t hash = minhash32_band_hash(x, sig, band);
+
+        for (size_t s = minhash32_home(x, hash); table[s].id != 0; s = (s + 1) & (x->nslots - 1)) {
+            if (table[s].hash == hash) {
+                if (found < max) {
+                    out[found] = table[s].id - 1;
+                }
+                found++;
+            }
+        }
+    }
+    if (found > max) {
+        return found;
+    }
+    qsort(out, found, sizeof(uint32_t), minhash32_compare_u32);
+    for (size_t i = 0; i < found; i++) {
+        if (unique == 0 || out[i] != out[unique - 1]) {
+            out[unique++] = out[i];
+        }
+    }
+    return unique;
+}
+
+#endif /* MINHASH32_H */
@@ -264,7 +264,8 @@ static inline uint64_t mult32_m64(const uint32_t m1, const uint64_t m2) {
 
 /* Mult32 hash function */
 
-static inline uint32_t Mult32_impl(const void* const in, const size_t len, const uint64_t UseSeed) {
+/* The 64-bit accumulator, before it is hashed down to 32 bits */
+static inline uint64_t mult32_accumulate(const void* const in, const size_t len, const uint64_t UseSeed) {
     uint64_t i = ((len >> 6) ^ len) & (RANDOM_POWER - 1);
     const uint64_t* Msg;
     uint64_t MsgLen;
@@ -336,19 +337,36 @@ static inline uint32_t Mult32_impl(const void* const in, const size_t len, const
                                       * MULT32_VALHASH8
                                       */
     
-    /* Hash 64 bits down to 32.
-     * This is fast, portable, and suitable for any 64-bit value,
-     * including doubles and long ints.
-     */
-    {
-        uint32_t Seed1 = UINT32_C(0xC5A308D3);
-        uint32_t Seed5 = UINT32_C(0xB8D01377);
-        
-        KOMI32_SEEDHASH4((uint32_t)hash);
-        KOMI32_SEEDHASH4((uint32_t)(hash >> 32));
-        
-        return Seed1;
-    }
+    return hash;
+}
+
+/* Hash 64 bits down to 32.
+ * This is fast, portable, and suitable for any 64-bit value,
+ * including doubles and long ints.
+ * Different starting values of Seed1 and Seed5 give unrelated results.
+ */
+static inline uint32_t mult32_fold(const uint64_t hash, uint32_t Seed1, uint32_t Seed5) {
+    KOMI32_SEEDHASH4((uint32_t)hash);
+    KOMI32_SEEDHASH4((uint32_t)(hash >> 32));
+    
+    return Seed1;
+}
+
+static inline uint32_t Mult32_impl(const void* const in, const size_t len, const uint64_t UseSeed) {
+    return mult32_fold(mult32_accumulate(in, len, UseSeed),
+                       UINT32_C(0xC5A308D3), UINT32_C(0xB8D01377));
+}
+
+/* Two 32-bit hashes from one pass over the input.
+ * *h1 is the same as Mult32_impl(in, len, UseSeed), and *h2 hashes the
+ * same 64-bit accumulator down to 32 bits from different starting values.
+ */
+static inline void Mult32x2_impl(const void* const in, const size_t len, const uint64_t UseSeed,
+                                 uint32_t* const h1, uint32_t* const h2) {
+    const uint64_t hash = mult32_accumulate(in, len, UseSeed);
+    
+    *h1 = mult32_fold(hash, UINT32_C(0xC5A308D3), UINT32_C(0xB8D01377));
+    *h2 = mult32_fold(hash, UINT32_C(0x03707344), UINT32_C(0x299F31D0));
 }
 
 /*------------------------------------------------------------*/
@@ -405,6 +423,11 @@ static inline uint64_t Xorshift128p(struct Xorshift128p_state *state) {
 
 /*------------------------------------------------------------ */
 
+/* Set once mult32_random[] is filled, by whichever of Mult32_init(),
+ * Mult32() and Mult32x2() runs first
+ */
+static int mult32_init_done = 0;
+
 /* Initialize the mult32_random[] array with random numbers.
  * This only happens once for the lifetime of the program,
  * so speed is not important.
@@ -416,6 +439,7 @@ static void Mult32_init(void) {
     for (unsigned int i = 0; i < RANDOM_LENGTH; i++) {
         mult32_random[i] = Xorshift128p(&state);
     }
+    mult32_init_done = 1;
 }
 
 /*------------------------------------------------------------ */
@@ -426,13 +450,21 @@ static uint32_t Mult32(const void* in, const size_t len, const uint64_t seed) {
      * Alternatively, remove this test and call Mult32_init()
      * at the beginning of your program.
      */
-    static int oneTimeDone = 0;
-    if (unlikely(oneTimeDone == 0)) {
+    if (unlikely(mult32_init_done == 0)) {
         Mult32_init();
-        oneTimeDone = 1;
     }
     
     return Mult32_impl(in, len, seed);
 }
 
+static inline void Mult32x2(const void* in, const size_t len, const uint64_t seed,
+                            uint32_t* h1, uint32_t* h2) {
+    /* The same one-time test as in Mult32() */
+    if (unlikely(mult32_init_done == 0)) {
+        Mult32_init();
+    }
+    
+    Mult32x2_impl(in, len, seed, h1, h2);
+}
+
 #endif /* mult32_h */
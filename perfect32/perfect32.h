@@ -0,0 +1,879 @@
+/*
+ * Perfect32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A minimal perfect hash function for static key sets, in the style of
+ * PTHash, written in C.
+ * Each key is hashed once with Combo32x2 into 64 bits, which choose a
+ * partition, a bucket within it, and, mixed with the bucket's pilot
+ * value, a position in the partition's table.  The builder searches the
+ * pilot of each bucket, largest buckets first, so that every key of the
+ * partition lands in its own position.
+ * Pilots are stored as fixed-width indexes into a dictionary of the
+ * distinct pilot values, so a lookup reads one packed index and one
+ * small, cache resident dictionary entry; the few positions past the
+ * number of keys are remapped into the holes below it through an
+ * Elias-Fano sequence.
+ * Partitions are built in parallel, and the result is one position
+ * independent blob that can be written to a file and used straight from
+ * mmap, with an O(1) lookup.
+ */
+
+#ifndef PERFECT32_H
+#define PERFECT32_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* comment out the next line if you don't want to build with threads */
+#define PERFECT32_USE_THREADS 1
+
+#if defined(PERFECT32_USE_THREADS) && PERFECT32_USE_THREADS
+  #include <pthread.h>
+#endif
+
+#if defined(__GNUC__)
+  #define PERFECT32_CTZ64(x) __builtin_ctzll(x)
+  #define PERFECT32_POPCOUNT64(x) __builtin_popcountll(x)
+#else
+  static inline int PERFECT32_CTZ64(uint64_t x) {
+      int n = 0;
+
+      while ((x & 1) == 0) {
+          x >>= 1;
+          n++;
+      }
+      return n;
+  }
+  static inline int PERFECT32_POPCOUNT64(uint64_t x) {
+      x = x - ((x >> 1) & UINT64_C(0x5555555555555555));
+      x = (x & UINT64_C(0x3333333333333333)) + ((x >> 2) & UINT64_C(0x3333333333333333));
+      x = (x + (x >> 4)) & UINT64_C(0x0F0F0F0F0F0F0F0F);
+      return (int)((x * UINT64_C(0x0101010101010101)) >> 56);
+  }
+#endif
+
+#define PERFECT32_FORMAT 2
+#define PERFECT32_BYTE_ORDER UINT32_C(0x01020304)
+/* Average keys per partition */
+#ifndef PERFECT32_PARTITION
+#define PERFECT32_PARTITION (1 << 22)
+#endif
+/* Buckets are PERFECT32_C * n / log2(n) */
+#ifndef PERFECT32_C
+#define PERFECT32_C 4.5
+#endif
+/* Keys per table position, below 1 so the last buckets find room fast */
+#define PERFECT32_ALPHA 0.99
+/* 60% of the keys go to the first 30% of the buckets */
+#define PERFECT32_DENSE_KEYS UINT32_C(2576980377)
+#define PERFECT32_DENSE_BUCKETS 0.3
+#define PERFECT32_MAX_PILOT (UINT64_C(1) << 24)
+/* Seeds tried before giving up on a key set with duplicates */
+#define PERFECT32_ATTEMPTS 4
+/* One select sample per this many Elias-Fano values */
+#define PERFECT32_EF_SAMPLE 256
+
+/* Errors; all are negative */
+#define PERFECT32_ERR_MEMORY -1
+#define PERFECT32_ERR_KEYS   -2     /* duplicate keys, or too many */
+#define PERFECT32_ERR_FORMAT -3     /* not a Perfect32 blob, or another byte order */
+#define PERFECT32_ERR_HASHER -4     /* built with another Combo32 version or threshold */
+
+static const char perfect32_magic[8] = { 'P', 'e', 'r', 'f', 'e', 'c', 't', 0 };
+
+/* The blob starts with this header, then one perfect32_part per
+ * partition, then the pilot dictionaries and remap sequences;
+ * everything is a multiple of 8 bytes, so the blob only needs to be
+ * 8-byte aligned.
+ */
+struct perfect32_header {
+    char magic[8];
+    uint32_t format;
+    uint32_t byte_order;           /* PERFECT32_BYTE_ORDER as written */
+    uint32_t combo32_version;
+    uint32_t combo32_threshold;
+    uint64_t seed;
+    uint64_t n;                    /* keys */
+    uint64_t nparts;
+    uint64_t size;                 /* of the whole blob, in bytes */
+};
+
+struct perfect32_part {
+    uint64_t base;                 /* index of the partition's first key */
+    uint64_t n;                    /* keys */
+    uint64_t nprime;               /* table positions, n / PERFECT32_ALPHA */
+    uint64_t nbuckets;
+    uint64_t dense;                /* buckets taking PERFECT32_DENSE_KEYS */
+    uint64_t pilots;               /* blob offset of the pilot dictionary */
+    uint64_t remap;                /* blob offset of the remap, 0 if none */
+};
+
+/* An Elias-Fano coded non-decreasing sequence, followed in the blob by
+ * its low bits, high bits and select samples, in 64-bit words
+ */
+struct perfect32_ef {
+    uint64_t count;
+    uint64_t lbits;                /* low bits per value */
+    uint64_t low_words;
+    uint64_t high_words;
+    uint64_t samples;
+};
+
+/* A loaded function; it points into the blob, which must outlive it */
+struct perfect32 {
+    const uint8_t *blob;
+    const struct perfect32_part *parts;
+    uint64_t nparts;
+    uint64_t n;
+    uint64_t seed;
+};
+
+/*------------------------------------------------------------ */
+
+/* Perfect32 hashing */
+
+static inline uint32_t perfect32_mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= UINT32_C(0x85EBCA6B);
+    x ^= x >> 13;
+    x *= UINT32_C(0xC2B2AE35);
+    x ^= x >> 16;
+    return x;
+}
+
+static inline uint64_t perfect32_mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= UINT64_C(0xFF51AFD7ED558CCD);
+    x ^= x >> 33;
+    x *= UINT64_C(0xC4CEB9FE1A85EC53);
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint64_t perfect32_hash(const void *key, const size_t len, const uint64_t seed) {
+    uint32_t h1, h2;
+
+    Combo32x2(key, len, seed, &h1, &h2);
+    return (uint64_t)h1 << 32 | h2;
+}
+
+/* The partition comes from the low half of the hash, the bucket from
+ * the high half, and the position from all of it
+ */
+static inline uint64_t perfect32_partition(const uint64_t hash, const uint64_t nparts) {
+    return ((hash & 0xFFFFFFFF) * nparts) >> 32;
+}
+
+static inline uint64_t perfect32_bucket(const struct perfect32_part *pt, const uint64_t hash) {
+    const uint32_t h1 = (uint32_t)(hash >> 32);
+
+    if (perfect32_mix32(h1) < PERFECT32_DENSE_KEYS) {
+        return ((uint64_t)h1 * pt->dense) >> 32;
+    }
+    return pt->dense + (((uint64_t)h1 * (pt->nbuckets - pt->dense)) >> 32);
+}
+
+/* The pilot's contribution, which the builder computes once per try */
+static inline uint64_t perfect32_pilot_mix(const uint64_t pilot) {
+    return perfect32_mix64(pilot + UINT64_C(0x9E3779B97F4A7C15));
+}
+
+static inline uint64_t perfect32_position(const uint64_t hash, const uint64_t pilot_mix,
+                                          const uint64_t nprime) {
+    return ((perfect32_mix64(hash ^ pilot_mix) >> 32) * nprime) >> 32;
+}
+
+/*------------------------------------------------------------ */
+
+/* Elias-Fano sequences */
+
+static inline uint64_t perfect32_ef_words(const struct perfect32_ef *ef) {
+    return sizeof(*ef) / 8 + ef->low_words + ef->high_words + ef->samples;
+}
+
+/* Position of the i-th one in the high bits */
+static inline uint64_t perfect32_ef_select(const struct perfect32_ef *ef, const uint64_t i) {
+    const uint64_t *low = (const uint64_t *)(ef + 1);
+    const uint64_t *high = low + ef->low_words;
+    const uint64_t *samples = high + ef->high_words;
+    const uint64_t pos = samples[i / PERFECT32_EF_SAMPLE];
+    uint64_t r = i % PERFECT32_EF_SAMPLE;
+    uint64_t w = pos >> 6;
+    uint64_t bits = high[w] & (~UINT64_C(0) << (pos & 63));
+
+    for (;;) {
+        const uint64_t c = (uint64_t)PERFECT32_POPCOUNT64(bits);
+
+        if (r < c) {
+            break;
+        }
+        r -= c;
+        bits = high[++w];
+    }
+    while (r-- != 0) {
+        bits &= bits - 1;
+    }
+    return (w << 6) + (uint64_t)PERFECT32_CTZ64(bits);
+}
+
+static inline uint64_t perfect32_ef_low(const struct perfect32_ef *ef, const uint64_t i) {
+    const uint64_t *low = (const uint64_t *)(ef + 1);
+    const uint64_t bit = i * ef->lbits;
+    const uint64_t w = bit >> 6;
+    const unsigned int sh = (unsigned int)(bit & 63);
+    uint64_t v;
+
+    if (ef->lbits == 0) {
+        return 0;
+    }
+    v = low[w] >> sh;
+    if (sh + ef->lbits > 64) {
+        v |= low[w + 1] << (64 - sh);
+    }
+    return v & ((UINT64_C(1) << ef->lbits) - 1);
+}
+
+static inline uint64_t perfect32_ef_get(const struct perfect32_ef *ef, const uint64_t i) {
+    return ((perfect32_ef_select(ef, i) - i) << ef->lbits) | perfect32_ef_low(ef, i);
+}
+
+/* Encode count non-decreasing values into a new buffer of 64-bit words.
+ * Returns NULL if out of memory.
+ */
+static uint64_t *perfect32_ef_encode(const uint64_t *values, const uint64_t count) {
+    struct perfect32_ef ef;
+    const uint64_t last = count != 0 ? values[count - 1] : 0;
+    uint64_t *out, *low, *high, *samples;
+    uint64_t lbits = 0;
+
+    while (count != 0 && (last + 1) >> (lbits + 1) >= count) {
+        lbits++;
+    }
+    ef.count = count;
+    ef.lbits = lbits;
+    ef.low_words = (count * lbits + 63) / 64;
+    ef.high_words = ((last >> lbits) + count + 1) / 64 + 2;
+    ef.samples = (count + PERFECT32_EF_SAMPLE - 1) / PERFECT32_EF_SAMPLE;
+    out = (uint64_t *)calloc((size_t)perfect32_ef_words(&ef), sizeof(uint64_t));
+    if (out == NULL) {
+        return NULL;
+    }
+    memcpy(out, &ef, sizeof(ef));
+    low = out + sizeof(ef) / 8;
+    high = low + ef.low_words;
+    samples = high + ef.high_words;
+    for (uint64_t i = 0; i < count; i++) {
+        const uint64_t pos = (values[i] >> lbits) + i;
+
+        if (lbits != 0) {
+            const uint64_t v = values[i] & ((UINT64_C(1) << lbits) - 1);
+            const uint64_t bit = i * lbits;
+            const unsigned int sh = (unsigned int)(bit & 63);
+
+            low[bit >> 6] |= v << sh;
+            if (sh + lbits > 64) {
+                low[(bit >> 6) + 1] |= v >> (64 - sh);
+            }
+        }
+        high[pos >> 6] |= UINT64_C(1) << (pos & 63);
+        if (i % PERFECT32_EF_SAMPLE == 0) {
+            samples[i / PERFECT32_EF_SAMPLE] = pos;
+        }
+    }
+    return out;
+}
+
+/*------------------------------------------------------------ */
+
+/* Dictionary coded pilots */
+
+/* count indexes of width bits each into ndict distinct values, followed
+ * in the blob by the values, most frequent first, as 32-bit words, then
+ * by the packed indexes in 64-bit words
+ */
+struct perfect32_dict {
+    uint64_t count;
+    uint64_t width;                /* bits per index */
+    uint64_t ndict;
+    uint64_t index_words;
+};
+
+static inline uint64_t perfect32_dict_words(const struct perfect32_dict *d) {
+    return sizeof(*d) / 8 + (d->ndict + 1) / 2 + d->index_words;
+}
+
+static inline uint64_t perfect32_dict_get(const struct perfect32_dict *d, const uint64_t i) {
+    const uint32_t *values = (const uint32_t *)(d + 1);
+    const uint64_t *index = (const uint64_t *)(d + 1) + (d->ndict + 1) / 2;
+    const uint64_t bit = i * d->width;
+    const uint64_t w = bit >> 6;
+    const unsigned int sh = (unsigned int)(bit & 63);
+    uint64_t v;
+
+    if (d->width == 0) {
+        return values[0];
+    }
+    v = index[w] >> sh;
+    if (sh + d->width > 64) {
+        v |= index[w + 1] << (64 - sh);
+    }
+    return values[v & ((UINT64_C(1) << d->width) - 1)];
+}
+
+static int perfect32_cmp64(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Encode count values below 2^32 into a new buffer of 64-bit words.
+ * Returns NULL if out of memory.
+ */
+static uint64_t *perfect32_dict_encode(const uint64_t *values, const uint64_t count) {
+    struct perfect32_dict d;
+    uint64_t *sorted = (uint64_t *)malloc((size_t)(count + 1) * sizeof(uint64_t));
+    uint64_t *out = NULL, *index;
+    uint32_t *dict;
+    uint64_t ndict = 0;
+
+    if (sorted == NULL) {
+        return NULL;
+    }
+    /* The distinct values with their counts, as count << 32 | value */
+    memcpy(sorted, values, (size_t)count * sizeof(uint64_t));
+    qsort(sorted, (size_t)count, sizeof(uint64_t), perfect32_cmp64);
+    for (uint64_t i = 0; i < count; i++) {
+        if (ndict != 0 && (sorted[ndict - 1] & 0xFFFFFFFF) == sorted[i]) {
+            sorted[ndict - 1] += UINT64_C(1) << 32;
+        } else {
+            sorted[ndict++] = (UINT64_C(1) << 32) | sorted[i];
+        }
+    }
+    /* Most frequent first, so the common pilots share cache lines */
+    for (uint64_t i = 0; i < ndict; i++) {
+        sorted[i] = ((UINT64_C(0xFFFFFFFF) - (sorted[i] >> 32)) << 32) | (sorted[i] & 0xFFFFFFFF);
+    }
+    qsort(sorted, (size_t)ndict, sizeof(uint64_t), perfect32_cmp64);
+
+    d.count = count;
+    d.ndict = ndict;
+    d.width = 0;
+    while ((UINT64_C(1) << d.width) < ndict) {
+        d.width++;
+    }
+    d.index_words = (count * d.width + 63) / 64;
+    out = (uint64_t *)calloc((size_t)perfect32_dict_words(&d), sizeof(uint64_t));
+    if (out == NULL) {
+        free(sorted);
+        return NULL;
+    }
+    memcpy(out, &d, sizeof(d));
+    dict = (uint32_t *)(out + sizeof(d) / 8);
+    index = out + sizeof(d) / 8 + (ndict + 1) / 2;
+    for (uint64_t i = 0; i < ndict; i++) {
+        dict[i] = (uint32_t)sorted[i];
+    }
+    /* Then sorted by value, to find each value's place in the dictionary */
+    for (uint64_t i = 0; i < ndict; i++) {
+        sorted[i] = (sorted[i] & 0xFFFFFFFF) << 32 | i;
+    }
+    qsort(sorted, (size_t)ndict, sizeof(uint64_t), perfect32_cmp64);
+    for (uint64_t i = 0; i < count; i++) {
+        const uint64_t key = values[i] << 32;
+        uint64_t lo = 0, hi = ndict - 1;
+        uint64_t bit, v;
+        unsigned int sh;
+
+        while (lo < hi) {
+            const uint64_t mid = (lo + hi) / 2;
+
+            if ((sorted[mid] & ~UINT64_C(0xFFFFFFFF)) < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        v = sorted[lo] & 0xFFFFFFFF;
+        bit = i * d.width;
+        sh = (unsigned int)(bit & 63);
+        if (d.width != 0) {
+            index[bit >> 6] |= v << sh;
+            if (sh + d.width > 64) {
+                index[(bit >> 6) + 1] |= v >> (64 - sh);
+            }
+        }
+    }
+    free(sorted);
+    return out;
+}
+
+/*------------------------------------------------------------ */
+
+/* Perfect32 lookup */
+
+/* Check a blob and set up p to use it in place.
+ * Returns 0 or a negative PERFECT32_ERR code.
+ */
+static int Perfect32_load(struct perfect32 *p, const void *blob, const size_t size) {
+    const struct perfect32_header *h = (const struct perfect32_header *)blob;
+
+    if (size < sizeof(*h) || memcmp(h->magic, perfect32_magic, sizeof(h->magic)) != 0 ||
+        h->format != PERFECT32_FORMAT || h->byte_order != PERFECT32_BYTE_ORDER ||
+        h->size > size || h->nparts == 0 ||
+        sizeof(*h) + h->nparts * sizeof(struct perfect32_part) > h->size) {
+        return PERFECT32_ERR_FORMAT;
+    }
+    if (h->combo32_version != COMBO32_VERSION ||
+        h->combo32_threshold != COMBO32_THRESHOLD) {
+        return PERFECT32_ERR_HASHER;
+    }
+    p->blob = (const uint8_t *)blob;
+    p->parts = (const struct perfect32_part *)(h + 1);
+    p->nparts = h->nparts;
+    p->n = h->n;
+    p->seed = h->seed;
+    return 0;
+}
+
+/* The key's index, from 0 to n - 1, for a key of the set the function
+ * was built from; any other key gives some index in the same range
+ */
+static inline uint64_t Perfect32_lookup(const struct perfect32 *p, const void *key,
+                                        const size_t len) {
+    const uint64_t hash = perfect32_hash(key, len, p->seed);
+    const struct perfect32_part *pt = &p->parts[perfect32_partition(hash, p->nparts)];
+    const uint64_t b = perfect32_bucket(pt, hash);
+    const uint64_t pilot = perfect32_dict_get(
+        (const struct perfect32_dict *)(p->blob + pt->pilots), b);
+    uint64_t pos = perfect32_position(hash, perfect32_pilot_mix(pilot), pt->nprime);
+
+    if (unlikely(pos >= pt->n)) {
+        pos = perfect32_ef_get((const struct perfect32_ef *)(p->blob + pt->remap), pos - pt->n);
+    }
+    return pt->base + pos;
+}
+
+/* Size of the blob in bits per key */
+static inline double Perfect32_bits_per_key(const struct perfect32 *p) {
+    const struct perfect32_header *h = (const struct perfect32_header *)p->blob;
+
+    return p->n != 0 ? 8.0 * (double)h->size / (double)p->n : 0.0;
+}
+
+/*------------------------------------------------------------ */
+
+/* Perfect32 builder */
+
+struct perfect32_work {
+    uint64_t *hashes;              /* grouped by partition */
+    struct perfect32_part *parts;
+    uint64_t **pilots;             /* encoded, per partition */
+    uint64_t **remaps;
+    uint64_t nparts;
+    unsigned int thread;
+    unsigned int nthreads;
+    int err;
+    /* hashing stage */
+    const void *const *keys;
+    const size_t *lens;
+    uint64_t n;
+    uint64_t seed;
+    uint64_t *all;                 /* hashes in key order */
+    uint64_t *counts;              /* nthreads * nparts */
+};
+
+/* Search the pilots of one partition and encode them and its remap */
+static int perfect32_build_part(struct perfect32_part *pt, const uint64_t *hashes,
+                                uint64_t **pilots_out, uint64_t **remap_out) {
+    const uint64_t n = pt->n, m = pt->nbuckets, nprime = pt->nprime;
+    uint64_t *bucket_of = (uint64_t *)malloc((size_t)(n + 1) * sizeof(uint64_t));
+    uint64_t *start = (uint64_t *)calloc((size_t)(m + 1), sizeof(uint64_t));
+    uint64_t *sorted = (uint64_t *)malloc((size_t)(n + 1) * sizeof(uint64_t));
+    uint64_t *pilots = (uint64_t *)malloc((size_t)m * sizeof(uint64_t));
+    uint64_t *taken = (uint64_t *)calloc((size_t)(nprime / 64 + 1), sizeof(uint64_t));
+    uint64_t *order = NULL, *size_start = NULL, *pos = NULL, *remap = NULL;
+    uint64_t max_size = 0;
+    int err = PERFECT32_ERR_MEMORY;
+
+    if (bucket_of == NULL || start == NULL || sorted == NULL || pilots == NULL ||
+        taken == NULL) {
+        goto done;
+    }
+
+    /* Group the hashes by bucket */
+    for (uint64_t i = 0; i < n; i++) {
+        bucket_of[i] = perfect32_bucket(pt, hashes[i]);
+        start[bucket_of[i] + 1]++;
+    }
+    for (uint64_t b = 0; b < m; b++) {
+        const uint64_t s = start[b + 1];
+
+        max_size = s > max_size ? s : max_size;
+        start[b + 1] += start[b];
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        sorted[start[bucket_of[i]]++] = hashes[i];
+    }
+    for (uint64_t b = m; b > 0; b--) {
+        start[b] = start[b - 1];
+    }
+    start[0] = 0;
+
+    /* Order the buckets from largest to smallest */
+    order = (uint64_t *)malloc((size_t)(m + 1) * sizeof(uint64_t));
+    size_start = (uint64_t *)calloc((size_t)(max_size + 2), sizeof(uint64_t));
+    pos = (uint64_t *)malloc((size_t)(max_size + 1) * sizeof(uint64_t));
+    if (order == NULL || size_start == NULL || pos == NULL) {
+        goto done;
+    }
+    for (uint64_t b = 0; b < m; b++) {
+        size_start[max_size - (start[b + 1] - start[b]) + 1]++;
+    }
+    for (uint64_t s = 0; s <= max_size; s++) {
+        size_start[s + 1] += size_start[s];
+    }
+    for (uint64_t b = 0; b < m; b++) {
+        order[size_start[max_size - (start[b + 1] - start[b])]++] = b;
+    }
+
+    err = PERFECT32_ERR_KEYS;
+    for (uint64_t j = 0; j < m; j++) {
+        const uint64_t b = order[j];
+        const uint64_t *h = sorted + start[b];
+        const uint64_t s = start[b + 1] - start[b];
+        uint64_t pilot;
+
+        if (s == 0) {
+            pilots[b] = 0;
+            continue;
+        }
+        /* Equal hashes would land together whatever the pilot */
+        for (uint64_t x = 0; x < s; x++) {
+            for (uint64_t y = x + 1; y < s; y++) {
+                if (h[x] == h[y]) {
+                    goto done;
+                }
+            }
+        }
+        for (pilot = 0; pilot < PERFECT32_MAX_PILOT; pilot++) {
+            const uint64_t mix = perfect32_pilot_mix(pilot);
+            uint64_t k;
+
+            /* Claim the positions one by one, undoing on a clash */
+            for (k = 0; k < s; k++) {
+                const uint64_t p = perfect32_position(h[k], mix, nprime);
+
+                if (taken[p >> 6] & (UINT64_C(1) << (p & 63))) {
+                    break;
+                }
+                taken[p >> 6] |= UINT64_C(1) << (p & 63);
+                pos[k] = p;
+            }
+            if (k == s) {
+                break;
+            }
+            while (k-- != 0) {
+                taken[pos[k] >> 6] &= ~(UINT64_C(1) << (pos[k] & 63));
+            }
+        }
+        if (pilot == PERFECT32_MAX_PILOT) {
+            goto done;
+        }
+        pilots[b] = pilot;
+    }
+
+    err = PERFECT32_ERR_MEMORY;
+    *pilots_out = perfect32_dict_encode(pilots, m);
+    if (*pilots_out == NULL) {
+        goto done;
+    }
+
+    /* Each taken position at or past n moves to the next hole below n;
+     * untaken ones repeat the last hole to keep the sequence sorted
+     */
+    *remap_out = NULL;
+    if (nprime > n) {
+        uint64_t hole = 0;
+
+        remap = (uint64_t *)malloc((size_t)(nprime - n) * sizeof(uint64_t));
+        if (remap == NULL) {
+            free(*pilots_out);
+            goto done;
+        }
+        for (uint64_t p = n; p < nprime; p++) {
+            if (taken[p >> 6] & (UINT64_C(1) << (p & 63))) {
+                while (taken[hole >> 6] & (UINT64_C(1) << (hole & 63))) {
+                    hole++;
+                }
+                remap[p - n] = hole++;
+            } else {
+                remap[p - n] = hole;
+            }
+        }
+        *remap_out = perfect32_ef_encode(remap, nprime - n);
+        if (*remap_out == NULL) {
+            free(*pilots_out);
+            goto done;
+        }
+    }
+    err = 0;
+
+done:
+    free(bucket_of);
+    free(start);
+    free(sorted);
+    free(pilots);
+    free(taken);
+    free(order);
+    free(size_start);
+    free(pos);
+    free(remap);
+    return err;
+}
+
+static void *perfect32_hash_thread(void *arg) {
+    struct perfect32_work *w = (struct perfect32_work *)arg;
+    const uint64_t first = w->n * w->thread / w->nthreads;
+    const uint64_t last = w->n * (w->thread + 1) / w->nthreads;
+    uint64_t *counts = w->counts + (uint64_t)w->thread * w->nparts;
+
+    for (uint64_t i = first; i < last; i++) {
+        w->all[i] = perfect32_hash(w->keys[i], w->lens[i], w->seed);
+        counts[perfect32_partition(w->all[i], w->nparts)]++;
+    }
+    return NULL;
+}
+
+static void *perfect32_scatter_thread(void *arg) {
+    struct perfect32_work *w = (struct perfect32_work *)arg;
+    const uint64_t first = w->n * w->thread / w->nthreads;
+    const uint64_t last = w->n * (w->thread + 1) / w->nthreads;
+    uint64_t *next = w->counts + (uint64_t)w->thread * w->nparts;
+
+    for (uint64_t i = first; i < last; i++) {
+        w->hashes[next[perfect32_partition(w->all[i], w->nparts)]++] = w->all[i];
+    }
+    return NULL;
+}
+
+static void *perfect32_part_thread(void *arg) {
+    struct perfect32_work *w = (struct perfect32_work *)arg;
+
+    for (uint64_t i = w->thread; i < w->nparts && w->err == 0; i += w->nthreads) {
+        w->err = perfect32_build_part(&w->parts[i], w->hashes + w->parts[i].base,
+                                      &w->pilots[i], &w->remaps[i]);
+    }
+    return NULL;
+}
+
+/* Run fn on every work item, on threads if there are any */
+static void perfect32_run(void *(*fn)(void *), struct perfect32_work *work,
+                          const unsigned int nthreads) {
+#if defined(PERFECT32_USE_THREADS) && PERFECT32_USE_THREADS
+    pthread_t *threads = (pthread_t *)malloc(nthreads * sizeof(pthread_t));
+    unsigned int started = 0;
+
+    if (threads != NULL) {
+        for (; started < nthreads; started++) {
+            if (pthread_create(&threads[started], NULL, fn, &work[started]) != 0) {
+                break;
+            }
+        }
+    }
+    /* Whatever could not get a thread runs here */
+    for (unsigned int t = started; t < nthreads; t++) {
+        fn(&work[t]);
+    }
+    for (unsigned int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+#else
+    for (unsigned int t = 0; t < nthreads; t++) {
+        fn(&work[t]);
+    }
+#endif
+}
+
+/* Build the function for n distinct keys, using up to nthreads threads.
+ * On success sets *blob to a malloc'd blob of *size bytes, for
+ * Perfect32_load or to be written to a file, and returns 0; else returns
+ * a negative PERFECT32_ERR code.
+ */
+static int Perfect32_build(const void *const *keys, const size_t *lens, const uint64_t n,
+                           const uint64_t seed, unsigned int nthreads,
+                           void **blob, size_t *size) {
+    const uint64_t nparts = n / PERFECT32_PARTITION + 1;
+    struct perfect32_work *work;
+    struct perfect32_part *parts;
+    uint64_t *all, *hashes, *counts, **pilots, **remaps;
+    int err = PERFECT32_ERR_MEMORY;
+
+#if !defined(PERFECT32_USE_THREADS) || !PERFECT32_USE_THREADS
+    nthreads = 1;
+#endif
+    if (nthreads == 0) {
+        nthreads = 1;
+    }
+    all = (uint64_t *)malloc((size_t)(n + 1) * sizeof(uint64_t));
+    hashes = (uint64_t *)malloc((size_t)(n + 1) * sizeof(uint64_t));
+    counts = (uint64_t *)malloc((size_t)(nthreads * nparts) * sizeof(uint64_t));
+    parts = (struct perfect32_part *)calloc((size_t)nparts, sizeof(struct perfect32_part));
+    pilots = (uint64_t **)calloc((size_t)nparts, sizeof(uint64_t *));
+    remaps = (uint64_t **)calloc((size_t)nparts, sizeof(uint64_t *));
+    work = (struct perfect32_work *)calloc(nthreads, sizeof(struct perfect32_work));
+    if (all == NULL || hashes == NULL || counts == NULL || parts == NULL ||
+        pilots == NULL || remaps == NULL || work == NULL) {
+        goto done;
+    }
+    /* Mult32x2 sets itself up on its first call; make that this thread */
+    perfect32_hash("", 0, seed);
+
+    for (unsigned int attempt = 0; attempt < PERFECT32_ATTEMPTS; attempt++) {
+        const uint64_t s = seed + attempt * UINT64_C(0x9E3779B97F4A7C15);
+        uint64_t total = 0;
+
+        memset(counts, 0, (size_t)(nthreads * nparts) * sizeof(uint64_t));
+        for (unsigned int t = 0; t < nthreads; t++) {
+            work[t].keys = keys;
+            work[t].lens = lens;
+            work[t].n = n;
+            work[t].seed = s;
+            work[t].all = all;
+            work[t].hashes = hashes;
+            work[t].counts = counts;
+            work[t].parts = parts;
+            work[t].pilots = pilots;
+            work[t].remaps = remaps;
+            work[t].nparts = nparts;
+            work[t].thread = t;
+            work[t].nthreads = nthreads;
+            work[t].err = 0;
+        }
+        perfect32_run(perfect32_hash_thread, work, nthreads);
+
+        /* Turn the per-thread counts into where each thread scatters */
+        for (uint64_t i = 0; i < nparts; i++) {
+            struct perfect32_part *pt = &parts[i];
+
+            pt->base = total;
+            for (unsigned int t = 0; t < nthreads; t++) {
+                const uint64_t c = counts[t * nparts + i];
+
+                counts[t * nparts + i] = total;
+                total += c;
+            }
+            pt->n = total - pt->base;
+            pt->nprime = (uint64_t)((double)pt->n / PERFECT32_ALPHA) + 1;
+            pt->nbuckets = pt->n > 1
+                ? (uint64_t)(PERFECT32_C * (double)pt->n / log2((double)pt->n)) + 2 : 2;
+            /* Both kinds of bucket must exist */
+            pt->dense = (uint64_t)(PERFECT32_DENSE_BUCKETS * (double)pt->nbuckets);
+            pt->dense = pt->dense == 0 ? 1 : pt->dense;
+            if (pt->nprime >= UINT64_C(1) << 32) {
+                err = PERFECT32_ERR_KEYS;
+                goto done;
+            }
+        }
+        perfect32_run(perfect32_scatter_thread, work, nthreads);
+        perfect32_run(perfect32_part_thread, work, nthreads);
+
+        err = 0;
+        for (unsigned int t = 0; t < nthreads; t++) {
+            err = work[t].err != 0 ? work[t].err : err;
+        }
+        if (err == 0) {
+            struct perfect32_header *h;
+            uint8_t *out;
+            size_t bytes = sizeof(*h) + (size_t)nparts * sizeof(struct perfect32_part);
+
+            for (uint64_t i = 0; i < nparts; i++) {
+                parts[i].pilots = bytes;
+                bytes += (size_t)perfect32_dict_words((struct perfect32_dict *)pilots[i]) * 8;
+                parts[i].remap = 0;
+                if (remaps[i] != NULL) {
+                    parts[i].remap = bytes;
+                    bytes += (size_t)perfect32_ef_words((struct perfect32_ef *)remaps[i]) * 8;
+                }
+            }
+            out = (uint8_t *)malloc(bytes);
+            if (out == NULL) {
+                err = PERFECT32_ERR_MEMORY;
+                goto done;
+            }
+            h = (struct perfect32_header *)out;
+            memset(h, 0, sizeof(*h));
+            memcpy(h->magic, perfect32_magic, sizeof(h->magic));
+            h->format = PERFECT32_FORMAT;
+            h->byte_order = PERFECT32_BYTE_ORDER;
+            h->combo32_version = COMBO32_VERSION;
+            h->combo32_threshold = COMBO32_THRESHOLD;
+            h->seed = s;
+            h->n = n;
+            h->nparts = nparts;
+            h->size = bytes;
+            memcpy(h + 1, parts, (size_t)nparts * sizeof(struct perfect32_part));
+            for (uint64_t i = 0; i < nparts; i++) {
+                memcpy(out + parts[i].pilots, pilots[i],
+                       (size_t)perfect32_dict_words((struct perfect32_dict *)pilots[i]) * 8);
+                if (remaps[i] != NULL) {
+                    memcpy(out + parts[i].remap, remaps[i],
+                           (size_t)perfect32_ef_words((struct perfect32_ef *)remaps[i]) * 8);
+                }
+            }
+            *blob = out;
+            *size = bytes;
+            goto done;
+        }
+        if (err != PERFECT32_ERR_KEYS) {
+            goto done;
+        }
+        /* Two keys hashed alike; try another seed */
+        for (uint64_t i = 0; i < nparts; i++) {
+            free(pilots[i]);
+            free(remaps[i]);
+            pilots[i] = NULL;
+            remaps[i] = NULL;
+        }
+    }
+
+done:
+    if (pilots != NULL && remaps != NULL) {
+        for (uint64_t i = 0; i < nparts; i++) {
+            free(pilots[i]);
+            free(remaps[i]);
+        }
+    }
+    free(all);
+    free(hashes);
+    free(counts);
+    free(parts);
+    free(pilots);
+    free(remaps);
+    free(work);
+    return err;
+}
+
+#endif /* PERFECT32_H */
@@ -0,0 +1,704 @@
+/*
+ * Quotient32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A counting quotient filter for byte strings, written in C.
+ * The 32-bit Combo32 value of a key is split into a quotient, its top
+ * q bits, and a remainder, the other 32 - q bits.  The remainder is
+ * stored in a table of 2^q slots, at the quotient's slot or, if that is
+ * taken, in the run of remainders of the same quotient that follows the
+ * runs of smaller quotients, kept in order.  Each slot also holds a
+ * few bits of count: a key's slots are the digits of its count, lowest
+ * first, so a count c takes O(log c) slots.
+ * Slots are grouped in blocks of 64 with an occupied bit per quotient,
+ * a run end bit per slot and an offset, from which a rank and a select
+ * find the run of any quotient, so a query reads one block and the run
+ * that usually follows in the next cache line.
+ * Since quotient and remainder together are the whole Combo32 value,
+ * the filter can double, or merge with another, without losing any
+ * bits, and its false positive rate is that of a 32-bit hash.
+ */
+
+#ifndef QUOTIENT32_H
+#define QUOTIENT32_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* comment out the next line if you don't want BMI2 */
+#define QUOTIENT32_USE_SIMD 1
+
+#if defined(QUOTIENT32_USE_SIMD) && QUOTIENT32_USE_SIMD && defined(__BMI2__)
+  #define QUOTIENT32_BMI2 1
+  #include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+  #define QUOTIENT32_CTZ64(x) __builtin_ctzll(x)
+  #define QUOTIENT32_POPCOUNT64(x) __builtin_popcountll(x)
+#else
+  static inline int QUOTIENT32_CTZ64(uint64_t x) {
+      int n = 0;
+
+      while ((x & 1) == 0) {
+          x >>= 1;
+          n++;
+      }
+      return n;
+  }
+  static inline int QUOTIENT32_POPCOUNT64(uint64_t x) {
+      x = x - ((x >> 1) & UINT64_C(0x5555555555555555));
+      x = (x & UINT64_C(0x3333333333333333)) + ((x >> 2) & UINT64_C(0x3333333333333333));
+      x = (x + (x >> 4)) & UINT64_C(0x0F0F0F0F0F0F0F0F);
+      return (int)((x * UINT64_C(0x0101010101010101)) >> 56);
+  }
+#endif
+
+/* Bits of count per slot, the base of a key's count digits */
+#ifndef QUOTIENT32_COUNT_BITS
+#define QUOTIENT32_COUNT_BITS 4
+#endif
+#if QUOTIENT32_COUNT_BITS < 1 || QUOTIENT32_COUNT_BITS > 16
+  #error "QUOTIENT32_COUNT_BITS must be from 1 to 16"
+#endif
+#define QUOTIENT32_COUNT_MAX ((UINT64_C(1) << QUOTIENT32_COUNT_BITS) - 1)
+
+#define QUOTIENT32_MIN_QBITS 6
+#define QUOTIENT32_MAX_QBITS 31
+/* Fraction of the slots in use at which the filter doubles */
+#define QUOTIENT32_MAX_LOAD 0.9
+
+#define QUOTIENT32_FORMAT 2
+#define QUOTIENT32_BYTE_ORDER UINT32_C(0x01020304)
+
+/* Errors; all are negative */
+#define QUOTIENT32_ERR_MEMORY -1
+#define QUOTIENT32_ERR_IO     -2     /* see errno */
+#define QUOTIENT32_ERR_FORMAT -3     /* not a Quotient32 file, or another byte order */
+#define QUOTIENT32_ERR_HASHER -4     /* another Combo32 version, threshold or seed */
+
+/* The words of a block: occupied bits, run end bits, offset, then 64
+ * slots of rbits + QUOTIENT32_COUNT_BITS bits each
+ */
+#define QUOTIENT32_OCCUPIEDS 0
+#define QUOTIENT32_RUNENDS 1
+#define QUOTIENT32_OFFSET 2
+#define QUOTIENT32_SLOTS 3
+
+static const char quotient32_magic[8] = { 'Q', 'u', 'o', 't', 'i', 'e', 'n', 't' };
+
+struct quotient32_header {
+    char magic[8];
+    uint32_t format;
+    uint32_t byte_order;           /* QUOTIENT32_BYTE_ORDER as written */
+    uint32_t combo32_version;
+    uint32_t combo32_threshold;
+    uint64_t seed;
+    uint32_t qbits;
+    uint32_t count_bits;
+    uint64_t nblocks;
+    uint64_t used;
+};
+
+struct quotient32 {
+    uint64_t *words;
+    uint64_t nslots;               /* 2^qbits quotients */
+    uint64_t nblocks;              /* including overflow blocks past nslots */
+    unsigned int qbits;
+    unsigned int rbits;            /* 32 - qbits */
+    unsigned int width;            /* bits per slot */
+    unsigned int block_words;
+    uint64_t used;                 /* slots in use */
+    uint64_t grow_at;
+    uint64_t seed;
+};
+
+/* Walks the keys of a filter in the order of their Combo32 values */
+struct quotient32_iter {
+    uint64_t quotient;             /* of the run being read */
+    uint64_t pos;                  /* next slot to read */
+};
+
+/*------------------------------------------------------------ */
+
+/* Quotient32 bit and slot access */
+
+/* Position of the k-th one of x, counting from 0 */
+static inline unsigned int quotient32_select64(uint64_t x, unsigned int k) {
+#if defined(QUOTIENT32_BMI2)
+    return (unsigned int)QUOTIENT32_CTZ64(_pdep_u64(UINT64_C(1) << k, x));
+#else
+    /* Count the ones of each byte and add them up from the low end;
+     * the bytes whose running count is at most k come before the one
+     * holding the k-th one
+     */
+    const uint64_t ones = UINT64_C(0x0101010101010101);
+    const uint64_t highs = UINT64_C(0x8080808080808080);
+    uint64_t c = x - ((x >> 1) & UINT64_C(0x5555555555555555));
+    uint64_t below;
+    unsigned int base;
+
+    c = (c & UINT64_C(0x3333333333333333)) + ((c >> 2) & UINT64_C(0x3333333333333333));
+    c = ((c + (c >> 4)) & UINT64_C(0x0F0F0F0F0F0F0F0F)) * ones;
+    below = ((((uint64_t)k * ones) | highs) - c) & highs;
+    base = (unsigned int)(((below >> 7) * ones) >> 56) * 8;
+    if (base != 0) {
+        k -= (unsigned int)(c >> (base - 8)) & 0xFF;
+    }
+    x >>= base;
+    while (k-- > 0) {
+        x &= x - 1;
+    }
+    return base + (unsigned int)QUOTIENT32_CTZ64(x);
+#endif
+}
+
+static inline uint64_t *quotient32_block(const struct quotient32 *f, const uint64_t b) {
+    return f->words + b * f->block_words;
+}
+
+static inline uint64_t quotient32_get(const struct quotient32 *f, const uint64_t i) {
+    const uint64_t *s = quotient32_block(f, i / 64) + QUOTIENT32_SLOTS;
+    const unsigned int bit = (unsigned int)(i % 64) * f->width;
+    const unsigned int sh = bit % 64;
+    uint64_t v = s[bit / 64] >> sh;
+
+    if (sh + f->width > 64) {
+        v |= s[bit / 64 + 1] << (64 - sh);
+    }
+    return v & ((UINT64_C(1) << f->width) - 1);
+}
+
+static inline void quotient32_set(struct quotient32 *f, const uint64_t i, const uint64_t v) {
+    uint64_t *s = quotient32_block(f, i / 64) + QUOTIENT32_SLOTS;
+    const unsigned int bit = (unsigned int)(i % 64) * f->width;
+    const unsigned int sh = bit % 64;
+    const uint64_t mask = (UINT64_C(1) << f->width) - 1;
+
+    s[bit / 64] = (s[bit / 64] & ~(mask << sh)) | v << sh;
+    if (sh + f->width > 64) {
+        s[bit / 64 + 1] = (s[bit / 64 + 1] & ~(mask >> (64 - sh))) | v >> (64 - sh);
+    }
+}
+
+static inline int quotient32_bit(const struct quotient32 *f, const unsigned int which,
+                                 const uint64_t i) {
+    return (int)(quotient32_block(f, i / 64)[which] >> (i % 64)) & 1;
+}
+
+static inline void quotient32_set_bit(struct quotient32 *f, const unsigned int which,
+                                      const uint64_t i, const int on) {
+    uint64_t *w = &quotient32_block(f, i / 64)[which];
+
+    *w = (*w & ~(UINT64_C(1) << (i % 64))) | (uint64_t)on << (i % 64);
+}
+
+/*------------------------------------------------------------ */
+
+/* Quotient32 runs */
+
+/* One past the end of the d-th run, counting from 1, of the quotients
+ * of block b; for d = 0, one past the end of the runs of the quotients
+ * before the block, or the block's first slot if they end sooner.
+ * The offset of a block is how many of its first slots those runs take.
+ */
+static uint64_t quotient32_end(const struct quotient32 *f, uint64_t b, uint64_t d) {
+    const uint64_t t = b * 64 + quotient32_block(f, b)[QUOTIENT32_OFFSET];
+    uint64_t w;
+
+    if (d == 0) {
+        return t;
+    }
+    b = t / 64;
+    w = quotient32_block(f, b)[QUOTIENT32_RUNENDS] & (~UINT64_C(0) << (t % 64));
+    for (;;) {
+        const uint64_t c = (uint64_t)QUOTIENT32_POPCOUNT64(w);
+
+        if (d <= c) {
+            return b * 64 + quotient32_select64(w, (unsigned int)(d - 1)) + 1;
+        }
+        d -= c;
+        w = quotient32_block(f, ++b)[QUOTIENT32_RUNENDS];
+    }
+}
+
+/* One past the end of the runs of the quotients up to s */
+static inline uint64_t quotient32_end_upto(const struct quotient32 *f, const uint64_t s) {
+    const uint64_t occupied = quotient32_block(f, s / 64)[QUOTIENT32_OCCUPIEDS];
+
+    return quotient32_end(f, s / 64,
+                          (uint64_t)QUOTIENT32_POPCOUNT64(occupied & (~UINT64_C(0) >> (63 - s % 64))));
+}
+
+/* Where the run of quotient x starts, or would start */
+static inline uint64_t quotient32_run_start(const struct quotient32 *f, const uint64_t x) {
+    const uint64_t occupied = quotient32_block(f, x / 64)[QUOTIENT32_OCCUPIEDS];
+    const uint64_t e = quotient32_end(f, x / 64,
+        (uint64_t)QUOTIENT32_POPCOUNT64(occupied & ((UINT64_C(1) << (x % 64)) - 1)));
+
+    return e > x ? e : x;
+}
+
+/* Make room at slot p for a slot of quotient x, shifting the slots from
+ * p up to the next free one along by one.
+ * Returns 0, or -1 if the slots past the table ran out.
+ */
+static int quotient32_open(struct quotient32 *f, const uint64_t x, const uint64_t p) {
+    const uint64_t total = f->nblocks * 64;
+    uint64_t s = p;
+
+    /* A slot is free if the runs of the quotients up to it end sooner */
+    for (;;) {
+        uint64_t e;
+
+        if (s >= total) {
+            return -1;
+        }
+        e = quotient32_end_upto(f, s);
+        if (e <= s) {
+            break;
+        }
+        s = e;
+    }
+    for (uint64_t i = s; i > p; i--) {
+        quotient32_set(f, i, quotient32_get(f, i - 1));
+        quotient32_set_bit(f, QUOTIENT32_RUNENDS, i, quotient32_bit(f, QUOTIENT32_RUNENDS, i - 1));
+    }
+    /* The runs of the quotients before each block start after x, x
+     * among them, now reach one slot further into it, up to slot s
+     */
+    for (uint64_t c = x / 64 + 1; c <= s / 64; c++) {
+        quotient32_block(f, c)[QUOTIENT32_OFFSET]++;
+    }
+    f->used++;
+    return 0;
+}
+
+/* Slots, digits of QUOTIENT32_COUNT_BITS bits, that a count takes */
+static inline unsigned int quotient32_digits(uint64_t count) {
+    unsigned int d = 1;
+
+    while ((count >>= QUOTIENT32_COUNT_BITS) != 0) {
+        d++;
+    }
+    return d;
+}
+
+/* The count held in the digits of the slots from p to last */
+static inline uint64_t quotient32_decode(const struct quotient32 *f, const uint64_t p,
+                                         const uint64_t last) {
+    uint64_t count = 0;
+
+    for (uint64_t i = p; i <= last && (i - p) * QUOTIENT32_COUNT_BITS < 64; i++) {
+        count |= (quotient32_get(f, i) & QUOTIENT32_COUNT_MAX) << ((i - p) * QUOTIENT32_COUNT_BITS);
+    }
+    return count;
+}
+
+/* Add count to the count of a hash, opening a slot for each digit it
+ * gains.  Returns 0, or -1 if the table ran out of slots, in which case
+ * the count is unchanged, though the hash may hold extra zero digits.
+ */
+static int quotient32_add(struct quotient32 *f, const uint32_t hash, const uint64_t count) {
+    const uint64_t x = hash >> f->rbits;
+    const uint64_t rem = hash & ((UINT64_C(1) << f->rbits) - 1);
+    const uint64_t start = quotient32_run_start(f, x);
+    uint64_t first, last, total;
+
+    if (count == 0) {
+        return 0;
+    }
+    if (!quotient32_bit(f, QUOTIENT32_OCCUPIEDS, x)) {
+        if (quotient32_open(f, x, start) != 0) {
+            return -1;
+        }
+        quotient32_set(f, start, rem << QUOTIENT32_COUNT_BITS);
+        quotient32_set_bit(f, QUOTIENT32_RUNENDS, start, 1);
+        quotient32_set_bit(f, QUOTIENT32_OCCUPIEDS, x, 1);
+        first = last = start;
+    } else {
+        int at_end = 0;
+
+        /* Remainders are in order; find this one, or the first larger
+         * one, or the end of the run
+         */
+        for (first = start;; first++) {
+            if (quotient32_get(f, first) >> QUOTIENT32_COUNT_BITS >= rem) {
+                break;
+            }
+            if (quotient32_bit(f, QUOTIENT32_RUNENDS, first)) {
+                first++;
+                at_end = 1;
+                break;
+            }
+        }
+        if (at_end || quotient32_get(f, first) >> QUOTIENT32_COUNT_BITS != rem) {
+            if (quotient32_open(f, x, first) != 0) {
+                return -1;
+            }
+            quotient32_set(f, first, rem << QUOTIENT32_COUNT_BITS);
+            if (at_end) {
+                quotient32_set_bit(f, QUOTIENT32_RUNENDS, first - 1, 0);
+                quotient32_set_bit(f, QUOTIENT32_RUNENDS, first, 1);
+            } else {
+                quotient32_set_bit(f, QUOTIENT32_RUNENDS, first, 0);
+            }
+        }
+        last = first;
+        while (!quotient32_bit(f, QUOTIENT32_RUNENDS, last) &&
+               quotient32_get(f, last + 1) >> QUOTIENT32_COUNT_BITS == rem) {
+            last++;
+        }
+    }
+
+    total = quotient32_decode(f, first, last);
+    total = total + count < total ? UINT64_MAX : total + count;
+
+    /* Open a zero digit past the last one until the new count fits */
+    while (last - first + 1 < quotient32_digits(total)) {
+        const int at_end = quotient32_bit(f, QUOTIENT32_RUNENDS, last);
+
+        if (quotient32_open(f, x, last + 1) != 0) {
+            return -1;
+        }
+        last++;
+        quotient32_set(f, last, rem << QUOTIENT32_COUNT_BITS);
+        quotient32_set_bit(f, QUOTIENT32_RUNENDS, last - 1, 0);
+        quotient32_set_bit(f, QUOTIENT32_RUNENDS, last, at_end);
+    }
+    for (uint64_t i = first; i <= last; i++) {
+        quotient32_set(f, i, rem << QUOTIENT32_COUNT_BITS | (total & QUOTIENT32_COUNT_MAX));
+        total >>= QUOTIENT32_COUNT_BITS;
+    }
+    return 0;
+}
+
+/* The first occupied quotient from q on, or nslots */
+static inline uint64_t quotient32_next_occupied(const struct quotient32 *f, uint64_t q) {
+    while (q < f->nslots) {
+        const uint64_t w = quotient32_block(f, q / 64)[QUOTIENT32_OCCUPIEDS] >> (q % 64);
+
+        if (w != 0) {
+            return q + (uint64_t)QUOTIENT32_CTZ64(w);
+        }
+        q = (q / 64 + 1) * 64;
+    }
+    return f->nslots;
+}
+
+static int quotient32_alloc(struct quotient32 *f, unsigned int qbits, const uint64_t seed) {
+    qbits = qbits < QUOTIENT32_MIN_QBITS ? QUOTIENT32_MIN_QBITS : qbits;
+    f->qbits = qbits;
+    f->rbits = 32 - qbits;
+    f->width = f->rbits + QUOTIENT32_COUNT_BITS;
+    f->block_words = QUOTIENT32_SLOTS + f->width;
+    f->nslots = UINT64_C(1) << qbits;
+    /* Runs past the last quotient spill into overflow blocks; the
+     * longest runs grow about as the square root of the slots
+     */
+    f->nblocks = f->nslots / 64 + (UINT64_C(1) << (qbits / 2)) / 8 + 2;
+    f->words = (uint64_t *)calloc((size_t)(f->nblocks * f->block_words), sizeof(uint64_t));
+    if (f->words == NULL) {
+        return QUOTIENT32_ERR_MEMORY;
+    }
+    f->used = 0;
+    f->grow_at = (uint64_t)((double)f->nslots * QUOTIENT32_MAX_LOAD);
+    f->seed = seed;
+    return 0;
+}
+
+/*------------------------------------------------------------ */
+
+/* Quotient32 filter functions */
+
+/* Size the filter for n distinct keys.  Returns 0, or -1 if out of memory. */
+static int Quotient32_init(struct quotient32 *f, const uint64_t n, const uint64_t seed) {
+    unsigned int qbits = QUOTIENT32_MIN_QBITS;
+
+    while (qbits < QUOTIENT32_MAX_QBITS &&
+           (double)n > (double)(UINT64_C(1) << qbits) * QUOTIENT32_MAX_LOAD) {
+        qbits++;
+    }
+    return quotient32_alloc(f, qbits, seed);
+}
+
+static void Quotient32_free(struct quotient32 *f) {
+    free(f->words);
+    f->words = NULL;
+    f->used = 0;
+}
+
+static inline uint32_t Quotient32_hash(const struct quotient32 *f, const void *key,
+                                       const size_t len) {
+    return Combo32(key, len, f->seed);
+}
+
+static inline void Quotient32_iter_init(const struct quotient32 *f, struct quotient32_iter *it) {
+    it->quotient = quotient32_next_occupied(f, 0);
+    it->pos = it->quotient;
+}
+
+/* The next hash in order and its count.  Returns 1, or 0 at the end. */
+static int Quotient32_next(const struct quotient32 *f, struct quotient32_iter *it,
+                           uint32_t *hash, uint64_t *count) {
+    do {
+        const uint64_t p = it->pos;
+        uint64_t s = p;
+        uint64_t rem;
+
+        if (it->quotient >= f->nslots) {
+            return 0;
+        }
+        rem = quotient32_get(f, s) >> QUOTIENT32_COUNT_BITS;
+        while (!quotient32_bit(f, QUOTIENT32_RUNENDS, s) &&
+               quotient32_get(f, s + 1) >> QUOTIENT32_COUNT_BITS == rem) {
+            s++;
+        }
+        *count = quotient32_decode(f, p, s);
+        *hash = (uint32_t)(it->quotient << f->rbits | rem);
+        if (quotient32_bit(f, QUOTIENT32_RUNENDS, s)) {
+            it->quotient = quotient32_next_occupied(f, it->quotient + 1);
+            it->pos = it->quotient > s + 1 ? it->quotient : s + 1;
+        } else {
+            it->pos = s + 1;
+        }
+        /* An insert that ran out of room can leave a count of 0 */
+    } while (*count == 0);
+    return 1;
+}
+
+/* Move everything to a new table of 2^qbits slots, or more if the runs
+ * do not fit.  Returns 0, or -1 if out of memory.
+ */
+static int Quotient32_resize(struct quotient32 *f, unsigned int qbits) {
+    struct quotient32 g;
+
+    for (;; qbits++) {
+        struct quotient32_iter it;
+        uint32_t hash;
+        uint64_t count;
+        int full = 0;
+
+        if (qbits > QUOTIENT32_MAX_QBITS ||
+            quotient32_alloc(&g, qbits, f->seed) != 0) {
+            return QUOTIENT32_ERR_MEMORY;
+        }
+        Quotient32_iter_init(f, &it);
+        while (!full && Quotient32_next(f, &it, &hash, &count)) {
+            full = quotient32_add(&g, hash, count) != 0;
+        }
+        if (!full) {
+            break;
+        }
+        Quotient32_free(&g);
+    }
+    Quotient32_free(f);
+    *f = g;
+    return 0;
+}
+
+/* Add count to a hash's count, doubling the filter when it is full.
+ * Returns 0, or -1 if out of memory.
+ */
+static int Quotient32_insert_hash(struct quotient32 *f, const uint32_t hash, uint64_t count) {
+    for (;;) {
+        if (f->used >= f->grow_at || quotient32_add(f, hash, count) != 0) {
+            if (Quotient32_resize(f, f->qbits + 1) != 0) {
+                return QUOTIENT32_ERR_MEMORY;
+            }
+            continue;
+        }
+        return 0;
+    }
+}
+
+static inline int Quotient32_insert(struct quotient32 *f, const void *key, const size_t len,
+                                    const uint64_t count) {
+    return Quotient32_insert_hash(f, Quotient32_hash(f, key, len), count);
+}
+
+/* How many times the hash was inserted, or 0 if never.  As with any
+ * filter, another key with the same Combo32 value adds to the count.
+ */
+static uint64_t Quotient32_count_hash(const struct quotient32 *f, const uint32_t hash) {
+    const uint64_t x = hash >> f->rbits;
+    const uint64_t rem = hash & ((UINT64_C(1) << f->rbits) - 1);
+    uint64_t p, last;
+
+    if (!quotient32_bit(f, QUOTIENT32_OCCUPIEDS, x)) {
+        return 0;
+    }
+    for (p = quotient32_run_start(f, x);; p++) {
+        const uint64_t r = quotient32_get(f, p) >> QUOTIENT32_COUNT_BITS;
+
+        if (r > rem) {
+            return 0;
+        }
+        if (r == rem) {
+            break;
+        }
+        if (quotient32_bit(f, QUOTIENT32_RUNENDS, p)) {
+            return 0;
+        }
+    }
+    last = p;
+    while (!quotient32_bit(f, QUOTIENT32_RUNENDS, last) &&
+           quotient32_get(f, last + 1) >> QUOTIENT32_COUNT_BITS == rem) {
+        last++;
+    }
+    return quotient32_decode(f, p, last);
+}
+
+static inline uint64_t Quotient32_count(const struct quotient32 *f, const void *key,
+                                        const size_t len) {
+    return Quotient32_count_hash(f, Quotient32_hash(f, key, len));
+}
+
+static inline int Quotient32_contains(const struct quotient32 *f, const void *key,
+                                      const size_t len) {
+    return Quotient32_count(f, key, len) != 0;
+}
+
+/* Set out to the union of a and b, adding up the counts of hashes in
+ * both, walking the two in order.  a and b must use the same seed.
+ * Returns 0 or a negative QUOTIENT32_ERR code.
+ */
+static int Quotient32_merge(struct quotient32 *out, const struct quotient32 *a,
+                            const struct quotient32 *b) {
+    struct quotient32_iter ia, ib;
+    uint32_t ha = 0, hb = 0;
+    uint64_t ca = 0, cb = 0;
+    int more_a, more_b;
+
+    if (a->seed != b->seed) {
+        return QUOTIENT32_ERR_HASHER;
+    }
+    if (Quotient32_init(out, a->used + b->used, a->seed) != 0) {
+        return QUOTIENT32_ERR_MEMORY;
+    }
+    Quotient32_iter_init(a, &ia);
+    Quotient32_iter_init(b, &ib);
+    more_a = Quotient32_next(a, &ia, &ha, &ca);
+    more_b = Quotient32_next(b, &ib, &hb, &cb);
+    while (more_a || more_b) {
+        int err;
+
+        if (more_a && (!more_b || ha < hb)) {
+            err = Quotient32_insert_hash(out, ha, ca);
+            more_a = Quotient32_next(a, &ia, &ha, &ca);
+        } else if (more_b && (!more_a || hb < ha)) {
+            err = Quotient32_insert_hash(out, hb, cb);
+            more_b = Quotient32_next(b, &ib, &hb, &cb);
+        } else {
+            err = Quotient32_insert_hash(out, ha, ca + cb);
+            more_a = Quotient32_next(a, &ia, &ha, &ca);
+            more_b = Quotient32_next(b, &ib, &hb, &cb);
+        }
+        if (err != 0) {
+            Quotient32_free(out);
+            return err;
+        }
+    }
+    return 0;
+}
+
+/* Fraction of the slots in use */
+static inline double Quotient32_load(const struct quotient32 *f) {
+    return (double)f->used / (double)f->nslots;
+}
+
+/* Size of the table in bytes */
+static inline size_t Quotient32_bytes(const struct quotient32 *f) {
+    return (size_t)(f->nblocks * f->block_words) * sizeof(uint64_t);
+}
+
+/*------------------------------------------------------------ */
+
+/* Quotient32 files */
+
+/* Write the filter to path.  Returns 0 or QUOTIENT32_ERR_IO. */
+static int Quotient32_write(const struct quotient32 *f, const char *path) {
+    struct quotient32_header h;
+    FILE *out = fopen(path, "wb");
+    int ok;
+
+    if (out == NULL) {
+        return QUOTIENT32_ERR_IO;
+    }
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, quotient32_magic, sizeof(h.magic));
+    h.format = QUOTIENT32_FORMAT;
+    h.byte_order = QUOTIENT32_BYTE_ORDER;
+    h.combo32_version = COMBO32_VERSION;
+    h.combo32_threshold = COMBO32_THRESHOLD;
+    h.seed = f->seed;
+    h.qbits = f->qbits;
+    h.count_bits = QUOTIENT32_COUNT_BITS;
+    h.nblocks = f->nblocks;
+    h.used = f->used;
+    ok = fwrite(&h, sizeof(h), 1, out) == 1 &&
+         fwrite(f->words, sizeof(uint64_t), (size_t)(f->nblocks * f->block_words), out) ==
+             (size_t)(f->nblocks * f->block_words);
+    if (fclose(out) != 0 || !ok) {
+        return QUOTIENT32_ERR_IO;
+    }
+    return 0;
+}
+
+/* Read a filter written by Quotient32_write.
+ * Returns 0 or a negative QUOTIENT32_ERR code.
+ */
+static int Quotient32_read(struct quotient32 *f, const char *path) {
+    struct quotient32_header h;
+    FILE *in = fopen(path, "rb");
+    int err = 0;
+
+    if (in == NULL) {
+        return QUOTIENT32_ERR_IO;
+    }
+    if (fread(&h, sizeof(h), 1, in) != 1) {
+        err = QUOTIENT32_ERR_FORMAT;
+    } else if (memcmp(h.magic, quotient32_magic, sizeof(h.magic)) != 0 ||
+               h.format != QUOTIENT32_FORMAT || h.byte_order != QUOTIENT32_BYTE_ORDER ||
+               h.count_bits != QUOTIENT32_COUNT_BITS ||
+               h.qbits < QUOTIENT32_MIN_QBITS || h.qbits > QUOTIENT32_MAX_QBITS) {
+        err = QUOTIENT32_ERR_FORMAT;
+    } else if (h.combo32_version != COMBO32_VERSION ||
+               h.combo32_threshold != COMBO32_THRESHOLD) {
+        err = QUOTIENT32_ERR_HASHER;
+    } else if ((err = quotient32_alloc(f, h.qbits, h.seed)) == 0) {
+        if (h.nblocks != f->nblocks ||
+            fread(f->words, sizeof(uint64_t), (size_t)(f->nblocks * f->block_words), in) !=
+                (size_t)(f->nblocks * f->block_words)) {
+            Quotient32_free(f);
+            err = QUOTIENT32_ERR_FORMAT;
+        } else {
+            f->used = h.used;
+        }
+    }
+    fclose(in);
+    return err;
+}
+
+#endif /* QUOTIENT32_H */
@@ -0,0 +1,165 @@
+/*
+ * Range32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Maps a 32-bit hash onto any number of buckets up to 2^32, for tables
+ * whose size is not a power of 2.
+ * The bucket is the high half of hash * nbuckets, one multiply instead
+ * of a division, and uses the high bits of the hash, which Combo32 mixes
+ * as well as the low ones.
+ * Batch versions reduce an array of hashes with SSE2 or AVX2.
+ * Table sizes come from a ladder of 8, 10, 12 and 14 times powers of 2,
+ * so each step grows by at most 1.25x and no primes are needed.
+ */
+
+#ifndef RANGE32_H
+#define RANGE32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* comment out the next line if you don't want SSE2 and AVX2 */
+#define RANGE32_USE_SIMD 1
+
+#if defined(RANGE32_USE_SIMD) && RANGE32_USE_SIMD && \
+    (defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #define RANGE32_SSE2 1
+  #include <emmintrin.h>
+  #if defined(__AVX2__)
+    #define RANGE32_AVX2 1
+    #include <immintrin.h>
+  #endif
+#endif
+
+/* The smallest size, and the top of the ladder */
+#define RANGE32_MIN_SIZE 8
+#define RANGE32_MAX_SIZE UINT64_C(0x100000000)
+
+/*------------------------------------------------------------ */
+
+/* Range32 reduction */
+
+/* Bucket of hash in a table of nbuckets, 1 to 2^32 */
+static inline uint32_t Range32_reduce(const uint32_t hash, const uint64_t nbuckets) {
+    return (uint32_t)(((uint64_t)hash * nbuckets) >> 32);
+}
+
+/* Bucket of hash in a table of nbuckets, a power of 2, for comparison */
+static inline uint32_t Range32_mask(const uint32_t hash, const uint64_t nbuckets) {
+    return hash & (uint32_t)(nbuckets - 1);
+}
+
+/* out[i] = Range32_reduce(hashes[i], nbuckets) for i < n.
+ * out may be the same array as hashes.
+ * nbuckets must be below 2^32 here, so that it fits a 32-bit lane.
+ */
+static void Range32_reduce_batch(const uint32_t *hashes, const size_t n,
+                                 const uint32_t nbuckets, uint32_t *out) {
+    size_t i = 0;
+
+#if defined(RANGE32_AVX2)
+    {
+        const __m256i nb = _mm256_set1_epi32((int)nbuckets);
+
+        /* _mm256_mul_epu32 multiplies the even lanes; shifting the odd
+         * lanes down handles them, and their products' high halves
+         * land back in the odd lanes
+         */
+        for (; i < n - n % 8; i += 8) {
+            const __m256i h = _mm256_loadu_si256((const __m256i *)(hashes + i));
+            const __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(h, nb), 32);
+            const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(h, 32), nb);
+
+            _mm256_storeu_si256((__m256i *)(out + i),
+                _mm256_blend_epi32(even, odd, 0xAA));
+        }
+    }
+#endif
+#if defined(RANGE32_SSE2)
+    {
+        const __m128i nb = _mm_set1_epi32((int)nbuckets);
+        const __m128i odd_lanes = _mm_set_epi32(-1, 0, -1, 0);
+
+        for (; i < n - n % 4; i += 4) {
+            const __m128i h = _mm_loadu_si128((const __m128i *)(hashes + i));
+            const __m128i even = _mm_srli_epi64(_mm_mul_epu32(h, nb), 32);
+            const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(h, 32), nb);
+
+            /* SSE2 has no blend */
+            _mm_storeu_si128((__m128i *)(out + i),
+                _mm_or_si128(_mm_andnot_si128(odd_lanes, even),
+                             _mm_and_si128(odd_lanes, odd)));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = Range32_reduce(hashes[i], nbuckets);
+    }
+}
+
+/*------------------------------------------------------------ */
+
+/* Range32 table sizes */
+
+/* The next size on the ladder above size: 8, 10, 12, 14, 16, 20, 24, ...
+ * Each step is 1.25x, 1.2x, 1.17x or 1.14x, and every size is a multiple
+ * of a quarter of the power of 2 below it, so it stays cache-line
+ * friendly.  Never returns more than RANGE32_MAX_SIZE.
+ */
+static inline uint64_t Range32_next_size(const uint64_t size) {
+    uint64_t p = RANGE32_MIN_SIZE;
+    uint64_t step;
+
+    if (size < RANGE32_MIN_SIZE) {
+        return RANGE32_MIN_SIZE;
+    }
+    /* p is the largest power of 2 <= size; the ladder steps by p/4 */
+    while (p * 2 <= size) {
+        p *= 2;
+    }
+    step = p / 4;
+    return size / step * step + step < RANGE32_MAX_SIZE
+           ? size / step * step + step : RANGE32_MAX_SIZE;
+}
+
+/* The smallest size on the ladder holding n keys at max_load, between
+ * 0 and 1.  Returns RANGE32_MAX_SIZE if nothing smaller is large enough.
+ */
+static inline uint64_t Range32_size_for(const uint64_t n, const double max_load) {
+    uint64_t size = RANGE32_MIN_SIZE;
+
+    while ((double)size * max_load < (double)n && size < RANGE32_MAX_SIZE) {
+        size = Range32_next_size(size);
+    }
+    return size;
+}
+
+/* The smallest power of 2 holding n keys at max_load, for comparison */
+static inline uint64_t Range32_pow2_for(const uint64_t n, const double max_load) {
+    uint64_t size = RANGE32_MIN_SIZE;
+
+    while ((double)size * max_load < (double)n && size < RANGE32_MAX_SIZE) {
+        size *= 2;
+    }
+    return size;
+}
+
+#endif /* RANGE32_H */
@@ -0,0 +1,504 @@
+/*
+ * Robin32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A Robin Hood linear-probing hash map keyed by byte strings.
+ * Each 8-byte slot holds the full 32-bit Combo32 value of its key next
+ * to the index of the key's entry in a dense entry array, so a lookup
+ * rejects nearly every mismatch without touching key bytes, and growing
+ * the map moves only slots and never calls Combo32 again.
+ * Erasing uses backward-shift deletion, so there are no tombstones, and
+ * the entry array stays dense, so iterating over it is a plain loop.
+ * The home slot is taken from the high bits of the hash.
+ * The map stores pointers to keys and values; the caller owns the
+ * memory they point to.
+ */
+
+#ifndef ROBIN32_H
+#define ROBIN32_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+#define ROBIN32_EMPTY UINT32_MAX
+#define ROBIN32_MIN_SLOTS 8
+#define ROBIN32_MAX_LOAD 0.95
+/* Probe distances of this and above share the last histogram bucket */
+#define ROBIN32_HIST 32
+/* Keys looked up together by Robin32_find_batch */
+#ifndef ROBIN32_BATCH
+#define ROBIN32_BATCH 32
+#endif
+
+struct robin32_slot {
+    uint32_t hash;
+    uint32_t index;        /* into entries, or ROBIN32_EMPTY */
+};
+
+struct robin32_entry {
+    const void *key;
+    size_t len;
+    void *value;
+    uint32_t hash;
+};
+
+struct robin32 {
+    struct robin32_slot *slots;
+    struct robin32_entry *entries;
+    size_t nslots;         /* always a power of 2 */
+    unsigned int shift;    /* 32 - log2(nslots) */
+    size_t size;           /* number of entries */
+    size_t capacity;       /* room in entries */
+    size_t grow_at;        /* size at which the slots are doubled */
+    double max_load;
+    uint64_t seed;
+};
+
+struct robin32_stats {
+    size_t size;
+    size_t nslots;
+    double load;
+    double mean;           /* mean probe distance, 0 in the home slot */
+    double variance;
+    uint32_t max;
+    uint64_t histogram[ROBIN32_HIST];
+};
+
+/*------------------------------------------------------------ */
+
+/* Robin32 helpers */
+
+static inline size_t robin32_home(const struct robin32 *m, const uint32_t hash) {
+    return (size_t)(hash >> m->shift);
+}
+
+static inline size_t robin32_distance(const struct robin32 *m, const size_t pos,
+                                      const uint32_t hash) {
+    return (pos - robin32_home(m, hash)) & (m->nslots - 1);
+}
+
+static size_t robin32_slots_for(const size_t n, const double max_load) {
+    size_t nslots = ROBIN32_MIN_SLOTS;
+
+    while ((double)nslots * max_load < (double)n + 1) {
+        nslots <<= 1;
+    }
+    return nslots;
+}
+
+static int robin32_alloc_slots(struct robin32 *m, const size_t nslots) {
+    unsigned int lg = 0;
+
+    m->slots = (struct robin32_slot *)malloc(nslots * sizeof(struct robin32_slot));
+    if (m->slots == NULL) {
+        return -1;
+    }
+    /* All ones marks every slot empty */
+    memset(m->slots, 0xFF, nslots * sizeof(struct robin32_slot));
+    while (((size_t)1 << lg) < nslots) {
+        lg++;
+    }
+    m->nslots = nslots;
+    m->shift = 32 - lg;
+    m->grow_at = (size_t)((double)nslots * m->max_load);
+    return 0;
+}
+
+/* Robin Hood insertion of a slot known not to be in the table.
+ * Whenever the carried slot is further from home than the resident one,
+ * they trade places.
+ */
+static inline void robin32_place(struct robin32 *m, struct robin32_slot carry) {
+    const size_t mask = m->nslots - 1;
+    size_t pos = robin32_home(m, carry.hash);
+    size_t dist = 0;
+
+    for (;;) {
+        struct robin32_slot *s = &m->slots[pos];
+        size_t d;
+
+        if (s->index == ROBIN32_EMPTY) {
+            *s = carry;
+            return;
+        }
+        d = robin32_distance(m, pos, s->hash);
+        if (d < dist) {
+            const struct robin32_slot tmp = *s;
+
+            *s = carry;
+            carry = tmp;
+            dist = d;
+        }
+        pos = (pos + 1) & mask;
+        dist++;
+    }
+}
+
+/* Position of the slot holding entry index, whose hash is hash */
+static inline size_t robin32_slot_of(const struct robin32 *m, const uint32_t hash,
+                                     const uint32_t index) {
+    size_t pos = robin32_home(m, hash);
+
+    while (m->slots[pos].index != index) {
+        pos = (pos + 1) & (m->nslots - 1);
+    }
+    return pos;
+}
+
+/* Empty the slot at pos by backward-shift deletion: the following slots
+ * move back one place until one is empty or already home.
+ */
+static inline void robin32_remove(struct robin32 *m, size_t pos) {
+    const size_t mask = m->nslots - 1;
+
+    for (;;) {
+        const size_t next = (pos + 1) & mask;
+        const struct robin32_slot s = m->slots[next];
+
+        if (s.index == ROBIN32_EMPTY || robin32_distance(m, next, s.hash) == 0) {
+            break;
+        }
+        m->slots[pos] = s;
+        pos = next;
+    }
+    m->slots[pos].hash = ROBIN32_EMPTY;
+    m->slots[pos].index = ROBIN32_EMPTY;
+}
+
+/*------------------------------------------------------------ */
+
+/* Robin32 map functions */
+
+/* max_load is the largest fraction of slots in use, up to 0.95;
+ * 0 selects 0.8.  Returns 0, or -1 if out of memory.
+ */
+static int Robin32_init(struct robin32 *m, const size_t capacity,
+                        double max_load, const uint64_t seed) {
+    if (max_load <= 0.0) {
+        max_load = 0.8;
+    } else if (max_load > ROBIN32_MAX_LOAD) {
+        max_load = ROBIN32_MAX_LOAD;
+    } else if (max_load < 0.25) {
+        max_load = 0.25;
+    }
+    m->max_load = max_load;
+    m->seed = seed;
+    m->size = 0;
+    m->capacity = capacity;
+    m->entries = NULL;
+    if (capacity != 0) {
+        m->entries = (struct robin32_entry *)malloc(capacity * sizeof(struct robin32_entry));
+        if (m->entries == NULL) {
+            return -1;
+        }
+    }
+    if (robin32_alloc_slots(m, robin32_slots_for(capacity, max_load)) != 0) {
+        free(m->entries);
+        return -1;
+    }
+    return 0;
+}
+
+static void Robin32_free(struct robin32 *m) {
+    free(m->slots);
+    free(m->entries);
+    m->slots = NULL;
+    m->entries = NULL;
+    m->nslots = 0;
+    m->size = 0;
+    m->capacity = 0;
+    m->grow_at = 0;
+}
+
+static inline uint32_t Robin32_hash(const struct robin32 *m, const void *key, const size_t len) {
+    return Combo32(key, len, m->seed);
+}
+
+/* Look up a key whose Combo32 value with the map's seed is already known.
+ * Returns NULL if the key is not in the map.
+ */
+static inline struct robin32_entry *Robin32_find_hash(const struct robin32 *m,
+                                                      const void *key,
+                                                      const size_t len,
+                                                      const uint32_t hash) {
+    const size_t mask = m->nslots - 1;
+    size_t pos = robin32_home(m, hash);
+    size_t dist = 0;
+
+    for (;;) {
+        const struct robin32_slot s = m->slots[pos];
+
+        /* Stop at an empty slot, or at one closer to home than we are,
+         * since the key would have displaced it
+         */
+        if (s.index == ROBIN32_EMPTY || robin32_distance(m, pos, s.hash) < dist) {
+            return NULL;
+        }
+        if (s.hash == hash) {
+            struct robin32_entry *e = &m->entries[s.index];
+
+            if (likely(e->len == len && memcmp(e->key, key, len) == 0)) {
+                return e;
+            }
+        }
+        pos = (pos + 1) & mask;
+        dist++;
+    }
+}
+
+static inline struct robin32_entry *Robin32_find(const struct robin32 *m,
+                                                 const void *key, const size_t len) {
+    return Robin32_find_hash(m, key, len, Robin32_hash(m, key, len));
+}
+
+/* Look up n keys at once, setting out[i] to the entry for keys[i] of
+ * length lens[i], or NULL.
+ * Up to ROBIN32_BATCH keys go through each stage together: hash them all
+ * and prefetch their home slots, then find each candidate slot and
+ * prefetch its entry, then prefetch the stored keys, then compare.
+ * The memory latency of one key is hidden behind the work on the others,
+ * which pays off once the map is larger than the last-level cache.
+ * A caller can use a smaller batch by passing n less than ROBIN32_BATCH.
+ */
+static void Robin32_find_batch(const struct robin32 *m,
+                               const void *const *keys,
+                               const size_t *lens,
+                               const size_t n,
+                               struct robin32_entry **out) {
+    const size_t mask = m->nslots - 1;
+    uint32_t hashes[ROBIN32_BATCH];
+    uint32_t index[ROBIN32_BATCH];
+
+    for (size_t base = 0; base < n; base += ROBIN32_BATCH) {
+        const size_t b = n - base < ROBIN32_BATCH ? n - base : ROBIN32_BATCH;
+        const void *const *k = keys + base;
+        const size_t *l = lens + base;
+        struct robin32_entry **o = out + base;
+
+        for (size_t i = 0; i < b; i++) {
+            hashes[i] = Combo32(k[i], l[i], m->seed);
+            prefetch(&m->slots[robin32_home(m, hashes[i])]);
+        }
+
+        /* The first slot with the same hash, or ROBIN32_EMPTY if the
+         * key is certainly missing
+         */
+        for (size_t i = 0; i < b; i++) {
+            size_t pos = robin32_home(m, hashes[i]);
+            size_t dist = 0;
+
+            index[i] = ROBIN32_EMPTY;
+            for (;;) {
+                const struct robin32_slot s = m->slots[pos];
+
+                if (s.index == ROBIN32_EMPTY || robin32_distance(m, pos, s.hash) < dist) {
+                    break;
+                }
+                if (s.hash == hashes[i]) {
+                    index[i] = s.index;
+                    prefetch(&m->entries[s.index]);
+                    break;
+                }
+                pos = (pos + 1) & mask;
+                dist++;
+            }
+        }
+
+        for (size_t i = 0; i < b; i++) {
+            if (index[i] != ROBIN32_EMPTY) {
+                prefetch(m->entries[index[i]].key);
+            }
+        }
+
+        for (size_t i = 0; i < b; i++) {
+            struct robin32_entry *e;
+
+            if (index[i] == ROBIN32_EMPTY) {
+                o[i] = NULL;
+                continue;
+            }
+            e = &m->entries[index[i]];
+            if (likely(e->len == l[i] && memcmp(e->key, k[i], l[i]) == 0)) {
+                o[i] = e;
+            } else {
+                /* The hashes collided; look further along */
+                o[i] = Robin32_find_hash(m, k[i], l[i], hashes[i]);
+            }
+        }
+    }
+}
+
+/* Rebuild the slots for at least n keys.
+ * Only the slots move; the stored hashes are reused, so neither
+ * Combo32 nor the keys are touched.
+ * Returns 0, or -1 if out of memory, in which case the map is unchanged.
+ */
+static int Robin32_rehash(struct robin32 *m, size_t n) {
+    struct robin32 old = *m;
+
+    if (n < m->size) {
+        n = m->size;
+    }
+    if (robin32_alloc_slots(m, robin32_slots_for(n, m->max_load)) != 0) {
+        *m = old;
+        return -1;
+    }
+    for (size_t i = 0; i < old.nslots; i++) {
+        if (old.slots[i].index != ROBIN32_EMPTY) {
+            robin32_place(m, old.slots[i]);
+        }
+    }
+    free(old.slots);
+    return 0;
+}
+
+/* Make room for n keys without further rehashing */
+static int Robin32_reserve(struct robin32 *m, const size_t n) {
+    if (n > m->capacity) {
+        struct robin32_entry *e = (struct robin32_entry *)
+            realloc(m->entries, n * sizeof(struct robin32_entry));
+
+        if (e == NULL) {
+            return -1;
+        }
+        m->entries = e;
+        m->capacity = n;
+    }
+    if (n <= m->grow_at) {
+        return 0;
+    }
+    return Robin32_rehash(m, n);
+}
+
+/* Find a key, or add it if it is missing.
+ * *inserted is set to 1 if the key was added, in which case the entry's
+ * value is uninitialized, or 0 if it was already there.
+ * Returns the key's entry, or NULL if out of memory.
+ * Entry pointers stay valid until the next insert or erase.
+ */
+static struct robin32_entry *Robin32_insert_hash(struct robin32 *m,
+                                                 const void *key,
+                                                 const size_t len,
+                                                 const uint32_t hash,
+                                                 int *inserted) {
+    struct robin32_entry *e = Robin32_find_hash(m, key, len, hash);
+    struct robin32_slot s;
+
+    *inserted = 0;
+    if (e != NULL) {
+        return e;
+    }
+    if (unlikely(m->size >= ROBIN32_EMPTY - 1)) {
+        return NULL;
+    }
+    if (unlikely(m->size == m->capacity)) {
+        const size_t n = m->capacity < 8 ? 8 : m->capacity * 2;
+        struct robin32_entry *grown = (struct robin32_entry *)
+            realloc(m->entries, n * sizeof(struct robin32_entry));
+
+        if (grown == NULL) {
+            return NULL;
+        }
+        m->entries = grown;
+        m->capacity = n;
+    }
+    if (unlikely(m->size + 1 > m->grow_at) &&
+        Robin32_rehash(m, m->size + 1) != 0) {
+        return NULL;
+    }
+
+    e = &m->entries[m->size];
+    e->key = key;
+    e->len = len;
+    e->hash = hash;
+    s.hash = hash;
+    s.index = (uint32_t)m->size;
+    robin32_place(m, s);
+    m->size++;
+    *inserted = 1;
+    return e;
+}
+
+static inline struct robin32_entry *Robin32_insert(struct robin32 *m,
+                                                   const void *key,
+                                                   const size_t len,
+                                                   int *inserted) {
+    return Robin32_insert_hash(m, key, len, Robin32_hash(m, key, len), inserted);
+}
+
+/* Remove entry e, which must be an entry of this map.
+ * The following slots are shifted back one place until one is empty or
+ * already home, and the last entry moves into e's place to keep the
+ * entry array dense.
+ */
+static void Robin32_erase_entry(struct robin32 *m, struct robin32_entry *e) {
+    const uint32_t index = (uint32_t)(e - m->entries);
+    const uint32_t last = (uint32_t)(m->size - 1);
+
+    robin32_remove(m, robin32_slot_of(m, e->hash, index));
+
+    if (index != last) {
+        m->entries[index] = m->entries[last];
+        m->slots[robin32_slot_of(m, m->entries[index].hash, last)].index = index;
+    }
+    m->size--;
+}
+
+/* Returns 1 if the key was removed, 0 if it was not in the map */
+static inline int Robin32_erase(struct robin32 *m, const void *key, const size_t len) {
+    struct robin32_entry *e = Robin32_find(m, key, len);
+
+    if (e == NULL) {
+        return 0;
+    }
+    Robin32_erase_entry(m, e);
+    return 1;
+}
+
+/* Probe-distance statistics over every key in the map */
+static void Robin32_stats(const struct robin32 *m, struct robin32_stats *st) {
+    double sum = 0.0, sum2 = 0.0;
+
+    memset(st, 0, sizeof(*st));
+    st->size = m->size;
+    st->nslots = m->nslots;
+    st->load = (double)m->size / (double)m->nslots;
+    for (size_t pos = 0; pos < m->nslots; pos++) {
+        size_t d;
+
+        if (m->slots[pos].index == ROBIN32_EMPTY) {
+            continue;
+        }
+        d = robin32_distance(m, pos, m->slots[pos].hash);
+        sum += (double)d;
+        sum2 += (double)d * (double)d;
+        st->max = d > st->max ? (uint32_t)d : st->max;
+        st->histogram[d < ROBIN32_HIST ? d : ROBIN32_HIST - 1]++;
+    }
+    if (m->size != 0) {
+        st->mean = sum / (double)m->size;
+        st->variance = sum2 / (double)m->size - st->mean * st->mean;
+    }
+}
+
+#endif /* ROBIN32_H */
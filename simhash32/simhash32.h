@@ -0,0 +1,373 @@
+/*
+ * Simhash32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SimHash fingerprints of weighted token streams, written in C.
+ * Each token is hashed once with Combo32, or Combo32x2 for 64-bit
+ * fingerprints, and its weight is added to the sum of every bit its hash
+ * has set, eight bits at a time with AVX2 or four with SSE2.  A
+ * fingerprint bit is set when its sum is more than half the total weight,
+ * so similar streams get fingerprints a few bits apart.  An index of
+ * permuted, sorted tables finds the fingerprints within k bits of one.
+ */
+
+#ifndef SIMHASH32_H
+#define SIMHASH32_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* comment out the next line if you don't want SSE2 and AVX2 */
+#define SIMHASH32_USE_SIMD 1
+
+#if defined(SIMHASH32_USE_SIMD) && SIMHASH32_USE_SIMD && \
+    (defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #define SIMHASH32_SSE2 1
+  #include <emmintrin.h>
+  #if defined(__AVX2__)
+    #define SIMHASH32_AVX2 1
+    #include <immintrin.h>
+  #endif
+#endif
+
+#if defined(__GNUC__)
+  #define SIMHASH32_POPCOUNT64(x) __builtin_popcountll(x)
+#else
+  static inline int SIMHASH32_POPCOUNT64(uint64_t x) {
+      int n = 0;
+
+      while (x != 0) {
+          x &= x - 1;
+          n++;
+      }
+      return n;
+  }
+#endif
+
+/* Tokens hashed at a time by Simhash32_add_batch */
+#define SIMHASH32_BATCH 64
+/* Most bits an index finds fingerprints within; it keeps k + 1 tables */
+#define SIMHASH32_MAX_K 7
+
+/* Errors; all are negative */
+#define SIMHASH32_ERR_MEMORY -1
+#define SIMHASH32_ERR_SIZE   -2    /* bits not 32 or 64, or k over SIMHASH32_MAX_K */
+
+struct simhash32 {
+    float sum[64];                 /* weight of the tokens with each bit set */
+    float total;                   /* weight of all the tokens */
+    unsigned int bits;             /* 32 or 64 */
+    uint64_t seed;
+};
+
+struct simhash32_entry {
+    uint64_t key;                  /* the fingerprint, turned so a block is on top */
+    uint32_t id;
+    uint32_t unused;
+};
+
+struct simhash32_index {
+    struct simhash32_entry *tables; /* k + 1 tables of n entries */
+    size_t n;
+    unsigned int bits;
+    unsigned int k;
+    unsigned int start[SIMHASH32_MAX_K + 2]; /* block t is bits start[t] to start[t + 1] - 1 */
+};
+
+/*------------------------------------------------------------ */
+
+/* Simhash32 helpers */
+
+/* Add w[i] to sum[b] for every bit b set in hash[i], for the lowest
+ * groups * 8 bits; groups is a constant where this is inlined, so the
+ * sums stay in registers
+ */
+static inline void simhash32_accumulate(float *sum, const uint64_t *hash, const float *w,
+                                        const size_t n, const unsigned int groups) {
+#if defined(SIMHASH32_AVX2)
+    const __m256i bit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256 acc[8];
+
+    for (unsigned int g = 0; g < groups; g++) {
+        acc[g] = _mm256_loadu_ps(sum + 8 * g);
+    }
+    for (size_t i = 0; i < n; i++) {
+        const __m256 weight = _mm256_set1_ps(w[i]);
+
+        for (unsigned int g = 0; g < groups; g++) {
+            const __m256i v = _mm256_and_si256(_mm256_set1_epi32((int)(hash[i] >> (8 * g))), bit);
+            const __m256 set = _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, bit));
+
+            acc[g] = _mm256_add_ps(acc[g], _mm256_and_ps(set, weight));
+        }
+    }
+    for (unsigned int g = 0; g < groups; g++) {
+        _mm256_storeu_ps(sum + 8 * g, acc[g]);
+    }
+#elif defined(SIMHASH32_SSE2)
+    const __m128i bit = _mm_setr_epi32(1, 2, 4, 8);
+    __m128 acc[16];
+
+    for (unsigned int g = 0; g < 2 * groups; g++) {
+        acc[g] = _mm_loadu_ps(sum + 4 * g);
+    }
+    for (size_t i = 0; i < n; i++) {
+        const __m128 weight = _mm_set1_ps(w[i]);
+
+        for (unsigned int g = 0; g < 2 * groups; g++) {
+            const __m128i v = _mm_and_si128(_mm_set1_epi32((int)(hash[i] >> (4 * g))), bit);
+            const __m128 set = _mm_castsi128_ps(_mm_cmpeq_epi32(v, bit));
+
+            acc[g] = _mm_add_ps(acc[g], _mm_and_ps(set, weight));
+        }
+    }
+    for (unsigned int g = 0; g < 2 * groups; g++) {
+        _mm_storeu_ps(sum + 4 * g, acc[g]);
+    }
+#else
+    for (size_t i = 0; i < n; i++) {
+        for (unsigned int b = 0; b < 8 * groups; b++) {
+            sum[b] += (hash[i] >> b & 1) != 0 ? w[i] : 0.0f;
+        }
+    }
+#endif
+}
+
+/* Rotate the low bits bits of x left by r, up to bits */
+static inline uint64_t simhash32_rotl(const uint64_t x, unsigned int r,
+                                      const unsigned int bits) {
+    const uint64_t mask = UINT64_MAX >> (64 - bits);
+
+    r %= bits;
+    return r == 0 ? x : ((x << r) | (x >> (bits - r))) & mask;
+}
+
+/* The fingerprint turned so that block t is its top bits, in the top bits
+ * of the key
+ */
+static inline uint64_t simhash32_key(const struct simhash32_index *x, const unsigned int t,
+                                     const uint64_t fp) {
+    return simhash32_rotl(fp, x->bits - x->start[t + 1], x->bits) << (64 - x->bits);
+}
+
+/* Whether a and b have the same block t */
+static inline int simhash32_same_block(const struct simhash32_index *x, const unsigned int t,
+                                       const uint64_t a, const uint64_t b) {
+    const unsigned int width = x->start[t + 1] - x->start[t];
+
+    return (((a ^ b) >> x->start[t]) & (UINT64_MAX >> (64 - width))) == 0;
+}
+
+static int simhash32_compare_entry(const void *a, const void *b) {
+    const uint64_t x = ((const struct simhash32_entry *)a)->key;
+    const uint64_t y = ((const struct simhash32_entry *)b)->key;
+
+    return (x > y) - (x < y);
+}
+
+/*------------------------------------------------------------ */
+
+/* Simhash32 fingerprint functions */
+
+/* Start a fingerprint of bits, 32 or 64, bits.
+ * Returns 0 or SIMHASH32_ERR_SIZE.
+ */
+static int Simhash32_init(struct simhash32 *s, const unsigned int bits, const uint64_t seed) {
+    if (bits != 32 && bits != 64) {
+        return SIMHASH32_ERR_SIZE;
+    }
+    memset(s->sum, 0, sizeof(s->sum));
+    s->total = 0.0f;
+    s->bits = bits;
+    s->seed = seed;
+    return 0;
+}
+
+/* Start another fingerprint of the same size and seed */
+static void Simhash32_clear(struct simhash32 *s) {
+    memset(s->sum, 0, sizeof(s->sum));
+    s->total = 0.0f;
+}
+
+static inline uint64_t Simhash32_hash(const struct simhash32 *s, const void *token,
+                                      const size_t len) {
+    if (s->bits == 64) {
+        uint32_t h1, h2;
+
+        Combo32x2(token, len, s->seed, &h1, &h2);
+        return (uint64_t)h1 << 32 | h2;
+    }
+    return Combo32(token, len, s->seed);
+}
+
+/* Add a token, by its Simhash32_hash, with weight w */
+static inline void Simhash32_add_hash(struct simhash32 *s, const uint64_t hash, const float w) {
+    if (s->bits == 64) {
+        simhash32_accumulate(s->sum, &hash, &w, 1, 8);
+    } else {
+        simhash32_accumulate(s->sum, &hash, &w, 1, 4);
+    }
+    s->total += w;
+}
+
+static inline void Simhash32_add(struct simhash32 *s, const void *token, const size_t len,
+                                 const float w) {
+    Simhash32_add_hash(s, Simhash32_hash(s, token, len), w);
+}
+
+/* Add n tokens, tokens[i] with weight weights[i], or 1 each if weights
+ * is NULL, hashing SIMHASH32_BATCH at a time and keeping the sums in
+ * registers over each batch
+ */
+static void Simhash32_add_batch(struct simhash32 *s, const void *const *tokens,
+                                const size_t *lens, const float *weights, const size_t n) {
+    uint64_t hash[SIMHASH32_BATCH];
+    float w[SIMHASH32_BATCH];
+
+    for (size_t base = 0; base < n; base += SIMHASH32_BATCH) {
+        const size_t b = n - base < SIMHASH32_BATCH ? n - base : SIMHASH32_BATCH;
+
+        for (size_t i = 0; i < b; i++) {
+            hash[i] = Simhash32_hash(s, tokens[base + i], lens[base + i]);
+            w[i] = weights != NULL ? weights[base + i] : 1.0f;
+            s->total += w[i];
+        }
+        if (s->bits == 64) {
+            simhash32_accumulate(s->sum, hash, w, b, 8);
+        } else {
+            simhash32_accumulate(s->sum, hash, w, b, 4);
+        }
+    }
+}
+
+/* The fingerprint of the tokens added so far */
+static uint64_t Simhash32_final(const struct simhash32 *s) {
+    uint64_t fp = 0;
+
+    for (unsigned int b = 0; b < s->bits; b++) {
+        fp |= (uint64_t)(2.0f * s->sum[b] > s->total) << b;
+    }
+    return fp;
+}
+
+/* The number of bits two fingerprints differ in */
+static inline unsigned int Simhash32_distance(const uint64_t a, const uint64_t b) {
+    return (unsigned int)SIMHASH32_POPCOUNT64(a ^ b);
+}
+
+/*------------------------------------------------------------ */
+
+/* Simhash32 index functions */
+
+/* Index n fingerprints of bits bits, fps[i] under id i, to find those
+ * within k bits of a query.  The bits are cut into k + 1 blocks, of
+ * which any fingerprint within k bits matches the query in at least one,
+ * and table t holds the fingerprints turned so that block t is on top,
+ * sorted, so the fingerprints matching in it are one range.
+ * Returns 0 or a negative SIMHASH32_ERR code.
+ */
+static int Simhash32_index_build(struct simhash32_index *x, const uint64_t *fps, const size_t n,
+                                 const unsigned int bits, const unsigned int k) {
+    if ((bits != 32 && bits != 64) || k > SIMHASH32_MAX_K) {
+        return SIMHASH32_ERR_SIZE;
+    }
+    x->tables = (struct simhash32_entry *)malloc((n * (k + 1) + 1) *
+                                                 sizeof(struct simhash32_entry));
+    if (x->tables == NULL) {
+        return SIMHASH32_ERR_MEMORY;
+    }
+    x->n = n;
+    x->bits = bits;
+    x->k = k;
+    for (unsigned int t = 0; t <= k + 1; t++) {
+        x->start[t] = bits * t / (k + 1);
+    }
+    for (unsigned int t = 0; t <= k; t++) {
+        struct simhash32_entry *table = x->tables + t * n;
+
+        for (size_t i = 0; i < n; i++) {
+            table[i].key = simhash32_key(x, t, fps[i]);
+            table[i].id = (uint32_t)i;
+            table[i].unused = 0;
+        }
+        qsort(table, n, sizeof(struct simhash32_entry), simhash32_compare_entry);
+    }
+    return 0;
+}
+
+static void Simhash32_index_free(struct simhash32_index *x) {
+    free(x->tables);
+    x->tables = NULL;
+    x->n = 0;
+}
+
+/* Find the ids of the fingerprints within k bits of fp, setting the first
+ * max of them in out, each once.  Returns how many there are.
+ */
+static size_t Simhash32_index_query(const struct simhash32_index *x, const uint64_t fp,
+                                    uint32_t *out, const size_t max) {
+    size_t found = 0;
+
+    for (unsigned int t = 0; t <= x->k; t++) {
+        const struct simhash32_entry *table = x->tables + t * x->n;
+        const unsigned int width = x->start[t + 1] - x->start[t];
+        const uint64_t key = simhash32_key(x, t, fp);
+        const uint64_t prefix = key >> (64 - width);
+        size_t lo = 0, hi = x->n;
+
+        /* The first entry whose top width bits are at least the query's */
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+
+            if (table[mid].key >> (64 - width) < prefix) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        for (; lo < x->n && table[lo].key >> (64 - width) == prefix; lo++) {
+            /* Turn it back */
+            const uint64_t other = simhash32_rotl(table[lo].key >> (64 - x->bits),
+                                                  x->start[t + 1], x->bits);
+            unsigned int earlier = 0;
+
+            if (Simhash32_distance(fp, other) > x->k) {
+                continue;
+            }
+            /* Report it from the first table it matches in */
+            for (unsigned int u = 0; u < t && !earlier; u++) {
+                earlier = simhash32_same_block(x, u, fp, other);
+            }
+            if (!earlier) {
+                if (found < max) {
+                    out[found] = table[lo].id;
+                }
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+#endif /* SIMHASH32_H */
@@ -0,0 +1,528 @@
+/*
+ * Swiss32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A flat open-addressing hash map keyed by byte strings, in the style
+ * of the "Swiss table".  Slots are arranged in groups of 16, each with
+ * 16 control bytes.  The 32-bit Combo32 value is split into a 7-bit tag,
+ * kept in the control byte, and a group index, and a lookup compares
+ * all 16 control bytes of a group at once (SSE2, or portable 64-bit
+ * arithmetic elsewhere).
+ * Each slot keeps the full 32-bit hash, so most mismatches are rejected
+ * without touching the key bytes, and growing the map never calls
+ * Combo32 again.
+ * The map stores pointers to keys and values; the caller owns the
+ * memory they point to.
+ */
+
+#ifndef SWISS32_H
+#define SWISS32_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* comment out the next line if you don't want SSE2 and AVX2 */
+#define SWISS32_USE_SIMD 1
+
+#if defined(SWISS32_USE_SIMD) && SWISS32_USE_SIMD && \
+    (defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #define SWISS32_SSE2 1
+  #include <emmintrin.h>
+  #if defined(__AVX2__)
+    #define SWISS32_AVX2 1
+    #include <immintrin.h>
+  #endif
+#endif
+
+#if defined(__GNUC__)
+  #define SWISS32_CTZ(x) __builtin_ctz(x)
+#else
+  static inline int SWISS32_CTZ(uint32_t x) {
+      int n = 0;
+
+      while ((x & 1) == 0) {
+          x >>= 1;
+          n++;
+      }
+      return n;
+  }
+#endif
+
+#define SWISS32_GROUP   16
+#define SWISS32_EMPTY   ((uint8_t)0x80)
+#define SWISS32_DELETED ((uint8_t)0xFE)
+/* Full control bytes hold the tag, 0 to 0x7F */
+
+/* Keys looked up together by Swiss32_find_batch */
+#ifndef SWISS32_BATCH
+#define SWISS32_BATCH 32
+#endif
+
+struct swiss32_slot {
+    const void *key;
+    size_t len;
+    void *value;
+    uint32_t hash;
+};
+
+struct swiss32 {
+    uint8_t *ctrl;                 /* ngroups * 16 control bytes */
+    struct swiss32_slot *slots;    /* ngroups * 16 slots */
+    size_t ngroups;                /* always a power of 2 */
+    size_t size;                   /* number of keys */
+    size_t growth_left;            /* empty slots left before a rehash */
+    uint64_t seed;
+};
+
+/*------------------------------------------------------------ */
+
+/* Control byte matching.
+ * Each function returns a 16-bit mask with bit i set if control byte i
+ * of the group matches.  swiss32_match() may report false positives in
+ * the portable version, which the hash comparison filters out.
+ */
+
+#if defined(SWISS32_SSE2)
+
+static inline uint32_t swiss32_match(const uint8_t *ctrl, const uint8_t tag) {
+    const __m128i c = _mm_loadu_si128((const __m128i *)ctrl);
+
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8((char)tag)));
+}
+
+static inline uint32_t swiss32_match_empty(const uint8_t *ctrl) {
+    const __m128i c = _mm_loadu_si128((const __m128i *)ctrl);
+
+    return (uint32_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(c, _mm_set1_epi8((char)SWISS32_EMPTY)));
+}
+
+/* Empty and deleted bytes are the only ones with the top bit set */
+static inline uint32_t swiss32_match_free(const uint8_t *ctrl) {
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+
+#else
+
+#define SWISS32_LSBS UINT64_C(0x0101010101010101)
+#define SWISS32_MSBS UINT64_C(0x8080808080808080)
+
+/* Gather the top bit of each byte of two words into a 16-bit mask */
+static inline uint32_t swiss32_pack(const uint64_t lo, const uint64_t hi) {
+    const uint64_t m = UINT64_C(0x0002040810204081);
+
+    return (uint32_t)(((lo & SWISS32_MSBS) * m) >> 56) |
+           ((uint32_t)(((hi & SWISS32_MSBS) * m) >> 56) << 8);
+}
+
+static inline void swiss32_load(const uint8_t *ctrl, uint64_t *lo, uint64_t *hi) {
+    memcpy(lo, ctrl, 8);
+    memcpy(hi, ctrl + 8, 8);
+  #if defined(BIG_ENDIAN)
+    *lo = BSWAP64(*lo);
+    *hi = BSWAP64(*hi);
+  #endif
+}
+
+static inline uint32_t swiss32_match(const uint8_t *ctrl, const uint8_t tag) {
+    const uint64_t t = SWISS32_LSBS * tag;
+    uint64_t lo, hi;
+
+    swiss32_load(ctrl, &lo, &hi);
+    lo ^= t;
+    hi ^= t;
+    return swiss32_pack((lo - SWISS32_LSBS) & ~lo, (hi - SWISS32_LSBS) & ~hi);
+}
+
+/* Top bit set and bit 1 clear is 0x80, the empty byte */
+static inline uint32_t swiss32_match_empty(const uint8_t *ctrl) {
+    uint64_t lo, hi;
+
+    swiss32_load(ctrl, &lo, &hi);
+    return swiss32_pack(lo & ~(lo << 6), hi & ~(hi << 6));
+}
+
+static inline uint32_t swiss32_match_free(const uint8_t *ctrl) {
+    uint64_t lo, hi;
+
+    swiss32_load(ctrl, &lo, &hi);
+    return swiss32_pack(lo, hi);
+}
+
+#endif /* SWISS32_SSE2 */
+
+/*------------------------------------------------------------ */
+
+/* Swiss32 helpers */
+
+static inline uint8_t swiss32_tag(const uint32_t hash) {
+    return (uint8_t)(hash & 0x7F);
+}
+
+static inline size_t swiss32_group(const uint32_t hash, const size_t ngroups) {
+    return (size_t)(hash >> 7) & (ngroups - 1);
+}
+
+/* The map is never more than 7/8 full */
+static inline size_t swiss32_max_load(const size_t ngroups) {
+    return ngroups * SWISS32_GROUP / 8 * 7;
+}
+
+static inline size_t swiss32_groups_for(const size_t n) {
+    size_t ngroups = 1;
+
+    while (swiss32_max_load(ngroups) < n) {
+        ngroups <<= 1;
+    }
+    return ngroups;
+}
+
+/* Index of the first empty or deleted slot on the probe sequence of hash.
+ * Groups are probed in triangular order, which visits every group
+ * because ngroups is a power of 2.
+ */
+static inline size_t swiss32_find_free(const struct swiss32 *m, const uint32_t hash) {
+    const size_t mask = m->ngroups - 1;
+    size_t g = swiss32_group(hash, m->ngroups);
+
+    for (size_t i = 1; ; i++) {
+        const uint32_t avail = swiss32_match_free(m->ctrl + g * SWISS32_GROUP);
+
+        if (likely(avail != 0)) {
+            return g * SWISS32_GROUP + (size_t)SWISS32_CTZ(avail);
+        }
+        g = (g + i) & mask;
+    }
+}
+
+static int swiss32_alloc(struct swiss32 *m, const size_t ngroups) {
+    const size_t nslots = ngroups * SWISS32_GROUP;
+
+    m->ctrl = (uint8_t *)malloc(nslots);
+    m->slots = (struct swiss32_slot *)malloc(nslots * sizeof(struct swiss32_slot));
+    if (m->ctrl == NULL || m->slots == NULL) {
+        free(m->ctrl);
+        free(m->slots);
+        return -1;
+    }
+    memset(m->ctrl, SWISS32_EMPTY, nslots);
+    m->ngroups = ngroups;
+    m->growth_left = swiss32_max_load(ngroups);
+    return 0;
+}
+
+/* Bit mask of the full slots among the 16 starting at ctrl */
+static inline uint32_t swiss32_match_full(const uint8_t *ctrl) {
+    return ~swiss32_match_free(ctrl) & 0xFFFF;
+}
+
+/*------------------------------------------------------------ */
+
+/* Swiss32 map functions */
+
+/* Returns 0, or -1 if out of memory */
+static int Swiss32_init(struct swiss32 *m, const size_t capacity, const uint64_t seed) {
+    m->size = 0;
+    m->seed = seed;
+    return swiss32_alloc(m, swiss32_groups_for(capacity));
+}
+
+static void Swiss32_free(struct swiss32 *m) {
+    free(m->ctrl);
+    free(m->slots);
+    m->ctrl = NULL;
+    m->slots = NULL;
+    m->ngroups = 0;
+    m->size = 0;
+    m->growth_left = 0;
+}
+
+static inline uint32_t Swiss32_hash(const struct swiss32 *m, const void *key, const size_t len) {
+    return Combo32(key, len, m->seed);
+}
+
+/* Look up a key whose Combo32 value with the map's seed is already known.
+ * Returns NULL if the key is not in the map.
+ */
+static inline struct swiss32_slot *Swiss32_find_hash(const struct swiss32 *m,
+                                                     const void *key,
+                                                     const size_t len,
+                                                     const uint32_t hash) {
+    const size_t mask = m->ngroups - 1;
+    const uint8_t tag = swiss32_tag(hash);
+    size_t g = swiss32_group(hash, m->ngroups);
+
+    for (size_t i = 1; ; i++) {
+        const uint8_t *ctrl = m->ctrl + g * SWISS32_GROUP;
+        uint32_t match = swiss32_match(ctrl, tag);
+
+        while (match != 0) {
+            struct swiss32_slot *s = &m->slots[g * SWISS32_GROUP + (size_t)SWISS32_CTZ(match)];
+
+            if (likely(s->hash == hash && s->len == len &&
+                       memcmp(s->key, key, len) == 0)) {
+                return s;
+            }
+            match &= match - 1;
+        }
+        /* A key is never stored past a group that has an empty slot */
+        if (likely(swiss32_match_empty(ctrl) != 0)) {
+            return NULL;
+        }
+        g = (g + i) & mask;
+    }
+}
+
+static inline struct swiss32_slot *Swiss32_find(const struct swiss32 *m,
+                                                const void *key, const size_t len) {
+    return Swiss32_find_hash(m, key, len, Swiss32_hash(m, key, len));
+}
+
+/* Look up n keys at once, setting out[i] to the slot for keys[i] of
+ * length lens[i], or NULL.
+ * Up to SWISS32_BATCH keys go through each stage together: hash them all
+ * and prefetch their first control group, then match the tags and
+ * prefetch the first candidate slot, then check its hash and prefetch
+ * the stored key, then compare.
+ * Keys whose first group does not settle the lookup fall back to
+ * Swiss32_find_hash.
+ * A caller can use a smaller batch by passing n less than SWISS32_BATCH.
+ */
+static void Swiss32_find_batch(const struct swiss32 *m,
+                               const void *const *keys,
+                               const size_t *lens,
+                               const size_t n,
+                               struct swiss32_slot **out) {
+    uint32_t hashes[SWISS32_BATCH];
+    uint32_t match[SWISS32_BATCH];
+
+    for (size_t base = 0; base < n; base += SWISS32_BATCH) {
+        const size_t b = n - base < SWISS32_BATCH ? n - base : SWISS32_BATCH;
+        const void *const *k = keys + base;
+        const size_t *l = lens + base;
+        struct swiss32_slot **o = out + base;
+
+        for (size_t i = 0; i < b; i++) {
+            hashes[i] = Combo32(k[i], l[i], m->seed);
+            prefetch(m->ctrl + swiss32_group(hashes[i], m->ngroups) * SWISS32_GROUP);
+        }
+
+        /* match[i] is 0 when the key is certainly missing */
+        for (size_t i = 0; i < b; i++) {
+            const size_t g = swiss32_group(hashes[i], m->ngroups);
+            const uint8_t *ctrl = m->ctrl + g * SWISS32_GROUP;
+
+            match[i] = swiss32_match(ctrl, swiss32_tag(hashes[i]));
+            if (match[i] != 0) {
+                prefetch(&m->slots[g * SWISS32_GROUP + (size_t)SWISS32_CTZ(match[i])]);
+            } else if (swiss32_match_empty(ctrl) == 0) {
+                /* The key may be in a later group */
+                match[i] = 1u << SWISS32_GROUP;
+            }
+        }
+
+        for (size_t i = 0; i < b; i++) {
+            if (match[i] != 0 && match[i] != 1u << SWISS32_GROUP) {
+                const size_t g = swiss32_group(hashes[i], m->ngroups);
+
+                prefetch(m->slots[g * SWISS32_GROUP + (size_t)SWISS32_CTZ(match[i])].key);
+            }
+        }
+
+        for (size_t i = 0; i < b; i++) {
+            if (match[i] == 0) {
+                o[i] = NULL;
+                continue;
+            }
+            if (match[i] != 1u << SWISS32_GROUP) {
+                const size_t g = swiss32_group(hashes[i], m->ngroups);
+                struct swiss32_slot *s =
+                    &m->slots[g * SWISS32_GROUP + (size_t)SWISS32_CTZ(match[i])];
+
+                if (likely(s->hash == hashes[i] && s->len == l[i] &&
+                           memcmp(s->key, k[i], l[i]) == 0)) {
+                    o[i] = s;
+                    continue;
+                }
+            }
+            o[i] = Swiss32_find_hash(m, k[i], l[i], hashes[i]);
+        }
+    }
+}
+
+/* Move every key into arrays sized for at least n keys.
+ * The stored hashes are reused, so Combo32 is not called.
+ * Returns 0, or -1 if out of memory, in which case the map is unchanged.
+ */
+static int Swiss32_rehash(struct swiss32 *m, size_t n) {
+    struct swiss32 old = *m;
+
+    if (n < m->size) {
+        n = m->size;
+    }
+    if (swiss32_alloc(m, swiss32_groups_for(n)) != 0) {
+        *m = old;
+        return -1;
+    }
+
+    for (size_t i = 0; i < old.ngroups * SWISS32_GROUP; ) {
+        uint32_t full;
+        size_t width;
+
+  #if defined(SWISS32_AVX2)
+        if (i + 32 <= old.ngroups * SWISS32_GROUP) {
+            full = ~(uint32_t)_mm256_movemask_epi8(
+                _mm256_loadu_si256((const __m256i *)(old.ctrl + i)));
+            width = 32;
+        } else
+  #endif
+        {
+            full = swiss32_match_full(old.ctrl + i);
+            width = SWISS32_GROUP;
+        }
+        while (full != 0) {
+            const size_t j = i + (size_t)SWISS32_CTZ(full);
+            const size_t k = swiss32_find_free(m, old.slots[j].hash);
+
+            m->ctrl[k] = swiss32_tag(old.slots[j].hash);
+            m->slots[k] = old.slots[j];
+            full &= full - 1;
+        }
+        i += width;
+    }
+    m->growth_left -= m->size;
+
+    free(old.ctrl);
+    free(old.slots);
+    return 0;
+}
+
+/* Make room for n keys without further rehashing */
+static inline int Swiss32_reserve(struct swiss32 *m, const size_t n) {
+    if (n <= m->size + m->growth_left) {
+        return 0;
+    }
+    return Swiss32_rehash(m, n);
+}
+
+/* Find a key, or add it if it is missing.
+ * *inserted is set to 1 if the key was added, in which case the slot's
+ * value is uninitialized, or 0 if it was already there.
+ * Returns the key's slot, or NULL if out of memory.
+ */
+static struct swiss32_slot *Swiss32_insert_hash(struct swiss32 *m,
+                                                const void *key,
+                                                const size_t len,
+                                                const uint32_t hash,
+                                                int *inserted) {
+    struct swiss32_slot *s = Swiss32_find_hash(m, key, len, hash);
+    size_t k;
+
+    *inserted = 0;
+    if (s != NULL) {
+        return s;
+    }
+
+    k = swiss32_find_free(m, hash);
+    if (unlikely(m->growth_left == 0 && m->ctrl[k] != SWISS32_DELETED)) {
+        /* Out of empty slots.  If deleted slots are taking up more than
+         * half the room, rehashing at the same size is enough.
+         */
+        const size_t n = m->size * 2 < swiss32_max_load(m->ngroups)
+                       ? swiss32_max_load(m->ngroups)
+                       : swiss32_max_load(m->ngroups) + 1;
+
+        if (Swiss32_rehash(m, n) != 0) {
+            return NULL;
+        }
+        k = swiss32_find_free(m, hash);
+    }
+
+    if (m->ctrl[k] == SWISS32_EMPTY) {
+        m->growth_left--;
+    }
+    m->ctrl[k] = swiss32_tag(hash);
+    s = &m->slots[k];
+    s->key = key;
+    s->len = len;
+    s->hash = hash;
+    m->size++;
+    *inserted = 1;
+    return s;
+}
+
+static inline struct swiss32_slot *Swiss32_insert(struct swiss32 *m,
+                                                  const void *key,
+                                                  const size_t len,
+                                                  int *inserted) {
+    return Swiss32_insert_hash(m, key, len, Swiss32_hash(m, key, len), inserted);
+}
+
+/* Remove the key in slot s, which must be a slot of this map.
+ * If the slot's group still has an empty slot, no lookup can have
+ * probed past it, so the slot becomes empty again instead of a
+ * tombstone.
+ */
+static inline void Swiss32_erase_slot(struct swiss32 *m, struct swiss32_slot *s) {
+    const size_t k = (size_t)(s - m->slots);
+    const uint8_t *ctrl = m->ctrl + (k & ~(size_t)(SWISS32_GROUP - 1));
+
+    if (swiss32_match_empty(ctrl) != 0) {
+        m->ctrl[k] = SWISS32_EMPTY;
+        m->growth_left++;
+    } else {
+        m->ctrl[k] = SWISS32_DELETED;
+    }
+    m->size--;
+}
+
+/* Returns 1 if the key was removed, 0 if it was not in the map */
+static inline int Swiss32_erase(struct swiss32 *m, const void *key, const size_t len) {
+    struct swiss32_slot *s = Swiss32_find(m, key, len);
+
+    if (s == NULL) {
+        return 0;
+    }
+    Swiss32_erase_slot(m, s);
+    return 1;
+}
+
+/* Iterate over the map.  Start with *pos = 0; returns NULL at the end.
+ * The map must not be changed during the iteration, except through
+ * Swiss32_erase_slot() on the slot just returned.
+ */
+static inline struct swiss32_slot *Swiss32_next(const struct swiss32 *m, size_t *pos) {
+    const size_t nslots = m->ngroups * SWISS32_GROUP;
+
+    while (*pos < nslots) {
+        const size_t i = (*pos)++;
+
+        if ((m->ctrl[i] & 0x80) == 0) {
+            return &m->slots[i];
+        }
+    }
+    return NULL;
+}
+
+#endif /* SWISS32_H */
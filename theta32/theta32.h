@@ -0,0 +1,596 @@
+/*
+ * Theta32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A Theta sketch of the distinct byte strings in a set, written in C,
+ * for estimating the sizes of unions, intersections and differences of
+ * huge sets.
+ * Each key is hashed into 64 bits with Combo32x2, and the sketch keeps
+ * the hashes below a threshold theta, in an open-addressing table; when
+ * the table is three quarters full, theta drops to the k + 1st smallest
+ * and only the k smallest are kept.  The count is the hashes kept over
+ * theta as a fraction of 2^64.  A batch of hashes is checked against
+ * theta with SSE2 or AVX2 before any reaches the table.
+ * Compact sketches, the kept hashes in order, are combined into others
+ * with sorted merges, and are stored in a flat byte form.
+ */
+
+#ifndef THETA32_H
+#define THETA32_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* comment out the next line if you don't want SSE2 and AVX2 */
+#define THETA32_USE_SIMD 1
+
+#if defined(THETA32_USE_SIMD) && THETA32_USE_SIMD && \
+    (defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #define THETA32_SSE2 1
+  #include <emmintrin.h>
+  #if defined(__AVX2__)
+    #define THETA32_AVX2 1
+    #include <immintrin.h>
+  #endif
+#endif
+
+#define THETA32_MIN_K 16
+#define THETA32_MAX_K (1 << 26)
+/* Keys hashed and checked against theta together by the batch function */
+#define THETA32_BATCH 64
+
+#define THETA32_FORMAT 1
+#define THETA32_BYTE_ORDER UINT32_C(0x01020304)
+
+/* Errors; all are negative */
+#define THETA32_ERR_MEMORY   -1
+#define THETA32_ERR_SIZE     -2     /* k out of range */
+#define THETA32_ERR_MISMATCH -3     /* combining sketches of another seed */
+#define THETA32_ERR_FORMAT   -4     /* not a Theta32 sketch, or another byte order */
+#define THETA32_ERR_HASHER   -5     /* stored with another Combo32 version or threshold */
+
+static const char theta32_magic[8] = { 'T', 'h', 'e', 't', 'a', '3', '2', 0 };
+
+/* The stored form is this header, then n hashes in ascending order */
+struct theta32_header {
+    char magic[8];
+    uint32_t format;
+    uint32_t byte_order;           /* THETA32_BYTE_ORDER as written */
+    uint32_t combo32_version;
+    uint32_t combo32_threshold;
+    uint64_t seed;
+    uint64_t theta;
+    uint64_t n;
+};
+
+/* Hashes 0 and above are never kept; with theta at UINT64_MAX, which it
+ * starts at, the sketch has every hash and the count is exact
+ */
+struct theta32 {
+    uint64_t *table;               /* the hashes below theta, 0 if free */
+    uint64_t *scratch;             /* limit hashes, for dropping theta */
+    size_t n;                      /* hashes in the table */
+    size_t slots;                  /* a power of 2, at least 2k */
+    size_t limit;                  /* n at which theta drops */
+    size_t k;
+    uint64_t theta;
+    uint64_t seed;
+};
+
+/* A sketch's hashes in order, for combining and storing */
+struct theta32_compact {
+    uint64_t *hashes;              /* ascending, all below theta */
+    size_t n;
+    uint64_t theta;
+    uint64_t seed;
+};
+
+/*------------------------------------------------------------ */
+
+/* Theta32 helpers */
+
+/* Whether the sketch keeps hash, which must be in [1, theta) */
+static inline int theta32_keeps(const uint64_t hash, const uint64_t theta) {
+    return hash - 1 < theta - 1;
+}
+
+#if defined(THETA32_SSE2) && !defined(THETA32_AVX2)
+/* The top bit of each 64-bit lane of the result is whether a < b,
+ * unsigned, from 32-bit compares since SSE2 has no 64-bit one
+ */
+static inline __m128i theta32_less_sse2(const __m128i a, const __m128i b) {
+    const __m128i sign = _mm_set1_epi32((int)0x80000000);
+    const __m128i x = _mm_xor_si128(a, sign);
+    const __m128i y = _mm_xor_si128(b, sign);
+    const __m128i gt = _mm_cmpgt_epi32(y, x);
+    const __m128i eq = _mm_cmpeq_epi32(x, y);
+
+    /* The high halves decide unless they are equal */
+    return _mm_or_si128(gt, _mm_and_si128(eq, _mm_slli_epi64(gt, 32)));
+}
+#endif
+
+/* Copy the hashes the sketch keeps at theta to out, in order, and
+ * return how many
+ */
+static size_t theta32_filter(const uint64_t *hash, const size_t n, const uint64_t theta,
+                             uint64_t *out) {
+    size_t i = 0, m = 0;
+
+#if defined(THETA32_AVX2)
+    {
+        /* Compare hash - 1 with theta - 1, signed after flipping the top bits */
+        const __m256i one = _mm256_set1_epi64x(1);
+        const __m256i sign = _mm256_set1_epi64x((long long)UINT64_C(0x8000000000000000));
+        const __m256i limit = _mm256_set1_epi64x((long long)((theta - 1) ^ UINT64_C(0x8000000000000000)));
+
+        for (; i + 4 <= n; i += 4) {
+            const __m256i h = _mm256_loadu_si256((const __m256i *)(hash + i));
+            const __m256i x = _mm256_xor_si256(_mm256_sub_epi64(h, one), sign);
+            unsigned int mask = (unsigned int)_mm256_movemask_pd(
+                _mm256_castsi256_pd(_mm256_cmpgt_epi64(limit, x)));
+
+            for (unsigned int j = 0; mask != 0; j++, mask >>= 1) {
+                if (mask & 1) {
+                    out[m++] = hash[i + j];
+                }
+            }
+        }
+    }
+#elif defined(THETA32_SSE2)
+    {
+        const __m128i one = _mm_set_epi32(0, 1, 0, 1);
+        const __m128i limit = _mm_set1_epi64x((long long)(theta - 1));
+
+        for (; i + 2 <= n; i += 2) {
+            const __m128i h = _mm_loadu_si128((const __m128i *)(hash + i));
+            const unsigned int mask = (unsigned int)_mm_movemask_pd(
+                _mm_castsi128_pd(theta32_less_sse2(_mm_sub_epi64(h, one), limit)));
+
+            if (mask & 1) {
+                out[m++] = hash[i];
+            }
+            if (mask & 2) {
+                out[m++] = hash[i + 1];
+            }
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (theta32_keeps(hash[i], theta)) {
+            out[m++] = hash[i];
+        }
+    }
+    return m;
+}
+
+/* Put a hash in [1, theta) in the table unless it is there; the low bits
+ * pick the slot, as the high ones are mostly 0 once theta drops
+ */
+static inline int theta32_insert(uint64_t *table, const size_t slots, const uint64_t hash) {
+    size_t s = (size_t)hash & (slots - 1);
+
+    for (;; s = (s + 1) & (slots - 1)) {
+        if (table[s] == 0) {
+            table[s] = hash;
+            return 1;
+        }
+        if (table[s] == hash) {
+            return 0;
+        }
+    }
+}
+
+/* Reorder a[0..n) so that a[k] is the k + 1st smallest, with the smaller
+ * ones before it; k < n
+ */
+static void theta32_select(uint64_t *a, const size_t n, const size_t k) {
+    size_t lo = 0, hi = n - 1;
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        uint64_t pivot, t;
+        size_t i = lo, j = hi;
+
+        /* Median of three */
+        if (a[mid] < a[lo]) { t = a[mid]; a[mid] = a[lo]; a[lo] = t; }
+        if (a[hi] < a[lo]) { t = a[hi]; a[hi] = a[lo]; a[lo] = t; }
+        if (a[hi] < a[mid]) { t = a[hi]; a[hi] = a[mid]; a[mid] = t; }
+        pivot = a[mid];
+        while (i <= j) {
+            while (a[i] < pivot) {
+                i++;
+            }
+            while (a[j] > pivot) {
+                j--;
+            }
+            if (i <= j) {
+                t = a[i]; a[i] = a[j]; a[j] = t;
+                i++;
+                if (j == 0) {
+                    break;
+                }
+                j--;
+            }
+        }
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            return;
+        }
+    }
+}
+
+/* Drop theta to the k + 1st smallest hash and keep the k below it */
+static void theta32_trim(struct theta32 *f) {
+    size_t m = 0;
+
+    for (size_t s = 0; s < f->slots; s++) {
+        if (f->table[s] != 0) {
+            f->scratch[m++] = f->table[s];
+        }
+    }
+    theta32_select(f->scratch, m, f->k);
+    f->theta = f->scratch[f->k];
+    memset(f->table, 0, f->slots * sizeof(uint64_t));
+    for (size_t i = 0; i < f->k; i++) {
+        theta32_insert(f->table, f->slots, f->scratch[i]);
+    }
+    f->n = f->k;
+}
+
+static inline double theta32_estimate(const size_t n, const uint64_t theta) {
+    if (theta == UINT64_MAX) {
+        return (double)n;
+    }
+    return (double)n / ((double)theta * 0x1p-64);
+}
+
+static int theta32_compare(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Set out to r, freeing out's hashes first if it is a or b */
+static void theta32_result(struct theta32_compact *out, const struct theta32_compact *a,
+                           const struct theta32_compact *b, const struct theta32_compact *r) {
+    if (out == a || out == b) {
+        free(out->hashes);
+    }
+    *out = *r;
+}
+
+/*------------------------------------------------------------ */
+
+/* Theta32 sketch functions */
+
+/* Make an empty sketch keeping the k smallest hashes, THETA32_MIN_K to
+ * THETA32_MAX_K.  Counts above k are off by about 1 / sqrt(k).
+ * Returns 0 or a negative THETA32_ERR code.
+ */
+static int Theta32_init(struct theta32 *f, const size_t k, const uint64_t seed) {
+    size_t slots = 2 * THETA32_MIN_K;
+
+    if (k < THETA32_MIN_K || k > THETA32_MAX_K) {
+        return THETA32_ERR_SIZE;
+    }
+    while (slots < 2 * k) {
+        slots *= 2;
+    }
+    f->slots = slots;
+    f->limit = slots / 4 * 3;
+    f->table = (uint64_t *)calloc(slots, sizeof(uint64_t));
+    f->scratch = (uint64_t *)malloc(f->limit * sizeof(uint64_t));
+    if (f->table == NULL || f->scratch == NULL) {
+        free(f->table);
+        free(f->scratch);
+        return THETA32_ERR_MEMORY;
+    }
+    f->n = 0;
+    f->k = k;
+    f->theta = UINT64_MAX;
+    f->seed = seed;
+    return 0;
+}
+
+static void Theta32_free(struct theta32 *f) {
+    free(f->table);
+    free(f->scratch);
+    f->table = NULL;
+    f->scratch = NULL;
+    f->n = 0;
+}
+
+static void Theta32_clear(struct theta32 *f) {
+    memset(f->table, 0, f->slots * sizeof(uint64_t));
+    f->n = 0;
+    f->theta = UINT64_MAX;
+}
+
+static inline uint64_t Theta32_hash(const struct theta32 *f, const void *key, const size_t len) {
+    uint32_t h1, h2;
+
+    Combo32x2(key, len, f->seed, &h1, &h2);
+    return (uint64_t)h1 << 32 | h2;
+}
+
+/* Add a key by its Theta32_hash */
+static inline void Theta32_add_hash(struct theta32 *f, const uint64_t hash) {
+    if (theta32_keeps(hash, f->theta) && theta32_insert(f->table, f->slots, hash) &&
+        ++f->n == f->limit) {
+        theta32_trim(f);
+    }
+}
+
+static inline void Theta32_add(struct theta32 *f, const void *key, const size_t len) {
+    Theta32_add_hash(f, Theta32_hash(f, key, len));
+}
+
+/* Add n keys by their Theta32_hash, checking each batch against theta
+ * first, so that once theta has dropped few reach the table
+ */
+static void Theta32_add_hashes(struct theta32 *f, const uint64_t *hashes, const size_t n) {
+    uint64_t kept[THETA32_BATCH];
+
+    for (size_t base = 0; base < n; base += THETA32_BATCH) {
+        const size_t b = n - base < THETA32_BATCH ? n - base : THETA32_BATCH;
+        const size_t m = theta32_filter(hashes + base, b, f->theta, kept);
+
+        for (size_t i = 0; i < m; i++) {
+            Theta32_add_hash(f, kept[i]);
+        }
+    }
+}
+
+/* Add n keys, with lengths lens */
+static void Theta32_add_batch(struct theta32 *f, const void *const *keys, const size_t *lens,
+                              const size_t n) {
+    uint64_t hash[THETA32_BATCH];
+
+    for (size_t base = 0; base < n; base += THETA32_BATCH) {
+        const size_t b = n - base < THETA32_BATCH ? n - base : THETA32_BATCH;
+
+        for (size_t i = 0; i < b; i++) {
+            hash[i] = Theta32_hash(f, keys[base + i], lens[base + i]);
+        }
+        Theta32_add_hashes(f, hash, b);
+    }
+}
+
+/* The estimated count of distinct keys added */
+static double Theta32_estimate(const struct theta32 *f) {
+    return theta32_estimate(f->n, f->theta);
+}
+
+static size_t Theta32_bytes(const struct theta32 *f) {
+    return (f->slots + f->limit) * sizeof(uint64_t);
+}
+
+/*------------------------------------------------------------ */
+
+/* Theta32 compact sketch functions */
+
+/* Set c to the sketch's hashes in order.
+ * Returns 0 or a negative THETA32_ERR code.
+ */
+static int Theta32_compact(const struct theta32 *f, struct theta32_compact *c) {
+    size_t m = 0;
+
+    c->hashes = (uint64_t *)malloc((f->n != 0 ? f->n : 1) * sizeof(uint64_t));
+    if (c->hashes == NULL) {
+        return THETA32_ERR_MEMORY;
+    }
+    for (size_t s = 0; s < f->slots; s++) {
+        if (f->table[s] != 0) {
+            c->hashes[m++] = f->table[s];
+        }
+    }
+    qsort(c->hashes, m, sizeof(uint64_t), theta32_compare);
+    c->n = m;
+    c->theta = f->theta;
+    c->seed = f->seed;
+    return 0;
+}
+
+static void Theta32_compact_free(struct theta32_compact *c) {
+    free(c->hashes);
+    c->hashes = NULL;
+    c->n = 0;
+}
+
+static double Theta32_compact_estimate(const struct theta32_compact *c) {
+    return theta32_estimate(c->n, c->theta);
+}
+
+/* Set out to a sketch of the union of a's and b's keys, keeping at most
+ * the k smallest hashes.  out may be a or b, and is otherwise new.
+ * Returns 0 or a negative THETA32_ERR code.
+ */
+static int Theta32_union(struct theta32_compact *out, const struct theta32_compact *a,
+                         const struct theta32_compact *b, const size_t k) {
+    struct theta32_compact r;
+    size_t i = 0, j = 0;
+
+    if (a->seed != b->seed) {
+        return THETA32_ERR_MISMATCH;
+    }
+    if (k == 0) {
+        return THETA32_ERR_SIZE;
+    }
+    r.hashes = (uint64_t *)malloc((a->n + b->n + 1) * sizeof(uint64_t));
+    if (r.hashes == NULL) {
+        return THETA32_ERR_MEMORY;
+    }
+    r.n = 0;
+    r.theta = a->theta < b->theta ? a->theta : b->theta;
+    r.seed = a->seed;
+    /* Merge up to theta, then drop it to the k + 1st if there are more */
+    while (i < a->n || j < b->n) {
+        const uint64_t x = i < a->n ? a->hashes[i] : UINT64_MAX;
+        const uint64_t y = j < b->n ? b->hashes[j] : UINT64_MAX;
+        const uint64_t h = x < y ? x : y;
+
+        if (h >= r.theta) {
+            break;
+        }
+        if (r.n == k) {
+            r.theta = h;
+            break;
+        }
+        r.hashes[r.n++] = h;
+        i += x == h;
+        j += y == h;
+    }
+    theta32_result(out, a, b, &r);
+    return 0;
+}
+
+/* Set out to a sketch of the keys both in a and in b.  out may be a or
+ * b, and is otherwise new.
+ * Returns 0 or a negative THETA32_ERR code.
+ */
+static int Theta32_intersect(struct theta32_compact *out, const struct theta32_compact *a,
+                             const struct theta32_compact *b) {
+    struct theta32_compact r;
+    size_t i = 0, j = 0;
+
+    if (a->seed != b->seed) {
+        return THETA32_ERR_MISMATCH;
+    }
+    r.hashes = (uint64_t *)malloc(((a->n < b->n ? a->n : b->n) + 1) * sizeof(uint64_t));
+    if (r.hashes == NULL) {
+        return THETA32_ERR_MEMORY;
+    }
+    r.n = 0;
+    r.theta = a->theta < b->theta ? a->theta : b->theta;
+    r.seed = a->seed;
+    while (i < a->n && j < b->n && a->hashes[i] < r.theta && b->hashes[j] < r.theta) {
+        if (a->hashes[i] < b->hashes[j]) {
+            i++;
+        } else if (a->hashes[i] > b->hashes[j]) {
+            j++;
+        } else {
+            r.hashes[r.n++] = a->hashes[i];
+            i++;
+            j++;
+        }
+    }
+    theta32_result(out, a, b, &r);
+    return 0;
+}
+
+/* Set out to a sketch of the keys in a but not in b.  out may be a or b,
+ * and is otherwise new.
+ * Returns 0 or a negative THETA32_ERR code.
+ */
+static int Theta32_a_not_b(struct theta32_compact *out, const struct theta32_compact *a,
+                           const struct theta32_compact *b) {
+    struct theta32_compact r;
+    size_t i = 0, j = 0;
+
+    if (a->seed != b->seed) {
+        return THETA32_ERR_MISMATCH;
+    }
+    r.hashes = (uint64_t *)malloc((a->n + 1) * sizeof(uint64_t));
+    if (r.hashes == NULL) {
+        return THETA32_ERR_MEMORY;
+    }
+    r.n = 0;
+    r.theta = a->theta < b->theta ? a->theta : b->theta;
+    r.seed = a->seed;
+    for (; i < a->n && a->hashes[i] < r.theta; i++) {
+        while (j < b->n && b->hashes[j] < a->hashes[i]) {
+            j++;
+        }
+        if (j == b->n || b->hashes[j] != a->hashes[i]) {
+            r.hashes[r.n++] = a->hashes[i];
+        }
+    }
+    theta32_result(out, a, b, &r);
+    return 0;
+}
+
+/* Bytes Theta32_store writes for c */
+static size_t Theta32_stored_size(const struct theta32_compact *c) {
+    return sizeof(struct theta32_header) + c->n * sizeof(uint64_t);
+}
+
+/* Write c to out, of Theta32_stored_size(c) bytes, and return how many */
+static size_t Theta32_store(const struct theta32_compact *c, void *out) {
+    struct theta32_header h;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, theta32_magic, sizeof(h.magic));
+    h.format = THETA32_FORMAT;
+    h.byte_order = THETA32_BYTE_ORDER;
+    h.combo32_version = COMBO32_VERSION;
+    h.combo32_threshold = COMBO32_THRESHOLD;
+    h.seed = c->seed;
+    h.theta = c->theta;
+    h.n = c->n;
+    memcpy(out, &h, sizeof(h));
+    memcpy((uint8_t *)out + sizeof(h), c->hashes, c->n * sizeof(uint64_t));
+    return Theta32_stored_size(c);
+}
+
+/* Set c to a new copy of the sketch Theta32_store wrote to in, of size
+ * bytes.
+ * Returns 0 or a negative THETA32_ERR code.
+ */
+static int Theta32_load(struct theta32_compact *c, const void *in, const size_t size) {
+    struct theta32_header h;
+
+    if (size < sizeof(h)) {
+        return THETA32_ERR_FORMAT;
+    }
+    memcpy(&h, in, sizeof(h));
+    if (memcmp(h.magic, theta32_magic, sizeof(h.magic)) != 0 || h.format != THETA32_FORMAT ||
+        h.byte_order != THETA32_BYTE_ORDER || h.n > (size - sizeof(h)) / sizeof(uint64_t)) {
+        return THETA32_ERR_FORMAT;
+    }
+    if (h.combo32_version != COMBO32_VERSION || h.combo32_threshold != COMBO32_THRESHOLD) {
+        return THETA32_ERR_HASHER;
+    }
+    c->hashes = (uint64_t *)malloc(((size_t)h.n + 1) * sizeof(uint64_t));
+    if (c->hashes == NULL) {
+        return THETA32_ERR_MEMORY;
+    }
+    memcpy(c->hashes, (const uint8_t *)in + sizeof(h), (size_t)h.n * sizeof(uint64_t));
+    /* The combining functions rely on the order */
+    for (size_t i = 0; i < h.n; i++) {
+        if (!theta32_keeps(c->hashes[i], h.theta) || (i != 0 && c->hashes[i] <= c->hashes[i - 1])) {
+            Theta32_compact_free(c);
+            return THETA32_ERR_FORMAT;
+        }
+    }
+    c->n = (size_t)h.n;
+    c->theta = h.theta;
+    c->seed = h.seed;
+    return 0;
+}
+
+#endif /* THETA32_H */
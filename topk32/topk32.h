@@ -0,0 +1,487 @@
+/*
+ * Topk32 version 1.0
+ * Copyright (c) 2022 David W. Gero
+ *
+ * This file is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A SpaceSaving tracker of the k most frequent byte strings in a stream,
+ * written in C.
+ * It finds a key's counter through an open-addressing table of hashes and
+ * counter numbers keyed by the key's Combo32 hash, and keeps the copies of
+ * the keys in an array of their own, read only when a hash matches.  An
+ * update of a tracked key is one hash, one probe, one key compare and an
+ * add to the counter.  The least count is found through a min-heap of the
+ * counts as they were when last looked at: counts only grow, so an entry
+ * is at most its counter's count, and the least is at the top once the
+ * top entry is brought up to date and sifted down until it stays.  A key
+ * without a counter takes over that one, whose count it inherits as its
+ * error.  Trackers of the same size and seed merge, so each thread can
+ * keep its own.
+ */
+
+#ifndef TOPK32_H
+#define TOPK32_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "combo32.h"
+
+/* Bytes of each key kept and compared; longer keys that agree in these,
+ * their length and their hash share a counter
+ */
+#ifndef TOPK32_KEY_MAX
+#define TOPK32_KEY_MAX 48
+#endif
+
+/* Errors; all are negative */
+#define TOPK32_ERR_MEMORY   -1
+#define TOPK32_ERR_SIZE     -2     /* k 0 or too large */
+#define TOPK32_ERR_MISMATCH -3     /* merging trackers of another size or seed */
+
+struct topk32_counter {
+    uint64_t count;
+    uint64_t error;                /* at most how much the count overstates the key's */
+    uint32_t hash;
+    uint32_t len;
+    uint32_t slot;                 /* in the table */
+};
+
+/* A counter in the heap, with its count when it was last put there */
+struct topk32_entry {
+    uint64_t count;
+    uint32_t counter;
+};
+
+struct topk32_slot {
+    uint32_t hash;
+    uint32_t counter;              /* counter number + 1, 0 if free */
+};
+
+struct topk32 {
+    struct topk32_counter *counters;
+    uint8_t *keys;                 /* TOPK32_KEY_MAX bytes per counter */
+    struct topk32_entry *heap;     /* least count first */
+    struct topk32_slot *table;
+    uint32_t mask;                 /* table slots - 1 */
+    uint32_t k;
+    uint32_t size;                 /* counters in use */
+    uint64_t total;                /* sum of the weights added */
+    uint64_t seed;
+};
+
+/* One of the most frequent keys, as Topk32_list reports them */
+struct topk32_item {
+    const uint8_t *key;            /* the first TOPK32_KEY_MAX bytes */
+    size_t len;
+    uint64_t count;
+    uint64_t error;
+};
+
+/*------------------------------------------------------------ */
+
+/* Topk32 helpers */
+
+/* A counter with its key, while merging */
+struct topk32_merged {
+    struct topk32_counter c;
+    uint8_t key[TOPK32_KEY_MAX];
+};
+
+static inline uint32_t topk32_home(const struct topk32 *t, const uint32_t hash) {
+    return (hash * UINT32_C(0x9E3779B1)) & t->mask;
+}
+
+static inline uint8_t *topk32_key(const struct topk32 *t, const uint32_t c) {
+    return t->keys + (size_t)c * TOPK32_KEY_MAX;
+}
+
+/* The table slot holding the key's counter, or the free slot ending its
+ * probe sequence
+ */
+static inline uint32_t topk32_find(const struct topk32 *t, const uint32_t hash,
+                                   const void *key, const size_t len) {
+    const size_t cmp = len < TOPK32_KEY_MAX ? len : TOPK32_KEY_MAX;
+    uint32_t s = topk32_home(t, hash);
+
+    for (;; s = (s + 1) & t->mask) {
+        const struct topk32_slot *e = &t->table[s];
+
+        if (e->counter == 0) {
+            return s;
+        }
+        if (e->hash == hash && t->counters[e->counter - 1].len == len &&
+            memcmp(topk32_key(t, e->counter - 1), key, cmp) == 0) {
+            return s;
+        }
+    }
+}
+
+/* Free table slot s, moving back the entries after it that may */
+static void topk32_table_remove(struct topk32 *t, uint32_t s) {
+    uint32_t next = (s + 1) & t->mask;
+
+    while (t->table[next].counter != 0) {
+        const uint32_t home = topk32_home(t, t->table[next].hash);
+
+        /* The entry may move to s unless its home is in (s, next] */
+        if (((next - home) & t->mask) >= ((next - s) & t->mask)) {
+            t->table[s] = t->table[next];
+            t->counters[t->table[s].counter - 1].slot = s;
+            s = next;
+        }
+        next = (next + 1) & t->mask;
+    }
+    t->table[s].counter = 0;
+}
+
+/* Move heap entry i down past smaller counts */
+static void topk32_sift_down(struct topk32 *t, uint32_t i) {
+    const struct topk32_entry e = t->heap[i];
+
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+
+        if (child >= t->size) {
+            break;
+        }
+        if (child + 1 < t->size && t->heap[child + 1].count < t->heap[child].count) {
+            child++;
+        }
+        if (t->heap[child].count >= e.count) {
+            break;
+        }
+        t->heap[i] = t->heap[child];
+        i = child;
+    }
+    t->heap[i] = e;
+}
+
+/* Move heap entry i, just added, up past larger counts */
+static void topk32_sift_up(struct topk32 *t, uint32_t i) {
+    const struct topk32_entry e = t->heap[i];
+
+    while (i > 0 && t->heap[(i - 1) / 2].count > e.count) {
+        t->heap[i] = t->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    t->heap[i] = e;
+}
+
+/* Give counter c the key, and put it in the table at slot s */
+static inline void topk32_take(struct topk32 *t, const uint32_t c, const uint32_t s,
+                               const uint32_t hash, const void *key, const size_t len) {
+    struct topk32_counter *e = &t->counters[c];
+
+    e->hash = hash;
+    e->len = (uint32_t)len;
+    e->slot = s;
+    memcpy(topk32_key(t, c), key, len < TOPK32_KEY_MAX ? len : TOPK32_KEY_MAX);
+    t->table[s].hash = hash;
+    t->table[s].counter = c + 1;
+}
+
+/* Give a key without a counter one, at free table slot s: a spare
+ * counter while there is one, else the counter of the least count,
+ * which the key inherits as its error.  The old key's slot is freed
+ * after the new key goes in, which may move the new one back.
+ */
+static void topk32_insert(struct topk32 *t, const uint32_t s, const uint32_t hash,
+                          const void *key, const size_t len, const uint64_t w) {
+    struct topk32_counter *e;
+    uint32_t c;
+
+    if (t->size < t->k) {
+        c = t->size++;
+        e = &t->counters[c];
+        topk32_take(t, c, s, hash, key, len);
+        e->count = w;
+        e->error = 0;
+        t->heap[c].count = w;
+        t->heap[c].counter = c;
+        topk32_sift_up(t, c);
+        return;
+    }
+    /* Bring the top entry up to date until one was already */
+    while (t->heap[0].count != t->counters[t->heap[0].counter].count) {
+        t->heap[0].count = t->counters[t->heap[0].counter].count;
+        topk32_sift_down(t, 0);
+    }
+    c = t->heap[0].counter;
+    e = &t->counters[c];
+    {
+        const uint32_t old = e->slot;
+
+        topk32_take(t, c, s, hash, key, len);
+        topk32_table_remove(t, old);
+    }
+    e->error = e->count;
+    e->count += w;
+    t->heap[0].count = e->count;
+    topk32_sift_down(t, 0);
+}
+
+/* The least count, once the tracker is full */
+static uint64_t topk32_least(const struct topk32 *t) {
+    uint64_t least = UINT64_MAX;
+
+    for (uint32_t c = 0; c < t->size; c++) {
+        least = t->counters[c].count < least ? t->counters[c].count : least;
+    }
+    return least;
+}
+
+/* Forget every key */
+static void topk32_reset(struct topk32 *t) {
+    memset(t->table, 0, ((size_t)t->mask + 1) * sizeof(struct topk32_slot));
+    t->size = 0;
+}
+
+static int topk32_compare_merged(const void *a, const void *b) {
+    const uint64_t x = ((const struct topk32_merged *)a)->c.count;
+    const uint64_t y = ((const struct topk32_merged *)b)->c.count;
+
+    return (x < y) - (x > y);
+}
+
+/* Move item i of a min-heap of n items down past smaller counts */
+static void topk32_item_sift(struct topk32_item *a, const size_t n, size_t i) {
+    const struct topk32_item e = a[i];
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n && a[child + 1].count < a[child].count) {
+            child++;
+        }
+        if (a[child].count >= e.count) {
+            break;
+        }
+        a[i] = a[child];
+        i = child;
+    }
+    a[i] = e;
+}
+
+/*------------------------------------------------------------ */
+
+/* Topk32 tracker functions */
+
+/* Make an empty tracker of k counters.  A key of count over total / k is
+ * always tracked, and each count overstates the key's by at most its
+ * error, itself at most total / k.
+ * Returns 0 or a negative TOPK32_ERR code.
+ */
+static int Topk32_init(struct topk32 *t, const uint32_t k, const uint64_t seed) {
+    uint32_t slots = 4;
+
+    if (k == 0 || k > UINT32_C(1) << 29) {
+        return TOPK32_ERR_SIZE;
+    }
+    /* At most half full */
+    while (slots < 2 * k) {
+        slots *= 2;
+    }
+    t->counters = (struct topk32_counter *)malloc(k * sizeof(struct topk32_counter));
+    t->keys = (uint8_t *)malloc((size_t)k * TOPK32_KEY_MAX);
+    t->heap = (struct topk32_entry *)malloc(k * sizeof(struct topk32_entry));
+    t->table = (struct topk32_slot *)malloc(slots * sizeof(struct topk32_slot));
+    if (t->counters == NULL || t->keys == NULL || t->heap == NULL || t->table == NULL) {
+        free(t->counters);
+        free(t->keys);
+        free(t->heap);
+        free(t->table);
+        return TOPK32_ERR_MEMORY;
+    }
+    t->mask = slots - 1;
+    t->k = k;
+    t->total = 0;
+    t->seed = seed;
+    topk32_reset(t);
+    return 0;
+}
+
+static void Topk32_free(struct topk32 *t) {
+    free(t->counters);
+    free(t->keys);
+    free(t->heap);
+    free(t->table);
+    t->counters = NULL;
+    t->keys = NULL;
+    t->heap = NULL;
+    t->table = NULL;
+    t->size = 0;
+}
+
+static void Topk32_clear(struct topk32 *t) {
+    topk32_reset(t);
+    t->total = 0;
+}
+
+static inline uint32_t Topk32_hash(const struct topk32 *t, const void *key, const size_t len) {
+    return Combo32(key, len, t->seed);
+}
+
+/* Add weight w, at least 1, to a key by its Topk32_hash */
+static inline void Topk32_add_hash(struct topk32 *t, const uint32_t hash, const void *key,
+                                   const size_t len, const uint64_t w) {
+    const uint32_t s = topk32_find(t, hash, key, len);
+
+    t->total += w;
+    if (likely(t->table[s].counter != 0)) {
+        t->counters[t->table[s].counter - 1].count += w;
+    } else {
+        topk32_insert(t, s, hash, key, len, w);
+    }
+}
+
+static inline void Topk32_add(struct topk32 *t, const void *key, const size_t len,
+                              const uint64_t w) {
+    Topk32_add_hash(t, Topk32_hash(t, key, len), key, len, w);
+}
+
+/* The key's count, at least its true count if it is tracked, else 0;
+ * *error, if not NULL, gets how much it may overstate it by
+ */
+static uint64_t Topk32_count(const struct topk32 *t, const void *key, const size_t len,
+                             uint64_t *error) {
+    const uint32_t s = topk32_find(t, Topk32_hash(t, key, len), key, len);
+    const struct topk32_counter *e =
+        t->table[s].counter != 0 ? &t->counters[t->table[s].counter - 1] : NULL;
+
+    if (error != NULL) {
+        *error = e != NULL ? e->error : 0;
+    }
+    return e != NULL ? e->count : 0;
+}
+
+/* Set out to the up to max tracked keys of the highest counts, highest
+ * first, and return how many were set.  The keys point into the tracker
+ * and stay valid until it next changes.
+ */
+static size_t Topk32_list(const struct topk32 *t, struct topk32_item *out, const size_t max) {
+    const size_t n = max < t->size ? max : t->size;
+
+    /* Keep the n highest in out as a min-heap, then sort it in place,
+     * which leaves the highest first
+     */
+    for (uint32_t c = 0; c < t->size; c++) {
+        struct topk32_item item;
+
+        item.key = topk32_key(t, c);
+        item.len = t->counters[c].len;
+        item.count = t->counters[c].count;
+        item.error = t->counters[c].error;
+        if (c < n) {
+            out[c] = item;
+            if (c + 1 == n) {
+                for (size_t i = n / 2; i-- > 0;) {
+                    topk32_item_sift(out, n, i);
+                }
+            }
+        } else if (n != 0 && item.count > out[0].count) {
+            out[0] = item;
+            topk32_item_sift(out, n, 0);
+        }
+    }
+    for (size_t end = n; end-- > 1;) {
+        const struct topk32_item least = out[0];
+
+        out[0] = out[end];
+        out[end] = least;
+        topk32_item_sift(out, end, 0);
+    }
+    return n;
+}
+
+/* Merge src into dst, which then tracks the most frequent keys of both
+ * streams with the same guarantees.  A key tracked in only one of them
+ * gets the other's least count added, as the most it can have had there.
+ * Returns 0 or a negative TOPK32_ERR code.
+ */
+static int Topk32_merge(struct topk32 *dst, const struct topk32 *src) {
+    const uint64_t dst_min = dst->size == dst->k ? topk32_least(dst) : 0;
+    const uint64_t src_min = src->size == src->k ? topk32_least(src) : 0;
+    struct topk32_merged *all;
+    size_t n = 0;
+
+    if (dst->k != src->k || dst->seed != src->seed) {
+        return TOPK32_ERR_MISMATCH;
+    }
+    all = (struct topk32_merged *)malloc(((size_t)dst->size + src->size + 1) *
+                                         sizeof(struct topk32_merged));
+    if (all == NULL) {
+        return TOPK32_ERR_MEMORY;
+    }
+    for (uint32_t c = 0; c < dst->size; c++) {
+        const struct topk32_counter *e = &dst->counters[c];
+        const uint8_t *key = topk32_key(dst, c);
+        const uint32_t s = topk32_find(src, e->hash, key, e->len);
+
+        all[n].c = *e;
+        memcpy(all[n].key, key, TOPK32_KEY_MAX);
+        if (src->table[s].counter != 0) {
+            const struct topk32_counter *o = &src->counters[src->table[s].counter - 1];
+
+            all[n].c.count += o->count;
+            all[n].c.error += o->error;
+        } else {
+            all[n].c.count += src_min;
+            all[n].c.error += src_min;
+        }
+        n++;
+    }
+    for (uint32_t c = 0; c < src->size; c++) {
+        const struct topk32_counter *e = &src->counters[c];
+        const uint8_t *key = topk32_key(src, c);
+
+        if (dst->table[topk32_find(dst, e->hash, key, e->len)].counter == 0) {
+            all[n].c = *e;
+            memcpy(all[n].key, key, TOPK32_KEY_MAX);
+            all[n].c.count += dst_min;
+            all[n].c.error += dst_min;
+            n++;
+        }
+    }
+    /* Keep the k highest, and put them back least first, which makes
+     * the heap array sorted and so a heap
+     */
+    qsort(all, n, sizeof(struct topk32_merged), topk32_compare_merged);
+    n = n < dst->k ? n : dst->k;
+    topk32_reset(dst);
+    for (size_t i = n; i-- > 0;) {
+        const struct topk32_counter *e = &all[i].c;
+        const uint32_t c = dst->size++;
+
+        topk32_take(dst, c, topk32_find(dst, e->hash, all[i].key, e->len), e->hash,
+                    all[i].key, e->len);
+        dst->counters[c].count = e->count;
+        dst->counters[c].error = e->error;
+        dst->heap[c].count = e->count;
+        dst->heap[c].counter = c;
+    }
+    dst->total += src->total;
+    free(all);
+    return 0;
+}
+
+#endif /* TOPK32_H */